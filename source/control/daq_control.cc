@@ -9,6 +9,7 @@
 
 #include "butterfly_house.hh"
 #include "psyllid_error.hh"
+#include "receiver_stats_house.hh"
 
 #include "message_relayer.hh"
 
@@ -245,6 +246,16 @@ namespace psyllid
         return a_request->reply( dripline::dl_success(), "Use Monarch request completed", std::move(t_payload_ptr) );
     }
 
+    dripline::reply_ptr_t daq_control::handle_get_status_request( const dripline::request_ptr_t a_request )
+    {
+        dripline::reply_ptr_t t_reply = sandfly::run_control::handle_get_status_request( a_request );
+        if( t_reply->payload().is_node() )
+        {
+            t_reply->payload().as_node().add( "receiver-stats", receiver_stats_house::get_instance()->get_stats() );
+        }
+        return t_reply;
+    }
+
 
     void daq_control::derived_register_handlers( std::shared_ptr< sandfly::request_receiver > a_receiver_ptr )
     {
@@ -257,6 +268,8 @@ namespace psyllid
         a_receiver_ptr->register_get_handler( "filename", std::bind( &daq_control::handle_get_filename_request, this, _1 ) );
         a_receiver_ptr->register_get_handler( "description", std::bind( &daq_control::handle_get_description_request, this, _1 ) );
         a_receiver_ptr->register_get_handler( "use-monarch", std::bind( &daq_control::handle_get_use_monarch_request, this, _1 ) );
+        // replaces run_control's handler
+        a_receiver_ptr->register_get_handler( "daq-status", std::bind( &daq_control::handle_get_status_request, this, _1 ) );
 
         // add set request handlers
         a_receiver_ptr->register_set_handler( "filename", std::bind( &daq_control::handle_set_filename_request, this, _1 ) );
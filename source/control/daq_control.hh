@@ -50,6 +50,9 @@ namespace psyllid
             dripline::reply_ptr_t handle_get_description_request( const dripline::request_ptr_t a_request );
             dripline::reply_ptr_t handle_get_use_monarch_request( const dripline::request_ptr_t a_request );
 
+            /// Adds the packet receivers' statistics to run_control's status reply
+            dripline::reply_ptr_t handle_get_status_request( const dripline::request_ptr_t a_request );
+
         protected:
             virtual void derived_register_handlers( std::shared_ptr< sandfly::request_receiver > a_receiver_ptr );
 
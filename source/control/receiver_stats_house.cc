@@ -0,0 +1,47 @@
+/*
+ * receiver_stats_house.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "receiver_stats_house.hh"
+
+#include "logger.hh"
+
+
+namespace psyllid
+{
+    LOGGER( plog, "receiver_stats_house" );
+
+
+    receiver_stats_house::receiver_stats_house() :
+            f_stats(),
+            f_house_mutex()
+    {
+        LDEBUG( plog, "Receiver stats house has been built" );
+    }
+
+    receiver_stats_house::~receiver_stats_house()
+    {
+    }
+
+    void receiver_stats_house::post( const std::string& a_name, const scarab::param_node& a_stats )
+    {
+        std::unique_lock< std::mutex > t_lock( f_house_mutex );
+        f_stats[ a_name ] = a_stats;
+        return;
+    }
+
+    scarab::param_node receiver_stats_house::get_stats() const
+    {
+        std::unique_lock< std::mutex > t_lock( f_house_mutex );
+        scarab::param_node t_stats;
+        for( auto t_stats_it = f_stats.begin(); t_stats_it != f_stats.end(); ++t_stats_it )
+        {
+            t_stats.add( t_stats_it->first, t_stats_it->second );
+        }
+        return t_stats;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,54 @@
+/*
+ * receiver_stats_house.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: N.S. Oblath
+ */
+
+#ifndef PSYLLID_RECEIVER_STATS_HOUSE_HH_
+#define PSYLLID_RECEIVER_STATS_HOUSE_HH_
+
+#include "param.hh"
+#include "singleton.hh"
+
+#include <map>
+#include <mutex>
+
+namespace psyllid
+{
+
+    /*!
+     @class receiver_stats_house
+     @author N. S. Oblath
+
+     @brief Holds the latest statistics posted by the packet receivers so that they can be reported by daq_control.
+
+     @details
+     Receivers post a snapshot of their statistics under their node name; a later post from the same node replaces the earlier one.
+     All function calls are thread-safe.
+     */
+    class receiver_stats_house : public scarab::singleton< receiver_stats_house >
+    {
+        public:
+            void post( const std::string& a_name, const scarab::param_node& a_stats );
+
+            /// Returns a node with one entry per receiver
+            scarab::param_node get_stats() const;
+
+        private:
+            std::map< std::string, scarab::param_node > f_stats;
+
+            mutable std::mutex f_house_mutex;
+
+        private:
+            friend class scarab::singleton< receiver_stats_house >;
+            friend class scarab::destroyer< receiver_stats_house >;
+
+            receiver_stats_house();
+            virtual ~receiver_stats_house();
+
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_RECEIVER_STATS_HOUSE_HH_ */
@@ -12,6 +12,7 @@
 
 #include "id_range_event.hh"
 #include "node_builder.hh"
+#include "packet_batch.hh"
 #include "trigger_flag.hh"
 
 #include "logger.hh"
@@ -24,7 +25,7 @@ namespace psyllid
     LOGGER( eblog_hdr, "event_builder_h" );
 
     /*!
-     @class event_builder
+     @class _event_builder
      @author N. S. Oblath
 
      @brief A transformer that considers a sequence of triggered packets and decides what constitutes a contiguous event
@@ -46,12 +47,16 @@ namespace psyllid
      Events are built by switching some untriggered packets to triggered packets according to the pretrigger and skip-tolerance parameters.
      Contiguous sequences of triggered packets constitute events.
 
+     The event builder takes either single trigger flags (event_builder) or batches of flags (event_batch_builder, for use with
+     frequency_mask_batch_trigger).  The batched builder outputs batches of the same capacity as its input; because of the pretrigger
+     the flags in an output batch are not the ones of an input batch, and a partly filled batch is output at the end of each input batch.
+
      Parameter setting is not thread-safe.  Executing is thread-safe.
 
      The cofigurable value "time-length" in the tf_roach_receiver must be set to a value greater than "pretrigger" and "skip-tolerance" (+5 is advised).
      Otherwise the time domain buffer gets filled and blocks further packet processing.
 
-     Node type: "packet-receiver-socket"
+     Node types: "event-builder" (single flags), "event-batch-builder" (batches)
 
      Available configuration values:
      - "length": uint -- The size of the output buffer
@@ -60,20 +65,21 @@ namespace psyllid
      - "n-triggers": uint -- Number of trigger flags with flag == true required before switching to triggered state
 
      Input Streams:
-     - 1: trigger_flag
+     - 0: trigger_flag or trigger_flag_batch
 
      Output Streams:
-     - 0: trigger_flag
+     - 0: trigger_flag or trigger_flag_batch
     */
-    class event_builder :
-            public midge::_transformer< midge::type_list< trigger_flag >, midge::type_list< trigger_flag > >
+    template< class x_flag_type >
+    class _event_builder :
+            public midge::_transformer< midge::type_list< x_flag_type >, midge::type_list< x_flag_type > >
     {
         public:
             typedef boost::circular_buffer< uint64_t > pretrigger_buffer_t;
 
         public:
-            event_builder();
-            virtual ~event_builder();
+            _event_builder();
+            virtual ~_event_builder();
 
         public:
 
@@ -95,8 +101,12 @@ namespace psyllid
             const pretrigger_buffer_t& skip_buffer() const;
 
         private:
-            bool write_output_from_ptbuff_front( bool a_flag, trigger_flag* a_data );
-            bool write_output_from_skipbuff_front( bool a_flag, trigger_flag* a_data );
+            bool write_output_from_ptbuff_front( bool a_flag );
+            bool write_output_from_skipbuff_front( bool a_flag );
+            /// Adds a flag to the output; the output slot is written when it's full (always, for single flags)
+            bool write_output( uint64_t a_id, bool a_flag );
+            /// Writes the output slot if it has any flags in it
+            bool flush_output();
             void advance_output_stream( trigger_flag* a_write_flag, uint64_t a_id, bool a_trig_flag );
 
             enum class state_t { untriggered, triggered, skipping, collecting_triggers };
@@ -105,62 +115,91 @@ namespace psyllid
             pretrigger_buffer_t f_pretrigger_buffer;
             pretrigger_buffer_t f_skip_buffer;
 
+            unsigned f_n_out; // flags in the current output slot
+            unsigned f_out_capacity;
+
     };
 
+    typedef _event_builder< trigger_flag > event_builder;
+    typedef _event_builder< trigger_flag_batch > event_batch_builder;
+
 
-    inline bool event_builder::is_triggered() const
+    template< class x_flag_type >
+    inline bool _event_builder< x_flag_type >::is_triggered() const
     {
         return f_state == state_t::triggered;
     }
 
-    inline const event_builder::pretrigger_buffer_t& event_builder::pretrigger_buffer() const
+    template< class x_flag_type >
+    inline const typename _event_builder< x_flag_type >::pretrigger_buffer_t& _event_builder< x_flag_type >::pretrigger_buffer() const
     {
         return f_pretrigger_buffer;
     }
-    inline const event_builder::pretrigger_buffer_t& event_builder::skip_buffer() const
+    template< class x_flag_type >
+    inline const typename _event_builder< x_flag_type >::pretrigger_buffer_t& _event_builder< x_flag_type >::skip_buffer() const
     {
         return f_skip_buffer;
     }
 
-    inline bool event_builder::write_output_from_ptbuff_front( bool a_flag, trigger_flag* a_data )
+    template< class x_flag_type >
+    inline bool _event_builder< x_flag_type >::write_output_from_ptbuff_front( bool a_flag )
     {
-        a_data->set_id( f_pretrigger_buffer.front() );
-        a_data->set_flag( a_flag );
-        LTRACE( eblog_hdr, "Event builder writing data to the output stream at index " << out_stream< 0 >().get_current_index() );
-        if( ! out_stream< 0 >().set( midge::stream::s_run ) )
-        {
-            LERROR( eblog_hdr, "Exiting due to stream error" );
-            return false;
-        }
+        if( ! write_output( f_pretrigger_buffer.front(), a_flag ) ) return false;
         f_pretrigger_buffer.pop_front();
         return true;
     }
 
-    inline bool event_builder::write_output_from_skipbuff_front( bool a_flag, trigger_flag* a_data )
+    template< class x_flag_type >
+    inline bool _event_builder< x_flag_type >::write_output_from_skipbuff_front( bool a_flag )
     {
-        a_data->set_id( f_skip_buffer.front() );
-        a_data->set_flag( a_flag );
-        LTRACE( eblog_hdr, "Event builder writing data to the output stream at index " << out_stream< 0 >().get_current_index() );
-        if( ! out_stream< 0 >().set( midge::stream::s_run ) )
+        if( ! write_output( f_skip_buffer.front(), a_flag ) ) return false;
+        f_skip_buffer.pop_front();
+        return true;
+    }
+
+    template< class x_flag_type >
+    inline bool _event_builder< x_flag_type >::write_output( uint64_t a_id, bool a_flag )
+    {
+        x_flag_type* t_slot = this->template out_stream< 0 >().data();
+        if( f_n_out == 0 ) _slot_traits< x_flag_type >::set_n_packets( *t_slot, f_out_capacity );
+        trigger_flag& t_flag = _slot_traits< x_flag_type >::packet( *t_slot, f_n_out );
+        t_flag.set_id( a_id );
+        t_flag.set_flag( a_flag );
+        ++f_n_out;
+        if( f_n_out < f_out_capacity ) return true;
+        return flush_output();
+    }
+
+    template< class x_flag_type >
+    inline bool _event_builder< x_flag_type >::flush_output()
+    {
+        if( f_n_out == 0 ) return true;
+        _slot_traits< x_flag_type >::set_n_packets( *this->template out_stream< 0 >().data(), f_n_out );
+        f_n_out = 0;
+        LTRACE( eblog_hdr, "Event builder writing data to the output stream at index " << this->template out_stream< 0 >().get_current_index() );
+        if( ! this->template out_stream< 0 >().set( midge::stream::s_run ) )
         {
             LERROR( eblog_hdr, "Exiting due to stream error" );
             return false;
         }
-        f_skip_buffer.pop_front();
         return true;
     }
 
-    class event_builder_binding : public sandfly::_node_binding< event_builder, event_builder_binding >
+    template< class x_flag_type >
+    class _event_builder_binding : public sandfly::_node_binding< _event_builder< x_flag_type >, _event_builder_binding< x_flag_type > >
     {
         public:
-            event_builder_binding();
-            virtual ~event_builder_binding();
+            _event_builder_binding();
+            virtual ~_event_builder_binding();
 
         private:
-            virtual void do_apply_config( event_builder* a_node, const scarab::param_node& a_config ) const;
-            virtual void do_dump_config( const event_builder* a_node, scarab::param_node& a_config ) const;
+            virtual void do_apply_config( _event_builder< x_flag_type >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _event_builder< x_flag_type >* a_node, scarab::param_node& a_config ) const;
     };
 
+    typedef _event_builder_binding< trigger_flag > event_builder_binding;
+    typedef _event_builder_binding< trigger_flag_batch > event_batch_builder_binding;
+
 
 } /* namespace psyllid */
 
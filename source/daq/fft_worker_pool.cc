@@ -0,0 +1,183 @@
+/*
+ * fft_worker_pool.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "fft_worker_pool.hh"
+
+#include "psyllid_error.hh"
+
+namespace psyllid
+{
+
+    fft_worker_pool::fft_worker_pool( std::vector< std::unique_ptr< packet_fft > >&& a_ffts, unsigned a_n_jobs ) :
+            f_batch_size( 0 ),
+            f_values_per_packet( 0 ),
+            f_ffts( std::move( a_ffts ) ),
+            f_replacement_ffts(),
+            f_retired_ffts(),
+            f_jobs(),
+            f_free_jobs(),
+            f_in_flight(),
+            f_next_sequence( 0 ),
+            f_queue(),
+            f_stop( false ),
+            f_mutex(),
+            f_queue_cv(),
+            f_done_cv(),
+            f_workers()
+    {
+        if( f_ffts.empty() || a_n_jobs == 0 )
+        {
+            throw error() << "[fft_worker_pool] The pool needs at least one worker and one job";
+        }
+        f_batch_size = f_ffts.front()->get_batch_size();
+        f_values_per_packet = 2 * f_ffts.front()->get_fft_size();
+        f_replacement_ffts.resize( f_ffts.size() );
+
+        unsigned t_n_values = get_batch_size() * get_values_per_packet();
+        f_jobs.resize( a_n_jobs );
+        for( unsigned i_job = 0; i_job < a_n_jobs; ++i_job )
+        {
+            job& t_job = f_jobs[ i_job ];
+            t_job.f_index = i_job;
+            t_job.f_sequence = 0;
+            t_job.f_n_packets = 0;
+            t_job.f_samples.resize( t_n_values );
+            t_job.f_spectra.resize( t_n_values );
+            t_job.f_done = false;
+        }
+        // hand out the lowest-numbered jobs first
+        for( unsigned i_job = a_n_jobs; i_job > 0; --i_job )
+        {
+            f_free_jobs.push_back( &f_jobs[ i_job - 1 ] );
+        }
+
+        for( unsigned i_worker = 0; i_worker < f_ffts.size(); ++i_worker )
+        {
+            f_workers.emplace_back( &fft_worker_pool::run_worker, this, i_worker );
+        }
+    }
+
+    fft_worker_pool::~fft_worker_pool()
+    {
+        {
+            std::unique_lock< std::mutex > t_lock( f_mutex );
+            f_stop = true;
+        }
+        f_queue_cv.notify_all();
+        for( std::thread& t_worker : f_workers )
+        {
+            t_worker.join();
+        }
+    }
+
+    fft_worker_pool::job* fft_worker_pool::get_free_job()
+    {
+        if( f_free_jobs.empty() ) return nullptr;
+        job* t_job = f_free_jobs.back();
+        f_free_jobs.pop_back();
+        t_job->f_n_packets = 0;
+        return t_job;
+    }
+
+    void fft_worker_pool::submit( job* a_job )
+    {
+        a_job->f_sequence = f_next_sequence++;
+        f_in_flight.push_back( a_job );
+
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        if( a_job->f_n_packets == 0 )
+        {
+            a_job->f_done = true;
+            return;
+        }
+        a_job->f_done = false;
+        f_queue.push_back( a_job );
+        t_lock.unlock();
+        f_queue_cv.notify_one();
+        return;
+    }
+
+    fft_worker_pool::job* fft_worker_pool::next_done( bool a_wait )
+    {
+        if( f_in_flight.empty() ) return nullptr;
+
+        job* t_oldest = f_in_flight.front();
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        if( a_wait )
+        {
+            f_done_cv.wait( t_lock, [t_oldest](){ return t_oldest->f_done; } );
+        }
+        else if( ! t_oldest->f_done )
+        {
+            return nullptr;
+        }
+        t_lock.unlock();
+
+        f_in_flight.pop_front();
+        return t_oldest;
+    }
+
+    void fft_worker_pool::release( job* a_job )
+    {
+        f_free_jobs.push_back( a_job );
+        return;
+    }
+
+    void fft_worker_pool::replace_ffts( std::vector< std::unique_ptr< packet_fft > >&& a_ffts )
+    {
+        if( a_ffts.size() != f_ffts.size() )
+        {
+            throw error() << "[fft_worker_pool] Replacing " << f_ffts.size() << " FFTs with " << a_ffts.size();
+        }
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        for( unsigned i_worker = 0; i_worker < a_ffts.size(); ++i_worker )
+        {
+            // a replacement that was never picked up is simply superseded
+            if( f_replacement_ffts[ i_worker ] ) f_retired_ffts.push_back( std::move( f_replacement_ffts[ i_worker ] ) );
+            f_replacement_ffts[ i_worker ] = std::move( a_ffts[ i_worker ] );
+        }
+        a_ffts.clear();
+        return;
+    }
+
+    void fft_worker_pool::run_worker( unsigned a_index )
+    {
+        unsigned t_n_values = get_values_per_packet();
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        while( true )
+        {
+            f_queue_cv.wait( t_lock, [this](){ return f_stop || ! f_queue.empty(); } );
+            if( f_stop ) return;
+
+            job* t_job = f_queue.front();
+            f_queue.pop_front();
+            if( f_replacement_ffts[ a_index ] )
+            {
+                f_retired_ffts.push_back( std::move( f_ffts[ a_index ] ) );
+                f_ffts[ a_index ] = std::move( f_replacement_ffts[ a_index ] );
+            }
+            packet_fft* t_fft = f_ffts[ a_index ].get();
+            t_lock.unlock();
+
+            for( unsigned i_packet = 0; i_packet < t_job->f_n_packets; ++i_packet )
+            {
+                t_fft->load( i_packet, &t_job->f_samples[ i_packet * t_n_values ] );
+            }
+            t_fft->execute();
+            for( unsigned i_packet = 0; i_packet < t_job->f_n_packets; ++i_packet )
+            {
+                t_fft->unfold( i_packet, &t_job->f_spectra[ i_packet * t_n_values ] );
+            }
+
+            t_lock.lock();
+            t_job->f_done = true;
+            // the owner waits for a particular job, which may not be the one that finished first
+            f_done_cv.notify_all();
+        }
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,132 @@
+/*
+ * fft_worker_pool.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_FFT_WORKER_POOL_HH_
+#define PSYLLID_FFT_WORKER_POOL_HH_
+
+#include "packet_fft.hh"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace psyllid
+{
+
+    /*!
+     @class fft_worker_pool
+     @author N. S. Oblath
+
+     @brief Transforms batches of time packets on a pool of worker threads, and gives the results back in the order they were submitted
+
+     @details
+     Each worker thread has its own packet_fft (plan and arrays).  The owner of the pool fills a job with up to batch-size packets
+     of int8 samples, and submits it; a free worker widens, transforms and unfolds the packets into the job's spectra.  Jobs are
+     numbered as they're submitted, and next_done() hands them back strictly in that order, however the workers finish, so the
+     owner's output stays in the order of its input.
+
+     There are a fixed number of jobs, so there's no allocation once the pool exists.  When all of them are in use, the owner has
+     to wait for the oldest one (next_done( true )) and release it before it can fill another.
+
+     The packet_ffts can be replaced while the pool is running (e.g. by better-tuned plans; see replace_ffts()): each worker
+     switches to its new packet_fft before starting its next job.  The old ones are kept until the pool is destroyed, so that
+     the workers don't wait for the FFTW planner.
+
+     The pool's methods are meant to be called from a single thread (the owner); the workers run until the pool is destroyed.
+    */
+    class fft_worker_pool
+    {
+        public:
+            struct job
+            {
+                unsigned f_index;          // position of the job in the pool, e.g. for the owner's per-job information
+                uint64_t f_sequence;       // submission order
+                unsigned f_n_packets;      // number of packets filled in
+                std::vector< int8_t > f_samples; // input: batch-size packets of 2 * fft-size values
+                std::vector< int8_t > f_spectra; // output: same layout as f_samples
+                bool f_done;
+            };
+
+        public:
+            /// Starts one worker per packet_fft (they must all have the same FFT and batch sizes), with a_n_jobs jobs
+            fft_worker_pool( std::vector< std::unique_ptr< packet_fft > >&& a_ffts, unsigned a_n_jobs );
+            fft_worker_pool( const fft_worker_pool& ) = delete;
+            /// Stops the workers; jobs that are still queued are not transformed
+            ~fft_worker_pool();
+
+            fft_worker_pool& operator=( const fft_worker_pool& ) = delete;
+
+            unsigned get_n_workers() const;
+            unsigned get_batch_size() const;
+            unsigned get_values_per_packet() const;
+
+            /// Returns a job to fill, or nullptr if all of the jobs are in use
+            job* get_free_job();
+
+            /// Queues a filled job for the workers; a job with no packets goes straight to done
+            void submit( job* a_job );
+
+            /// Returns the oldest submitted job if it's done (waiting for it if a_wait is true), or nullptr if it isn't or there are no jobs in flight
+            job* next_done( bool a_wait );
+
+            /// Returns a job from next_done() to the pool
+            void release( job* a_job );
+
+            unsigned get_n_in_flight() const;
+
+            /// Gives each worker a new packet_fft (one per worker, with the same FFT and batch sizes), to be used from its next job
+            void replace_ffts( std::vector< std::unique_ptr< packet_fft > >&& a_ffts );
+
+        private:
+            void run_worker( unsigned a_index );
+
+            unsigned f_batch_size;
+            unsigned f_values_per_packet;
+            std::vector< std::unique_ptr< packet_fft > > f_ffts;
+            std::vector< std::unique_ptr< packet_fft > > f_replacement_ffts;
+            std::vector< std::unique_ptr< packet_fft > > f_retired_ffts;
+            std::vector< job > f_jobs;
+            std::vector< job* > f_free_jobs;   // owner only
+            std::deque< job* > f_in_flight;    // owner only, in submission order
+            uint64_t f_next_sequence;          // owner only
+
+            std::deque< job* > f_queue;
+            bool f_stop;
+            std::mutex f_mutex;
+            std::condition_variable f_queue_cv;
+            std::condition_variable f_done_cv;
+
+            std::vector< std::thread > f_workers;
+    };
+
+    inline unsigned fft_worker_pool::get_n_workers() const
+    {
+        return f_workers.size();
+    }
+
+    inline unsigned fft_worker_pool::get_batch_size() const
+    {
+        return f_batch_size;
+    }
+
+    inline unsigned fft_worker_pool::get_values_per_packet() const
+    {
+        return f_values_per_packet;
+    }
+
+    inline unsigned fft_worker_pool::get_n_in_flight() const
+    {
+        return f_in_flight.size();
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_FFT_WORKER_POOL_HH_ */
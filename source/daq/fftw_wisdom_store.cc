@@ -0,0 +1,126 @@
+/*
+ * fftw_wisdom_store.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "fftw_wisdom_store.hh"
+
+#include "logger.hh"
+
+#include <cctype>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <dirent.h>
+
+namespace psyllid
+{
+    LOGGER( plog, "fftw_wisdom_store" );
+
+    namespace
+    {
+        std::string sanitize( const std::string& a_text )
+        {
+            std::string t_sanitized;
+            for( char t_char : a_text )
+            {
+                bool t_keep = std::isalnum( static_cast< unsigned char >( t_char ) );
+                if( t_keep ) t_sanitized.push_back( t_char );
+                else if( ! t_sanitized.empty() && t_sanitized.back() != '-' ) t_sanitized.push_back( '-' );
+            }
+            while( ! t_sanitized.empty() && t_sanitized.back() == '-' ) t_sanitized.pop_back();
+            return t_sanitized;
+        }
+
+        std::string read_cpu_model()
+        {
+            std::ifstream t_cpuinfo( "/proc/cpuinfo" );
+            std::string t_line;
+            while( std::getline( t_cpuinfo, t_line ) )
+            {
+                if( t_line.compare( 0, 10, "model name" ) != 0 ) continue;
+                std::string::size_type t_colon = t_line.find( ':' );
+                if( t_colon == std::string::npos ) continue;
+                std::string t_model = sanitize( t_line.substr( t_colon + 1 ) );
+                if( ! t_model.empty() ) return t_model;
+            }
+            return "unknown-cpu";
+        }
+    }
+
+    unsigned fftw_wisdom_store::preload( const std::string& a_directory )
+    {
+        static std::mutex s_mutex;
+        static std::set< std::string > s_preloaded;
+
+        std::unique_lock< std::mutex > t_lock( s_mutex );
+        if( ! s_preloaded.insert( a_directory ).second ) return 0;
+
+        DIR* t_dir = ::opendir( a_directory.c_str() );
+        if( t_dir == nullptr )
+        {
+            LWARN( plog, "Unable to open the FFTW wisdom directory <" << a_directory << ">" );
+            return 0;
+        }
+
+        const std::string t_double_prefix = cpu_model() + "_" + packet_fft::precision_name( packet_fft::precision::double_precision ) + "_";
+        const std::string t_single_prefix = cpu_model() + "_" + packet_fft::precision_name( packet_fft::precision::single_precision ) + "_";
+        unsigned t_n_imported = 0;
+        while( dirent* t_entry = ::readdir( t_dir ) )
+        {
+            std::string t_name( t_entry->d_name );
+            packet_fft::precision t_precision = packet_fft::precision::double_precision;
+            if( t_name.compare( 0, t_double_prefix.size(), t_double_prefix ) == 0 ) t_precision = packet_fft::precision::double_precision;
+            else if( t_name.compare( 0, t_single_prefix.size(), t_single_prefix ) == 0 ) t_precision = packet_fft::precision::single_precision;
+            else continue;
+
+            if( t_precision == packet_fft::precision::single_precision && ! packet_fft::single_precision_available() ) continue;
+
+            std::string t_path = a_directory + "/" + t_name;
+            if( packet_fft::import_wisdom( t_precision, t_path ) )
+            {
+                LDEBUG( plog, "Imported FFTW wisdom from <" << t_path << ">" );
+                ++t_n_imported;
+            }
+            else
+            {
+                LWARN( plog, "Unable to read FFTW wisdom from <" << t_path << ">" );
+            }
+        }
+        ::closedir( t_dir );
+
+        LINFO( plog, "Preloaded " << t_n_imported << " FFTW wisdom files for <" << cpu_model() << "> from <" << a_directory << ">" );
+        return t_n_imported;
+    }
+
+    bool fftw_wisdom_store::save( const std::string& a_directory, packet_fft::precision a_precision, const std::string& a_flag, unsigned a_fft_size, unsigned a_batch_size )
+    {
+        std::string t_filename = filename( a_directory, a_precision, a_flag, a_fft_size, a_batch_size );
+        if( ! packet_fft::export_wisdom( a_precision, t_filename ) )
+        {
+            LWARN( plog, "Unable to write FFTW wisdom to <" << t_filename << ">" );
+            return false;
+        }
+        LDEBUG( plog, "Saved FFTW wisdom to <" << t_filename << ">" );
+        return true;
+    }
+
+    std::string fftw_wisdom_store::filename( const std::string& a_directory, packet_fft::precision a_precision, const std::string& a_flag, unsigned a_fft_size, unsigned a_batch_size )
+    {
+        std::stringstream t_filename;
+        t_filename << a_directory << "/" << cpu_model() << "_" << packet_fft::precision_name( a_precision ) << "_" << sanitize( a_flag ) << "_"
+                << a_fft_size << "x" << a_batch_size << ".wisdom";
+        return t_filename.str();
+    }
+
+    const std::string& fftw_wisdom_store::cpu_model()
+    {
+        static const std::string s_model = read_cpu_model();
+        return s_model;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,50 @@
+/*
+ * fftw_wisdom_store.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_FFTW_WISDOM_STORE_HH_
+#define PSYLLID_FFTW_WISDOM_STORE_HH_
+
+#include "packet_fft.hh"
+
+#include <string>
+
+namespace psyllid
+{
+
+    /*!
+     @class fftw_wisdom_store
+     @author N. S. Oblath
+
+     @brief A directory of FFTW wisdom files, one per CPU model, precision, planning flag, FFT size and batch size
+
+     @details
+     Wisdom is only valid on the kind of machine it was made on, so each file is named for the CPU model (from /proc/cpuinfo)
+     as well as the transform: [cpu model]_[precision]_[flag]_[fft size]x[batch size].wisdom.  Several hosts can therefore share
+     one directory.
+
+     preload() imports all of the files for this CPU model into FFTW (in both precisions), once per directory per process, so that
+     any plan that has been tuned before on this kind of CPU can be made straight from wisdom.  save() writes FFTW's wisdom
+     to the file for a transform once its plan has been made.
+    */
+    class fftw_wisdom_store
+    {
+        public:
+            /// Imports the wisdom files for this CPU model in a_directory, if that hasn't been done already; returns the number of files imported
+            static unsigned preload( const std::string& a_directory );
+
+            /// Saves the current wisdom for a_precision to the file for the transform; returns false if the file can't be written
+            static bool save( const std::string& a_directory, packet_fft::precision a_precision, const std::string& a_flag, unsigned a_fft_size, unsigned a_batch_size );
+
+            static std::string filename( const std::string& a_directory, packet_fft::precision a_precision, const std::string& a_flag, unsigned a_fft_size, unsigned a_batch_size );
+
+            /// The CPU model, with everything but letters, digits and dashes replaced by dashes; "unknown-cpu" if it can't be found
+            static const std::string& cpu_model();
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_FFTW_WISDOM_STORE_HH_ */
@@ -23,43 +23,49 @@ namespace psyllid
 {
 
     REGISTER_NODE_AND_BUILDER( frequency_mask_trigger, "frequency-mask-trigger", frequency_mask_trigger_binding );
+    REGISTER_NODE_AND_BUILDER( frequency_mask_batch_trigger, "frequency-mask-batch-trigger", frequency_mask_batch_trigger_binding );
 
     LOGGER( plog, "frequency_mask_trigger" );
 
     // trigger_mode_t utility functions
-    std::string frequency_mask_trigger::trigger_mode_to_string( frequency_mask_trigger::trigger_mode_t a_trigger_mode )
+    template< class x_input_type, class x_output_type >
+    std::string _frequency_mask_trigger< x_input_type, x_output_type >::trigger_mode_to_string( trigger_mode_t a_trigger_mode )
     {
         // note that the string representations use hyphens, not underscores
         switch (a_trigger_mode) {
-            case frequency_mask_trigger::trigger_mode_t::single_level: return "single-level";
-            case frequency_mask_trigger::trigger_mode_t::two_level: return "two-level";
+            case trigger_mode_t::single_level: return "single-level";
+            case trigger_mode_t::two_level: return "two-level";
             default: throw psyllid::error() << "trigger_mode value <" << trigger_mode_to_uint(a_trigger_mode) << "> not recognized";
         }
     }
-    frequency_mask_trigger::trigger_mode_t frequency_mask_trigger::string_to_trigger_mode( const std::string& a_trigger_mode_string )
+    template< class x_input_type, class x_output_type >
+    typename _frequency_mask_trigger< x_input_type, x_output_type >::trigger_mode_t _frequency_mask_trigger< x_input_type, x_output_type >::string_to_trigger_mode( const std::string& a_trigger_mode_string )
     {
-        if ( a_trigger_mode_string == trigger_mode_to_string( frequency_mask_trigger::trigger_mode_t::single_level ) ) return trigger_mode_t::single_level;
-        if ( a_trigger_mode_string == trigger_mode_to_string( frequency_mask_trigger::trigger_mode_t::two_level ) ) return trigger_mode_t::two_level;
+        if ( a_trigger_mode_string == trigger_mode_to_string( trigger_mode_t::single_level ) ) return trigger_mode_t::single_level;
+        if ( a_trigger_mode_string == trigger_mode_to_string( trigger_mode_t::two_level ) ) return trigger_mode_t::two_level;
         throw psyllid::error() << "string <" << a_trigger_mode_string << "> not recognized as valid trigger_mode type";
     }
 
     // threshold_t utility functions
-    std::string frequency_mask_trigger::threshold_to_string( frequency_mask_trigger::threshold_t a_threshold )
+    template< class x_input_type, class x_output_type >
+    std::string _frequency_mask_trigger< x_input_type, x_output_type >::threshold_to_string( threshold_t a_threshold )
     {
         switch (a_threshold) {
-            case frequency_mask_trigger::threshold_t::snr: return "snr";
-            case frequency_mask_trigger::threshold_t::sigma: return "sigma";
+            case threshold_t::snr: return "snr";
+            case threshold_t::sigma: return "sigma";
             default: throw psyllid::error() << "threshold value <" << threshold_to_uint(a_threshold) << "> not recognized";
         }
     }
-    frequency_mask_trigger::threshold_t frequency_mask_trigger::string_to_threshold( const std::string& a_threshold_string )
+    template< class x_input_type, class x_output_type >
+    typename _frequency_mask_trigger< x_input_type, x_output_type >::threshold_t _frequency_mask_trigger< x_input_type, x_output_type >::string_to_threshold( const std::string& a_threshold_string )
     {
-        if ( a_threshold_string == threshold_to_string( frequency_mask_trigger::threshold_t::snr ) ) return threshold_t::snr;
-        if ( a_threshold_string == threshold_to_string( frequency_mask_trigger::threshold_t::sigma ) ) return threshold_t::sigma;
+        if ( a_threshold_string == threshold_to_string( threshold_t::snr ) ) return threshold_t::snr;
+        if ( a_threshold_string == threshold_to_string( threshold_t::sigma ) ) return threshold_t::sigma;
         throw psyllid::error() << "string <" << a_threshold_string << "> not recognized as valid threshold type";
     }
 
-    frequency_mask_trigger::frequency_mask_trigger() :
+    template< class x_input_type, class x_output_type >
+    _frequency_mask_trigger< x_input_type, x_output_type >::_frequency_mask_trigger() :
             f_length( 10 ),
             f_n_packets_for_mask( 10 ),
             f_threshold_snr( 30. ),
@@ -71,7 +77,7 @@ namespace psyllid
             f_status( status_t::mask_update ),
             f_trigger_mode(trigger_mode_t::single_level ),
             f_n_excluded_bins( 0 ),
-            f_exe_func( &frequency_mask_trigger::exe_apply_threshold ),
+            f_exe_func( &_frequency_mask_trigger::exe_apply_threshold ),
             f_mask(),
             f_mask2(),
             f_average_data(),
@@ -81,11 +87,13 @@ namespace psyllid
     {
     }
 
-    frequency_mask_trigger::~frequency_mask_trigger()
+    template< class x_input_type, class x_output_type >
+    _frequency_mask_trigger< x_input_type, x_output_type >::~_frequency_mask_trigger()
     {
     }
 
-    void frequency_mask_trigger::set_n_packets_for_mask( unsigned a_n_pkts )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::set_n_packets_for_mask( unsigned a_n_pkts )
     {
         if( a_n_pkts == 0 )
         {
@@ -95,21 +103,24 @@ namespace psyllid
         return;
     }
 
-    void frequency_mask_trigger::set_threshold_ampl_snr( double a_ampl_snr )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::set_threshold_ampl_snr( double a_ampl_snr )
     {
         f_threshold_snr = a_ampl_snr * a_ampl_snr;
         LDEBUG( plog, "Setting threshold (power via ampl) to " << f_threshold_snr );
         return;
     }
 
-    void frequency_mask_trigger::set_threshold_dB( double a_dB )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::set_threshold_dB( double a_dB )
     {
         f_threshold_snr = pow( 10, a_dB / 10. );
         LDEBUG( plog, "Setting threshold (power via dB) to " << f_threshold_snr );
         return;
     }
 
-    void frequency_mask_trigger::calculate_sigma_mask_spline_points( std::vector< double >& t_x_vals, std::vector< double >& t_y_vals, double threshold )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::calculate_sigma_mask_spline_points( std::vector< double >& t_x_vals, std::vector< double >& t_y_vals, double threshold )
     {
         unsigned t_n_bins_per_point = f_average_data.size() / f_n_spline_points;
         for( unsigned i_spline_point = 0; i_spline_point < f_n_spline_points; ++i_spline_point )
@@ -127,7 +138,8 @@ namespace psyllid
         }
     }
 
-    void frequency_mask_trigger::calculate_snr_mask_spline_points( std::vector< double >& t_x_vals, std::vector< double >& t_y_vals, double threshold )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::calculate_snr_mask_spline_points( std::vector< double >& t_x_vals, std::vector< double >& t_y_vals, double threshold )
     {
         unsigned t_n_bins_per_point = f_average_data.size() / f_n_spline_points;
         for( unsigned i_spline_point = 0; i_spline_point < f_n_spline_points; ++i_spline_point )
@@ -145,7 +157,8 @@ namespace psyllid
         }
     }
 
-    void frequency_mask_trigger::set_mask_parameters_from_node( const scarab::param_node& a_mask_and_data_values )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::set_mask_parameters_from_node( const scarab::param_node& a_mask_and_data_values )
     {
         // set n-points
         f_n_packets_for_mask = a_mask_and_data_values["n-packets"]().as_uint();
@@ -185,49 +198,52 @@ namespace psyllid
         //}
     }
 
-    void frequency_mask_trigger::switch_to_update_mask()
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::switch_to_update_mask()
     {
         LDEBUG( plog, "Requesting switch to update-mask mode" );
         f_exe_func_mutex.lock();
-        if( f_exe_func != &frequency_mask_trigger::exe_add_to_mask )
+        if( f_exe_func != &_frequency_mask_trigger::exe_add_to_mask )
         {
             f_break_exe_func.store( true );
             f_status = status_t::mask_update;
-            f_exe_func = &frequency_mask_trigger::exe_add_to_mask;
+            f_exe_func = &_frequency_mask_trigger::exe_add_to_mask;
         }
         f_exe_func_mutex.unlock();
         return;
     }
 
-    void frequency_mask_trigger::switch_to_apply_trigger()
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::switch_to_apply_trigger()
     {
         LDEBUG( plog, "Requesting switch to apply-trigger mode" );
         f_exe_func_mutex.lock();
         if ( f_trigger_mode == trigger_mode_t::single_level)
         {
-            if ( f_exe_func != &frequency_mask_trigger::exe_apply_threshold )
+            if ( f_exe_func != &_frequency_mask_trigger::exe_apply_threshold )
             {
                 f_break_exe_func.store( true );
                 f_status = status_t::triggering;
-                f_exe_func = &frequency_mask_trigger::exe_apply_threshold;
+                f_exe_func = &_frequency_mask_trigger::exe_apply_threshold;
             }
         }
         else
         {
             LDEBUG( plog, "Switching to exe_apply_two_thresholds" );
-            if ( f_exe_func != &frequency_mask_trigger::exe_apply_two_thresholds )
+            if ( f_exe_func != &_frequency_mask_trigger::exe_apply_two_thresholds )
             {
                 LDEBUG( plog, "Break exe_func" );
                 f_break_exe_func.store( true );
                 f_status = status_t::triggering;
-                f_exe_func = &frequency_mask_trigger::exe_apply_two_thresholds;
+                f_exe_func = &_frequency_mask_trigger::exe_apply_two_thresholds;
             }
         }
         f_exe_func_mutex.unlock();
         return;
     }
 
-    void frequency_mask_trigger::write_mask( const std::string& a_filename )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::write_mask( const std::string& a_filename )
     {
         std::unique_lock< std::mutex > t_lock( f_mask_mutex );
 
@@ -283,13 +299,15 @@ namespace psyllid
         return;
     }
 
-    void frequency_mask_trigger::initialize()
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::initialize()
     {
-        out_buffer< 0 >().initialize( f_length );
+        this->template out_buffer< 0 >().initialize( f_length );
         return;
     }
 
-    void frequency_mask_trigger::execute( midge::diptera* a_midge )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::execute( midge::diptera* a_midge )
     {
         exe_func_context t_ctx;
         t_ctx.f_midge = a_midge;
@@ -315,18 +333,20 @@ namespace psyllid
         return;
     }
 
-    void frequency_mask_trigger::exe_add_to_mask( exe_func_context& a_ctx )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::exe_add_to_mask( exe_func_context& a_ctx )
     {
         f_exe_func_mutex.unlock();
 
         try
         {
+            x_input_type* t_input = nullptr;
             freq_data* t_freq_data = nullptr;
             double t_real = 0., t_imag = 0., t_abs_square = 0.;
             unsigned t_array_size = 0;
 
             LDEBUG( plog, "Entering add-to-mask loop" );
-            while( ! is_canceled() && ! f_break_exe_func.load() )
+            while( ! this->is_canceled() && ! f_break_exe_func.load() )
             {
                 // the stream::get function is called at the end of the loop so
                 // that we can enter the exe func after switching the function pointer
@@ -351,126 +371,131 @@ namespace psyllid
                 }
                 else if( a_ctx.f_in_command == stream::s_run )
                 {
-                    t_freq_data = in_stream< 0 >().data();
+                    t_input = this->template in_stream< 0 >().data();
 
                     try
                     {
-                        if( f_n_summed >= f_n_packets_for_mask )
+                        for( unsigned i_packet = 0; i_packet < _slot_traits< x_input_type >::n_packets( *t_input ); ++i_packet )
                         {
-                            LTRACE( plog, "Already have enough packets for the mask; skipping this packet" );
-                        }
-                        else
-                        {
-                            LTRACE( plog, "Considering frequency data:  chan = " << t_freq_data->get_digital_id() <<
-                                   "  time = " << t_freq_data->get_unix_time() <<
-                                   "  id = " << t_freq_data->get_pkt_in_session() <<
-                                   "  freqNotTime = " << t_freq_data->get_freq_not_time() <<
-                                   "  bin 0 [0] = " << (unsigned)t_freq_data->get_array()[ 0 ][ 0 ] );
+                            t_freq_data = &_slot_traits< x_input_type >::packet( *t_input, i_packet );
 
-                            if( a_ctx.f_first_packet_after_start )
+                            if( f_n_summed >= f_n_packets_for_mask )
                             {
-                                t_array_size = t_freq_data->get_array_size();
-                                f_average_data.resize( t_array_size );
-                                f_variance_data.resize( t_array_size );
-                                for( unsigned i_bin = 0; i_bin < t_array_size; ++i_bin )
-                                {
-                                    f_average_data[ i_bin ] = 0.;
-                                    f_variance_data[ i_bin ] = 0.;
-                                }
-                                a_ctx.f_first_packet_after_start = false;
+                                LTRACE( plog, "Already have enough packets for the mask; skipping this packet" );
                             }
-                            for( unsigned i_bin = 0; i_bin < t_array_size; ++i_bin )
+                            else
                             {
-                                t_real = t_freq_data->get_array()[ i_bin ][ 0 ];
-                                t_imag = t_freq_data->get_array()[ i_bin ][ 1 ];
-                                t_abs_square = t_real*t_real + t_imag*t_imag;
-                                f_variance_data[ i_bin ] = f_variance_data[ i_bin ] + t_abs_square * t_abs_square;
-                                f_average_data[ i_bin ] = f_average_data[ i_bin ] +  t_abs_square;
-                            }
+                                LTRACE( plog, "Considering frequency data:  chan = " << t_freq_data->get_digital_id() <<
+                                       "  time = " << t_freq_data->get_unix_time() <<
+                                       "  id = " << t_freq_data->get_pkt_in_session() <<
+                                       "  freqNotTime = " << t_freq_data->get_freq_not_time() <<
+                                       "  bin 0 [0] = " << (unsigned)t_freq_data->get_array()[ 0 ][ 0 ] );
 
-                            ++f_n_summed;
-                            LTRACE( plog, "Added data to frequency mask; mask now has " << f_n_summed << " packets" );
-
-                            if( f_n_summed == f_n_packets_for_mask )
-                            {
-                                // calculate average and variance
-                                for( unsigned i_bin = 0; i_bin < f_average_data.size(); ++i_bin )
+                                if( a_ctx.f_first_packet_after_start )
                                 {
-                                    f_variance_data [ i_bin ] = ( f_variance_data [ i_bin ] - f_average_data [ i_bin ] * f_average_data [ i_bin ] / (double) f_n_summed ) /( (double) f_n_summed -1 );
-                                    f_average_data[ i_bin ] = f_average_data[ i_bin ]/ (double) f_n_summed;
+                                    t_array_size = t_freq_data->get_array_size();
+                                    f_average_data.resize( t_array_size );
+                                    f_variance_data.resize( t_array_size );
+                                    for( unsigned i_bin = 0; i_bin < t_array_size; ++i_bin )
+                                    {
+                                        f_average_data[ i_bin ] = 0.;
+                                        f_variance_data[ i_bin ] = 0.;
+                                    }
+                                    a_ctx.f_first_packet_after_start = false;
                                 }
-
-                                LDEBUG( plog, "Calculating spline for frequency mask" );
-                                std::vector< double > t_x_vals( f_n_spline_points );
-                                std::vector< double > t_y_vals( f_n_spline_points );
-
-                                if ( f_threshold_type == threshold_t::sigma )
+                                for( unsigned i_bin = 0; i_bin < t_array_size; ++i_bin )
                                 {
-                                    calculate_sigma_mask_spline_points(t_x_vals, t_y_vals, f_threshold_sigma);
+                                    t_real = t_freq_data->get_array()[ i_bin ][ 0 ];
+                                    t_imag = t_freq_data->get_array()[ i_bin ][ 1 ];
+                                    t_abs_square = t_real*t_real + t_imag*t_imag;
+                                    f_variance_data[ i_bin ] = f_variance_data[ i_bin ] + t_abs_square * t_abs_square;
+                                    f_average_data[ i_bin ] = f_average_data[ i_bin ] +  t_abs_square;
+                                }
 
-                                    // create the spline
-                                    tk::spline t_spline;
-                                    t_spline.set_points( t_x_vals, t_y_vals );
+                                ++f_n_summed;
+                                LTRACE( plog, "Added data to frequency mask; mask now has " << f_n_summed << " packets" );
 
-                                    f_mask_mutex.lock();
-                                    LDEBUG( plog, "Calculating frequency sigma mask" );
-                                    f_mask.resize( f_average_data.size() );
-                                    for( unsigned i_bin = 0; i_bin < f_mask.size(); ++i_bin )
+                                if( f_n_summed == f_n_packets_for_mask )
+                                {
+                                    // calculate average and variance
+                                    for( unsigned i_bin = 0; i_bin < f_average_data.size(); ++i_bin )
                                     {
-                                        f_mask[ i_bin ] = t_spline( i_bin );
+                                        f_variance_data [ i_bin ] = ( f_variance_data [ i_bin ] - f_average_data [ i_bin ] * f_average_data [ i_bin ] / (double) f_n_summed ) /( (double) f_n_summed -1 );
+                                        f_average_data[ i_bin ] = f_average_data[ i_bin ]/ (double) f_n_summed;
                                     }
 
-                                    if ( f_trigger_mode == trigger_mode_t::two_level )
+                                    LDEBUG( plog, "Calculating spline for frequency mask" );
+                                    std::vector< double > t_x_vals( f_n_spline_points );
+                                    std::vector< double > t_y_vals( f_n_spline_points );
+
+                                    if ( f_threshold_type == threshold_t::sigma )
                                     {
-                                        calculate_sigma_mask_spline_points(t_x_vals, t_y_vals, f_threshold_sigma_high);
+                                        calculate_sigma_mask_spline_points(t_x_vals, t_y_vals, f_threshold_sigma);
+
                                         // create the spline
                                         tk::spline t_spline;
                                         t_spline.set_points( t_x_vals, t_y_vals );
 
-                                        LDEBUG( plog, "Calculating frequency sigma mask2" );
+                                        f_mask_mutex.lock();
+                                        LDEBUG( plog, "Calculating frequency sigma mask" );
+                                        f_mask.resize( f_average_data.size() );
+                                        for( unsigned i_bin = 0; i_bin < f_mask.size(); ++i_bin )
+                                        {
+                                            f_mask[ i_bin ] = t_spline( i_bin );
+                                        }
 
-                                        f_mask2.resize( f_average_data.size() );
-                                        for( unsigned i_bin = 0; i_bin < f_mask2.size(); ++i_bin )
+                                        if ( f_trigger_mode == trigger_mode_t::two_level )
                                         {
-                                            f_mask2[ i_bin ] = t_spline( i_bin );
+                                            calculate_sigma_mask_spline_points(t_x_vals, t_y_vals, f_threshold_sigma_high);
+                                            // create the spline
+                                            tk::spline t_spline;
+                                            t_spline.set_points( t_x_vals, t_y_vals );
+
+                                            LDEBUG( plog, "Calculating frequency sigma mask2" );
+
+                                            f_mask2.resize( f_average_data.size() );
+                                            for( unsigned i_bin = 0; i_bin < f_mask2.size(); ++i_bin )
+                                            {
+                                                f_mask2[ i_bin ] = t_spline( i_bin );
+                                            }
                                         }
                                     }
-                                }
-                                else
-                                {
-                                    calculate_snr_mask_spline_points(t_x_vals, t_y_vals, f_threshold_snr);
-
-                                    // create the spline
-                                    tk::spline t_spline;
-                                    t_spline.set_points( t_x_vals, t_y_vals );
-
-                                    f_mask_mutex.lock();
-                                    LDEBUG( plog, "Calculating frequency snr mask" );
-
-                                    f_mask.resize( f_average_data.size() );
-                                    for( unsigned i_bin = 0; i_bin < f_mask.size(); ++i_bin )
+                                    else
                                     {
-                                        f_mask[ i_bin ] = t_spline( i_bin );
-                                    }
+                                        calculate_snr_mask_spline_points(t_x_vals, t_y_vals, f_threshold_snr);
 
-                                    if ( f_trigger_mode == trigger_mode_t::two_level )
-                                    {
-                                        calculate_snr_mask_spline_points(t_x_vals, t_y_vals, f_threshold_snr_high);
                                         // create the spline
                                         tk::spline t_spline;
                                         t_spline.set_points( t_x_vals, t_y_vals );
 
-                                        LDEBUG( plog, "Calculating frequency snr mask2" );
+                                        f_mask_mutex.lock();
+                                        LDEBUG( plog, "Calculating frequency snr mask" );
+
+                                        f_mask.resize( f_average_data.size() );
+                                        for( unsigned i_bin = 0; i_bin < f_mask.size(); ++i_bin )
+                                        {
+                                            f_mask[ i_bin ] = t_spline( i_bin );
+                                        }
 
-                                        f_mask2.resize( f_average_data.size() );
-                                        for( unsigned i_bin = 0; i_bin < f_mask2.size(); ++i_bin )
+                                        if ( f_trigger_mode == trigger_mode_t::two_level )
                                         {
-                                            f_mask2[ i_bin ] = t_spline( i_bin );
+                                            calculate_snr_mask_spline_points(t_x_vals, t_y_vals, f_threshold_snr_high);
+                                            // create the spline
+                                            tk::spline t_spline;
+                                            t_spline.set_points( t_x_vals, t_y_vals );
+
+                                            LDEBUG( plog, "Calculating frequency snr mask2" );
+
+                                            f_mask2.resize( f_average_data.size() );
+                                            for( unsigned i_bin = 0; i_bin < f_mask2.size(); ++i_bin )
+                                            {
+                                                f_mask2[ i_bin ] = t_spline( i_bin );
+                                            }
                                         }
                                     }
-                                }
 
-                                f_mask_mutex.unlock();
+                                    f_mask_mutex.unlock();
+                                }
                             }
                         }
                     }
@@ -500,12 +525,12 @@ namespace psyllid
 
                 }
 
-                a_ctx.f_in_command = in_stream< 0 >().get();
-                LTRACE( plog, "FMT (update-mask) reading stream at index " << in_stream< 0 >().get_current_index() );
+                a_ctx.f_in_command = this->template in_stream< 0 >().get();
+                LTRACE( plog, "FMT (update-mask) reading stream at index " << this->template in_stream< 0 >().get_current_index() );
 
             } // end while( ! is_canceled() && ! a_ctx.f_break_exe_loop() )
 
-            LDEBUG( plog, "FMT has exited the add-to-mask while loop; possible reasons: is_canceled() = " << is_canceled() << "; f_break_exe_func.load() = " << f_break_exe_func.load() );
+            LDEBUG( plog, "FMT has exited the add-to-mask while loop; possible reasons: is_canceled() = " << this->is_canceled() << "; f_break_exe_func.load() = " << f_break_exe_func.load() );
             if( f_break_exe_func.load() )
             {
                 LINFO( plog, "FMT is switching exe while loops" );
@@ -517,10 +542,10 @@ namespace psyllid
             }
 
             LDEBUG( plog, "Stopping output stream" );
-            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+            if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) return;
 
             LDEBUG( plog, "Exiting output stream" );
-            out_stream< 0 >().set( stream::s_exit );
+            this->template out_stream< 0 >().set( stream::s_exit );
 
             return;
         }
@@ -531,12 +556,16 @@ namespace psyllid
         }
     }
 
-    void frequency_mask_trigger::exe_apply_threshold( exe_func_context& a_ctx )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::exe_apply_threshold( exe_func_context& a_ctx )
     {
         f_exe_func_mutex.unlock();
 
         try
         {
+            x_input_type* t_input = nullptr;
+            x_output_type* t_output = nullptr;
+            unsigned t_n_packets = 0;
             freq_data* t_freq_data = nullptr;
             trigger_flag* t_trigger_flag = nullptr;
             double t_real = 0., t_imag = 0., t_power_amp = 0.;
@@ -549,7 +578,7 @@ namespace psyllid
             f_mask_mutex.unlock();
 
             LDEBUG( plog, "Entering apply-threshold loop" );
-            while( ! is_canceled() && ! f_break_exe_func.load() )
+            while( ! this->is_canceled() && ! f_break_exe_func.load() )
             {
                 // the stream::get function is called at the end of the loop so
                 // that we can enter the exe func after switching the function pointer
@@ -566,66 +595,76 @@ namespace psyllid
                 }
                 else if( a_ctx.f_in_command == stream::s_start )
                 {
-                    LDEBUG( plog, "Starting the FMT; output at stream index " << out_stream< 0 >().get_current_index() );
-                    if( ! out_stream< 0 >().set( stream::s_start ) ) break;
+                    LDEBUG( plog, "Starting the FMT; output at stream index " << this->template out_stream< 0 >().get_current_index() );
+                    if( ! this->template out_stream< 0 >().set( stream::s_start ) ) break;
                     a_ctx.f_first_packet_after_start = true;
                 }
                 if( a_ctx.f_in_command == stream::s_run )
                 {
-                    t_freq_data = in_stream< 0 >().data();
-                    t_trigger_flag = out_stream< 0 >().data();
-
-                    LTRACE( plog, "Considering frequency data:  chan = " << t_freq_data->get_digital_id() <<
-                           "  time = " << t_freq_data->get_unix_time() <<
-                           "  id = " << t_freq_data->get_pkt_in_session() <<
-                           "  freqNotTime = " << t_freq_data->get_freq_not_time() <<
-                           "  bin 0 [0] = " << (unsigned)t_freq_data->get_array()[ 0 ][ 0 ] );
+                    t_input = this->template in_stream< 0 >().data();
+                    t_output = this->template out_stream< 0 >().data();
+
                     try
                     {
-                        t_array_size = t_freq_data->get_array_size();
-                        t_loop_lower_limit = f_n_excluded_bins;
-                        t_loop_upper_limit = t_array_size - f_n_excluded_bins;
-                        LDEBUG( plog, "Array size: "<<t_array_size );
-                        LDEBUG( plog, "Looping from "<<t_loop_lower_limit<<" to "<<t_loop_upper_limit-1 );
-
-                        if( a_ctx.f_first_packet_after_start )
+                        // one flag for each spectrum
+                        t_n_packets = _slot_traits< x_input_type >::n_packets( *t_input );
+                        _slot_traits< x_output_type >::set_n_packets( *t_output, t_n_packets );
+                        for( unsigned i_packet = 0; i_packet < t_n_packets; ++i_packet )
                         {
-                            if( t_mask_buffer.size() != t_array_size )
+                            t_freq_data = &_slot_traits< x_input_type >::packet( *t_input, i_packet );
+                            t_trigger_flag = &_slot_traits< x_output_type >::packet( *t_output, i_packet );
+
+                            LTRACE( plog, "Considering frequency data:  chan = " << t_freq_data->get_digital_id() <<
+                                   "  time = " << t_freq_data->get_unix_time() <<
+                                   "  id = " << t_freq_data->get_pkt_in_session() <<
+                                   "  freqNotTime = " << t_freq_data->get_freq_not_time() <<
+                                   "  bin 0 [0] = " << (unsigned)t_freq_data->get_array()[ 0 ][ 0 ] );
+
+                            t_array_size = t_freq_data->get_array_size();
+                            t_loop_lower_limit = f_n_excluded_bins;
+                            t_loop_upper_limit = t_array_size - f_n_excluded_bins;
+                            LDEBUG( plog, "Array size: "<<t_array_size );
+                            LDEBUG( plog, "Looping from "<<t_loop_lower_limit<<" to "<<t_loop_upper_limit-1 );
+
+                            if( a_ctx.f_first_packet_after_start )
                             {
-                                throw psyllid::error() << "Frequency mask is not the same size as frequency data array";
+                                if( t_mask_buffer.size() != t_array_size )
+                                {
+                                    throw psyllid::error() << "Frequency mask is not the same size as frequency data array";
+                                }
+                                a_ctx.f_first_packet_after_start = false;
                             }
-                            a_ctx.f_first_packet_after_start = false;
-                        }
 
-                        t_trigger_flag->set_flag( false );
-                        t_trigger_flag->set_high_threshold( false );
-                        t_trigger_flag->set_id( t_freq_data->get_pkt_in_session() );
+                            t_trigger_flag->set_flag( false );
+                            t_trigger_flag->set_high_threshold( false );
+                            t_trigger_flag->set_id( t_freq_data->get_pkt_in_session() );
 
-                        for( unsigned i_bin = t_loop_lower_limit; i_bin < t_loop_upper_limit; ++i_bin )
-                        {
-                            t_real = t_freq_data->get_array()[ i_bin ][ 0 ];
-                            t_imag = t_freq_data->get_array()[ i_bin ][ 1 ];
-                            t_power_amp = t_real*t_real + t_imag*t_imag;
-
-                            if( t_power_amp >= t_mask_buffer[ i_bin ] )
+                            for( unsigned i_bin = t_loop_lower_limit; i_bin < t_loop_upper_limit; ++i_bin )
                             {
-                                t_trigger_flag->set_flag( true );
-                                t_trigger_flag->set_high_threshold( true );
-                                LDEBUG( plog, "Data id <" << t_trigger_flag->get_id() << "> [bin " << i_bin <<
-                                       "] resulted in flag <" << t_trigger_flag->get_flag() << ">" << '\n' <<
-                                       "\tdata: " << t_power_amp << ";  mask1: " << t_mask_buffer[ i_bin ] );
-                                break;
+                                t_real = t_freq_data->get_array()[ i_bin ][ 0 ];
+                                t_imag = t_freq_data->get_array()[ i_bin ][ 1 ];
+                                t_power_amp = t_real*t_real + t_imag*t_imag;
+
+                                if( t_power_amp >= t_mask_buffer[ i_bin ] )
+                                {
+                                    t_trigger_flag->set_flag( true );
+                                    t_trigger_flag->set_high_threshold( true );
+                                    LDEBUG( plog, "Data id <" << t_trigger_flag->get_id() << "> [bin " << i_bin <<
+                                           "] resulted in flag <" << t_trigger_flag->get_flag() << ">" << '\n' <<
+                                           "\tdata: " << t_power_amp << ";  mask1: " << t_mask_buffer[ i_bin ] );
+                                    break;
+                                }
                             }
-                        }
 #ifndef NDEBUG
-                        if( ! t_trigger_flag->get_flag() )
-                        {
-                            LTRACE( plog, "Data id <" << t_trigger_flag->get_id() << "> resulted in flag <" << t_trigger_flag->get_flag() << ">");
-                        }
+                            if( ! t_trigger_flag->get_flag() )
+                            {
+                                LTRACE( plog, "Data id <" << t_trigger_flag->get_id() << "> resulted in flag <" << t_trigger_flag->get_flag() << ">");
+                            }
 #endif
+                        }
 
-                        LTRACE( plog, "FMT writing data to output stream at index " << out_stream< 0 >().get_current_index() );
-                        if( ! out_stream< 0 >().set( stream::s_run ) )
+                        LTRACE( plog, "FMT writing data to output stream at index " << this->template out_stream< 0 >().get_current_index() );
+                        if( ! this->template out_stream< 0 >().set( stream::s_run ) )
                         {
                             LERROR( plog, "Exiting due to stream error" );
                             throw midge::node_nonfatal_error() << "Stream error while applying threshold";
@@ -640,23 +679,23 @@ namespace psyllid
                 }
                 else if( a_ctx.f_in_command == stream::s_stop )
                 {
-                    LDEBUG( plog, "FMT is stopping at stream index " << out_stream< 0 >().get_current_index() );
-                    if( ! out_stream< 0 >().set( stream::s_stop ) ) break;
+                    LDEBUG( plog, "FMT is stopping at stream index " << this->template out_stream< 0 >().get_current_index() );
+                    if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) break;
                 }
                 else if( a_ctx.f_in_command == stream::s_exit )
                 {
-                    LDEBUG( plog, "FMT is exiting at stream index " << out_stream< 0 >().get_current_index() );
-                    out_stream< 0 >().set( stream::s_exit );
+                    LDEBUG( plog, "FMT is exiting at stream index " << this->template out_stream< 0 >().get_current_index() );
+                    this->template out_stream< 0 >().set( stream::s_exit );
                     break;
                 }
 
-                a_ctx.f_in_command = in_stream< 0 >().get();
-                LTRACE( plog, "FMT (apply-threshold) reading stream at index " << in_stream< 0 >().get_current_index() );
+                a_ctx.f_in_command = this->template in_stream< 0 >().get();
+                LTRACE( plog, "FMT (apply-threshold) reading stream at index " << this->template in_stream< 0 >().get_current_index() );
 
             } // while( ! is_canceled() && ! f_break_exe_func.load() )
 
             LDEBUG( plog, "FMT has exited the apply-threshold while loop; possible reasons: is_canceled() = " <<
-                   is_canceled() << "; f_break_exe_func.load() = " << f_break_exe_func.load() );
+                   this->is_canceled() << "; f_break_exe_func.load() = " << f_break_exe_func.load() );
             if( f_break_exe_func.load() )
             {
                 LINFO( plog, "FMT is switching exe while loops" );
@@ -668,10 +707,10 @@ namespace psyllid
             }
 
             LDEBUG( plog, "Stopping output stream" );
-            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+            if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) return;
 
             LDEBUG( plog, "Exiting output stream" );
-            out_stream< 0 >().set( stream::s_exit );
+            this->template out_stream< 0 >().set( stream::s_exit );
 
             return;
         }
@@ -683,12 +722,16 @@ namespace psyllid
     }
 
 
-    void frequency_mask_trigger::exe_apply_two_thresholds( exe_func_context& a_ctx )
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::exe_apply_two_thresholds( exe_func_context& a_ctx )
     {
         f_exe_func_mutex.unlock();
 
         try
         {
+            x_input_type* t_input = nullptr;
+            x_output_type* t_output = nullptr;
+            unsigned t_n_packets = 0;
             freq_data* t_freq_data = nullptr;
             trigger_flag* t_trigger_flag = nullptr;
             double t_real = 0., t_imag = 0., t_power_amp = 0.;
@@ -707,7 +750,7 @@ namespace psyllid
 
             LDEBUG( plog, "Entering apply-two-thresholds loop" );
 
-            while( ! is_canceled() && ! f_break_exe_func.load() )
+            while( ! this->is_canceled() && ! f_break_exe_func.load() )
             {
                 // the stream::get function is called at the end of the loop so
                 // that we can enter the exe func after switching the function pointer
@@ -724,80 +767,90 @@ namespace psyllid
                 }
                 else if( a_ctx.f_in_command == stream::s_start )
                 {
-                    LDEBUG( plog, "Starting the FMT; output at stream index " << out_stream< 0 >().get_current_index() );
-                    if( ! out_stream< 0 >().set( stream::s_start ) ) break;
+                    LDEBUG( plog, "Starting the FMT; output at stream index " << this->template out_stream< 0 >().get_current_index() );
+                    if( ! this->template out_stream< 0 >().set( stream::s_start ) ) break;
                     a_ctx.f_first_packet_after_start = true;
                 }
                 if( a_ctx.f_in_command == stream::s_run )
                 {
-                    t_freq_data = in_stream< 0 >().data();
-                    t_trigger_flag = out_stream< 0 >().data();
-
-                    LTRACE( plog, "Considering frequency data:  chan = " << t_freq_data->get_digital_id() <<
-                           "  time = " << t_freq_data->get_unix_time() <<
-                           "  id = " << t_freq_data->get_pkt_in_session() <<
-                           "  freqNotTime = " << t_freq_data->get_freq_not_time() <<
-                           "  bin 0 [0] = " << (unsigned)t_freq_data->get_array()[ 0 ][ 0 ] );
+                    t_input = this->template in_stream< 0 >().data();
+                    t_output = this->template out_stream< 0 >().data();
+
                     try
                     {
-                        t_array_size = t_freq_data->get_array_size();
-                        t_loop_lower_limit = f_n_excluded_bins;
-                        t_loop_upper_limit = t_array_size - f_n_excluded_bins;
-                        LDEBUG( plog, "Array size: "<<t_array_size );
-                        LDEBUG( plog, "Looping from "<<t_loop_lower_limit<<" to "<<t_loop_upper_limit-1 );
-
-                        if( a_ctx.f_first_packet_after_start )
+                        // one flag for each spectrum
+                        t_n_packets = _slot_traits< x_input_type >::n_packets( *t_input );
+                        _slot_traits< x_output_type >::set_n_packets( *t_output, t_n_packets );
+                        for( unsigned i_packet = 0; i_packet < t_n_packets; ++i_packet )
                         {
-                            if ( t_mask_buffer.size() != t_freq_data->get_array_size() )
-                            {
-                                throw psyllid::error() << "Frequency mask is not the same size as frequency data array";
-                            }
-                            if ( t_mask2_buffer.size() != t_freq_data->get_array_size() )
-                            {
-                                throw psyllid::error() << "Frequency mask2 is not the same size as frequency data array";
-                            }
-                            a_ctx.f_first_packet_after_start = false;
-                        }
+                            t_freq_data = &_slot_traits< x_input_type >::packet( *t_input, i_packet );
+                            t_trigger_flag = &_slot_traits< x_output_type >::packet( *t_output, i_packet );
 
-                        t_trigger_flag->set_flag( false );
-                        t_trigger_flag->set_high_threshold( false );
-                        t_trigger_flag->set_id( t_freq_data->get_pkt_in_session() );
+                            LTRACE( plog, "Considering frequency data:  chan = " << t_freq_data->get_digital_id() <<
+                                   "  time = " << t_freq_data->get_unix_time() <<
+                                   "  id = " << t_freq_data->get_pkt_in_session() <<
+                                   "  freqNotTime = " << t_freq_data->get_freq_not_time() <<
+                                   "  bin 0 [0] = " << (unsigned)t_freq_data->get_array()[ 0 ][ 0 ] );
 
-                        for( unsigned i_bin = t_loop_lower_limit; i_bin < t_loop_upper_limit; ++i_bin )
-                        {
-                            t_real = t_freq_data->get_array()[ i_bin ][ 0 ];
-                            t_imag = t_freq_data->get_array()[ i_bin ][ 1 ];
-                            t_power_amp = t_real*t_real + t_imag*t_imag;
+                            t_array_size = t_freq_data->get_array_size();
+                            t_loop_lower_limit = f_n_excluded_bins;
+                            t_loop_upper_limit = t_array_size - f_n_excluded_bins;
+                            LDEBUG( plog, "Array size: "<<t_array_size );
+                            LDEBUG( plog, "Looping from "<<t_loop_lower_limit<<" to "<<t_loop_upper_limit-1 );
 
-                            if(  t_power_amp >= t_mask2_buffer[ i_bin ] )
+                            if( a_ctx.f_first_packet_after_start )
                             {
-                                t_trigger_flag->set_flag( true );
-                                t_trigger_flag->set_high_threshold( true );
-                                LDEBUG( plog, "Data " << t_trigger_flag->get_id() << " [bin " << i_bin <<
-                                       "] resulted in flag <" << t_trigger_flag->get_flag() << ">" << '\n' <<
-                                       "\tdata: " << t_power_amp << ";  mask2: " << t_mask2_buffer[ i_bin ] );
-                                break;
+                                if ( t_mask_buffer.size() != t_freq_data->get_array_size() )
+                                {
+                                    throw psyllid::error() << "Frequency mask is not the same size as frequency data array";
+                                }
+                                if ( t_mask2_buffer.size() != t_freq_data->get_array_size() )
+                                {
+                                    throw psyllid::error() << "Frequency mask2 is not the same size as frequency data array";
+                                }
+                                a_ctx.f_first_packet_after_start = false;
                             }
-                            else if( t_power_amp >= t_mask_buffer[ i_bin ] )
+
+                            t_trigger_flag->set_flag( false );
+                            t_trigger_flag->set_high_threshold( false );
+                            t_trigger_flag->set_id( t_freq_data->get_pkt_in_session() );
+
+                            for( unsigned i_bin = t_loop_lower_limit; i_bin < t_loop_upper_limit; ++i_bin )
                             {
-                                t_trigger_flag->set_flag( true );
-                                t_trigger_flag->set_high_threshold( false );
-                                LTRACE( plog, "Data id <" << t_trigger_flag->get_id() << "> [bin " << i_bin <<
-                                       "] resulted in flag <" << t_trigger_flag->get_flag() << ">" << '\n' <<
-                                       "\tdata: " << t_power_amp << ";  mask1: " << t_mask_buffer[ i_bin ] );
+                                t_real = t_freq_data->get_array()[ i_bin ][ 0 ];
+                                t_imag = t_freq_data->get_array()[ i_bin ][ 1 ];
+                                t_power_amp = t_real*t_real + t_imag*t_imag;
+
+                                if(  t_power_amp >= t_mask2_buffer[ i_bin ] )
+                                {
+                                    t_trigger_flag->set_flag( true );
+                                    t_trigger_flag->set_high_threshold( true );
+                                    LDEBUG( plog, "Data " << t_trigger_flag->get_id() << " [bin " << i_bin <<
+                                           "] resulted in flag <" << t_trigger_flag->get_flag() << ">" << '\n' <<
+                                           "\tdata: " << t_power_amp << ";  mask2: " << t_mask2_buffer[ i_bin ] );
+                                    break;
+                                }
+                                else if( t_power_amp >= t_mask_buffer[ i_bin ] )
+                                {
+                                    t_trigger_flag->set_flag( true );
+                                    t_trigger_flag->set_high_threshold( false );
+                                    LTRACE( plog, "Data id <" << t_trigger_flag->get_id() << "> [bin " << i_bin <<
+                                           "] resulted in flag <" << t_trigger_flag->get_flag() << ">" << '\n' <<
+                                           "\tdata: " << t_power_amp << ";  mask1: " << t_mask_buffer[ i_bin ] );
+                                }
                             }
-                        }
 
 #ifndef NDEBUG
-                        if( ! t_trigger_flag->get_flag() )
-                        {
-                            LTRACE( plog, "Data id <" << t_trigger_flag->get_id() << "> resulted in flag <" <<
-                                   t_trigger_flag->get_flag() << ">");
-                        }
+                            if( ! t_trigger_flag->get_flag() )
+                            {
+                                LTRACE( plog, "Data id <" << t_trigger_flag->get_id() << "> resulted in flag <" <<
+                                       t_trigger_flag->get_flag() << ">");
+                            }
 #endif
+                        }
 
-                        LTRACE( plog, "FMT writing data to output stream at index " << out_stream< 0 >().get_current_index() );
-                        if( ! out_stream< 0 >().set( stream::s_run ) )
+                        LTRACE( plog, "FMT writing data to output stream at index " << this->template out_stream< 0 >().get_current_index() );
+                        if( ! this->template out_stream< 0 >().set( stream::s_run ) )
                         {
                             LERROR( plog, "Exiting due to stream error" );
                             throw midge::node_nonfatal_error() << "Stream error while applying threshold";
@@ -812,23 +865,23 @@ namespace psyllid
                 }
                 else if( a_ctx.f_in_command == stream::s_stop )
                 {
-                    LDEBUG( plog, "FMT is stopping at stream index " << out_stream< 0 >().get_current_index() );
-                    if( ! out_stream< 0 >().set( stream::s_stop ) ) break;
+                    LDEBUG( plog, "FMT is stopping at stream index " << this->template out_stream< 0 >().get_current_index() );
+                    if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) break;
                 }
                 else if( a_ctx.f_in_command == stream::s_exit )
                 {
-                    LDEBUG( plog, "FMT is exiting at stream index " << out_stream< 0 >().get_current_index() );
-                    out_stream< 0 >().set( stream::s_exit );
+                    LDEBUG( plog, "FMT is exiting at stream index " << this->template out_stream< 0 >().get_current_index() );
+                    this->template out_stream< 0 >().set( stream::s_exit );
                     break;
                 }
 
-                a_ctx.f_in_command = in_stream< 0 >().get();
-                LTRACE( plog, "FMT (apply-threshold) reading stream at index " << in_stream< 0 >().get_current_index() );
+                a_ctx.f_in_command = this->template in_stream< 0 >().get();
+                LTRACE( plog, "FMT (apply-threshold) reading stream at index " << this->template in_stream< 0 >().get_current_index() );
 
             } // while( ! is_canceled() && ! f_break_exe_func.load() )
 
             LDEBUG( plog, "FMT has exited the apply-two-threshold while loop; possible reasons: is_canceled() = " <<
-                   is_canceled() << "; f_break_exe_func.load() = " << f_break_exe_func.load() );
+                   this->is_canceled() << "; f_break_exe_func.load() = " << f_break_exe_func.load() );
             if( f_break_exe_func.load() )
             {
                 LINFO( plog, "FMT is switching exe while loops" );
@@ -840,10 +893,10 @@ namespace psyllid
             }
 
             LDEBUG( plog, "Stopping output stream" );
-            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+            if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) return;
 
             LDEBUG( plog, "Exiting output stream" );
-            out_stream< 0 >().set( stream::s_exit );
+            this->template out_stream< 0 >().set( stream::s_exit );
 
             return;
         }
@@ -854,23 +907,27 @@ namespace psyllid
         }
     }
 
-    void frequency_mask_trigger::finalize()
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger< x_input_type, x_output_type >::finalize()
     {
-        out_buffer< 0 >().finalize();
+        this->template out_buffer< 0 >().finalize();
         return;
     }
 
 
-    frequency_mask_trigger_binding::frequency_mask_trigger_binding() :
-            sandfly::_node_binding< frequency_mask_trigger, frequency_mask_trigger_binding >()
+    template< class x_input_type, class x_output_type >
+    _frequency_mask_trigger_binding< x_input_type, x_output_type >::_frequency_mask_trigger_binding() :
+            sandfly::_node_binding< _frequency_mask_trigger< x_input_type, x_output_type >, _frequency_mask_trigger_binding< x_input_type, x_output_type > >()
     {
     }
 
-    frequency_mask_trigger_binding::~frequency_mask_trigger_binding()
+    template< class x_input_type, class x_output_type >
+    _frequency_mask_trigger_binding< x_input_type, x_output_type >::~_frequency_mask_trigger_binding()
     {
     }
 
-    void frequency_mask_trigger_binding::do_apply_config( frequency_mask_trigger* a_node, const scarab::param_node& a_config ) const
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger_binding< x_input_type, x_output_type >::do_apply_config( _frequency_mask_trigger< x_input_type, x_output_type >* a_node, const scarab::param_node& a_config ) const
     {
         LDEBUG( plog, "Configuring frequency_mask_trigger with:\n" << a_config );
         a_node->set_n_packets_for_mask( a_config.get_value( "n-packets-for-mask", a_node->get_n_packets_for_mask() ) );
@@ -942,7 +999,8 @@ namespace psyllid
         return;
     }
 
-    void frequency_mask_trigger_binding::do_dump_config( const frequency_mask_trigger* a_node, scarab::param_node& a_config ) const
+    template< class x_input_type, class x_output_type >
+    void _frequency_mask_trigger_binding< x_input_type, x_output_type >::do_dump_config( const _frequency_mask_trigger< x_input_type, x_output_type >* a_node, scarab::param_node& a_config ) const
     {
         LDEBUG( plog, "Dumping configuration for frequency_mask_trigger" );
         a_config.add( "n-packets-for-mask", a_node->get_n_packets_for_mask() );
@@ -955,11 +1013,11 @@ namespace psyllid
         // get threshold values corresponding only to the configured threshold type
         switch ( a_node->get_threshold_type() )
         {
-            case frequency_mask_trigger::threshold_t::snr:
+            case _frequency_mask_trigger< x_input_type, x_output_type >::threshold_t::snr:
                 a_config.add( "threshold-power-snr", a_node->get_threshold_snr() );
                 a_config.add( "threshold-power-snr-high", a_node->get_threshold_snr_high() );
                 break;
-            case frequency_mask_trigger::threshold_t::sigma:
+            case _frequency_mask_trigger< x_input_type, x_output_type >::threshold_t::sigma:
                 a_config.add( "threshold-power-sigma", a_node->get_threshold_sigma() );
                 a_config.add( "threshold-power-sigma-high", a_node->get_threshold_sigma_high() );
                 break;
@@ -968,7 +1026,8 @@ namespace psyllid
         return;
     }
 
-    bool frequency_mask_trigger_binding::do_run_command( frequency_mask_trigger* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const
+    template< class x_input_type, class x_output_type >
+    bool _frequency_mask_trigger_binding< x_input_type, x_output_type >::do_run_command( _frequency_mask_trigger< x_input_type, x_output_type >* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const
     {
         if( a_cmd == "update-mask" )
         {
@@ -999,5 +1058,10 @@ namespace psyllid
         }
     }
 
+    template class _frequency_mask_trigger< freq_data, trigger_flag >;
+    template class _frequency_mask_trigger< freq_data_batch, trigger_flag_batch >;
+
+    template class _frequency_mask_trigger_binding< freq_data, trigger_flag >;
+    template class _frequency_mask_trigger_binding< freq_data_batch, trigger_flag_batch >;
 
 } /* namespace psyllid */
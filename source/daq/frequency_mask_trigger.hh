@@ -12,6 +12,7 @@
 
 #include "freq_data.hh"
 #include "node_builder.hh"
+#include "packet_batch.hh"
 #include "trigger_flag.hh"
 
 #include "member_variables.hh"
@@ -25,7 +26,7 @@ namespace psyllid
 {
 
     /*!
-     @class frequency_mask_trigger
+     @class _frequency_mask_trigger
      @author N. S. Oblath
 
      @brief A basic FMT.
@@ -53,9 +54,13 @@ namespace psyllid
          "mask": [value_0, value_1, . . . .]
      }
 
+     The trigger takes either single spectra (frequency_mask_trigger) or batches of spectra (frequency_mask_batch_trigger, for use
+     with tf_roach_batch_receiver).  The batched trigger outputs one batch of trigger flags for each batch of spectra, with a flag
+     for each spectrum.
+
      Parameter setting is not thread-safe.  Executing (including switching modes) is thread-safe.
 
-     Node type: "frequency-mask-trigger"
+     Node types: "frequency-mask-trigger" (single spectra), "frequency-mask-batch-trigger" (batches)
 
      Available configuration values:
      - "length": uint -- The size of the output data buffer
@@ -74,14 +79,15 @@ namespace psyllid
      - "write-mask" ("filename" string) -- Write the mask in JSON format to the given file
 
      Input Streams:
-     - 0: freq_data (for the apply-trigger mode)
-     - 1: freq_data (for the update-mask mode)
+     - 0: freq_data or freq_data_batch (for the apply-trigger mode)
+     - 1: freq_data or freq_data_batch (for the update-mask mode)
 
      Output Streams:
-     - 0: trigger_flag
+     - 0: trigger_flag or trigger_flag_batch
     */
-    class frequency_mask_trigger :
-            public midge::_transformer< midge::type_list< freq_data >, midge::type_list< trigger_flag > >
+    template< class x_input_type, class x_output_type >
+    class _frequency_mask_trigger :
+            public midge::_transformer< midge::type_list< x_input_type >, midge::type_list< x_output_type > >
     {
         public:
             enum class status_t
@@ -112,8 +118,8 @@ namespace psyllid
 
 
         public:
-            frequency_mask_trigger();
-            virtual ~frequency_mask_trigger();
+            _frequency_mask_trigger();
+            virtual ~_frequency_mask_trigger();
 
             void set_n_packets_for_mask( unsigned a_n_pkts );
 
@@ -167,7 +173,7 @@ namespace psyllid
             void exe_apply_two_thresholds( exe_func_context& a_ctx );
             void exe_add_to_mask( exe_func_context& a_ctx );
 
-            void (frequency_mask_trigger::*f_exe_func)( exe_func_context& a_ctx );
+            void (_frequency_mask_trigger::*f_exe_func)( exe_func_context& a_ctx );
             std::mutex f_exe_func_mutex;
             std::atomic< bool > f_break_exe_func;
 
@@ -182,57 +188,73 @@ namespace psyllid
 
     };
 
-    inline uint32_t frequency_mask_trigger::trigger_mode_to_uint( frequency_mask_trigger::trigger_mode_t a_trigger_mode )
+    typedef _frequency_mask_trigger< freq_data, trigger_flag > frequency_mask_trigger;
+    typedef _frequency_mask_trigger< freq_data_batch, trigger_flag_batch > frequency_mask_batch_trigger;
+
+    template< class x_input_type, class x_output_type >
+    inline uint32_t _frequency_mask_trigger< x_input_type, x_output_type >::trigger_mode_to_uint( trigger_mode_t a_trigger_mode )
     {
         return static_cast< uint32_t >( a_trigger_mode );
     }
-    inline frequency_mask_trigger::trigger_mode_t frequency_mask_trigger::uint_to_trigger_mode( uint32_t a_trigger_mode_uint )
+    template< class x_input_type, class x_output_type >
+    inline typename _frequency_mask_trigger< x_input_type, x_output_type >::trigger_mode_t _frequency_mask_trigger< x_input_type, x_output_type >::uint_to_trigger_mode( uint32_t a_trigger_mode_uint )
     {
-        return static_cast< frequency_mask_trigger::trigger_mode_t >( a_trigger_mode_uint );
+        return static_cast< trigger_mode_t >( a_trigger_mode_uint );
     }
 
-    inline uint32_t frequency_mask_trigger::threshold_to_uint( frequency_mask_trigger::threshold_t a_threshold )
+    template< class x_input_type, class x_output_type >
+    inline uint32_t _frequency_mask_trigger< x_input_type, x_output_type >::threshold_to_uint( threshold_t a_threshold )
     {
         return static_cast< uint32_t >( a_threshold );
     }
-    inline frequency_mask_trigger::threshold_t frequency_mask_trigger::uint_to_threshold( uint32_t a_threshold_uint )
+    template< class x_input_type, class x_output_type >
+    inline typename _frequency_mask_trigger< x_input_type, x_output_type >::threshold_t _frequency_mask_trigger< x_input_type, x_output_type >::uint_to_threshold( uint32_t a_threshold_uint )
     {
-        return static_cast< frequency_mask_trigger::threshold_t >( a_threshold_uint );
+        return static_cast< threshold_t >( a_threshold_uint );
     }
 
-    inline void frequency_mask_trigger::set_trigger_mode( const std::string& a_trigger_mode )
+    template< class x_input_type, class x_output_type >
+    inline void _frequency_mask_trigger< x_input_type, x_output_type >::set_trigger_mode( const std::string& a_trigger_mode )
     {
         set_trigger_mode( string_to_trigger_mode( a_trigger_mode ) );
     }
 
-    inline void frequency_mask_trigger::set_threshold_type( const std::string& a_threshold_type )
+    template< class x_input_type, class x_output_type >
+    inline void _frequency_mask_trigger< x_input_type, x_output_type >::set_threshold_type( const std::string& a_threshold_type )
     {
         set_threshold_type( string_to_threshold( a_threshold_type ) );
     }
 
-    inline std::string frequency_mask_trigger::get_trigger_mode_str() const
+    template< class x_input_type, class x_output_type >
+    inline std::string _frequency_mask_trigger< x_input_type, x_output_type >::get_trigger_mode_str() const
     {
         return trigger_mode_to_string( f_trigger_mode );
     }
 
-    inline std::string frequency_mask_trigger::get_threshold_type_str() const
+    template< class x_input_type, class x_output_type >
+    inline std::string _frequency_mask_trigger< x_input_type, x_output_type >::get_threshold_type_str() const
     {
         return threshold_to_string( f_threshold_type );
     }
 
-    class frequency_mask_trigger_binding : public sandfly::_node_binding< frequency_mask_trigger, frequency_mask_trigger_binding >
+    template< class x_input_type, class x_output_type >
+    class _frequency_mask_trigger_binding :
+            public sandfly::_node_binding< _frequency_mask_trigger< x_input_type, x_output_type >, _frequency_mask_trigger_binding< x_input_type, x_output_type > >
     {
         public:
-            frequency_mask_trigger_binding();
-            virtual ~frequency_mask_trigger_binding();
+            _frequency_mask_trigger_binding();
+            virtual ~_frequency_mask_trigger_binding();
 
         private:
-            virtual void do_apply_config( frequency_mask_trigger* a_node, const scarab::param_node& a_config ) const;
-            virtual void do_dump_config( const frequency_mask_trigger* a_node, scarab::param_node& a_config ) const;
+            virtual void do_apply_config( _frequency_mask_trigger< x_input_type, x_output_type >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _frequency_mask_trigger< x_input_type, x_output_type >* a_node, scarab::param_node& a_config ) const;
 
-            virtual bool do_run_command( frequency_mask_trigger* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const;
+            virtual bool do_run_command( _frequency_mask_trigger< x_input_type, x_output_type >* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const;
     };
 
+    typedef _frequency_mask_trigger_binding< freq_data, trigger_flag > frequency_mask_trigger_binding;
+    typedef _frequency_mask_trigger_binding< freq_data_batch, trigger_flag_batch > frequency_mask_batch_trigger_binding;
+
 
 } /* namespace psyllid */
 
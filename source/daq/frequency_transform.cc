@@ -8,11 +8,14 @@
 
 #include "frequency_transform.hh"
 
+#include "fftw_wisdom_store.hh"
 #include "psyllid_error.hh"
 
 #include "logger.hh"
 #include "param.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <thread>
 #include <memory>
@@ -31,21 +34,34 @@ namespace psyllid
             f_time_length( 10 ),
             f_freq_length( 10 ),
             f_fft_size( 4096 ),
+            f_batch_size( 1 ),
             f_transform_flag( "ESTIMATE" ),
             f_use_wisdom( true ),
             f_wisdom_filename( "wisdom_complexfft.fftw3" ),
+            f_precision( "double" ),
+            f_n_workers( 0 ),
+            f_wisdom_directory(),
+            f_background_planning( true ),
             f_enable_time_output( true ),
             f_transform_flag_map(),
-            f_fftw_input(),
-            f_fftw_output(),
-            f_fftw_plan(),
-            f_multithreaded_is_initialized( false )
+            f_fft(),
+            f_multithreaded_is_initialized( false ),
+            f_batch(),
+            f_n_in_batch( 0 ),
+            f_workers(),
+            f_current_job( nullptr ),
+            f_job_entries(),
+            f_planner_thread(),
+            f_tuned_ready( false ),
+            f_tuned_ffts(),
+            f_retired_ffts()
     {
         setup_internal_maps();
     }
 
     frequency_transform::~frequency_transform()
     {
+        if (f_planner_thread.joinable()) f_planner_thread.join();
     }
 
     void frequency_transform::switch_to_freq_only()
@@ -62,19 +78,42 @@ namespace psyllid
 
     void frequency_transform::initialize()
     {
+        if (f_batch_size == 0)
+        {
+            throw error() << "[frequency_transform] The batch size must be at least 1";
+        }
+        if (f_fft_size * 2 > PAYLOAD_SIZE)
+        {
+            throw error() << "[frequency_transform] The FFT size (" << f_fft_size << ") is larger than a packet (" << PAYLOAD_SIZE / 2 << " samples)";
+        }
+        // the time output has to hold the packets the frequency output is behind by, or a consumer reading both in lockstep (e.g. triggered_writer) deadlocks;
+        // that's the batch being filled, plus the batches in flight on the workers
+        uint64_t t_max_lag_batches = f_n_workers == 0 ? 1 : 2 * uint64_t(f_n_workers) + 1;
+        if (f_time_length < f_batch_size * t_max_lag_batches)
+        {
+            throw error() << "[frequency_transform] The time-data buffer length (" << f_time_length << ") must be at least the batch size times "
+                    << t_max_lag_batches << " (" << f_batch_size * t_max_lag_batches << ") to cover the lag of the frequency output";
+        }
+
         out_buffer< 0 >().initialize( f_time_length );
         out_buffer< 1 >().initialize( f_freq_length );
 
         // fftw stuff
+        if (f_planner_thread.joinable()) f_planner_thread.join();
         TransformFlagMap::const_iterator iter = f_transform_flag_map.find(f_transform_flag);
         unsigned transform_flag = iter->second;
-        // initialize FFTW IO arrays
-        f_fftw_input = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * f_fft_size);
-        f_fftw_output = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * f_fft_size);
-        if (f_use_wisdom)
+        packet_fft::precision t_precision = packet_fft::parse_precision(f_precision);
+        f_batch.resize(f_batch_size);
+        f_n_in_batch = 0;
+        if (f_use_wisdom && ! f_wisdom_directory.empty())
+        {
+            // only reads the directory the first time in this process
+            fftw_wisdom_store::preload(f_wisdom_directory);
+        }
+        else if (f_use_wisdom)
         {
             LDEBUG( plog, "Reading wisdom from file <" << f_wisdom_filename << ">");
-            if (fftw_import_wisdom_from_filename(f_wisdom_filename.c_str()) == 0)
+            if (! packet_fft::import_wisdom(t_precision, f_wisdom_filename))
             {
                 LWARN( plog, "Unable to read FFTW wisdom from file <" << f_wisdom_filename << ">" );
             }
@@ -83,26 +122,62 @@ namespace psyllid
         #ifdef FFTW_NTHREADS
         if (! f_multithreaded_is_initialized)
         {
+            std::unique_lock< std::mutex > t_planner_lock( packet_fft::planner_mutex() );
             fftw_init_threads();
             fftw_plan_with_nthreads(FFTW_NTHREADS);
+            #ifdef FFTWF_FOUND
+            fftwf_init_threads();
+            fftwf_plan_with_nthreads(FFTW_NTHREADS);
+            #endif
             LDEBUG( plog, "Configuring FFTW to use up to " << FFTW_NTHREADS << " threads.");
             f_multithreaded_is_initialized = true;
         }
         #endif
-        //create fftw plan
-        f_fftw_plan = fftw_plan_dft_1d(f_fft_size, f_fftw_input, f_fftw_output, FFTW_FORWARD, transform_flag | FFTW_PRESERVE_INPUT);
-        //save plan
-        if (f_fftw_plan != NULL)
+        //create fftw plan for a batch of transforms (throws if that's not possible); with worker threads, one plan per worker
+        //if the tuned plan isn't in the wisdom, start with an ESTIMATE plan and make the tuned one in the background
+        std::vector< std::unique_ptr< packet_fft > > t_ffts;
+        bool t_plan_in_background = false;
+        if (transform_flag != FFTW_ESTIMATE && f_use_wisdom)
         {
-            if (f_use_wisdom)
+            try
             {
-                if (fftw_export_wisdom_to_filename(f_wisdom_filename.c_str()) == 0)
-                {
-                    LWARN( plog, "Unable to write FFTW wisdom to file<" << f_wisdom_filename << ">");
-                }
+                t_ffts = make_ffts(t_precision, transform_flag | FFTW_WISDOM_ONLY);
+                LDEBUG( plog, "Made the " << f_transform_flag << " plan from wisdom" );
+            }
+            catch (error&)
+            {
+                LDEBUG( plog, "No wisdom for the " << f_transform_flag << " plan" );
+                t_ffts.clear();
             }
-            LDEBUG( plog, "FFTW plan created; initialization complete" );
         }
+        if (t_ffts.empty())
+        {
+            t_plan_in_background = f_background_planning && transform_flag != FFTW_ESTIMATE;
+            t_ffts = make_ffts(t_precision, t_plan_in_background ? FFTW_ESTIMATE : transform_flag);
+            //save plan
+            if (f_use_wisdom && ! t_plan_in_background) save_wisdom(t_precision);
+        }
+        if (f_n_workers == 0)
+        {
+            f_fft = std::move(t_ffts.front());
+        }
+        else
+        {
+            unsigned t_n_jobs = 2 * f_n_workers;
+            f_workers.reset( new fft_worker_pool(std::move(t_ffts), t_n_jobs) );
+            f_job_entries.assign(t_n_jobs, std::vector< batch_entry >(f_batch_size));
+            f_current_job = nullptr;
+            LDEBUG( plog, "Transforming on " << f_n_workers << " worker threads" );
+        }
+        LDEBUG( plog, "Transforming in " << packet_fft::precision_name(t_precision) << " precision"
+                << (t_precision == packet_fft::precision::single_precision && packet_fft::simd_kernels_available() ? " with AVX2 kernels" : "") );
+        if (t_plan_in_background)
+        {
+            LINFO( plog, "Starting with an ESTIMATE plan while the " << f_transform_flag << " plan is made in the background" );
+            f_tuned_ready.store(false);
+            f_planner_thread = std::thread(&frequency_transform::plan_tuned, this, t_precision, transform_flag);
+        }
+        LDEBUG( plog, "FFTW plan created; initialization complete" );
 
         return;
     }
@@ -115,8 +190,6 @@ namespace psyllid
 
             time_data* time_data_in = nullptr;
             time_data* time_data_out = nullptr;
-            freq_data* freq_data_out = nullptr;
-            double fft_norm = sqrt(1. / (double)f_fft_size);
 
             try
             {
@@ -154,6 +227,7 @@ namespace psyllid
                     if ( in_cmd == stream::s_stop )
                     {
                         LDEBUG( plog, "got an s_stop on slot <" << in_stream< 0 >().get_current_index() << ">" );
+                        if ( ! flush_batches() ) break;
                         if ( f_enable_time_output && ! out_stream< 0 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream 0 error while stopping";
                         if ( ! out_stream< 1 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream 1 error while stopping";
                         continue;
@@ -175,38 +249,15 @@ namespace psyllid
                         {
                             time_data_out = out_stream< 0 >().data();
                             *time_data_out = *time_data_in;
+                            if ( !out_stream< 0 >().set( stream::s_run ) )
+                            {
+                                LERROR( plog, "frequency_transform error setting time output stream to s_run" );
+                                break;
+                            }
                         }
-                        //frequency output
-                        freq_data_out = out_stream< 1 >().data();
-                        freq_data_out->set_freq_not_time( true );
-                        //TODO there are many other members of the underlying roach_packet_data type; should more carefully think through all of them and if they should be on the frequency_data (is there a way to copy all the members *except* the data array?)
-                        LDEBUG( plog, "next steams acquired, doing FFT" );
-                        std::copy(&time_data_in->get_array()[0][0], &time_data_in->get_array()[0][0] + f_fft_size*2, &f_fftw_input[0][0]);
-                        fftw_execute_dft(f_fftw_plan, f_fftw_input, f_fftw_output);
-                        //is this the normalization we want? (is it what the ROACH does?)
-                        for (size_t i_bin=0; i_bin<f_fft_size; ++i_bin)
-                        {
-                            f_fftw_output[i_bin][0] = round(f_fftw_output[i_bin][0]*fft_norm);
-                            f_fftw_output[i_bin][1] = round(f_fftw_output[i_bin][1]*fft_norm);
-                        }
-                        //std::copy(&f_fftw_output[0][0], &f_fftw_output[0][0] + f_fft_size*2, &freq_data_out->get_array()[0][0]);
-                        // FFT unfolding based on katydid:Source/Data/Transform/KTFrequencyTransformFFTW
-                        unsigned t_center_bin = time_data_in->get_array_size();
-                        std::copy(&f_fftw_output[0][0], &f_fftw_output[0][0] + (t_center_bin - 1), &freq_data_out->get_array()[0][0] + t_center_bin);
-                        std::copy(&f_fftw_output[0][0] + t_center_bin, &f_fftw_output[0][0] + f_fft_size*2, &freq_data_out->get_array()[0][0]);
-                        freq_data_out->set_pkt_in_batch(time_data_in->get_pkt_in_batch());
-                        freq_data_out->set_pkt_in_session(time_data_in->get_pkt_in_session());
-
-                        if ( f_enable_time_output && !out_stream< 0 >().set( stream::s_run ) )
-                        {
-                            LERROR( plog, "frequency_transform error setting time output stream to s_run" );
-                            break;
-                        }
-                        if ( !out_stream< 1 >().set( stream::s_run ) )
-                        {
-                            LERROR( plog, "frequency_transform error setting frequency output stream to s_run" );
-                            break;
-                        }
+
+                        //add to the batch; the frequency output is written when the batch has been transformed
+                        if ( ! add_to_batch(*time_data_in) ) break;
                     }
                 }
             }
@@ -217,6 +268,9 @@ namespace psyllid
 
             LINFO( plog, "FREQUENCY TRANSFORM is exiting" );
 
+            // transform whatever is left of the batch
+            if ( ! flush_batches() ) return;
+
             // normal exit condition
             LDEBUG( plog, "Stopping output streams" );
             bool t_t_stop_ok = f_enable_time_output && out_stream< 0 >().set( stream::s_stop );
@@ -242,19 +296,208 @@ namespace psyllid
     {
         out_buffer< 0 >().finalize();
         out_buffer< 1 >().finalize();
-        if (f_fftw_input != NULL )
+        if (f_planner_thread.joinable())
+        {
+            if (! f_tuned_ready.load()) LINFO( plog, "Waiting for the " << f_transform_flag << " plan to finish" );
+            f_planner_thread.join();
+        }
+        f_fft.reset();
+        f_workers.reset();
+        f_current_job = nullptr;
+        f_tuned_ffts.clear();
+        f_tuned_ready.store(false);
+        f_retired_ffts.clear();
+        return;
+    }
+
+    std::vector< std::unique_ptr< packet_fft > > frequency_transform::make_ffts( packet_fft::precision a_precision, unsigned a_flags ) const
+    {
+        std::vector< std::unique_ptr< packet_fft > > t_ffts;
+        unsigned t_n_ffts = f_n_workers == 0 ? 1 : f_n_workers;
+        for (unsigned i_fft = 0; i_fft < t_n_ffts; ++i_fft)
+        {
+            t_ffts.emplace_back( new packet_fft(f_fft_size, f_batch_size, a_precision, a_flags) );
+        }
+        return t_ffts;
+    }
+
+    void frequency_transform::save_wisdom( packet_fft::precision a_precision ) const
+    {
+        if (! f_wisdom_directory.empty())
+        {
+            fftw_wisdom_store::save(f_wisdom_directory, a_precision, f_transform_flag, f_fft_size, f_batch_size);
+        }
+        else if (! packet_fft::export_wisdom(a_precision, f_wisdom_filename))
+        {
+            LWARN( plog, "Unable to write FFTW wisdom to file<" << f_wisdom_filename << ">");
+        }
+        return;
+    }
+
+    void frequency_transform::plan_tuned( packet_fft::precision a_precision, unsigned a_flags )
+    {
+        try
+        {
+            auto t_start = std::chrono::steady_clock::now();
+            std::vector< std::unique_ptr< packet_fft > > t_ffts = make_ffts(a_precision, a_flags);
+            if (f_use_wisdom) save_wisdom(a_precision);
+            f_tuned_ffts = std::move(t_ffts);
+            f_tuned_ready.store(true, std::memory_order_release);
+            std::chrono::duration< double > t_elapsed = std::chrono::steady_clock::now() - t_start;
+            LINFO( plog, "The " << f_transform_flag << " plan is ready after " << t_elapsed.count() << " s" );
+        }
+        catch (std::exception& e)
+        {
+            LERROR( plog, "Unable to make the " << f_transform_flag << " plan; staying with the ESTIMATE plan: " << e.what() );
+        }
+        return;
+    }
+
+    void frequency_transform::install_tuned_ffts()
+    {
+        if (! f_tuned_ready.load(std::memory_order_acquire) || f_tuned_ffts.empty()) return;
+
+        if (f_workers)
         {
-            fftw_free(f_fftw_input);
-            f_fftw_input = NULL;
+            f_workers->replace_ffts(std::move(f_tuned_ffts));
         }
-        if (f_fftw_output != NULL)
+        else
         {
-            fftw_free(f_fftw_output);
-            f_fftw_output = NULL;
+            f_retired_ffts.push_back(std::move(f_fft));
+            f_fft = std::move(f_tuned_ffts.front());
         }
+        f_tuned_ffts.clear();
+        LINFO( plog, "Switched to the " << f_transform_flag << " plan" );
         return;
     }
 
+    bool frequency_transform::add_to_batch( const time_data& a_time_data )
+    {
+        // the plans are only switched between batches
+        if (f_n_in_batch == 0) install_tuned_ffts();
+
+        const int8_t* t_samples = &a_time_data.get_array()[0][0];
+        batch_entry* t_entries = f_batch.data();
+        if (f_workers)
+        {
+            if (f_current_job == nullptr && ! acquire_job()) return false;
+            t_entries = f_job_entries[f_current_job->f_index].data();
+            std::copy(t_samples, t_samples + f_fft_size*2, &f_current_job->f_samples[f_n_in_batch * f_fft_size*2]);
+        }
+        else
+        {
+            f_fft->load(f_n_in_batch, t_samples);
+        }
+
+        //TODO there are many other members of the underlying roach_packet_data type; should more carefully think through all of them and if they should be on the frequency_data (is there a way to copy all the members *except* the data array?)
+        batch_entry& t_entry = t_entries[f_n_in_batch];
+        t_entry.f_pkt_in_batch = a_time_data.get_pkt_in_batch();
+        t_entry.f_pkt_in_session = a_time_data.get_pkt_in_session();
+        t_entry.f_rx_timestamp_ns = a_time_data.get_rx_timestamp_ns();
+
+        if (++f_n_in_batch < f_batch_size) return true;
+        return transform_batch();
+    }
+
+    bool frequency_transform::transform_batch()
+    {
+        if (f_n_in_batch == 0) return true;
+
+        if (f_workers)
+        {
+            LDEBUG( plog, "submitting a batch of " << f_n_in_batch << " packets to the workers" );
+            f_current_job->f_n_packets = f_n_in_batch;
+            f_n_in_batch = 0;
+            f_workers->submit(f_current_job);
+            f_current_job = nullptr;
+
+            // write out whatever has finished, without waiting
+            while (fft_worker_pool::job* t_job = f_workers->next_done(false))
+            {
+                if (! retire_job(t_job)) return false;
+            }
+            return true;
+        }
+
+        LDEBUG( plog, "doing FFT of a batch of " << f_n_in_batch << " packets" );
+        // a partial batch is transformed in full; the unused rows are ignored
+        f_fft->execute();
+
+        unsigned t_n_packets = f_n_in_batch;
+        f_n_in_batch = 0;
+        for (unsigned i_packet = 0; i_packet < t_n_packets; ++i_packet)
+        {
+            //frequency output
+            freq_data* freq_data_out = prepare_freq_output(f_batch[i_packet]);
+            //is this the normalization we want? (is it what the ROACH does?)
+            // FFT unfolding based on katydid:Source/Data/Transform/KTFrequencyTransformFFTW
+            f_fft->unfold(i_packet, &freq_data_out->get_array()[0][0]);
+
+            if ( !out_stream< 1 >().set( stream::s_run ) )
+            {
+                LERROR( plog, "frequency_transform error setting frequency output stream to s_run" );
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool frequency_transform::flush_batches()
+    {
+        if (! transform_batch()) return false;
+        if (! f_workers) return true;
+
+        while (fft_worker_pool::job* t_job = f_workers->next_done(true))
+        {
+            if (! retire_job(t_job)) return false;
+        }
+        return true;
+    }
+
+    bool frequency_transform::acquire_job()
+    {
+        f_current_job = f_workers->get_free_job();
+        while (f_current_job == nullptr)
+        {
+            // all of the jobs are in flight; the oldest one has to finish before another batch can start
+            if (! retire_job(f_workers->next_done(true))) return false;
+            f_current_job = f_workers->get_free_job();
+        }
+        return true;
+    }
+
+    bool frequency_transform::retire_job( fft_worker_pool::job* a_job )
+    {
+        const std::vector< batch_entry >& t_entries = f_job_entries[a_job->f_index];
+        unsigned t_n_values = f_fft_size*2;
+        bool t_ok = true;
+        for (unsigned i_packet = 0; i_packet < a_job->f_n_packets; ++i_packet)
+        {
+            freq_data* freq_data_out = prepare_freq_output(t_entries[i_packet]);
+            const int8_t* t_spectrum = &a_job->f_spectra[i_packet * t_n_values];
+            std::copy(t_spectrum, t_spectrum + t_n_values, &freq_data_out->get_array()[0][0]);
+
+            if ( !out_stream< 1 >().set( stream::s_run ) )
+            {
+                LERROR( plog, "frequency_transform error setting frequency output stream to s_run" );
+                t_ok = false;
+                break;
+            }
+        }
+        f_workers->release(a_job);
+        return t_ok;
+    }
+
+    freq_data* frequency_transform::prepare_freq_output( const batch_entry& a_entry )
+    {
+        freq_data* freq_data_out = out_stream< 1 >().data();
+        freq_data_out->set_freq_not_time( true );
+        freq_data_out->set_pkt_in_batch(a_entry.f_pkt_in_batch);
+        freq_data_out->set_pkt_in_session(a_entry.f_pkt_in_session);
+        freq_data_out->set_rx_timestamp_ns(a_entry.f_rx_timestamp_ns);
+        return freq_data_out;
+    }
+
     void frequency_transform::setup_internal_maps()
     {
         f_transform_flag_map.clear();
@@ -281,9 +524,14 @@ namespace psyllid
         a_node->set_time_length( a_config.get_value( "time-length", a_node->get_time_length() ) );
         a_node->set_freq_length( a_config.get_value( "freq-length", a_node->get_freq_length() ) );
         a_node->set_fft_size( a_config.get_value( "fft-size", a_node->get_fft_size() ) );
+        a_node->set_batch_size( a_config.get_value( "batch-size", a_node->get_batch_size() ) );
         a_node->set_transform_flag( a_config.get_value( "transform-flag", a_node->get_transform_flag() ) );
         a_node->set_use_wisdom( a_config.get_value( "use-wisdom", a_node->get_use_wisdom() ) );
         a_node->set_wisdom_filename( a_config.get_value( "wisdom-filename", a_node->get_wisdom_filename() ) );
+        a_node->set_precision( a_config.get_value( "precision", a_node->get_precision() ) );
+        a_node->set_n_workers( a_config.get_value( "n-workers", a_node->get_n_workers() ) );
+        a_node->set_wisdom_directory( a_config.get_value( "wisdom-directory", a_node->get_wisdom_directory() ) );
+        a_node->set_background_planning( a_config.get_value( "background-planning", a_node->get_background_planning() ) );
         return;
     }
 
@@ -293,9 +541,14 @@ namespace psyllid
         a_config.add( "time-length", scarab::param_value( a_node->get_time_length() ) );
         a_config.add( "freq-length", scarab::param_value( a_node->get_freq_length() ) );
         a_config.add( "fft-size", scarab::param_value( a_node->get_fft_size() ) );
+        a_config.add( "batch-size", scarab::param_value( a_node->get_batch_size() ) );
         a_config.add( "transform-flag", scarab::param_value( a_node->get_transform_flag() ) );
         a_config.add( "use-wisdom", scarab::param_value( a_node->get_use_wisdom() ) );
         a_config.add( "wisdom-filename", scarab::param_value( a_node->get_wisdom_filename() ) );
+        a_config.add( "precision", scarab::param_value( a_node->get_precision() ) );
+        a_config.add( "n-workers", scarab::param_value( a_node->get_n_workers() ) );
+        a_config.add( "wisdom-directory", scarab::param_value( a_node->get_wisdom_directory() ) );
+        a_config.add( "background-planning", scarab::param_value( a_node->get_background_planning() ) );
         return;
     }
 
@@ -8,14 +8,19 @@
 #ifndef PSYLLID_FREQUENCY_TRANSFORM_HH_
 #define PSYLLID_FREQUENCY_TRANSFORM_HH_
 
+#include "fft_worker_pool.hh"
 #include "freq_data.hh"
 #include "node_builder.hh"
+#include "packet_fft.hh"
 #include "time_data.hh"
 
 #include "transformer.hh"
 #include "shared_cancel.hh"
 
-#include <fftw3.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
 
 namespace scarab
 {
@@ -31,18 +36,51 @@ namespace psyllid
      @brief A transformer to receive time data, compute an FFT, and distribute as time and frequency ROACH packets.
 
      @details
+     The time packets are transformed in batches of "batch-size": each packet is copied into its row of the FFT input as it
+     arrives (and, unless in frequency-only mode, passed on to the time output straight away), and when the batch is full a single
+     FFTW plan (fftw_plan_many_dft) transforms all of the rows.  Each spectrum is then normalized, rounded and unfolded (fftshift)
+     into its freq_data output in one pass (see packet_fft).  With "batch-size" greater than 1 the frequency output runs up to "batch-size" - 1
+     packets behind the time output; a partial batch is transformed when the input stream stops or exits.
+     Consumers that read the two in lockstep (e.g. triggered_writer, whose triggers come from the frequency data) need the time
+     output to hold those packets, so "time-length" must be at least "batch-size" (times 2 x "n-workers" + 1 with worker threads,
+     see below); initialize() throws otherwise.
+
+     With "precision" set to "single" the transforms are done in single precision (fftwf), with AVX2 kernels for the conversions
+     to and from int8 where the CPU supports them.  The 8-bit outputs match those in double precision except for the occasional
+     bin that differs by one count.  FFTW wisdom is specific to the precision, so each precision needs its own wisdom file.
+
+     With "n-workers" greater than 0, the batches are transformed on that many worker threads (see fft_worker_pool), each with its
+     own plan and arrays, instead of on the node's thread.  The node's thread only copies the packets into the batches and the
+     spectra into the frequency output; the batches are numbered as they're handed out, and their spectra are output strictly in
+     that order, so the frequency output is in the same order as the input.  Up to 2 x "n-workers" batches can be in flight, so the
+     frequency output then runs up to that many batches, plus the one being filled, behind the time output: "time-length" must be
+     at least "batch-size" x ( 2 x "n-workers" + 1 ).  The workers scale with cores where
+     FFTW_NTHREADS (which splits each small transform across threads) mostly adds overhead, so leave FFTW_NTHREADS at 1.
+
+     Planning with MEASURE or better can take seconds.  With "wisdom-directory" set, the wisdom is kept in that directory in one
+     file per CPU model, precision, flag, FFT size and batch size (see fftw_wisdom_store), and all of the files for this CPU model
+     are imported the first time the node is initialized.  If the wisdom already has the plan, initialize() makes it straight away.
+     If not, and "background-planning" is true, initialize() makes ESTIMATE plans, which take milliseconds, and the tuned plans are
+     made on a separate thread and saved to the wisdom; the node switches to them at the start of the next batch after they're
+     ready.  The outputs of the two plans are the same except for rounding.  Without "wisdom-directory", "wisdom-filename" is
+     used as before.
 
      Parameter setting is not thread-safe.  Executing is thread-safe.
 
      Node type: "frequency-transform"
 
      Available configuration values:
-     - "time-length": uint -- The size of the output time-data buffer
+     - "time-length": uint -- The size of the output time-data buffer; must be at least "batch-size" ( x ( 2 x "n-workers" + 1 ) with workers)
      - "freq-length": uint -- The size of the output frequency-data buffer
      - "fft-size": unsigned -- The length of the fft input/output array (each element is 2-component)
+     - "batch-size": unsigned -- The number of packets transformed together (default is 1)
      - "transform-flag": string -- FFTW flag to indicate how much optimization of the fftw_plan is desired
      - "use-wisdom": bool -- whether to use a plan from a wisdom file and save the plan to that file
-     - "wisdom-filename": string -- if "use-wisdom" is true, resolvable path to the wisdom file
+     - "wisdom-filename": string -- if "use-wisdom" is true and "wisdom-directory" is empty, resolvable path to the wisdom file
+     - "wisdom-directory": string -- if "use-wisdom" is true, directory of per-CPU wisdom files (default is empty, to use "wisdom-filename")
+     - "background-planning": bool -- whether to plan on a separate thread, with an ESTIMATE plan until the tuned one is ready (default is true)
+     - "precision": string -- "double" (default) or "single"; single precision needs the single-precision FFTW library
+     - "n-workers": unsigned -- The number of worker threads doing the transforms; 0 (the default) transforms on the node's thread
 
     Available DAQ commands:
     - "freq-only" (no args) -- Switch the execution mode to frequency only
@@ -68,9 +106,14 @@ namespace psyllid
             mv_accessible( uint64_t, time_length );
             mv_accessible( uint64_t, freq_length );
             mv_accessible( unsigned, fft_size ); // I really wish I could get this from the egg header
+            mv_accessible( unsigned, batch_size );
             mv_accessible( std::string, transform_flag );
             mv_accessible( bool, use_wisdom );
             mv_accessible( std::string, wisdom_filename );
+            mv_accessible( std::string, precision );
+            mv_accessible( unsigned, n_workers );
+            mv_accessible( std::string, wisdom_directory );
+            mv_accessible( bool, background_planning );
 
         private:
             bool f_enable_time_output;
@@ -85,17 +128,68 @@ namespace psyllid
 
         private:
             TransformFlagMap f_transform_flag_map;
-            fftw_complex* f_fftw_input;
-            fftw_complex* f_fftw_output;
-            fftw_plan f_fftw_plan;
+            std::unique_ptr< packet_fft > f_fft;
 
             bool f_multithreaded_is_initialized;
 
+            // header values of the packets in the current batch, for the frequency outputs
+            struct batch_entry
+            {
+                uint32_t f_pkt_in_batch;
+                uint64_t f_pkt_in_session;
+                uint64_t f_rx_timestamp_ns;
+            };
+            std::vector< batch_entry > f_batch;
+            unsigned f_n_in_batch;
+
+            // with worker threads, the batch being filled is f_current_job, and each job has its own header values
+            std::unique_ptr< fft_worker_pool > f_workers;
+            fft_worker_pool::job* f_current_job;
+            std::vector< std::vector< batch_entry > > f_job_entries;
+
+            // tuned plans made on f_planner_thread; f_tuned_ffts is handed over when f_tuned_ready is set
+            std::thread f_planner_thread;
+            std::atomic< bool > f_tuned_ready;
+            std::vector< std::unique_ptr< packet_fft > > f_tuned_ffts;
+            // plans that have been replaced; they're destroyed in finalize(), so the node never waits for the planner mid-run
+            std::vector< std::unique_ptr< packet_fft > > f_retired_ffts;
+
             //uint64_t f_time_session_pkt_counter;
             //uint64_t f_freq_session_pkt_counter;
         private:
             void setup_internal_maps();
 
+            /// Makes one packet_fft (or one per worker); throws psyllid::error if a plan can't be made with a_flags
+            std::vector< std::unique_ptr< packet_fft > > make_ffts( packet_fft::precision a_precision, unsigned a_flags ) const;
+
+            /// Saves the wisdom, to the wisdom directory or the wisdom file
+            void save_wisdom( packet_fft::precision a_precision ) const;
+
+            /// Makes the tuned plans (on f_planner_thread)
+            void plan_tuned( packet_fft::precision a_precision, unsigned a_flags );
+
+            /// Switches to the tuned plans, if they're ready; called between batches
+            void install_tuned_ffts();
+
+            /// Adds a packet to the current batch, and transforms the batch if it's full; returns false if there's a stream error
+            bool add_to_batch( const time_data& a_time_data );
+
+            /// Transforms the packets in the current batch and writes them to the frequency output (with worker threads, submits
+            /// the batch and writes out whichever batches are finished); returns false if there's a stream error
+            bool transform_batch();
+
+            /// Transforms the current batch and, with worker threads, waits for and writes out all of the batches in flight
+            bool flush_batches();
+
+            /// Takes a free job for the next batch, waiting for the oldest batch in flight and writing it out if there are none
+            bool acquire_job();
+
+            /// Writes out the spectra of a finished job and returns it to the pool
+            bool retire_job( fft_worker_pool::job* a_job );
+
+            /// Gets the next frequency output slot, with the header values of a_entry
+            freq_data* prepare_freq_output( const batch_entry& a_entry );
+
     };
 
     class frequency_transform_binding : public sandfly::_node_binding< frequency_transform, frequency_transform_binding >
@@ -0,0 +1,299 @@
+/*
+ * packet_capture.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_capture.hh"
+
+#include "psyllid_error.hh"
+#include "rx_timestamp.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( packet_capture, "packet-capture", packet_capture_binding );
+
+    LOGGER( plog, "packet_capture" );
+
+    static const size_t s_ip_udp_header_size = 28;
+
+    packet_capture::packet_capture() :
+            f_length( 10 ),
+            f_filename( "capture.pcap" ),
+            f_max_packets( 0 ),
+            f_buffer_size( 16777216 ),
+            f_fd( -1 ),
+            f_write_buffer(),
+            f_write_buffer_used( 0 ),
+            f_packets_captured( 0 ),
+            f_bytes_written( 0 )
+    {
+    }
+
+    packet_capture::~packet_capture()
+    {
+        close_file();
+    }
+
+    void packet_capture::initialize()
+    {
+        out_buffer< 0 >().initialize( f_length );
+
+        f_fd = ::open( f_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+        if( f_fd < 0 )
+        {
+            f_fd = -1;
+            throw error() << "[packet_capture] Unable to open capture file <" << f_filename << ">:\n\t" << strerror( errno );
+        }
+
+        f_write_buffer.resize( std::max( f_buffer_size, 65536U ) );
+        f_write_buffer_used = 0;
+        f_packets_captured = 0;
+        f_bytes_written = 0;
+
+        pcap_file_header t_header;
+        t_header.f_magic = s_pcap_magic_nsec;
+        t_header.f_version_major = 2;
+        t_header.f_version_minor = 4;
+        t_header.f_thiszone = 0;
+        t_header.f_sigfigs = 0;
+        t_header.f_snaplen = 65535;
+        t_header.f_linktype = s_pcap_linktype_ipv4;
+        ::memcpy( f_write_buffer.data(), &t_header, sizeof(pcap_file_header) );
+        f_write_buffer_used = sizeof(pcap_file_header);
+
+        LINFO( plog, "Capturing packets to <" << f_filename << ">" );
+        return;
+    }
+
+    void packet_capture::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet capture" );
+
+            memory_block* t_block_in = nullptr;
+
+            LINFO( plog, "Starting main loop (packet capture)" );
+            while( ! is_canceled() )
+            {
+                if( out_stream< 0 >().get() == stream::s_stop )
+                {
+                    LWARN( plog, "Output stream(s) have stop condition" );
+                    break;
+                }
+
+                midge::enum_t t_in_cmd = in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error )
+                {
+                    LDEBUG( plog, "got an s_error on slot <" << in_stream< 0 >().get_current_index() << ">" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "got an s_exit on slot <" << in_stream< 0 >().get_current_index() << ">" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    LDEBUG( plog, "got an s_stop on slot <" << in_stream< 0 >().get_current_index() << ">" );
+                    flush();
+                    if( ! out_stream< 0 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream error while stopping";
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    LDEBUG( plog, "got an s_start on slot <" << in_stream< 0 >().get_current_index() << ">" );
+                    if( ! out_stream< 0 >().set( stream::s_start ) ) throw midge::node_nonfatal_error() << "Stream error while starting";
+                    continue;
+                }
+                if( t_in_cmd == stream::s_run )
+                {
+                    t_block_in = in_stream< 0 >().data();
+
+                    if( f_max_packets == 0 || f_packets_captured < f_max_packets )
+                    {
+                        capture( *t_block_in );
+                        if( f_packets_captured == f_max_packets )
+                        {
+                            LINFO( plog, "Captured the requested " << f_max_packets << " packets; later packets will not be captured" );
+                            flush();
+                        }
+                    }
+
+                    // the input slot gets the output slot's old memory, which the receiver will overwrite
+                    out_stream< 0 >().data()->swap( *t_block_in );
+                    if( ! out_stream< 0 >().set( stream::s_run ) )
+                    {
+                        LERROR( plog, "Exiting due to stream error" );
+                        break;
+                    }
+                }
+            }
+
+            LINFO( plog, "Packet capture is exiting" );
+            flush();
+            LINFO( plog, "Captured " << f_packets_captured << " packets (" << f_bytes_written << " bytes written to <" << f_filename << ">)" );
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output stream" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output stream" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void packet_capture::finalize()
+    {
+        close_file();
+        out_buffer< 0 >().finalize();
+        return;
+    }
+
+    void packet_capture::capture( const memory_block& a_block )
+    {
+        size_t t_payload_len = std::min( a_block.get_n_bytes_used(), size_t(65535 - s_ip_udp_header_size) );
+        size_t t_record_len = sizeof(pcap_record_header) + s_ip_udp_header_size + t_payload_len;
+        if( f_write_buffer_used + t_record_len > f_write_buffer.size() ) flush();
+        if( t_record_len > f_write_buffer.size() ) f_write_buffer.resize( t_record_len );
+
+        uint8_t* t_record = f_write_buffer.data() + f_write_buffer_used;
+
+        uint64_t t_time_ns = a_block.get_rx_timestamp_ns();
+        if( t_time_ns == 0 )
+        {
+            t_time_ns = rx_clock_now_ns();
+        }
+
+        pcap_record_header t_rec_header;
+        t_rec_header.f_ts_sec = t_time_ns / 1000000000;
+        t_rec_header.f_ts_frac = t_time_ns % 1000000000;
+        t_rec_header.f_incl_len = s_ip_udp_header_size + t_payload_len;
+        t_rec_header.f_orig_len = t_rec_header.f_incl_len;
+        ::memcpy( t_record, &t_rec_header, sizeof(pcap_record_header) );
+        t_record += sizeof(pcap_record_header);
+
+        // IPv4 header: no options, don't fragment, UDP; the destination address isn't known
+        uint16_t t_ip_header[ 10 ];
+        uint16_t t_total_len = s_ip_udp_header_size + t_payload_len;
+        uint32_t t_source_address = a_block.get_source_address();
+        t_ip_header[ 0 ] = htons( 0x4500 );
+        t_ip_header[ 1 ] = htons( t_total_len );
+        t_ip_header[ 2 ] = 0;
+        t_ip_header[ 3 ] = htons( 0x4000 );
+        t_ip_header[ 4 ] = htons( 0x4011 ); // TTL 64, protocol 17
+        t_ip_header[ 5 ] = 0;
+        ::memcpy( &t_ip_header[ 6 ], &t_source_address, sizeof(uint32_t) );
+        t_ip_header[ 8 ] = 0;
+        t_ip_header[ 9 ] = 0;
+        uint32_t t_sum = 0;
+        for( unsigned i_word = 0; i_word < 10; ++i_word ) t_sum += t_ip_header[ i_word ];
+        while( t_sum >> 16 ) t_sum = ( t_sum & 0xffff ) + ( t_sum >> 16 );
+        t_ip_header[ 5 ] = ~uint16_t(t_sum);
+        ::memcpy( t_record, t_ip_header, 20 );
+        t_record += 20;
+
+        // UDP header: the source port isn't known, and the checksum is left out (allowed for UDP over IPv4)
+        uint16_t t_udp_header[ 4 ];
+        t_udp_header[ 0 ] = 0;
+        t_udp_header[ 1 ] = htons( a_block.get_dest_port() );
+        t_udp_header[ 2 ] = htons( uint16_t(8 + t_payload_len) );
+        t_udp_header[ 3 ] = 0;
+        ::memcpy( t_record, t_udp_header, 8 );
+        t_record += 8;
+
+        ::memcpy( t_record, a_block.block(), t_payload_len );
+
+        f_write_buffer_used += t_record_len;
+        ++f_packets_captured;
+        return;
+    }
+
+    void packet_capture::flush()
+    {
+        if( f_fd < 0 ) return;
+        size_t t_written = 0;
+        while( t_written < f_write_buffer_used )
+        {
+            ssize_t t_ret = ::write( f_fd, f_write_buffer.data() + t_written, f_write_buffer_used - t_written );
+            if( t_ret < 0 )
+            {
+                if( errno == EINTR ) continue;
+                throw error() << "[packet_capture] Unable to write to capture file <" << f_filename << ">:\n\t" << strerror( errno );
+            }
+            t_written += t_ret;
+        }
+        f_bytes_written += t_written;
+        f_write_buffer_used = 0;
+        return;
+    }
+
+    void packet_capture::close_file()
+    {
+        if( f_fd < 0 ) return;
+        try
+        {
+            flush();
+        }
+        catch( std::exception& e )
+        {
+            LERROR( plog, e.what() );
+        }
+        ::close( f_fd );
+        f_fd = -1;
+        return;
+    }
+
+
+    packet_capture_binding::packet_capture_binding() :
+            sandfly::_node_binding< packet_capture, packet_capture_binding >()
+    {
+    }
+
+    packet_capture_binding::~packet_capture_binding()
+    {
+    }
+
+    void packet_capture_binding::do_apply_config( packet_capture* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_capture with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->filename() = a_config.get_value( "filename", a_node->filename() );
+        a_node->set_max_packets( a_config.get_value( "max-packets", a_node->get_max_packets() ) );
+        a_node->set_buffer_size( a_config.get_value( "buffer-size", a_node->get_buffer_size() ) );
+        return;
+    }
+
+    void packet_capture_binding::do_dump_config( const packet_capture* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_capture" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "filename", scarab::param_value( a_node->filename() ) );
+        a_config.add( "max-packets", scarab::param_value( a_node->get_max_packets() ) );
+        a_config.add( "buffer-size", scarab::param_value( a_node->get_buffer_size() ) );
+        return;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,133 @@
+/*
+ * packet_capture.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_CAPTURE_HH_
+#define PSYLLID_PACKET_CAPTURE_HH_
+
+#include "memory_block.hh"
+#include "node_builder.hh"
+
+#include "transformer.hh"
+
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+    // pcap file format (https://www.tcpdump.org/manpages/pcap-savefile.5.html), shared by packet_capture and packet_replay
+    struct pcap_file_header
+    {
+        uint32_t f_magic;
+        uint16_t f_version_major;
+        uint16_t f_version_minor;
+        int32_t f_thiszone;
+        uint32_t f_sigfigs;
+        uint32_t f_snaplen;
+        uint32_t f_linktype;
+    };
+
+    struct pcap_record_header
+    {
+        uint32_t f_ts_sec;
+        uint32_t f_ts_frac; // us or ns, depending on the magic number
+        uint32_t f_incl_len;
+        uint32_t f_orig_len;
+    };
+
+    static const uint32_t s_pcap_magic_usec = 0xa1b2c3d4;
+    static const uint32_t s_pcap_magic_nsec = 0xa1b23c4d;
+
+    static const uint32_t s_pcap_linktype_ethernet = 1;
+    static const uint32_t s_pcap_linktype_raw = 101;
+    static const uint32_t s_pcap_linktype_ipv4 = 228;
+
+    /*!
+     @class packet_capture
+     @author N. S. Oblath
+
+     @brief Writes every packet that passes through it to a pcap file, without parsing it
+
+     @details
+     The node sits between a packet receiver (or packet_demux) and the tf_roach_receiver, and passes its input on
+     unchanged, without copying (the input memory_block is swapped with the output slot's memory_block).
+     Packets are captured before tf_roach_receiver byte-swaps them, so the file holds the packets as they came off
+     the wire, and packet_replay can feed them back into the chain bit-for-bit.
+
+     The file uses the pcap format with nanosecond timestamps and link type LINKTYPE_IPV4, so it can also be read
+     with tcpdump, Wireshark, etc.  Each record is the UDP payload behind a 28-byte IPv4+UDP header that's filled
+     in from the memory_block's metadata (source address and destination port, where the receiver records them).
+     The record time is the kernel receive time if the receiver recorded it, and the capture time otherwise.
+
+     Records are collected in a memory buffer and written with one system call each time it fills, so the
+     per-packet cost is a copy into the buffer.  Writing blocks this node, though, so the receiver's ring has to
+     absorb the time spent in the file system; the disk must keep up with the packet data rate on average.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node type: "packet-capture"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "filename": string -- Path of the pcap file; an existing file is overwritten (default is "capture.pcap")
+     - "max-packets": uint -- Number of packets to capture; later packets are passed on without being captured; 0 (default) is no limit
+     - "buffer-size": uint -- Size of the write buffer in bytes (default is 16 MiB)
+
+     Input Stream:
+     - 0: memory_block
+
+     Output Stream:
+     - 0: memory_block
+    */
+    class packet_capture : public midge::_transformer< midge::type_list< memory_block >, midge::type_list< memory_block > >
+    {
+        public:
+            packet_capture();
+            virtual ~packet_capture();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_referrable( std::string, filename );
+            mv_accessible( uint64_t, max_packets );
+            mv_accessible( unsigned, buffer_size );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            void capture( const memory_block& a_block );
+            void flush();
+            void close_file();
+
+            int f_fd;
+            std::vector< uint8_t > f_write_buffer;
+            size_t f_write_buffer_used;
+
+            uint64_t f_packets_captured;
+            uint64_t f_bytes_written;
+    };
+
+
+    class packet_capture_binding : public sandfly::_node_binding< packet_capture, packet_capture_binding >
+    {
+        public:
+            packet_capture_binding();
+            virtual ~packet_capture_binding();
+
+        private:
+            virtual void do_apply_config( packet_capture* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const packet_capture* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_CAPTURE_HH_ */
@@ -0,0 +1,368 @@
+/*
+ * packet_demux.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_demux.hh"
+
+#include "byte_swap.hh"
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <sstream>
+#include <string>
+#include <string.h>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( packet_demux_2, "packet-demux-2", packet_demux_2_binding );
+    REGISTER_NODE_AND_BUILDER( packet_demux_3, "packet-demux-3", packet_demux_3_binding );
+    REGISTER_NODE_AND_BUILDER( packet_demux_4, "packet-demux-4", packet_demux_4_binding );
+
+    LOGGER( plog, "packet_demux" );
+
+
+    //************************
+    // packet_demux_router
+    //************************
+
+    packet_demux_router::packet_demux_router() :
+            f_route_by( "digital-id" ),
+            f_routes(),
+            f_key_type( key_type::digital_id ),
+            f_route_keys(),
+            f_packets_routed(),
+            f_packets_unrouted( 0 )
+    {
+    }
+
+    packet_demux_router::~packet_demux_router()
+    {
+    }
+
+    void packet_demux_router::build_routing_table( unsigned a_n_outputs )
+    {
+        if( f_route_by == "digital-id" ) f_key_type = key_type::digital_id;
+        else if( f_route_by == "source-ip" ) f_key_type = key_type::source_ip;
+        else if( f_route_by == "dest-port" ) f_key_type = key_type::dest_port;
+        else
+        {
+            throw error() << "[packet_demux] Unknown routing key <" << f_route_by << ">; options are \"digital-id\", \"source-ip\", and \"dest-port\"";
+        }
+
+        if( f_routes.size() != a_n_outputs )
+        {
+            throw error() << "[packet_demux] There must be one route per output; " << a_n_outputs << " outputs and " << f_routes.size() << " routes were given";
+        }
+
+        f_route_keys.clear();
+        for( const std::string& t_route : f_routes )
+        {
+            uint32_t t_key = 0;
+            if( f_key_type == key_type::source_ip )
+            {
+                in_addr t_address;
+                if( ::inet_pton( AF_INET, t_route.c_str(), &t_address ) != 1 )
+                {
+                    throw error() << "[packet_demux] Invalid source IP address <" << t_route << ">";
+                }
+                t_key = t_address.s_addr;
+            }
+            else
+            {
+                try
+                {
+                    t_key = std::stoul( t_route );
+                }
+                catch( std::exception& )
+                {
+                    throw error() << "[packet_demux] Invalid " << f_route_by << " <" << t_route << ">";
+                }
+            }
+            if( std::find( f_route_keys.begin(), f_route_keys.end(), t_key ) != f_route_keys.end() )
+            {
+                throw error() << "[packet_demux] Route <" << t_route << "> was given more than once";
+            }
+            f_route_keys.push_back( t_key );
+        }
+
+        f_packets_routed.assign( a_n_outputs, 0 );
+        f_packets_unrouted = 0;
+        return;
+    }
+
+    int packet_demux_router::route( const memory_block& a_block ) const
+    {
+        uint32_t t_key = 0;
+        switch( f_key_type )
+        {
+            case key_type::digital_id:
+            {
+                // the first header word is big-endian on the wire; see roach_packet
+                if( a_block.get_n_bytes_used() < sizeof(uint64_t) ) return -1;
+                uint64_t t_word_0;
+                ::memcpy( &t_word_0, a_block.block(), sizeof(uint64_t) );
+                t_key = ( be64toh( t_word_0 ) >> 52 ) & 0x3f;
+                break;
+            }
+            case key_type::source_ip:
+                t_key = a_block.get_source_address();
+                break;
+            case key_type::dest_port:
+                t_key = a_block.get_dest_port();
+                break;
+        }
+
+        for( unsigned i_output = 0; i_output < f_route_keys.size(); ++i_output )
+        {
+            if( f_route_keys[ i_output ] == t_key ) return i_output;
+        }
+        return -1;
+    }
+
+    void packet_demux_router::log_stats( const std::string& a_name ) const
+    {
+        std::stringstream t_counts;
+        for( unsigned i_output = 0; i_output < f_packets_routed.size(); ++i_output )
+        {
+            t_counts << "\n\toutput " << i_output << " (" << f_route_by << " " << f_routes[ i_output ] << "): " << f_packets_routed[ i_output ];
+        }
+        LINFO( plog, "Packets routed by <" << a_name << ">:" << t_counts.str() << "\n\tunrouted (dropped): " << f_packets_unrouted );
+        return;
+    }
+
+
+    //************************
+    // _packet_demux
+    //************************
+
+    template< unsigned x_n_outputs >
+    _packet_demux< x_n_outputs >::_packet_demux() :
+            packet_demux_router(),
+            f_length( 10 )
+    {
+    }
+
+    template< unsigned x_n_outputs >
+    _packet_demux< x_n_outputs >::~_packet_demux()
+    {
+    }
+
+    template< unsigned x_n_outputs >
+    void _packet_demux< x_n_outputs >::initialize()
+    {
+        build_routing_table( x_n_outputs );
+        set_all_buffers( std::make_index_sequence< x_n_outputs >() );
+        return;
+    }
+
+    template< unsigned x_n_outputs >
+    template< std::size_t... x_indices >
+    void _packet_demux< x_n_outputs >::set_all_buffers( std::index_sequence< x_indices... > )
+    {
+        ( this->template out_buffer< x_indices >().initialize( f_length ), ... );
+        return;
+    }
+
+    template< unsigned x_n_outputs >
+    template< std::size_t... x_indices >
+    void _packet_demux< x_n_outputs >::finalize_all_buffers( std::index_sequence< x_indices... > )
+    {
+        ( this->template out_buffer< x_indices >().finalize(), ... );
+        return;
+    }
+
+    template< unsigned x_n_outputs >
+    template< std::size_t... x_indices >
+    bool _packet_demux< x_n_outputs >::set_all( midge::enum_t a_command, std::index_sequence< x_indices... > )
+    {
+        // every output is set, even if an earlier one fails
+        bool t_ok = true;
+        ( ( t_ok = this->template out_stream< x_indices >().set( a_command ) && t_ok ), ... );
+        return t_ok;
+    }
+
+    template< unsigned x_n_outputs >
+    template< std::size_t... x_indices >
+    bool _packet_demux< x_n_outputs >::any_stopped( std::index_sequence< x_indices... > )
+    {
+        return ( ( this->template out_stream< x_indices >().get() == stream::s_stop ) || ... );
+    }
+
+    template< unsigned x_n_outputs >
+    template< std::size_t... x_indices >
+    bool _packet_demux< x_n_outputs >::forward( unsigned a_output, memory_block* a_block, std::index_sequence< x_indices... > )
+    {
+        bool t_ok = true;
+        ( ( a_output == x_indices ? ( t_ok = forward_to< x_indices >( a_block ) ) : true ), ... );
+        return t_ok;
+    }
+
+    template< unsigned x_n_outputs >
+    template< std::size_t x_index >
+    bool _packet_demux< x_n_outputs >::forward_to( memory_block* a_block )
+    {
+        // the input slot gets the output slot's old memory, which the receiver will overwrite
+        this->template out_stream< x_index >().data()->swap( *a_block );
+        return this->template out_stream< x_index >().set( stream::s_run );
+    }
+
+    template< unsigned x_n_outputs >
+    void _packet_demux< x_n_outputs >::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet demux with " << x_n_outputs << " outputs" );
+
+            const std::make_index_sequence< x_n_outputs > t_outputs;
+
+            memory_block* t_block_in = nullptr;
+            int t_output = -1;
+
+            LINFO( plog, "Starting main loop (packet demux)" );
+            while( ! this->is_canceled() )
+            {
+                // stop if any output stream has s_stop
+                if( any_stopped( t_outputs ) )
+                {
+                    LWARN( plog, "Output stream(s) have stop condition" );
+                    break;
+                }
+
+                midge::enum_t t_in_cmd = this->template in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error )
+                {
+                    LDEBUG( plog, "got an s_error on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "got an s_exit on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    LDEBUG( plog, "got an s_stop on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    if( ! set_all( stream::s_stop, t_outputs ) ) throw midge::node_nonfatal_error() << "Stream error while stopping";
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    LDEBUG( plog, "got an s_start on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    if( ! set_all( stream::s_start, t_outputs ) ) throw midge::node_nonfatal_error() << "Stream error while starting";
+                    continue;
+                }
+                if( t_in_cmd == stream::s_run )
+                {
+                    t_block_in = this->template in_stream< 0 >().data();
+
+                    t_output = route( *t_block_in );
+                    if( t_output < 0 )
+                    {
+                        ++f_packets_unrouted;
+                        continue;
+                    }
+                    ++f_packets_routed[ t_output ];
+
+                    LTRACE( plog, "Routing packet to output <" << t_output << ">" );
+                    if( ! forward( t_output, t_block_in, t_outputs ) )
+                    {
+                        LERROR( plog, "Exiting due to stream error" );
+                        break;
+                    }
+                }
+            }
+
+            LINFO( plog, "Packet demux is exiting" );
+            log_stats( this->get_name() );
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! set_all( stream::s_stop, t_outputs ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            set_all( stream::s_exit, t_outputs );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    template< unsigned x_n_outputs >
+    void _packet_demux< x_n_outputs >::finalize()
+    {
+        finalize_all_buffers( std::make_index_sequence< x_n_outputs >() );
+        return;
+    }
+
+
+    //************************
+    // _packet_demux_binding
+    //************************
+
+    template< unsigned x_n_outputs >
+    _packet_demux_binding< x_n_outputs >::_packet_demux_binding() :
+            sandfly::_node_binding< _packet_demux< x_n_outputs >, _packet_demux_binding< x_n_outputs > >()
+    {
+    }
+
+    template< unsigned x_n_outputs >
+    _packet_demux_binding< x_n_outputs >::~_packet_demux_binding()
+    {
+    }
+
+    template< unsigned x_n_outputs >
+    void _packet_demux_binding< x_n_outputs >::do_apply_config( _packet_demux< x_n_outputs >* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_demux with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->route_by() = a_config.get_value( "route-by", a_node->route_by() );
+        if( a_config.has( "routes" ) )
+        {
+            a_node->routes().clear();
+            const scarab::param_array& t_routes = a_config["routes"].as_array();
+            for( unsigned i_route = 0; i_route < t_routes.size(); ++i_route )
+            {
+                a_node->routes().push_back( t_routes[ i_route ]().as_string() );
+            }
+        }
+        return;
+    }
+
+    template< unsigned x_n_outputs >
+    void _packet_demux_binding< x_n_outputs >::do_dump_config( const _packet_demux< x_n_outputs >* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_demux" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "route-by", scarab::param_value( a_node->route_by() ) );
+        scarab::param_array t_routes;
+        for( const std::string& t_route : a_node->routes() )
+        {
+            t_routes.push_back( scarab::param_value( t_route ) );
+        }
+        a_config.add( "routes", t_routes );
+        return;
+    }
+
+    template class _packet_demux< 2 >;
+    template class _packet_demux< 3 >;
+    template class _packet_demux< 4 >;
+
+    template class _packet_demux_binding< 2 >;
+    template class _packet_demux_binding< 3 >;
+    template class _packet_demux_binding< 4 >;
+
+} /* namespace psyllid */
@@ -0,0 +1,173 @@
+/*
+ * packet_demux.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_DEMUX_HH_
+#define PSYLLID_PACKET_DEMUX_HH_
+
+#include "memory_block.hh"
+#include "node_builder.hh"
+
+#include "transformer.hh"
+
+#include <utility>
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+    template< class x_type, std::size_t >
+    using demux_repeat_type = x_type;
+
+    template< class x_type, class x_indices >
+    struct demux_type_list;
+
+    template< class x_type, std::size_t... x_indices >
+    struct demux_type_list< x_type, std::index_sequence< x_indices... > >
+    {
+        typedef midge::type_list< demux_repeat_type< x_type, x_indices >... > type;
+    };
+
+    /*!
+     @class packet_demux_router
+     @author N. S. Oblath
+
+     @brief Routing table and statistics shared by the packet_demux nodes
+
+     @details
+     The routing key of a packet is one of:
+     - "digital-id": the ROACH digital channel ID, read from the packet header (works with any packet receiver)
+     - "source-ip": the IPv4 source address recorded by the packet receiver
+     - "dest-port": the UDP destination port recorded by the packet receiver
+
+     Entry i of the routes is the key value that's sent to output i.
+    */
+    class packet_demux_router
+    {
+        public:
+            packet_demux_router();
+            virtual ~packet_demux_router();
+
+        public:
+            mv_referrable( std::string, route_by );             /// "digital-id", "source-ip", or "dest-port"
+            mv_referrable( std::vector< std::string >, routes ); /// Key value for each output
+
+        protected:
+            /// Converts the routes into keys; throws if they're invalid for a demux with a_n_outputs outputs
+            void build_routing_table( unsigned a_n_outputs );
+
+            /// Returns the output to which the packet should go, or -1 if it matches no route
+            int route( const memory_block& a_block ) const;
+
+            void log_stats( const std::string& a_name ) const;
+
+            enum class key_type
+            {
+                digital_id,
+                source_ip,
+                dest_port
+            };
+            key_type f_key_type;
+            std::vector< uint32_t > f_route_keys;
+
+            std::vector< uint64_t > f_packets_routed; // per output
+            uint64_t f_packets_unrouted;
+    };
+
+    /*!
+     @class _packet_demux
+     @author N. S. Oblath
+
+     @brief Routes raw packets from one packet receiver to one of several output streams
+
+     @details
+     With this node a single packet receiver can serve several ROACH channels: the receiver's ring is walked and each
+     packet is parsed once, and the demux sends each packet to the stream for its channel (e.g. a tf_roach_receiver per channel).
+
+     Packets are not copied: the input memory_block is swapped with the output slot's memory_block, which hands the
+     input slot's previous contents back to the receiver to be overwritten.  With a zero-copy receiver, the
+     views into the ring are passed along, so the ring must have room for the blocks held by the receiver's
+     buffer plus all of the demux output buffers.
+
+     Packets that match no route are dropped and counted.  The packet counts are logged when the node exits.
+
+     Node types: "packet-demux-2", "packet-demux-3", "packet-demux-4"
+
+     Available configuration values:
+     - "route-by": string -- Routing key: "digital-id" (default), "source-ip", or "dest-port"
+     - "routes": array -- Key value sent to each output, in output order (e.g. [0, 1, 3] for digital IDs, or ["192.168.1.2", "192.168.1.3"] for source addresses); one entry per output
+     - "length": uint -- The size of the output buffers
+
+     Input Stream:
+     - 0: memory_block
+
+     Output Streams:
+     - 0 .. N-1: memory_block
+    */
+    template< unsigned x_n_outputs >
+    class _packet_demux :
+            public midge::_transformer< midge::type_list< memory_block >, typename demux_type_list< memory_block, std::make_index_sequence< x_n_outputs > >::type >,
+            public packet_demux_router
+    {
+        public:
+            _packet_demux();
+            virtual ~_packet_demux();
+
+        public:
+            mv_accessible( uint64_t, length );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            template< std::size_t... x_indices >
+            void set_all_buffers( std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            void finalize_all_buffers( std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            bool set_all( midge::enum_t a_command, std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            bool any_stopped( std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            bool forward( unsigned a_output, memory_block* a_block, std::index_sequence< x_indices... > );
+
+            template< std::size_t x_index >
+            bool forward_to( memory_block* a_block );
+    };
+
+    typedef _packet_demux< 2 > packet_demux_2;
+    typedef _packet_demux< 3 > packet_demux_3;
+    typedef _packet_demux< 4 > packet_demux_4;
+
+    template< unsigned x_n_outputs >
+    class _packet_demux_binding : public sandfly::_node_binding< _packet_demux< x_n_outputs >, _packet_demux_binding< x_n_outputs > >
+    {
+        public:
+            _packet_demux_binding();
+            virtual ~_packet_demux_binding();
+
+        private:
+            virtual void do_apply_config( _packet_demux< x_n_outputs >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _packet_demux< x_n_outputs >* a_node, scarab::param_node& a_config ) const;
+    };
+
+    typedef _packet_demux_binding< 2 > packet_demux_2_binding;
+    typedef _packet_demux_binding< 3 > packet_demux_3_binding;
+    typedef _packet_demux_binding< 4 > packet_demux_4_binding;
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_DEMUX_HH_ */
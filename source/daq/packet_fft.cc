@@ -0,0 +1,313 @@
+/*
+ * packet_fft.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_fft.hh"
+
+#include "psyllid_error.hh"
+
+#include <cmath>
+
+// the SIMD kernels are only used in single precision
+#if defined(FFTWF_FOUND) && ( defined(__x86_64__) || defined(__i386__) )
+#define PSYLLID_X86_FFT_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace psyllid
+{
+
+    namespace
+    {
+        // rounds half away from zero (as std::round does) and saturates to the int8 range
+        template< class x_real >
+        inline int8_t round_to_int8( x_real a_value )
+        {
+            x_real t_rounded = std::round( a_value );
+            if( t_rounded > x_real(127) ) return 127;
+            if( t_rounded < x_real(-128) ) return -128;
+            return static_cast< int8_t >( t_rounded );
+        }
+
+        template< class x_real >
+        void widen_scalar( const int8_t* a_src, x_real* a_dest, unsigned a_n_values )
+        {
+            for( unsigned i_value = 0; i_value < a_n_values; ++i_value )
+            {
+                a_dest[ i_value ] = static_cast< x_real >( a_src[ i_value ] );
+            }
+            return;
+        }
+
+        template< class x_real >
+        void scale_round_scalar( const x_real* a_src, x_real a_norm, int8_t* a_dest, unsigned a_n_values )
+        {
+            for( unsigned i_value = 0; i_value < a_n_values; ++i_value )
+            {
+                a_dest[ i_value ] = round_to_int8( a_src[ i_value ] * a_norm );
+            }
+            return;
+        }
+
+#ifdef PSYLLID_X86_FFT_KERNELS
+        __attribute__(( target("avx2") ))
+        void widen_avx2( const int8_t* a_src, float* a_dest, unsigned a_n_values )
+        {
+            unsigned i_value = 0;
+            for( ; i_value + 32 <= a_n_values; i_value += 32 )
+            {
+                __m256i t_bytes = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( a_src + i_value ) );
+                __m128i t_low = _mm256_castsi256_si128( t_bytes );
+                __m128i t_high = _mm256_extracti128_si256( t_bytes, 1 );
+                _mm256_storeu_ps( a_dest + i_value,      _mm256_cvtepi32_ps( _mm256_cvtepi8_epi32( t_low ) ) );
+                _mm256_storeu_ps( a_dest + i_value + 8,  _mm256_cvtepi32_ps( _mm256_cvtepi8_epi32( _mm_srli_si128( t_low, 8 ) ) ) );
+                _mm256_storeu_ps( a_dest + i_value + 16, _mm256_cvtepi32_ps( _mm256_cvtepi8_epi32( t_high ) ) );
+                _mm256_storeu_ps( a_dest + i_value + 24, _mm256_cvtepi32_ps( _mm256_cvtepi8_epi32( _mm_srli_si128( t_high, 8 ) ) ) );
+            }
+            widen_scalar( a_src + i_value, a_dest + i_value, a_n_values - i_value );
+            return;
+        }
+
+        // the same rounding as round_to_int8(): truncate, then step away from zero if the dropped fraction is at least 1/2
+        __attribute__(( target("avx2") ))
+        inline __m256i round_saturate_avx2( __m256 a_values )
+        {
+            const __m256 t_sign_mask = _mm256_set1_ps( -0.f );
+            __m256 t_truncated = _mm256_round_ps( a_values, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC );
+            __m256 t_fraction = _mm256_andnot_ps( t_sign_mask, _mm256_sub_ps( a_values, t_truncated ) );
+            __m256 t_step = _mm256_or_ps( _mm256_and_ps( a_values, t_sign_mask ), _mm256_set1_ps( 1.f ) );
+            __m256 t_round_away = _mm256_cmp_ps( t_fraction, _mm256_set1_ps( 0.5f ), _CMP_GE_OQ );
+            __m256 t_rounded = _mm256_add_ps( t_truncated, _mm256_and_ps( t_round_away, t_step ) );
+            t_rounded = _mm256_min_ps( _mm256_max_ps( t_rounded, _mm256_set1_ps( -128.f ) ), _mm256_set1_ps( 127.f ) );
+            return _mm256_cvttps_epi32( t_rounded );
+        }
+
+        __attribute__(( target("avx2") ))
+        void scale_round_avx2( const float* a_src, float a_norm, int8_t* a_dest, unsigned a_n_values )
+        {
+            const __m256 t_norm = _mm256_set1_ps( a_norm );
+            // the packs work within 128-bit lanes, leaving the 4-byte groups in the order a0 b0 c0 d0 a1 b1 c1 d1
+            const __m256i t_order = _mm256_setr_epi32( 0, 4, 1, 5, 2, 6, 3, 7 );
+            unsigned i_value = 0;
+            for( ; i_value + 32 <= a_n_values; i_value += 32 )
+            {
+                __m256i t_a = round_saturate_avx2( _mm256_mul_ps( _mm256_loadu_ps( a_src + i_value ), t_norm ) );
+                __m256i t_b = round_saturate_avx2( _mm256_mul_ps( _mm256_loadu_ps( a_src + i_value + 8 ), t_norm ) );
+                __m256i t_c = round_saturate_avx2( _mm256_mul_ps( _mm256_loadu_ps( a_src + i_value + 16 ), t_norm ) );
+                __m256i t_d = round_saturate_avx2( _mm256_mul_ps( _mm256_loadu_ps( a_src + i_value + 24 ), t_norm ) );
+                __m256i t_packed = _mm256_packs_epi16( _mm256_packs_epi32( t_a, t_b ), _mm256_packs_epi32( t_c, t_d ) );
+                _mm256_storeu_si256( reinterpret_cast< __m256i* >( a_dest + i_value ), _mm256_permutevar8x32_epi32( t_packed, t_order ) );
+            }
+            scale_round_scalar( a_src + i_value, a_norm, a_dest + i_value, a_n_values - i_value );
+            return;
+        }
+#endif
+    }
+
+    packet_fft::packet_fft( unsigned a_fft_size, unsigned a_batch_size, precision a_precision, unsigned a_fftw_flags ) :
+            f_fft_size( a_fft_size ),
+            f_batch_size( a_batch_size ),
+            f_precision( a_precision ),
+            f_norm( std::sqrt( 1. / double(a_fft_size) ) ),
+            f_use_simd( simd_kernels_available() ),
+            f_input( nullptr ),
+            f_output( nullptr ),
+            f_plan( nullptr )
+#ifdef FFTWF_FOUND
+            , f_input_f( nullptr ),
+            f_output_f( nullptr ),
+            f_plan_f( nullptr )
+#endif
+    {
+        if( f_fft_size == 0 || f_batch_size == 0 )
+        {
+            throw error() << "[packet_fft] The FFT size and the batch size must be at least 1";
+        }
+
+        // one row of fft-size bins per packet, with the rows contiguous in the arrays
+        int t_fft_size = f_fft_size;
+        std::unique_lock< std::mutex > t_lock( planner_mutex() );
+        if( f_precision == precision::double_precision )
+        {
+            f_input = (fftw_complex*) fftw_malloc( sizeof(fftw_complex) * f_fft_size * f_batch_size );
+            f_output = (fftw_complex*) fftw_malloc( sizeof(fftw_complex) * f_fft_size * f_batch_size );
+            f_plan = fftw_plan_many_dft( 1, &t_fft_size, f_batch_size,
+                                         f_input, nullptr, 1, t_fft_size,
+                                         f_output, nullptr, 1, t_fft_size,
+                                         FFTW_FORWARD, a_fftw_flags | FFTW_PRESERVE_INPUT );
+            if( f_plan == nullptr )
+            {
+                fftw_free( f_input );
+                fftw_free( f_output );
+                throw error() << "[packet_fft] Unable to make an FFTW plan for " << f_batch_size << " transforms of size " << f_fft_size;
+            }
+            return;
+        }
+
+#ifdef FFTWF_FOUND
+        f_input_f = (fftwf_complex*) fftwf_malloc( sizeof(fftwf_complex) * f_fft_size * f_batch_size );
+        f_output_f = (fftwf_complex*) fftwf_malloc( sizeof(fftwf_complex) * f_fft_size * f_batch_size );
+        f_plan_f = fftwf_plan_many_dft( 1, &t_fft_size, f_batch_size,
+                                        f_input_f, nullptr, 1, t_fft_size,
+                                        f_output_f, nullptr, 1, t_fft_size,
+                                        FFTW_FORWARD, a_fftw_flags | FFTW_PRESERVE_INPUT );
+        if( f_plan_f == nullptr )
+        {
+            fftwf_free( f_input_f );
+            fftwf_free( f_output_f );
+            throw error() << "[packet_fft] Unable to make a single-precision FFTW plan for " << f_batch_size << " transforms of size " << f_fft_size;
+        }
+#else
+        throw error() << "[packet_fft] Single precision is not available: psyllid was built without the single-precision FFTW library (fftw3f)";
+#endif
+    }
+
+    packet_fft::~packet_fft()
+    {
+        std::unique_lock< std::mutex > t_lock( planner_mutex() );
+        if( f_plan != nullptr )
+        {
+            fftw_destroy_plan( f_plan );
+            fftw_free( f_input );
+            fftw_free( f_output );
+        }
+#ifdef FFTWF_FOUND
+        if( f_plan_f != nullptr )
+        {
+            fftwf_destroy_plan( f_plan_f );
+            fftwf_free( f_input_f );
+            fftwf_free( f_output_f );
+        }
+#endif
+    }
+
+    bool packet_fft::single_precision_available()
+    {
+#ifdef FFTWF_FOUND
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool packet_fft::simd_kernels_available()
+    {
+#ifdef PSYLLID_X86_FFT_KERNELS
+        return __builtin_cpu_supports( "avx2" );
+#else
+        return false;
+#endif
+    }
+
+    packet_fft::precision packet_fft::parse_precision( const std::string& a_name )
+    {
+        if( a_name == "double" ) return precision::double_precision;
+        if( a_name == "single" ) return precision::single_precision;
+        throw error() << "[packet_fft] Unknown precision <" << a_name << ">; use \"double\" or \"single\"";
+    }
+
+    const char* packet_fft::precision_name( precision a_precision )
+    {
+        return a_precision == precision::single_precision ? "single" : "double";
+    }
+
+    bool packet_fft::import_wisdom( precision a_precision, const std::string& a_filename )
+    {
+        std::unique_lock< std::mutex > t_lock( planner_mutex() );
+        if( a_precision == precision::double_precision ) return fftw_import_wisdom_from_filename( a_filename.c_str() ) != 0;
+#ifdef FFTWF_FOUND
+        return fftwf_import_wisdom_from_filename( a_filename.c_str() ) != 0;
+#else
+        return false;
+#endif
+    }
+
+    bool packet_fft::export_wisdom( precision a_precision, const std::string& a_filename )
+    {
+        std::unique_lock< std::mutex > t_lock( planner_mutex() );
+        if( a_precision == precision::double_precision ) return fftw_export_wisdom_to_filename( a_filename.c_str() ) != 0;
+#ifdef FFTWF_FOUND
+        return fftwf_export_wisdom_to_filename( a_filename.c_str() ) != 0;
+#else
+        return false;
+#endif
+    }
+
+    std::mutex& packet_fft::planner_mutex()
+    {
+        static std::mutex s_mutex;
+        return s_mutex;
+    }
+
+    void packet_fft::set_use_simd( bool a_flag )
+    {
+        f_use_simd = a_flag && simd_kernels_available();
+        return;
+    }
+
+    void packet_fft::load( unsigned a_row, const int8_t* a_samples )
+    {
+        unsigned t_n_values = 2 * f_fft_size;
+        if( f_precision == precision::double_precision )
+        {
+            widen_scalar( a_samples, &f_input[ a_row * f_fft_size ][ 0 ], t_n_values );
+            return;
+        }
+#ifdef FFTWF_FOUND
+        float* t_row = &f_input_f[ a_row * f_fft_size ][ 0 ];
+#ifdef PSYLLID_X86_FFT_KERNELS
+        if( f_use_simd )
+        {
+            widen_avx2( a_samples, t_row, t_n_values );
+            return;
+        }
+#endif
+        widen_scalar( a_samples, t_row, t_n_values );
+#endif
+        return;
+    }
+
+    void packet_fft::execute()
+    {
+        if( f_precision == precision::double_precision )
+        {
+            fftw_execute( f_plan );
+            return;
+        }
+#ifdef FFTWF_FOUND
+        fftwf_execute( f_plan_f );
+#endif
+        return;
+    }
+
+    void packet_fft::unfold( unsigned a_row, int8_t* a_dest ) const
+    {
+        // the spectrum has 2 * fft-size values; the upper half (negative frequencies) goes first
+        if( f_precision == precision::double_precision )
+        {
+            const double* t_spectrum = &f_output[ a_row * f_fft_size ][ 0 ];
+            scale_round_scalar( t_spectrum + f_fft_size, f_norm, a_dest, f_fft_size );
+            scale_round_scalar( t_spectrum, f_norm, a_dest + f_fft_size, f_fft_size );
+            return;
+        }
+#ifdef FFTWF_FOUND
+        const float* t_spectrum = &f_output_f[ a_row * f_fft_size ][ 0 ];
+        float t_norm = float(f_norm);
+#ifdef PSYLLID_X86_FFT_KERNELS
+        if( f_use_simd )
+        {
+            scale_round_avx2( t_spectrum + f_fft_size, t_norm, a_dest, f_fft_size );
+            scale_round_avx2( t_spectrum, t_norm, a_dest + f_fft_size, f_fft_size );
+            return;
+        }
+#endif
+        scale_round_scalar( t_spectrum + f_fft_size, t_norm, a_dest, f_fft_size );
+        scale_round_scalar( t_spectrum, t_norm, a_dest + f_fft_size, f_fft_size );
+#endif
+        return;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,132 @@
+/*
+ * packet_fft.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_FFT_HH_
+#define PSYLLID_PACKET_FFT_HH_
+
+#include <fftw3.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace psyllid
+{
+
+    /*!
+     @class packet_fft
+     @author N. S. Oblath
+
+     @brief Computes the spectra of batches of ROACH time packets with FFTW, in double or single precision
+
+     @details
+     Each packet in a batch has a row of fft-size complex bins in the FFT input.  load() widens a packet's int8 IQ samples into its
+     row, execute() transforms all of the rows with one FFTW plan (fftw_plan_many_dft or fftwf_plan_many_dft), and unfold() writes
+     a row's spectrum into a ROACH payload: scaled by 1/sqrt(fft-size), rounded (half away from zero), saturated to the int8 range,
+     and unfolded so that the zero-frequency bin is in the middle (fftshift).
+
+     Double precision buys nothing for 8-bit samples; single precision halves the size of the FFT arrays and doubles the SIMD
+     width.  In single precision, the widening and the unfolding use AVX2 kernels where the CPU supports them.  Single precision
+     needs the single-precision FFTW library (fftw3f; see single_precision_available()).  The two precisions can differ by one
+     count in a bin whose scaled value is within rounding error of a half-integer.
+
+     The plan is made in the constructor, which therefore takes as long as FFTW planning with the given flags.  The FFTW planner
+     is not thread-safe, so planning, destroying plans, and importing and exporting wisdom are serialized with planner_mutex();
+     a packet_fft may be used from any one thread.  Note that creating or destroying a packet_fft waits for any planning that's
+     going on in other threads.
+    */
+    class packet_fft
+    {
+        public:
+            enum class precision
+            {
+                double_precision,
+                single_precision
+            };
+
+            /// Throws psyllid::error if the precision isn't available or FFTW can't make the plan
+            packet_fft( unsigned a_fft_size, unsigned a_batch_size, precision a_precision, unsigned a_fftw_flags );
+            packet_fft( const packet_fft& ) = delete;
+            ~packet_fft();
+
+            packet_fft& operator=( const packet_fft& ) = delete;
+
+            /// Whether psyllid was built with the single-precision FFTW library
+            static bool single_precision_available();
+            /// Whether the single-precision SIMD kernels are built in and supported by this CPU
+            static bool simd_kernels_available();
+
+            /// "double" or "single"
+            static precision parse_precision( const std::string& a_name );
+            static const char* precision_name( precision a_precision );
+
+            /// Wisdom is kept separately for each precision; these return false if the file can't be read or written
+            static bool import_wisdom( precision a_precision, const std::string& a_filename );
+            static bool export_wisdom( precision a_precision, const std::string& a_filename );
+
+            /// Held for all calls to the FFTW planner (in either precision); lock it for any other planner calls (e.g. fftw_plan_with_nthreads)
+            static std::mutex& planner_mutex();
+
+        public:
+            /// Widens a packet's fft-size int8 IQ pairs into the input row a_row
+            void load( unsigned a_row, const int8_t* a_samples );
+
+            /// Transforms all of the rows
+            void execute();
+
+            /// Writes the spectrum in row a_row to a_dest (2 * fft-size int8 values)
+            void unfold( unsigned a_row, int8_t* a_dest ) const;
+
+            unsigned get_fft_size() const;
+            unsigned get_batch_size() const;
+            precision get_precision() const;
+
+            /// Whether the SIMD kernels are used (if they're available, by default); turning them off is for testing
+            bool get_use_simd() const;
+            void set_use_simd( bool a_flag );
+
+        private:
+            unsigned f_fft_size;
+            unsigned f_batch_size;
+            precision f_precision;
+            double f_norm;
+            bool f_use_simd;
+
+            fftw_complex* f_input;
+            fftw_complex* f_output;
+            fftw_plan f_plan;
+
+#ifdef FFTWF_FOUND
+            fftwf_complex* f_input_f;
+            fftwf_complex* f_output_f;
+            fftwf_plan f_plan_f;
+#endif
+    };
+
+    inline unsigned packet_fft::get_fft_size() const
+    {
+        return f_fft_size;
+    }
+
+    inline unsigned packet_fft::get_batch_size() const
+    {
+        return f_batch_size;
+    }
+
+    inline packet_fft::precision packet_fft::get_precision() const
+    {
+        return f_precision;
+    }
+
+    inline bool packet_fft::get_use_simd() const
+    {
+        return f_use_simd;
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_FFT_HH_ */
@@ -8,12 +8,15 @@
 #include "packet_receiver_fpa.hh"
 
 #include "psyllid_error.hh"
+#include "receiver_stats_house.hh"
 
 #include "logger.hh"
 #include "param.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <errno.h>
+#include <linux/filter.h>
 #include <linux/if_ether.h>
 #include <linux/ip.h>
 #include <linux/udp.h>
@@ -27,6 +30,7 @@
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <thread>
 
 // debug
 #ifndef NDEBUG
@@ -45,16 +49,36 @@ namespace psyllid
             f_length( 10 ),
             f_max_packet_size( 1048576 ),
             f_port( 23530 ),
+            f_extra_ports(),
             f_interface( "eth1" ),
             f_timeout_sec( 1 ),
             f_n_blocks( 64 ),
             f_block_size( 1 << 22 ),
             f_frame_size( 1 << 14 ),
+            f_block_timeout_ms( 60 ),
+            f_spin_count( 0 ),
+            f_busy_poll_usec( 0 ),
+            f_prefer_busy_poll( false ),
+            f_n_fanout_sockets( 1 ),
+            f_fanout_mode( "hash" ),
+            f_fanout_group_id( 0 ),
+            f_zero_copy( false ),
+            f_kernel_filter( true ),
+            f_source_ips(),
+            f_stats_interval_sec( 10 ),
             f_net_interface_index( 0 ),
-            f_socket( 0 ),
-            f_ring(),
+            f_source_addresses(),
+            f_sockets(),
+            f_ring_mapped(),
+            f_out_stream_mutex(),
+            f_stop_walking( false ),
+            f_walker_exception(),
             f_packets_total( 0 ),
-            f_bytes_total( 0 )
+            f_bytes_total( 0 ),
+            f_stats_mutex(),
+            f_last_stats_time(),
+            f_last_stats_packets( 0 ),
+            f_last_stats_bytes( 0 )
     {
     }
 
@@ -76,48 +100,108 @@ namespace psyllid
 
         LDEBUG( plog, "Preparing fast-packet-acquisition on interface " << f_interface << " at UDP port " << f_port );
 
+        if( f_n_fanout_sockets == 0 )
+        {
+            throw error() << "[packet_receiver_fpa] Number of fan-out sockets must be non-zero";
+        }
+
+        // the fan-out argument is only used if there's more than one socket
+        int t_fanout_arg = 0;
+        if( f_n_fanout_sockets > 1 )
+        {
+            int t_fanout_type = 0;
+            if( f_fanout_mode == "hash" ) t_fanout_type = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+            else if( f_fanout_mode == "cpu" ) t_fanout_type = PACKET_FANOUT_CPU;
+            else if( f_fanout_mode == "round-robin" ) t_fanout_type = PACKET_FANOUT_LB;
+            else
+            {
+                throw error() << "[packet_receiver_fpa] Unknown fan-out mode <" << f_fanout_mode << ">; options are \"hash\", \"cpu\", and \"round-robin\"";
+            }
+
+            unsigned t_group_id = f_fanout_group_id;
+            if( t_group_id == 0 ) t_group_id = ( ::getpid() ^ f_port ) & 0xffff;
+            t_fanout_arg = ( t_group_id & 0xffff ) | ( t_fanout_type << 16 );
+            LDEBUG( plog, "Using " << f_n_fanout_sockets << " sockets in fan-out group <" << ( t_group_id & 0xffff ) << "> with mode <" << f_fanout_mode << ">" );
+        }
+
+        f_source_addresses.clear();
+        for( const std::string& t_source_ip : f_source_ips )
+        {
+            in_addr t_address;
+            if( ::inet_pton( AF_INET, t_source_ip.c_str(), &t_address ) != 1 )
+            {
+                throw error() << "[packet_receiver_fpa] Invalid source IP address <" << t_source_ip << ">";
+            }
+            f_source_addresses.push_back( t_address.s_addr );
+        }
+        if( ! f_source_addresses.empty() )
+        {
+            LDEBUG( plog, "Accepting packets from " << f_source_addresses.size() << " source address(es)" );
+        }
+
+        if( f_zero_copy && f_n_blocks <= f_length + 1 )
+        {
+            throw error() << "[packet_receiver_fpa] In zero-copy mode the number of ring blocks (" << f_n_blocks << ") must be larger than the buffer length + 1 (" << f_length + 1 << ")";
+        }
+
+        f_ring_mapped = std::make_shared< std::atomic< bool > >( true );
+        f_sockets.clear();
+        f_sockets.resize( f_n_fanout_sockets );
+        for( fpa_socket& t_socket : f_sockets )
+        {
+            setup_socket( t_socket, t_fanout_arg );
+        }
+
+        LINFO( plog, "Ready to consume packets on interface <" << f_interface << ">" );
+
+        return;
+    }
+
+    void packet_receiver_fpa::setup_socket( fpa_socket& a_socket, int a_fanout_arg )
+    {
         // open socket
-        //int fd;
-        f_socket = ::socket( AF_PACKET, SOCK_RAW, htons(ETH_P_IP) );
-        if( f_socket < 0 )
+        a_socket.f_socket = ::socket( AF_PACKET, SOCK_RAW, htons(ETH_P_IP) );
+        if( a_socket.f_socket < 0 )
         {
+            a_socket.f_socket = 0;
             throw error() << "Could not create socket:\n\t" << strerror( errno );
         }
 
+        // the socket starts receiving as soon as it's created, so filter before anything else
+        if( f_kernel_filter ) attach_filter( a_socket.f_socket );
+
         int t_packet_ver = TPACKET_V3;
-        if( ::setsockopt( f_socket, SOL_PACKET, PACKET_VERSION, &t_packet_ver, sizeof(int) ) < 0 )
+        if( ::setsockopt( a_socket.f_socket, SOL_PACKET, PACKET_VERSION, &t_packet_ver, sizeof(int) ) < 0 )
         {
             throw error() << "Could not set packet version:\n\t" << strerror( errno );
         }
 
         // create the ring buffer
-        //f_ring = new receive_ring();
-        //::memset( f_ring, 0, sizeof(receive_ring) );
-        //::memset( &f_ring->f_req, 0, sizeof(tpacket_req3) );
+        receive_ring& t_ring = a_socket.f_ring;
         LDEBUG( plog, "Ring buffer parameters:\n" <<
                 "block size: " << f_block_size << '\n' <<
                 "frame size: " << f_frame_size << '\n' <<
-                "number of blocks: " << f_n_blocks );
-        f_ring.f_req.tp_block_size = f_block_size;
-        f_ring.f_req.tp_frame_size = f_frame_size;
-        f_ring.f_req.tp_block_nr = f_n_blocks;
-        f_ring.f_req.tp_frame_nr = (f_block_size * f_n_blocks) / f_frame_size;
-        f_ring.f_req.tp_retire_blk_tov = 60;
-        f_ring.f_req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
-
-        //LWARN( plog, "f_ring = " << f_ring );
+                "number of blocks: " << f_n_blocks << '\n' <<
+                "block timeout (ms): " << f_block_timeout_ms );
+        t_ring.f_req.tp_block_size = f_block_size;
+        t_ring.f_req.tp_frame_size = f_frame_size;
+        t_ring.f_req.tp_block_nr = f_n_blocks;
+        t_ring.f_req.tp_frame_nr = (f_block_size * f_n_blocks) / f_frame_size;
+        t_ring.f_req.tp_retire_blk_tov = f_block_timeout_ms;
+        t_ring.f_req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+
 #ifndef NDEBUG
-        bool test = f_ring.f_rd == nullptr;
+        bool test = t_ring.f_rd == nullptr;
         LTRACE( plog, "f_ring.f_rd == nullptr: " << test );
-        test = f_ring.f_map == nullptr;
+        test = t_ring.f_map == nullptr;
         LTRACE( plog, "f_ring.f_map == nullptr: " << test );
 #endif
-        LTRACE( plog, "f_ring.f_req.tp_block_size = " << f_ring.f_req.tp_block_size );
+        LTRACE( plog, "f_ring.f_req.tp_block_size = " << t_ring.f_req.tp_block_size );
 
         LDEBUG( plog, "Opening packet_eater for network interface <" << f_interface << ">" );
 
-        LTRACE( plog, "f_socket = " << f_socket << ";  SOL_PACKET = " << SOL_PACKET << ";  PACKET_RX_RING = " << PACKET_RX_RING << ";  &f_ring.f_req = " << &f_ring.f_req << ";  sizeof(f_ring.f_req) = " << sizeof(f_ring.f_req) );
-        if( ::setsockopt( f_socket, SOL_PACKET, PACKET_RX_RING, &f_ring.f_req, sizeof(f_ring.f_req) ) < 0 )
+        LTRACE( plog, "f_socket = " << a_socket.f_socket << ";  SOL_PACKET = " << SOL_PACKET << ";  PACKET_RX_RING = " << PACKET_RX_RING << ";  &f_ring.f_req = " << &t_ring.f_req << ";  sizeof(f_ring.f_req) = " << sizeof(t_ring.f_req) );
+        if( ::setsockopt( a_socket.f_socket, SOL_PACKET, PACKET_RX_RING, &t_ring.f_req, sizeof(t_ring.f_req) ) < 0 )
         {
             throw error() << "Could not set receive ring:\n\t" << strerror( errno );
         }
@@ -136,26 +220,49 @@ namespace psyllid
             timeval t_timeout;
             t_timeout.tv_sec = f_timeout_sec;
             t_timeout.tv_usec = 0;  // Not init'ing this can cause strange errors
-            ::setsockopt( f_socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&t_timeout, sizeof(struct timeval) );
+            ::setsockopt( a_socket.f_socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&t_timeout, sizeof(struct timeval) );
+        }
+
+        // Busy polling
+        if( f_busy_poll_usec > 0 )
+        {
+            int t_busy_poll = f_busy_poll_usec;
+            if( ::setsockopt( a_socket.f_socket, SOL_SOCKET, SO_BUSY_POLL, &t_busy_poll, sizeof(t_busy_poll) ) < 0 )
+            {
+                LWARN( plog, "Could not set busy polling; continuing without it:\n\t" << strerror( errno ) );
+            }
+            if( f_prefer_busy_poll )
+            {
+#ifdef SO_PREFER_BUSY_POLL
+                int t_prefer = 1;
+                if( ::setsockopt( a_socket.f_socket, SOL_SOCKET, SO_PREFER_BUSY_POLL, &t_prefer, sizeof(t_prefer) ) < 0 )
+                {
+                    LWARN( plog, "Could not set preferred busy polling; continuing without it:\n\t" << strerror( errno ) );
+                }
+#else
+                LWARN( plog, "Preferred busy polling is not available on this system" );
+#endif
+            }
         }
 
         // finish preparing the ring
-        f_ring.f_map = (uint8_t*)::mmap( nullptr, f_ring.f_req.tp_block_size * f_ring.f_req.tp_block_nr,
-                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, f_socket, 0);
-        if( f_ring.f_map == MAP_FAILED )
+        t_ring.f_map = (uint8_t*)::mmap( nullptr, t_ring.f_req.tp_block_size * t_ring.f_req.tp_block_nr,
+                PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, a_socket.f_socket, 0);
+        if( t_ring.f_map == MAP_FAILED )
         {
+            t_ring.f_map = nullptr;
             throw error() << "Unable to setup ring map";
         }
 
-        f_ring.f_rd = (iovec*)::malloc(f_ring.f_req.tp_block_nr * sizeof(*f_ring.f_rd) );
-        if( f_ring.f_rd == nullptr )
+        t_ring.f_rd = (iovec*)::malloc(t_ring.f_req.tp_block_nr * sizeof(*t_ring.f_rd) );
+        if( t_ring.f_rd == nullptr )
         {
             throw error() << "Unable to allocate memory for the ring";
         }
-        for( unsigned i_block = 0; i_block < f_ring.f_req.tp_block_nr; ++i_block )
+        for( unsigned i_block = 0; i_block < t_ring.f_req.tp_block_nr; ++i_block )
         {
-            f_ring.f_rd[ i_block ].iov_base = f_ring.f_map + ( i_block * f_ring.f_req.tp_block_size );
-            f_ring.f_rd[ i_block ].iov_len = f_ring.f_req.tp_block_size;
+            t_ring.f_rd[ i_block ].iov_base = t_ring.f_map + ( i_block * t_ring.f_req.tp_block_size );
+            t_ring.f_rd[ i_block ].iov_len = t_ring.f_req.tp_block_size;
         }
 
         // initialize the address
@@ -168,67 +275,252 @@ namespace psyllid
         t_address.sll_pkttype = 0;
         t_address.sll_halen = 0;
 
-        if( ::bind( f_socket, (sockaddr*)&t_address, sizeof(t_address) ) < 0 )
+        if( ::bind( a_socket.f_socket, (sockaddr*)&t_address, sizeof(t_address) ) < 0 )
         {
             throw error() << "Could not bind socket:\n\t" << strerror( errno );
         }
 
-        LINFO( plog, "Ready to consume packets on interface <" << f_interface << ">" );
+        // join the fan-out group; this has to happen after the socket is bound
+        if( a_fanout_arg != 0 )
+        {
+            if( ::setsockopt( a_socket.f_socket, SOL_PACKET, PACKET_FANOUT, &a_fanout_arg, sizeof(a_fanout_arg) ) < 0 )
+            {
+                throw error() << "Could not join the fan-out group:\n\t" << strerror( errno );
+            }
+        }
 
         return;
     }
 
+    void packet_receiver_fpa::attach_filter( int a_socket ) const
+    {
+        std::vector< sock_filter > t_code = build_filter( f_port, f_extra_ports, f_source_addresses );
+
+        sock_fprog t_program;
+        t_program.len = t_code.size();
+        t_program.filter = t_code.data();
+
+        LDEBUG( plog, "Attaching kernel filter with " << t_code.size() << " instructions" );
+        if( ::setsockopt( a_socket, SOL_SOCKET, SO_ATTACH_FILTER, &t_program, sizeof(t_program) ) < 0 )
+        {
+            throw error() << "Could not attach the kernel filter:\n\t" << strerror( errno );
+        }
+
+        return;
+    }
+
+    std::vector< sock_filter > packet_receiver_fpa::build_filter( uint32_t a_port, const std::vector< unsigned >& a_extra_ports, const std::vector< uint32_t >& a_source_addresses )
+    {
+        // Classic BPF program; offsets are relative to the start of the ethernet frame.
+        // Jumps to the drop and port-check instructions are patched once their positions are known.
+        static const uint16_t t_eth_proto_offset = 12;
+        static const uint16_t t_ip_proto_offset = ETH_HLEN + 9;
+        static const uint16_t t_ip_frag_offset = ETH_HLEN + 6;
+        static const uint16_t t_ip_saddr_offset = ETH_HLEN + 12;
+        static const uint16_t t_udp_dest_offset = 2; // relative to the UDP header
+
+        std::vector< sock_filter > t_code;
+        std::vector< size_t > t_jf_to_drop, t_jt_to_drop, t_jt_to_port;
+
+        // IPv4 only
+        t_code.push_back( BPF_STMT( BPF_LD | BPF_H | BPF_ABS, t_eth_proto_offset ) );
+        t_jf_to_drop.push_back( t_code.size() );
+        t_code.push_back( BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 0, 0 ) );
+
+        // UDP only
+        t_code.push_back( BPF_STMT( BPF_LD | BPF_B | BPF_ABS, t_ip_proto_offset ) );
+        t_jf_to_drop.push_back( t_code.size() );
+        t_code.push_back( BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, IPPROTO_UDP, 0, 0 ) );
+
+        // no fragments after the first; they don't have a UDP header
+        t_code.push_back( BPF_STMT( BPF_LD | BPF_H | BPF_ABS, t_ip_frag_offset ) );
+        t_jt_to_drop.push_back( t_code.size() );
+        t_code.push_back( BPF_JUMP( BPF_JMP | BPF_JSET | BPF_K, 0x1fff, 0, 0 ) );
+
+        // source addresses, if any were given
+        if( ! a_source_addresses.empty() )
+        {
+            t_code.push_back( BPF_STMT( BPF_LD | BPF_W | BPF_ABS, t_ip_saddr_offset ) );
+            for( uint32_t t_address : a_source_addresses )
+            {
+                t_jt_to_port.push_back( t_code.size() );
+                t_code.push_back( BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, ntohl( t_address ), 0, 0 ) );
+            }
+            t_jf_to_drop.push_back( t_code.size() - 1 );
+        }
+
+        // destination port(s); X <- IP header length
+        size_t t_port_pos = t_code.size();
+        t_code.push_back( BPF_STMT( BPF_LDX | BPF_B | BPF_MSH, ETH_HLEN ) );
+        t_code.push_back( BPF_STMT( BPF_LD | BPF_H | BPF_IND, ETH_HLEN + t_udp_dest_offset ) );
+        std::vector< size_t > t_jt_to_accept;
+        t_jt_to_accept.push_back( t_code.size() );
+        t_code.push_back( BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, a_port, 0, 0 ) );
+        for( unsigned t_extra_port : a_extra_ports )
+        {
+            t_jt_to_accept.push_back( t_code.size() );
+            t_code.push_back( BPF_JUMP( BPF_JMP | BPF_JEQ | BPF_K, t_extra_port, 0, 0 ) );
+        }
+        t_jf_to_drop.push_back( t_code.size() - 1 );
+
+        // accept the whole packet
+        size_t t_accept_pos = t_code.size();
+        t_code.push_back( BPF_STMT( BPF_RET | BPF_K, 0x40000 ) );
+
+        // drop
+        size_t t_drop_pos = t_code.size();
+        t_code.push_back( BPF_STMT( BPF_RET | BPF_K, 0 ) );
+
+        // jt/jf are 8 bits wide; the longest jumps (from the first checks to the drop) grow with the number of sources plus ports
+        if( t_drop_pos - t_jf_to_drop.front() - 1 > 255 )
+        {
+            throw error() << "[packet_receiver_fpa] Too many source addresses and extra ports for the kernel filter: " << a_source_addresses.size()
+                    << " + " << a_extra_ports.size() << "; jumps are limited to 255 instructions";
+        }
+
+        for( size_t t_pos : t_jf_to_drop ) t_code[ t_pos ].jf = t_drop_pos - t_pos - 1;
+        for( size_t t_pos : t_jt_to_drop ) t_code[ t_pos ].jt = t_drop_pos - t_pos - 1;
+        for( size_t t_pos : t_jt_to_port ) t_code[ t_pos ].jt = t_port_pos - t_pos - 1;
+        for( size_t t_pos : t_jt_to_accept ) t_code[ t_pos ].jt = t_accept_pos - t_pos - 1;
+
+        return t_code;
+    }
+
     void packet_receiver_fpa::execute( midge::diptera* a_midge )
     {
         try
         {
             LDEBUG( plog, "Executing the packet_receiver_fpa" );
 
-            //memory_block* t_mem_block = nullptr;
+            if( ! out_stream< 0 >().set( stream::s_start ) ) return;
+
+            f_stop_walking.store( false );
+            f_walker_exception = nullptr;
+
+            f_last_stats_time = std::chrono::steady_clock::now();
+            f_last_stats_packets = f_packets_total.load();
+            f_last_stats_bytes = f_bytes_total.load();
 
+            LINFO( plog, "Starting main loop; waiting for packets" );
+            if( f_sockets.size() == 1 )
+            {
+                walk_ring( f_sockets[ 0 ] );
+            }
+            else
+            {
+                // one walker thread per socket; they share the output stream
+                std::vector< std::thread > t_walkers;
+                for( fpa_socket& t_socket : f_sockets )
+                {
+                    t_walkers.push_back( std::thread( &packet_receiver_fpa::walk_ring, this, std::ref( t_socket ) ) );
+                }
+                for( std::thread& t_walker : t_walkers )
+                {
+                    t_walker.join();
+                }
+            }
+
+            if( f_walker_exception ) std::rethrow_exception( f_walker_exception );
+
+            LINFO( plog, "Packet receiver is exiting; final ring statistics:\n" << update_stats() );
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void packet_receiver_fpa::walk_ring( fpa_socket& a_socket )
+    {
+        try
+        {
             // Setup the polling file descriptor struct
             pollfd t_pollfd;
             ::memset( &t_pollfd, 0, sizeof(pollfd) );
-            t_pollfd.fd = f_socket;
+            t_pollfd.fd = a_socket.f_socket;
             t_pollfd.events = POLLIN | POLLERR;
             t_pollfd.revents = 0;
 
             unsigned t_block_num = 0;
             block_desc* t_block = nullptr;
+            std::shared_ptr< void > t_block_ref;
 
             unsigned t_timeout_msec = 1000 * f_timeout_sec;
+            unsigned t_spins = 0;
 
-            //LDEBUG( plog, "Server is listening" );
-
-            std::unique_ptr< char[] > t_buffer_ptr( new char[ f_max_packet_size ] );
+            uint8_t* t_udp_data = nullptr;
+            size_t t_udp_data_len = 0;
+            uint32_t t_source_address = 0;
+            uint16_t t_dest_port = 0;
 
-            if( ! out_stream< 0 >().set( stream::s_start ) ) return;
-
-            LINFO( plog, "Starting main loop; waiting for packets" );
-            while( ! is_canceled() )
+            // the output stream is shared by the walkers, so it's only checked once per block or poll, not on every spin
+            auto t_output_stopped = [this]() -> bool
             {
-
+                std::unique_lock< std::mutex > t_lock( f_out_stream_mutex );
                 if( (out_stream< 0 >().get() == stream::s_stop) )
                 {
                     LWARN( plog, "Output stream(s) have stop condition" );
-                    break;
+                    f_stop_walking.store( true );
+                    return true;
                 }
+                return false;
+            };
 
+            while( ! is_canceled() && ! f_stop_walking.load() )
+            {
                 // get the next block
-                t_block = (block_desc *) f_ring.f_rd[ t_block_num ].iov_base;
+                t_block = (block_desc *) a_socket.f_ring.f_rd[ t_block_num ].iov_base;
 
                 // make sure the next block has been made available to the user
-                if( ( t_block->f_packet_hdr.block_status & TP_STATUS_USER ) == 0 )
+                if( ( __atomic_load_n( &t_block->f_packet_hdr.block_status, __ATOMIC_ACQUIRE ) & TP_STATUS_USER ) == 0 )
                 {
+                    // spin for a while before sleeping, if requested
+                    if( t_spins < f_spin_count )
+                    {
+                        ++t_spins;
+#if defined(__x86_64__) || defined(__i386__)
+                        __builtin_ia32_pause();
+#endif
+                        continue;
+                    }
+                    t_spins = 0;
+
                     // next block isn't available yet, so poll until it is, with the specified timeout
                     // timeout or successful poll will go back to the top of the loop
                     poll( &t_pollfd, 1, t_timeout_msec );
+                    if( t_output_stopped() ) break;
                     continue;
                 }
+                t_spins = 0;
+                if( t_output_stopped() ) break;
 
                 // we have a block available, so process it
+                if( f_zero_copy )
+                {
+                    // the block goes back to the kernel when the last reference to it is dropped:
+                    // either below, when we're done walking it, or when the last stream slot viewing it is overwritten
+                    std::shared_ptr< std::atomic< bool > > t_ring_mapped = f_ring_mapped;
+                    t_block_ref.reset( t_block, [t_ring_mapped]( block_desc* a_block )
+                            {
+                                if( ! t_ring_mapped->load() ) return;
+                                std::atomic_thread_fence( std::memory_order_release );
+                                a_block->f_packet_hdr.block_status = TP_STATUS_KERNEL;
+                            } );
+                }
+
                 unsigned t_num_pkts = t_block->f_packet_hdr.num_pkts;
                 unsigned long t_bytes = 0;
+                unsigned t_pkts_output = 0;
 
                 tpacket3_hdr* t_packet = reinterpret_cast< tpacket3_hdr* >( (uint8_t*)t_block + t_block->f_packet_hdr.offset_to_first_pkt );
 
@@ -237,15 +529,19 @@ namespace psyllid
                 {
                     t_bytes += t_packet->tp_snaplen;
 
-                    LTRACE( plog, "Processing IP packet; current iterator index is <" << out_stream< 0 >().get_current_index() << ">" );
-                    if( process_packet( t_packet ) )
+                    t_udp_data = parse_packet( t_packet, t_udp_data_len, t_source_address, t_dest_port );
+                    if( t_udp_data != nullptr )
                     {
+                        std::unique_lock< std::mutex > t_lock( f_out_stream_mutex );
                         LTRACE( plog, "UDP packet processed; outputing to stream index <" << out_stream< 0 >().get_current_index() << ">" );
-                        if( ! out_stream< 0 >().set( stream::s_run ) )
+                        if( ! output_packet( t_udp_data, t_udp_data_len, t_source_address, t_dest_port,
+                                uint64_t(t_packet->tp_sec) * 1000000000ull + t_packet->tp_nsec, t_block_ref ) )
                         {
                             LERROR( plog, "Exiting due to stream error" );
+                            f_stop_walking.store( true );
                             break;
                         }
+                        ++t_pkts_output;
                     }
                     else
                     {
@@ -259,32 +555,39 @@ namespace psyllid
 
                 f_packets_total += t_num_pkts;
                 f_bytes_total += t_bytes;
+                {
+                    std::unique_lock< std::mutex > t_lock( f_stats_mutex );
+                    a_socket.f_packets_total += t_num_pkts;
+                    a_socket.f_bytes_total += t_bytes;
+                    a_socket.f_packets_output += t_pkts_output;
+                    if( t_block->f_packet_hdr.block_status & TP_STATUS_LOSING ) ++a_socket.f_losing_blocks;
+                    if( t_block->f_packet_hdr.block_status & TP_STATUS_BLK_TMO ) ++a_socket.f_timeout_blocks;
+
+                    if( f_stats_interval_sec != 0 &&
+                            std::chrono::steady_clock::now() - f_last_stats_time >= std::chrono::seconds( f_stats_interval_sec ) )
+                    {
+                        LDEBUG( plog, "Ring statistics:\n" << update_stats_locked() );
+                    }
+                }
 
                 // return the block to the kernel; we're done with it
-                t_block->f_packet_hdr.block_status = TP_STATUS_KERNEL;
+                // in zero-copy mode that only happens once the output stream releases it too
+                if( f_zero_copy ) t_block_ref.reset();
+                else t_block->f_packet_hdr.block_status = TP_STATUS_KERNEL;
                 t_block_num = ( t_block_num + 1 ) % f_n_blocks;
-
             }
-
-            LINFO( plog, "Packet receiver is exiting" );
-
-            // normal exit condition
-            LDEBUG( plog, "Stopping output streams" );
-            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
-
-            LDEBUG( plog, "Exiting output streams" );
-            out_stream< 0 >().set( stream::s_exit );
-
-            return;
         }
         catch(...)
         {
-            if( a_midge ) a_midge->throw_ex( std::current_exception() );
-            else throw;
+            // only the first exception is kept; the other walkers are told to stop
+            std::unique_lock< std::mutex > t_lock( f_out_stream_mutex );
+            if( ! f_walker_exception ) f_walker_exception = std::current_exception();
+            f_stop_walking.store( true );
         }
+        return;
     }
 
-    bool packet_receiver_fpa::process_packet( tpacket3_hdr* a_packet )
+    uint8_t* packet_receiver_fpa::parse_packet( tpacket3_hdr* a_packet, size_t& a_udp_data_len, uint32_t& a_source_address, uint16_t& a_dest_port ) const
     {
         //printf("rxhash: 0x%x\n", a_packet->hv1.tp_rxhash);
 
@@ -311,12 +614,12 @@ namespace psyllid
         LTRACE( plog, "Ethernet sizes (total, header, data): ???, " << ETH_HLEN << ", ???" );
         LTRACE( plog, "Ethernet mem addresses (packet/header, data): " << t_eth_hdr << ", " << (void*)( (char*)t_eth_hdr + ETH_HLEN ) );
 
-        // filter only IP packets
+        // filter only IP packets (already done by the kernel if the kernel filter is in use)
         static const unsigned short t_eth_p_ip = htons(ETH_P_IP);
-        if( t_eth_hdr->h_proto != t_eth_p_ip )
+        if( ! f_kernel_filter && t_eth_hdr->h_proto != t_eth_p_ip )
         {
             LDEBUG( plog, "Non-IP packet skipped" );
-            return false;
+            return nullptr;
         }
 
 
@@ -335,8 +638,13 @@ namespace psyllid
         LTRACE( plog, "IP header: version: " << unsigned(t_ip_hdr->version) << ";  ihl: " << unsigned(t_ip_hdr->ihl) << ";  tos: " << ntohs(t_ip_hdr->tos) << ";  tot_len: " << ntohs(t_ip_hdr->tot_len) << ";  protocol: " << unsigned(t_ip_hdr->protocol) << ";  saddr: " << t_source_ip << ";  daddr: " << t_dest_ip );
 #endif
 
-        //TODO: filter on source address?
-        //uint32_t t_source_address = t_ip_hdr->saddr;
+        // filter on source address
+        if( ! f_kernel_filter && ! f_source_addresses.empty() &&
+                std::find( f_source_addresses.begin(), f_source_addresses.end(), t_ip_hdr->saddr ) == f_source_addresses.end() )
+        {
+            LDEBUG( plog, "Packet from unlisted source skipped" );
+            return nullptr;
+        }
 
         // get ip packet data
         //char* t_ip_data = (char*)t_ip_hdr + t_ip_hdr->ihl * 4;
@@ -345,10 +653,10 @@ namespace psyllid
         LTRACE( plog, "IP sizes (total, header, data): " << ntohs(t_ip_hdr->tot_len) << ", " << unsigned(t_ip_hdr->ihl * 4) << ", " << ntohs(t_ip_hdr->tot_len) - t_ip_hdr->ihl * 4 );
         LTRACE( plog, "IP mem addresses(packet/header, data): " << t_ip_hdr << ", " << (void*)( (char*)t_ip_hdr + t_ip_hdr->ihl * 4 ) );
 
-        if( t_ip_hdr->protocol != 17 )
+        if( ! f_kernel_filter && t_ip_hdr->protocol != 17 )
         {
             LDEBUG( plog, "Non-UDP packet skipped" );
-            return false;
+            return nullptr;
         }
 
         //***********
@@ -360,39 +668,69 @@ namespace psyllid
 
         udphdr* t_udp_hdr = reinterpret_cast< udphdr* >( (char*)t_ip_hdr + t_ip_hdr->ihl * 4 );
 
+        // the payload must lie within the captured frame: in zero-copy mode it's output as a view into the ring
+        uint8_t* t_frame_end = (uint8_t*)t_eth_hdr + a_packet->tp_snaplen;
+        if( t_ip_hdr->ihl < 5 || (uint8_t*)t_udp_hdr + t_udp_hdr_len > t_frame_end ||
+                ntohs(t_udp_hdr->len) < t_udp_hdr_len || (uint8_t*)t_udp_hdr + ntohs(t_udp_hdr->len) > t_frame_end )
+        {
+            LDEBUG( plog, "Truncated or malformed packet skipped" );
+            return nullptr;
+        }
+
         LTRACE( plog, "UDP header: source port: " << ntohs(t_udp_hdr->source) << ";  dest port: " << ntohs(t_udp_hdr->dest) << ";  len: " << ntohs(t_udp_hdr->len) << ";  check: " << ntohs(t_udp_hdr->check) );
 
         // get port number
         //unsigned t_port = ntohs(t_udp_hdr->dest);
 
-        // check port number against configured port
-        if( ntohs(t_udp_hdr->dest) != f_port )
+        // check port number against configured port(s)
+        a_dest_port = ntohs(t_udp_hdr->dest);
+        if( ! f_kernel_filter && a_dest_port != f_port &&
+                std::find( f_extra_ports.begin(), f_extra_ports.end(), a_dest_port ) == f_extra_ports.end() )
         {
-            LDEBUG( plog, "Destination port is incorrect: expected " << f_port << " but got " << ntohs(t_udp_hdr->dest) );
-            return false;
+            LDEBUG( plog, "Destination port is incorrect: expected " << f_port << " but got " << a_dest_port );
+            return nullptr;
         }
+        a_source_address = t_ip_hdr->saddr;
 
-        size_t t_udp_data_len = ntohs(t_udp_hdr->len) - t_udp_hdr_len;
+        a_udp_data_len = ntohs(t_udp_hdr->len) - t_udp_hdr_len;
 
-        LTRACE( plog, "UDP sizes (total, header, data): " << ntohs(t_udp_hdr->len) << ", " << t_udp_hdr_len << ", " << t_udp_data_len );
+        LTRACE( plog, "UDP sizes (total, header, data): " << ntohs(t_udp_hdr->len) << ", " << t_udp_hdr_len << ", " << a_udp_data_len );
         LTRACE( plog, "UDP mem addresses (packet/header, data): " << t_udp_hdr << ", " << (void*)((char*)t_udp_hdr + t_udp_hdr_len) );
 
+        return reinterpret_cast< uint8_t* >( t_udp_hdr ) + t_udp_hdr_len;
+    }
+
+    bool packet_receiver_fpa::output_packet( uint8_t* a_udp_data, size_t a_udp_data_len, uint32_t a_source_address, uint16_t a_dest_port, uint64_t a_rx_timestamp_ns, const std::shared_ptr< void >& a_block_ref )
+    {
         memory_block* t_mem_block = out_stream< 0 >().data();
-        t_mem_block->resize( f_max_packet_size );
+        t_mem_block->set_source_address( a_source_address );
+        t_mem_block->set_dest_port( a_dest_port );
+        t_mem_block->set_rx_timestamp_ns( a_rx_timestamp_ns );
+
+        if( f_zero_copy )
+        {
+            // replacing the view releases this slot's reference to whichever ring block it viewed before
+            LTRACE( plog, "Packet received (" << a_udp_data_len << " bytes); viewing it in the ring at " << (void*)a_udp_data );
+            t_mem_block->set_view( a_udp_data, a_udp_data_len, a_block_ref );
+            return out_stream< 0 >().set( stream::s_run );
+        }
 
-        LTRACE( plog, "Packet received (" << t_udp_data_len << " bytes); block address is " << (void*)t_mem_block->block() );
+        // size the block to the packet: with packets of constant size, this allocates only the first time round the stream buffer
+        if( a_udp_data_len > f_max_packet_size ) a_udp_data_len = f_max_packet_size;
+        t_mem_block->resize( a_udp_data_len );
+
+        LTRACE( plog, "Packet received (" << a_udp_data_len << " bytes); block address is " << (void*)t_mem_block->block() );
 
         LTRACE( plog, "Packet words: " << std::hex << strtoull((char*)t_mem_block->block(), NULL, 0) );
         LTRACE( plog, "Packet bytes: " << unsigned(((char*)t_mem_block->block())[0]) << " " << unsigned(((char*)t_mem_block->block())[1]) << " " << unsigned(((char*)t_mem_block->block())[2]) );
 
         // copy the UPD packet from the IP packet into the appropriate buffer
-        //uint8_t* t_udp_data = (uint8_t*)t_udp_hdr + t_udp_hdr_len;
         ::memcpy( reinterpret_cast< void* >( t_mem_block->block() ),
-                  reinterpret_cast< void* >( (char*)t_udp_hdr + t_udp_hdr_len ),
-                  t_udp_data_len );
-        t_mem_block->set_n_bytes_used( t_udp_data_len );
+                  reinterpret_cast< void* >( a_udp_data ),
+                  a_udp_data_len );
+        t_mem_block->set_n_bytes_used( a_udp_data_len );
 
-        return true;
+        return out_stream< 0 >().set( stream::s_run );
     }
 
     void packet_receiver_fpa::finalize()
@@ -405,26 +743,111 @@ namespace psyllid
         return;
     }
 
-    void packet_receiver_fpa::cleanup_fpa()
+    scarab::param_node packet_receiver_fpa::update_stats()
+    {
+        std::unique_lock< std::mutex > t_lock( f_stats_mutex );
+        return update_stats_locked();
+    }
+
+    scarab::param_node packet_receiver_fpa::update_stats_locked()
     {
-        if( f_ring.f_map != nullptr )
+        std::chrono::steady_clock::time_point t_now = std::chrono::steady_clock::now();
+        double t_interval = std::chrono::duration< double >( t_now - f_last_stats_time ).count();
+        uint64_t t_packets = f_packets_total.load();
+        uint64_t t_bytes = f_bytes_total.load();
+
+        scarab::param_node t_stats;
+        t_stats.add( "packets", scarab::param_value( t_packets ) );
+        t_stats.add( "bytes", scarab::param_value( t_bytes ) );
+        t_stats.add( "packet-rate", scarab::param_value( t_interval > 0. ? double(t_packets - f_last_stats_packets) / t_interval : 0. ) );
+        t_stats.add( "byte-rate", scarab::param_value( t_interval > 0. ? double(t_bytes - f_last_stats_bytes) / t_interval : 0. ) );
+
+        f_last_stats_time = t_now;
+        f_last_stats_packets = t_packets;
+        f_last_stats_bytes = t_bytes;
+
+        uint64_t t_kernel_packets = 0, t_kernel_drops = 0, t_freeze_q_cnt = 0, t_losing_blocks = 0, t_timeout_blocks = 0;
+        scarab::param_array t_socket_stats;
+        for( fpa_socket& t_socket : f_sockets )
         {
-            LDEBUG( plog, "Unmapping mmap ring" );
-            ::munmap(f_ring.f_map, f_ring.f_req.tp_block_size * f_ring.f_req.tp_block_nr);
-            f_ring.f_map = nullptr;
+            // the kernel resets its counters each time they're read
+            if( t_socket.f_socket != 0 )
+            {
+                tpacket_stats_v3 t_kernel_stats;
+                socklen_t t_len = sizeof(t_kernel_stats);
+                if( ::getsockopt( t_socket.f_socket, SOL_PACKET, PACKET_STATISTICS, &t_kernel_stats, &t_len ) < 0 )
+                {
+                    LWARN( plog, "Unable to get the ring statistics:\n\t" << strerror( errno ) );
+                }
+                else
+                {
+                    t_socket.f_kernel_packets += t_kernel_stats.tp_packets;
+                    t_socket.f_kernel_drops += t_kernel_stats.tp_drops;
+                    t_socket.f_freeze_q_cnt += t_kernel_stats.tp_freeze_q_cnt;
+                }
+            }
+
+            scarab::param_node t_this_socket;
+            t_this_socket.add( "packets", scarab::param_value( t_socket.f_packets_total ) );
+            t_this_socket.add( "bytes", scarab::param_value( t_socket.f_bytes_total ) );
+            t_this_socket.add( "packets-output", scarab::param_value( t_socket.f_packets_output ) );
+            t_this_socket.add( "kernel-packets", scarab::param_value( t_socket.f_kernel_packets ) );
+            t_this_socket.add( "kernel-drops", scarab::param_value( t_socket.f_kernel_drops ) );
+            t_this_socket.add( "freeze-q-count", scarab::param_value( t_socket.f_freeze_q_cnt ) );
+            t_this_socket.add( "losing-blocks", scarab::param_value( t_socket.f_losing_blocks ) );
+            t_this_socket.add( "timeout-blocks", scarab::param_value( t_socket.f_timeout_blocks ) );
+            t_socket_stats.push_back( t_this_socket );
+
+            t_kernel_packets += t_socket.f_kernel_packets;
+            t_kernel_drops += t_socket.f_kernel_drops;
+            t_freeze_q_cnt += t_socket.f_freeze_q_cnt;
+            t_losing_blocks += t_socket.f_losing_blocks;
+            t_timeout_blocks += t_socket.f_timeout_blocks;
         }
-        if( f_ring.f_rd != nullptr )
+
+        t_stats.add( "kernel-packets", scarab::param_value( t_kernel_packets ) );
+        t_stats.add( "kernel-drops", scarab::param_value( t_kernel_drops ) );
+        t_stats.add( "freeze-q-count", scarab::param_value( t_freeze_q_cnt ) );
+        t_stats.add( "losing-blocks", scarab::param_value( t_losing_blocks ) );
+        t_stats.add( "timeout-blocks", scarab::param_value( t_timeout_blocks ) );
+        t_stats.add( "sockets", t_socket_stats );
+
+        if( t_kernel_drops != 0 || t_losing_blocks != 0 )
         {
-            LDEBUG( plog, "freeing f_rd" );
-            ::free( f_ring.f_rd );
-            f_ring.f_rd = nullptr;
+            LWARN( plog, "Packets have been dropped in the ring (" << t_kernel_drops << " packets dropped; " << t_losing_blocks << " blocks flagged as losing); consider increasing n-blocks or block-size" );
         }
 
-        // close socket
-        if( f_socket != 0 )
+        receiver_stats_house::get_instance()->post( get_name(), t_stats );
+
+        return t_stats;
+    }
+
+    void packet_receiver_fpa::cleanup_fpa()
+    {
+        // any views still outstanding must not touch the ring once it's unmapped
+        if( f_ring_mapped ) f_ring_mapped->store( false );
+
+        for( fpa_socket& t_socket : f_sockets )
         {
-            ::close( f_socket );
-            f_socket = 0;
+            if( t_socket.f_ring.f_map != nullptr )
+            {
+                LDEBUG( plog, "Unmapping mmap ring" );
+                ::munmap(t_socket.f_ring.f_map, t_socket.f_ring.f_req.tp_block_size * t_socket.f_ring.f_req.tp_block_nr);
+                t_socket.f_ring.f_map = nullptr;
+            }
+            if( t_socket.f_ring.f_rd != nullptr )
+            {
+                LDEBUG( plog, "freeing f_rd" );
+                ::free( t_socket.f_ring.f_rd );
+                t_socket.f_ring.f_rd = nullptr;
+            }
+
+            // close socket
+            if( t_socket.f_socket != 0 )
+            {
+                ::close( t_socket.f_socket );
+                t_socket.f_socket = 0;
+            }
         }
 
         return;
@@ -446,11 +869,39 @@ namespace psyllid
         LDEBUG( plog, "Configuring packet_receiver_fpa with:\n" << a_config );
         a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
         a_node->set_port( a_config.get_value( "port", a_node->get_port() ) );
+        if( a_config.has( "extra-ports" ) )
+        {
+            a_node->extra_ports().clear();
+            const scarab::param_array& t_extra_ports = a_config["extra-ports"].as_array();
+            for( unsigned i_port = 0; i_port < t_extra_ports.size(); ++i_port )
+            {
+                a_node->extra_ports().push_back( t_extra_ports[ i_port ]().as_uint() );
+            }
+        }
         a_node->interface() = a_config.get_value( "interface", a_node->interface() );
         a_node->set_timeout_sec( a_config.get_value( "timeout-sec", a_node->get_timeout_sec() ) );
         a_node->set_n_blocks( a_config.get_value( "n-blocks", a_node->get_n_blocks() ) );
         a_node->set_block_size( a_config.get_value( "block-size", a_node->get_block_size() ) );
         a_node->set_frame_size( a_config.get_value( "frame-size", a_node->get_frame_size() ) );
+        a_node->set_block_timeout_ms( a_config.get_value( "block-timeout-ms", a_node->get_block_timeout_ms() ) );
+        a_node->set_spin_count( a_config.get_value( "spin-count", a_node->get_spin_count() ) );
+        a_node->set_busy_poll_usec( a_config.get_value( "busy-poll-usec", a_node->get_busy_poll_usec() ) );
+        a_node->set_prefer_busy_poll( a_config.get_value( "prefer-busy-poll", a_node->get_prefer_busy_poll() ) );
+        a_node->set_n_fanout_sockets( a_config.get_value( "n-fanout-sockets", a_node->get_n_fanout_sockets() ) );
+        a_node->fanout_mode() = a_config.get_value( "fanout-mode", a_node->fanout_mode() );
+        a_node->set_fanout_group_id( a_config.get_value( "fanout-group-id", a_node->get_fanout_group_id() ) );
+        a_node->set_zero_copy( a_config.get_value( "zero-copy", a_node->get_zero_copy() ) );
+        a_node->set_kernel_filter( a_config.get_value( "kernel-filter", a_node->get_kernel_filter() ) );
+        a_node->set_stats_interval_sec( a_config.get_value( "stats-interval-sec", a_node->get_stats_interval_sec() ) );
+        if( a_config.has( "source-ips" ) )
+        {
+            a_node->source_ips().clear();
+            const scarab::param_array& t_source_ips = a_config["source-ips"].as_array();
+            for( unsigned i_ip = 0; i_ip < t_source_ips.size(); ++i_ip )
+            {
+                a_node->source_ips().push_back( t_source_ips[ i_ip ]().as_string() );
+            }
+        }
         return;
     }
 
@@ -464,7 +915,43 @@ namespace psyllid
         a_config.add( "n-blocks", scarab::param_value( a_node->get_n_blocks() ) );
         a_config.add( "block-size", scarab::param_value( a_node->get_block_size() ) );
         a_config.add( "frame-size", scarab::param_value( a_node->get_frame_size() ) );
+        a_config.add( "block-timeout-ms", scarab::param_value( a_node->get_block_timeout_ms() ) );
+        a_config.add( "spin-count", scarab::param_value( a_node->get_spin_count() ) );
+        a_config.add( "busy-poll-usec", scarab::param_value( a_node->get_busy_poll_usec() ) );
+        a_config.add( "prefer-busy-poll", scarab::param_value( a_node->get_prefer_busy_poll() ) );
+        a_config.add( "n-fanout-sockets", scarab::param_value( a_node->get_n_fanout_sockets() ) );
+        a_config.add( "fanout-mode", scarab::param_value( a_node->fanout_mode() ) );
+        a_config.add( "fanout-group-id", scarab::param_value( a_node->get_fanout_group_id() ) );
+        a_config.add( "zero-copy", scarab::param_value( a_node->get_zero_copy() ) );
+        a_config.add( "kernel-filter", scarab::param_value( a_node->get_kernel_filter() ) );
+        a_config.add( "stats-interval-sec", scarab::param_value( a_node->get_stats_interval_sec() ) );
+        scarab::param_array t_source_ips;
+        for( const std::string& t_source_ip : a_node->source_ips() )
+        {
+            t_source_ips.push_back( scarab::param_value( t_source_ip ) );
+        }
+        a_config.add( "source-ips", t_source_ips );
+        scarab::param_array t_extra_ports;
+        for( unsigned t_extra_port : a_node->extra_ports() )
+        {
+            t_extra_ports.push_back( scarab::param_value( t_extra_port ) );
+        }
+        a_config.add( "extra-ports", t_extra_ports );
         return;
     }
 
+    bool packet_receiver_fpa_binding::do_run_command( packet_receiver_fpa* a_node, const std::string& a_cmd, const scarab::param_node& ) const
+    {
+        if( a_cmd == "ring-stats" )
+        {
+            LINFO( plog, "Ring statistics for <" << a_node->get_name() << ">:\n" << a_node->update_stats() );
+            return true;
+        }
+        else
+        {
+            LWARN( plog, "Unrecognized command: <" << a_cmd << ">" );
+            return false;
+        }
+    }
+
 } /* namespace psyllid */
@@ -14,9 +14,14 @@
 #include "producer.hh"
 #include "shared_cancel.hh"
 
+#include <linux/filter.h>
 #include <linux/if_packet.h>
+#include <atomic>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <sys/uio.h>
+#include <vector>
 
 namespace scarab
 {
@@ -41,6 +46,23 @@ namespace psyllid
         {}
     };
 
+    struct fpa_socket
+    {
+        int f_socket;
+        receive_ring f_ring;
+        uint64_t f_packets_total;  /// Packets walked in this socket's ring
+        uint64_t f_bytes_total;    /// Bytes walked in this socket's ring
+        uint64_t f_packets_output; /// Packets that passed the filters and were written to the output stream
+        uint64_t f_kernel_packets; /// Packets received by the kernel for this socket (PACKET_STATISTICS)
+        uint64_t f_kernel_drops;   /// Packets the kernel dropped because the ring was full (PACKET_STATISTICS)
+        uint64_t f_freeze_q_cnt;   /// Times the ring queue was frozen (PACKET_STATISTICS)
+        uint64_t f_losing_blocks;  /// Blocks flagged TP_STATUS_LOSING
+        uint64_t f_timeout_blocks; /// Blocks retired by the block timeout (TP_STATUS_BLK_TMO)
+        fpa_socket() : f_socket( 0 ), f_ring(), f_packets_total( 0 ), f_bytes_total( 0 ), f_packets_output( 0 ),
+                f_kernel_packets( 0 ), f_kernel_drops( 0 ), f_freeze_q_cnt( 0 ), f_losing_blocks( 0 ), f_timeout_blocks( 0 )
+        {}
+    };
+
 
     /*!
      @class packet_receiver_fpa
@@ -102,11 +124,58 @@ namespace psyllid
      - "length": uint -- The size of the output buffer
      - "max-packet-size": uint -- Maximum number of bytes to be read for each packet; larger packets will be truncated
      - "port": uint -- UDP port to listen on for packets
+     - "extra-ports": array of uints -- Optional list of additional UDP ports to accept (e.g. one per ROACH channel, for routing with packet_demux)
      - "interface": string -- Name of the network interface to listen on for packets
      - "timeout-sec": uint -- Timeout (in seconds) while listening for incoming packets; listening for packets repeats after timeout
      - "n-blocks": uint -- Number of blocks in the mmap ring buffer
      - "block-size": uint -- Number of packets per block in the mmap ring buffer
      - "frame-size": uint -- Number of blocks per frame in the mmap ring buffer
+     - "block-timeout-ms": uint -- Time (in ms) after which the kernel hands over a block that isn't full (tp_retire_blk_tov); default is 60
+     - "spin-count": uint -- Number of times the walker checks for the next block in user space before falling back to poll(); 0 (default) always polls
+     - "busy-poll-usec": uint -- If non-zero, sets SO_BUSY_POLL on the socket(s) so that the kernel busy-polls the device queue for up to this long; default is 0
+     - "prefer-busy-poll": bool -- Sets SO_PREFER_BUSY_POLL (Linux 5.11 and later) in addition to "busy-poll-usec"; default is false
+     - "n-fanout-sockets": uint -- Number of sockets (each with its own ring and walker thread) joined in a PACKET_FANOUT group; 1 disables fan-out
+     - "fanout-mode": string -- How the kernel distributes packets among the fan-out sockets: "hash" (default; keeps each flow on one socket), "cpu", or "round-robin"
+     - "fanout-group-id": uint -- PACKET_FANOUT group ID (16 bits); must be unique on the host among receivers using fan-out; 0 picks an ID from the process ID and port
+     - "kernel-filter": bool -- If true (default), a classic BPF program attached to each socket drops non-UDP/IPv4 traffic, IP fragments, packets to other ports, and packets from unlisted sources in the kernel, and the equivalent checks in user space are skipped; if false, all IP traffic on the interface is walked and checked in user space.  The filter can hold at most 246 "source-ips" and "extra-ports" together
+     - "source-ips": array of strings -- Optional list of IPv4 source addresses to accept; if empty (default), packets from any source are accepted
+     - "stats-interval-sec": uint -- Interval (in seconds) between polls of the kernel's ring statistics; the statistics are logged and posted for the daq-status request; 0 disables periodic polling (default is 10)
+     - "zero-copy": bool -- If true, output memory_blocks point at the UDP payloads in the mmap ring instead of holding a copy (see below)
+
+     Fan-out mode:
+     When "n-fanout-sockets" is greater than 1, the ring walking and packet parsing is spread over that many threads.
+     Writing to the output stream is serialized with a mutex, so packets from different sockets are interleaved in the output stream.
+     With the "hash" mode all packets from a single ROACH stream land on the same socket, which preserves their order.
+
+     Zero-copy mode:
+     Each output memory_block is a view (see memory_block::set_view()) into the ring frame holding the packet,
+     and it keeps a reference to its ring block.  A ring block is returned to the kernel (TP_STATUS_KERNEL) once
+     the walker is done with it and every stream slot viewing it has been overwritten, which midge only allows
+     after all downstream nodes have released that slot.  Downstream nodes must not modify the packet, since the
+     view ends where the packet does (unpack_roach_packet() copies out of views), and must not keep pointers to it
+     past the release of the slot.  Packets whose UDP length runs past the captured frame are skipped.
+     Since each stream slot can hold at most one ring block, "n-blocks" must be larger than "length" + 1.
+
+     Latency:
+     A block is handed to the walker when it's full or when the block timeout expires, so at low packet rates the
+     block timeout sets the latency.  When the next block isn't ready, the walker can spin for "spin-count" checks
+     before sleeping in poll(); combined with "busy-poll-usec" this trades CPU for latency.
+     Use test_tpacket_v3 to measure the latency for a given set of parameters.
+
+     Ring statistics:
+     The receiver keeps the number of packets and bytes walked, the packet and byte rates over the last polling interval,
+     the kernel's PACKET_STATISTICS counters (packets, drops, and queue freezes), and the number of blocks flagged
+     TP_STATUS_LOSING and TP_STATUS_BLK_TMO, in total and per socket.  Drops and losing blocks mean the ring was full;
+     many timed-out blocks mean the blocks are too large for the packet rate.
+
+     Available commands:
+     - "ring-stats": polls and logs the ring statistics
+
+     Packet metadata:
+     Each output memory_block records the packet's source address and destination port, so that a packet_demux node
+     can route the packets from several ROACH channels received by this one ring to separate streams.
+     It also records the time the kernel received the packet (tp_sec/tp_nsec from the ring), which is passed on
+     to the time and frequency data by tf_roach_receiver.
 
      Output Streams:
      - 0: memory_block
@@ -121,29 +190,67 @@ namespace psyllid
             mv_accessible( uint64_t, length );
             mv_accessible( uint32_t, max_packet_size );
             mv_accessible( uint32_t, port );
+            mv_referrable( std::vector< unsigned >, extra_ports ); /// Additional UDP ports to accept
             mv_referrable( std::string, interface );
             mv_accessible( unsigned, timeout_sec );  /// Timeout in seconds for waiting on the network interface
             mv_accessible( unsigned, n_blocks );     /// Number of blocks in the mmap ring buffer
             mv_accessible( unsigned, block_size );   /// Number of packets per block in the mmap ring buffer
             mv_accessible( unsigned, frame_size );   /// Number of blocks per frame in the mmap ring buffer
+            mv_accessible( unsigned, block_timeout_ms ); /// Block retire timeout in ms
+            mv_accessible( unsigned, spin_count );       /// Number of user-space checks for the next block before polling
+            mv_accessible( unsigned, busy_poll_usec );   /// SO_BUSY_POLL value; 0 disables busy polling
+            mv_accessible( bool, prefer_busy_poll );     /// Whether to set SO_PREFER_BUSY_POLL
+            mv_accessible( unsigned, n_fanout_sockets ); /// Number of sockets in the PACKET_FANOUT group; 1 disables fan-out
+            mv_referrable( std::string, fanout_mode );   /// "hash", "cpu", or "round-robin"
+            mv_accessible( unsigned, fanout_group_id );  /// PACKET_FANOUT group ID; 0 means automatic
+            mv_accessible( bool, zero_copy );            /// Output views into the mmap ring instead of copies
+            mv_accessible( bool, kernel_filter );        /// Filter packets with an in-kernel BPF program instead of in user space
+            mv_referrable( std::vector< std::string >, source_ips ); /// Source addresses to accept; empty accepts all
+            mv_accessible( unsigned, stats_interval_sec ); /// Interval between polls of the ring statistics; 0 disables polling
 
         public:
             virtual void initialize();
             virtual void execute( midge::diptera* a_midge = nullptr );
             virtual void finalize();
 
+            /// Polls the kernel's ring statistics, posts them to the receiver_stats_house, and returns them
+            scarab::param_node update_stats();
+
+            /*!
+             Builds the classic BPF program used by "kernel-filter" (addresses in network byte order).
+             Throws if there are too many source addresses and extra ports together for the program's 8-bit jumps.
+            */
+            static std::vector< sock_filter > build_filter( uint32_t a_port, const std::vector< unsigned >& a_extra_ports, const std::vector< uint32_t >& a_source_addresses );
+
         private:
-            bool process_packet( tpacket3_hdr* a_packet );
+            void setup_socket( fpa_socket& a_socket, int a_fanout_arg );
+            void attach_filter( int a_socket ) const;
+            void walk_ring( fpa_socket& a_socket );
+            uint8_t* parse_packet( tpacket3_hdr* a_packet, size_t& a_udp_data_len, uint32_t& a_source_address, uint16_t& a_dest_port ) const;
+            bool output_packet( uint8_t* a_udp_data, size_t a_udp_data_len, uint32_t a_source_address, uint16_t a_dest_port, uint64_t a_rx_timestamp_ns, const std::shared_ptr< void >& a_block_ref );
             void cleanup_fpa();
+            scarab::param_node update_stats_locked();
 
             int f_net_interface_index;
+            std::vector< uint32_t > f_source_addresses; // network byte order
+
+            std::vector< fpa_socket > f_sockets;
 
-            int f_socket;
+            // outstanding ring-block references check this before handing a block back to the kernel
+            std::shared_ptr< std::atomic< bool > > f_ring_mapped;
 
-            receive_ring f_ring;
+            std::mutex f_out_stream_mutex;
+            std::atomic< bool > f_stop_walking;
+            std::exception_ptr f_walker_exception;
 
-            uint64_t f_packets_total;
-            uint64_t f_bytes_total;
+            std::atomic< uint64_t > f_packets_total;
+            std::atomic< uint64_t > f_bytes_total;
+
+            // guards the per-socket counters and the rate bookkeeping
+            std::mutex f_stats_mutex;
+            std::chrono::steady_clock::time_point f_last_stats_time;
+            uint64_t f_last_stats_packets;
+            uint64_t f_last_stats_bytes;
     };
 
     class packet_receiver_fpa_binding : public sandfly::_node_binding< packet_receiver_fpa, packet_receiver_fpa_binding >
@@ -155,6 +262,8 @@ namespace psyllid
         private:
             virtual void do_apply_config( packet_receiver_fpa* a_node, const scarab::param_node& a_config ) const;
             virtual void do_dump_config( const packet_receiver_fpa* a_node, scarab::param_node& a_config ) const;
+
+            virtual bool do_run_command( packet_receiver_fpa* a_node, const std::string& a_cmd, const scarab::param_node& a_args ) const;
     };
 
 } /* namespace psyllid */
@@ -12,6 +12,7 @@
 #include "logger.hh"
 #include "param.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <errno.h>
 #include <memory>
@@ -22,6 +23,10 @@
 #include <netdb.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#ifdef __linux__
+#include <atomic>
+#include <netinet/udp.h>
+#endif
 
 using midge::stream;
 
@@ -31,14 +36,26 @@ namespace psyllid
 
     LOGGER( plog, "packet_receiver_socket" );
 
+    // largest possible UDP datagram, including a GRO super-datagram
+    static const size_t s_gro_buffer_size = 65536;
+
     packet_receiver_socket::packet_receiver_socket() :
             f_length( 10 ),
             f_max_packet_size( 1048576 ),
             f_port( 23530 ),
             f_ip( "127.0.0.1" ),
             f_timeout_sec( 1 ),
+            f_batch_size( 1 ),
+            f_rcvbuf_size( 0 ),
+            f_timestamps( false ),
+            f_gro( false ),
             f_socket( 0 ),
             f_address( nullptr ),
+            f_staging_blocks(),
+            f_gro_buffers(),
+            f_gro_staged(),
+            f_gro_datagrams( 0 ),
+            f_gro_packets( 0 ),
             f_last_errno( 0 )
     {
     }
@@ -96,6 +113,95 @@ namespace psyllid
             ::setsockopt( f_socket, SOL_SOCKET, SO_RCVTIMEO, (char *)&t_timeout, sizeof(struct timeval) );
         }
 
+        // Receive buffer size
+        if( f_rcvbuf_size > 0 )
+        {
+            int t_rcvbuf = f_rcvbuf_size;
+#ifdef __linux__
+            // SO_RCVBUFFORCE ignores net.core.rmem_max, but needs CAP_NET_ADMIN
+            if( ::setsockopt( f_socket, SOL_SOCKET, SO_RCVBUFFORCE, &t_rcvbuf, sizeof(t_rcvbuf) ) < 0 &&
+                    ::setsockopt( f_socket, SOL_SOCKET, SO_RCVBUF, &t_rcvbuf, sizeof(t_rcvbuf) ) < 0 )
+#else
+            if( ::setsockopt( f_socket, SOL_SOCKET, SO_RCVBUF, &t_rcvbuf, sizeof(t_rcvbuf) ) < 0 )
+#endif
+            {
+                LWARN( plog, "Unable to set the receive buffer size:\n\t" << strerror( errno ) );
+            }
+            socklen_t t_len = sizeof(t_rcvbuf);
+            ::getsockopt( f_socket, SOL_SOCKET, SO_RCVBUF, &t_rcvbuf, &t_len );
+            // the kernel doubles the requested value to allow for its bookkeeping
+            LDEBUG( plog, "Receive buffer size requested: " << f_rcvbuf_size << "; actual (including kernel overhead): " << t_rcvbuf );
+            if( (unsigned)t_rcvbuf < f_rcvbuf_size )
+            {
+                LWARN( plog, "Receive buffer is smaller than requested (" << t_rcvbuf << " < " << f_rcvbuf_size << "); raise net.core.rmem_max to allow larger buffers" );
+            }
+        }
+
+#ifndef __linux__
+        if( f_batch_size > 1 || f_timestamps || f_gro )
+        {
+            LWARN( plog, "Batched receiving, timestamps, and GRO are only available on Linux; receiving one packet at a time without timestamps" );
+            f_batch_size = 1;
+            f_timestamps = false;
+            f_gro = false;
+        }
+#endif
+
+        // Receive timestamps
+        if( f_timestamps )
+        {
+            int t_on = 1;
+            if( ::setsockopt( f_socket, SOL_SOCKET, SO_TIMESTAMPNS, &t_on, sizeof(t_on) ) < 0 )
+            {
+                throw error() << "[packet_receiver_socket] could not enable timestamps:\n\t" << strerror( errno );
+            }
+        }
+
+#ifdef __linux__
+        // UDP GRO
+        if( f_gro )
+        {
+            int t_on = 1;
+            if( ::setsockopt( f_socket, SOL_UDP, UDP_GRO, &t_on, sizeof(t_on) ) < 0 )
+            {
+                throw error() << "[packet_receiver_socket] could not enable UDP GRO:\n\t" << strerror( errno );
+            }
+        }
+#endif
+
+        // Staging blocks for batched receiving
+        f_staging_blocks.clear();
+        f_gro_staged.clear();
+        f_gro_datagrams = 0;
+        f_gro_packets = 0;
+        if( f_gro )
+        {
+            // no staging blocks: packets are output as views into the pooled buffers
+            if( f_batch_size == 0 ) f_batch_size = 1;
+#ifdef __linux__
+            f_msgs.resize( f_batch_size );
+            f_iovecs.resize( f_batch_size );
+            f_control.resize( f_batch_size * ( CMSG_SPACE( sizeof(timespec) ) + CMSG_SPACE( sizeof(int) ) ) );
+#endif
+            f_gro_staged.resize( f_batch_size );
+            LDEBUG( plog, "Receiving up to " << f_batch_size << " GRO super-datagrams per call" );
+        }
+        else if( f_batch_size > 1 || f_timestamps )
+        {
+            if( f_batch_size == 0 ) f_batch_size = 1;
+            for( unsigned i_block = 0; i_block < f_batch_size; ++i_block )
+            {
+                f_staging_blocks.emplace_back( new memory_block() );
+                f_staging_blocks.back()->resize( f_max_packet_size );
+            }
+#ifdef __linux__
+            f_msgs.resize( f_batch_size );
+            f_iovecs.resize( f_batch_size );
+            f_control.resize( f_timestamps ? f_batch_size * CMSG_SPACE( sizeof(timespec) ) : 0 );
+#endif
+            LDEBUG( plog, "Receiving up to " << f_batch_size << " packets per call" );
+        }
+
         //msg_normal( pmsg, "socket open..." );
 
         //bind socket
@@ -116,22 +222,13 @@ namespace psyllid
         {
             LDEBUG( plog, "Executing the packet_receiver_socket" );
 
-            memory_block* t_block = nullptr;
-
             //LDEBUG( plog, "Server is listening" );
 
             if( ! out_stream< 0 >().set( stream::s_start ) ) return;
 
-            ssize_t t_size_received = 0;
-
             LINFO( plog, "Starting main loop; waiting for packets" );
             while( ! is_canceled() )
             {
-                t_block = out_stream< 0 >().data();
-                t_block->resize( f_max_packet_size );
-
-                t_size_received = 0;
-
                 if( (out_stream< 0 >().get() == stream::s_stop) )
                 {
                     LWARN( plog, "Output stream(s) have stop condition" );
@@ -140,45 +237,19 @@ namespace psyllid
 
                 LTRACE( plog, "Waiting for packets" );
 
-                // inner loop over packet-receive timeouts
-                while( t_size_received <= 0 && ! is_canceled() )
+                bool t_stream_ok = f_gro ? receive_gro() : ( f_staging_blocks.empty() ? receive_single() : receive_batched() );
+                if( ! t_stream_ok )
                 {
-                    t_size_received = ::recv( f_socket, (void*)t_block->block(), f_max_packet_size, 0 );
-
-                    if( t_size_received > 0 )
-                    {
-                        LTRACE( plog, "Packet received (" << t_size_received << " bytes)" );
-                        LTRACE( plog, "Packet written to stream index <" << out_stream< 0 >().get_current_index() << ">" );
-
-                        t_block->set_n_bytes_used( t_size_received );
-
-                        if( ! out_stream< 0 >().set( stream::s_run ) )
-                        {
-                            LERROR( plog, "Exiting due to stream error" );
-                            break;
-                        }
-                        break;
-                    }
-
-                    f_last_errno = errno;
-                    if( f_last_errno == EWOULDBLOCK || f_last_errno == EAGAIN )
-                    {
-                        // recv timed out without anything being available to receive
-                        // nothing seems to be wrong with the socket
-                        break;
-                    }
-                    else if( t_size_received == 0 )
-                    {
-                        LWARN( plog, "No message present" );
-                    }
-                    else  // t_size_received < 0 && f_last_errno != EWOULDBLOCK && f_last_errno != EAGAIN
-                    {
-                        LWARN( plog, "Unable to receive; error message: " << strerror( f_last_errno ) );
-                    }
+                    LERROR( plog, "Exiting due to stream error" );
+                    break;
                 }
             }
 
             LINFO( plog, "Packet receiver is exiting" );
+            if( f_gro )
+            {
+                LINFO( plog, "Received " << f_gro_packets << " packets in " << f_gro_datagrams << " GRO super-datagrams" );
+            }
 
             // normal exit condition
             LDEBUG( plog, "Stopping output streams" );
@@ -195,10 +266,216 @@ namespace psyllid
         }
     }
 
+    bool packet_receiver_socket::receive_single()
+    {
+        memory_block* t_block = out_stream< 0 >().data();
+        t_block->resize( f_max_packet_size );
+
+        ssize_t t_size_received = 0;
+
+        // inner loop over packet-receive timeouts
+        while( t_size_received <= 0 && ! is_canceled() )
+        {
+            t_size_received = ::recv( f_socket, (void*)t_block->block(), f_max_packet_size, 0 );
+
+            if( t_size_received > 0 )
+            {
+                LTRACE( plog, "Packet received (" << t_size_received << " bytes)" );
+                LTRACE( plog, "Packet written to stream index <" << out_stream< 0 >().get_current_index() << ">" );
+
+                t_block->set_n_bytes_used( t_size_received );
+
+                return out_stream< 0 >().set( stream::s_run );
+            }
+
+            f_last_errno = errno;
+            if( f_last_errno == EWOULDBLOCK || f_last_errno == EAGAIN )
+            {
+                // recv timed out without anything being available to receive
+                // nothing seems to be wrong with the socket
+                break;
+            }
+            else if( t_size_received == 0 )
+            {
+                LWARN( plog, "No message present" );
+            }
+            else  // t_size_received < 0 && f_last_errno != EWOULDBLOCK && f_last_errno != EAGAIN
+            {
+                LWARN( plog, "Unable to receive; error message: " << strerror( f_last_errno ) );
+            }
+        }
+        return true;
+    }
+
+    bool packet_receiver_socket::receive_batched()
+    {
+#ifdef __linux__
+        unsigned t_n_msgs = f_staging_blocks.size();
+
+        // the staging blocks' memory changes hands with every swap, so the message headers are rebuilt each time
+        static const size_t t_control_len = CMSG_SPACE( sizeof(timespec) );
+        for( unsigned i_msg = 0; i_msg < t_n_msgs; ++i_msg )
+        {
+            f_iovecs[ i_msg ].iov_base = f_staging_blocks[ i_msg ]->block();
+            f_iovecs[ i_msg ].iov_len = f_max_packet_size;
+            ::memset( &f_msgs[ i_msg ], 0, sizeof(mmsghdr) );
+            f_msgs[ i_msg ].msg_hdr.msg_iov = &f_iovecs[ i_msg ];
+            f_msgs[ i_msg ].msg_hdr.msg_iovlen = 1;
+            if( f_timestamps )
+            {
+                f_msgs[ i_msg ].msg_hdr.msg_control = &f_control[ i_msg * t_control_len ];
+                f_msgs[ i_msg ].msg_hdr.msg_controllen = t_control_len;
+            }
+        }
+
+        // blocks (up to the timeout) until at least one packet is available, then takes whatever else is there
+        int t_n_received = ::recvmmsg( f_socket, f_msgs.data(), t_n_msgs, MSG_WAITFORONE, nullptr );
+        if( t_n_received < 0 )
+        {
+            f_last_errno = errno;
+            if( f_last_errno != EWOULDBLOCK && f_last_errno != EAGAIN && f_last_errno != EINTR )
+            {
+                LWARN( plog, "Unable to receive; error message: " << strerror( f_last_errno ) );
+            }
+            return true;
+        }
+
+        LTRACE( plog, "Received " << t_n_received << " packets" );
+        for( int i_msg = 0; i_msg < t_n_received; ++i_msg )
+        {
+            memory_block* t_staging_block = f_staging_blocks[ i_msg ].get();
+            t_staging_block->set_n_bytes_used( f_msgs[ i_msg ].msg_len );
+
+            t_staging_block->set_rx_timestamp_ns( 0 );
+            if( f_timestamps )
+            {
+                for( cmsghdr* t_cmsg = CMSG_FIRSTHDR( &f_msgs[ i_msg ].msg_hdr ); t_cmsg != nullptr; t_cmsg = CMSG_NXTHDR( &f_msgs[ i_msg ].msg_hdr, t_cmsg ) )
+                {
+                    if( t_cmsg->cmsg_level == SOL_SOCKET && t_cmsg->cmsg_type == SCM_TIMESTAMPNS )
+                    {
+                        timespec t_stamp;
+                        ::memcpy( &t_stamp, CMSG_DATA( t_cmsg ), sizeof(timespec) );
+                        t_staging_block->set_rx_timestamp_ns( (uint64_t)t_stamp.tv_sec * 1000000000 + t_stamp.tv_nsec );
+                    }
+                }
+            }
+
+            // trade memory with the stream slot; the staging block gets the slot's old memory for the next call
+            memory_block* t_block = out_stream< 0 >().data();
+            t_block->resize( f_max_packet_size );
+            t_block->swap( *t_staging_block );
+
+            LTRACE( plog, "Packet (" << t_block->get_n_bytes_used() << " bytes) written to stream index <" << out_stream< 0 >().get_current_index() << ">" );
+
+            if( ! out_stream< 0 >().set( stream::s_run ) ) return false;
+        }
+
+        return true;
+#else
+        return receive_single();
+#endif
+    }
+
+    bool packet_receiver_socket::receive_gro()
+    {
+#ifdef __linux__
+        unsigned t_n_msgs = f_msgs.size();
+
+        static const size_t t_control_len = CMSG_SPACE( sizeof(timespec) ) + CMSG_SPACE( sizeof(int) );
+        for( unsigned i_msg = 0; i_msg < t_n_msgs; ++i_msg )
+        {
+            if( ! f_gro_staged[ i_msg ] ) f_gro_staged[ i_msg ] = get_gro_buffer();
+            f_iovecs[ i_msg ].iov_base = f_gro_staged[ i_msg ].get();
+            f_iovecs[ i_msg ].iov_len = s_gro_buffer_size;
+            ::memset( &f_msgs[ i_msg ], 0, sizeof(mmsghdr) );
+            f_msgs[ i_msg ].msg_hdr.msg_iov = &f_iovecs[ i_msg ];
+            f_msgs[ i_msg ].msg_hdr.msg_iovlen = 1;
+            f_msgs[ i_msg ].msg_hdr.msg_control = &f_control[ i_msg * t_control_len ];
+            f_msgs[ i_msg ].msg_hdr.msg_controllen = t_control_len;
+        }
+
+        // blocks (up to the timeout) until at least one datagram is available, then takes whatever else is there
+        int t_n_received = ::recvmmsg( f_socket, f_msgs.data(), t_n_msgs, MSG_WAITFORONE, nullptr );
+        if( t_n_received < 0 )
+        {
+            f_last_errno = errno;
+            if( f_last_errno != EWOULDBLOCK && f_last_errno != EAGAIN && f_last_errno != EINTR )
+            {
+                LWARN( plog, "Unable to receive; error message: " << strerror( f_last_errno ) );
+            }
+            return true;
+        }
+
+        LTRACE( plog, "Received " << t_n_received << " datagrams" );
+        for( int i_msg = 0; i_msg < t_n_received; ++i_msg )
+        {
+            size_t t_size = f_msgs[ i_msg ].msg_len;
+            // without the GRO control message, the datagram is a single packet
+            size_t t_segment_size = t_size;
+            uint64_t t_rx_timestamp_ns = 0;
+            for( cmsghdr* t_cmsg = CMSG_FIRSTHDR( &f_msgs[ i_msg ].msg_hdr ); t_cmsg != nullptr; t_cmsg = CMSG_NXTHDR( &f_msgs[ i_msg ].msg_hdr, t_cmsg ) )
+            {
+                if( t_cmsg->cmsg_level == SOL_UDP && t_cmsg->cmsg_type == UDP_GRO )
+                {
+                    int t_gso_size;
+                    ::memcpy( &t_gso_size, CMSG_DATA( t_cmsg ), sizeof(int) );
+                    if( t_gso_size > 0 ) t_segment_size = t_gso_size;
+                }
+                else if( t_cmsg->cmsg_level == SOL_SOCKET && t_cmsg->cmsg_type == SCM_TIMESTAMPNS )
+                {
+                    timespec t_stamp;
+                    ::memcpy( &t_stamp, CMSG_DATA( t_cmsg ), sizeof(timespec) );
+                    t_rx_timestamp_ns = (uint64_t)t_stamp.tv_sec * 1000000000 + t_stamp.tv_nsec;
+                }
+            }
+            ++f_gro_datagrams;
+
+            // the buffer now belongs to the slots viewing it; a new one is staged for the next call
+            std::shared_ptr< uint8_t > t_buffer = std::move( f_gro_staged[ i_msg ] );
+            for( size_t t_offset = 0; t_offset < t_size; t_offset += t_segment_size )
+            {
+                // replacing the view drops this slot's reference to the buffer it viewed before
+                memory_block* t_block = out_stream< 0 >().data();
+                t_block->set_view( t_buffer.get() + t_offset, std::min( t_segment_size, t_size - t_offset ), t_buffer );
+                t_block->set_rx_timestamp_ns( t_rx_timestamp_ns );
+                ++f_gro_packets;
+
+                LTRACE( plog, "Packet (" << t_block->get_n_bytes_used() << " bytes) written to stream index <" << out_stream< 0 >().get_current_index() << ">" );
+
+                if( ! out_stream< 0 >().set( stream::s_run ) ) return false;
+            }
+        }
+
+        return true;
+#else
+        return receive_single();
+#endif
+    }
+
+    std::shared_ptr< uint8_t > packet_receiver_socket::get_gro_buffer()
+    {
+        // a buffer is free once the pool holds the only reference to it
+        for( const std::shared_ptr< uint8_t >& t_buffer : f_gro_buffers )
+        {
+            if( t_buffer.use_count() == 1 )
+            {
+                // synchronizes with the release of the last view by a downstream thread
+                std::atomic_thread_fence( std::memory_order_acquire );
+                return t_buffer;
+            }
+        }
+        f_gro_buffers.emplace_back( new uint8_t[ s_gro_buffer_size ], std::default_delete< uint8_t[] >() );
+        LDEBUG( plog, "Allocated GRO buffer " << f_gro_buffers.size() );
+        return f_gro_buffers.back();
+    }
+
     void packet_receiver_socket::finalize()
     {
         out_buffer< 0 >().finalize();
 
+        f_staging_blocks.clear();
+        f_gro_staged.clear();
+        f_gro_buffers.clear();
         cleanup_socket();
 
         return;
@@ -240,6 +517,10 @@ namespace psyllid
         a_node->set_port( a_config.get_value( "port", a_node->get_port() ) );
         a_node->ip() = a_config.get_value( "ip", a_node->ip() );
         a_node->set_timeout_sec( a_config.get_value( "timeout-sec", a_node->get_timeout_sec() ) );
+        a_node->set_batch_size( a_config.get_value( "batch-size", a_node->get_batch_size() ) );
+        a_node->set_rcvbuf_size( a_config.get_value( "rcvbuf-size", a_node->get_rcvbuf_size() ) );
+        a_node->set_timestamps( a_config.get_value( "timestamps", a_node->get_timestamps() ) );
+        a_node->set_gro( a_config.get_value( "gro", a_node->get_gro() ) );
         return;
     }
 
@@ -250,6 +531,10 @@ namespace psyllid
         a_config.add( "port", scarab::param_value( a_node->get_port() ) );
         a_config.add( "ip", scarab::param_value( a_node->ip() ) );
         a_config.add( "timeout-sec", scarab::param_value( a_node->get_timeout_sec() ) );
+        a_config.add( "batch-size", scarab::param_value( a_node->get_batch_size() ) );
+        a_config.add( "rcvbuf-size", scarab::param_value( a_node->get_rcvbuf_size() ) );
+        a_config.add( "timestamps", scarab::param_value( a_node->get_timestamps() ) );
+        a_config.add( "gro", scarab::param_value( a_node->get_gro() ) );
         return;
     }
 
@@ -14,7 +14,11 @@
 #include "producer.hh"
 #include "shared_cancel.hh"
 
+#include <memory>
+#include <vector>
+
 #include <netinet/in.h>
+#include <sys/socket.h>
 
 namespace scarab
 {
@@ -42,6 +46,29 @@ namespace psyllid
      - "port": uint -- UDP port to listen on for packets
      - "ip": string -- IP port to listen on for packets; must be in IPV4 numbers-and-dots notation (e.g. 127.0.0.1)
      - "timeout-sec": uint -- Timeout (in seconds) while listening for incoming packets; listening for packets repeats after timeout
+     - "batch-size": uint -- Maximum number of packets received per system call; if greater than 1, recvmmsg is used (default is 1)
+     - "rcvbuf-size": uint -- Size of the socket receive buffer (SO_RCVBUF) in bytes; 0 (default) keeps the system default
+     - "timestamps": bool -- If true, the kernel receive time of each packet (SO_TIMESTAMPNS) is stored in the output memory_block (default is false)
+     - "gro": bool -- If true, UDP generic receive offload (UDP_GRO) is enabled, so that each receive can return many packets (default is false)
+
+     Batched receiving:
+     With "batch-size" > 1, up to that many packets are received with a single recvmmsg call into a set of staging blocks.
+     Each staging block then trades its memory with the current output-stream slot (memory_block::swap()), so the
+     packets are not copied.  The call returns as soon as at least one packet is available.
+
+     UDP GRO:
+     With "gro" enabled, the kernel coalesces consecutive packets from the same flow into super-datagrams of up to 64 kB,
+     and reports the size of the original packets (the segment size) with each one.  Each super-datagram is received into
+     a pooled 64-kB buffer and split into its original packets, which are output in consecutive slots as views
+     (see memory_block::set_view()) into that buffer, so there is no copying.  A buffer is reused once no slot refers
+     to it anymore.  The last segment of a super-datagram can be shorter than the others, and is output with its own size
+     (the TF ROACH receivers drop blocks shorter than a ROACH packet).  Combined with "batch-size", each recvmmsg call can
+     return up to "batch-size" super-datagrams.  "max-packet-size" is not used with GRO.  Coalescing happens for packets
+     received from a NIC with GRO enabled, or on loopback when the sender uses UDP_SEGMENT (see test_gso_sender).  Requires Linux 5.0 or later.
+
+     Batched receiving, timestamps, and GRO are only available on Linux.
+
+     The receive buffer size is limited by net.core.rmem_max, unless the process has CAP_NET_ADMIN, in which case SO_RCVBUFFORCE is used.
 
      Output Streams:
      - 0: memory_block
@@ -58,6 +85,10 @@ namespace psyllid
             mv_accessible( uint32_t, port );
             mv_referrable( std::string, ip );
             mv_accessible( unsigned, timeout_sec );  /// Timeout in seconds for waiting on socket recv function
+            mv_accessible( unsigned, batch_size );   /// Maximum number of packets per recvmmsg call
+            mv_accessible( unsigned, rcvbuf_size );  /// Socket receive buffer size in bytes; 0 for the system default
+            mv_accessible( bool, timestamps );       /// Whether to record kernel receive timestamps
+            mv_accessible( bool, gro );              /// Whether to receive coalesced super-datagrams with UDP_GRO
 
         public:
             virtual void initialize();
@@ -65,11 +96,27 @@ namespace psyllid
             virtual void finalize();
 
         private:
+            bool receive_single();
+            bool receive_batched();
+            bool receive_gro();
+            std::shared_ptr< uint8_t > get_gro_buffer();
             void cleanup_socket();
 
             int f_socket;
             sockaddr_in* f_address;
 
+            std::vector< std::unique_ptr< memory_block > > f_staging_blocks;
+#ifdef __linux__
+            std::vector< mmsghdr > f_msgs;
+            std::vector< iovec > f_iovecs;
+            std::vector< char > f_control;
+#endif
+
+            std::vector< std::shared_ptr< uint8_t > > f_gro_buffers; // pool of super-datagram buffers; shared with the memory_blocks viewing them
+            std::vector< std::shared_ptr< uint8_t > > f_gro_staged;  // buffers given to the current recvmmsg call
+            uint64_t f_gro_datagrams;
+            uint64_t f_gro_packets;
+
         protected:
             int f_last_errno;
 
@@ -0,0 +1,445 @@
+/*
+ * packet_receiver_uring.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_receiver_uring.hh"
+
+#include "psyllid_error.hh"
+#include "receiver_stats_house.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <errno.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( packet_receiver_uring, "packet-receiver-uring", packet_receiver_uring_binding );
+
+    LOGGER( plog, "packet_receiver_uring" );
+
+    static const unsigned s_buffer_group = 0;
+
+    packet_receiver_uring::packet_receiver_uring() :
+            f_length( 10 ),
+            f_max_packet_size( 16384 ),
+            f_port( 23530 ),
+            f_ip( "127.0.0.1" ),
+            f_timeout_sec( 1 ),
+            f_n_buffers( 1024 ),
+            f_rcvbuf_size( 0 ),
+            f_timestamps( false ),
+            f_socket( 0 ),
+            f_ring_initialized( false ),
+            f_ring(),
+            f_buf_ring( nullptr ),
+            f_msg(),
+            f_buffer_size( 0 ),
+            f_buffer_area( nullptr ),
+            f_buffer_refs(),
+            f_outstanding_buffer_ids(),
+            f_packets_total( 0 ),
+            f_bytes_total( 0 ),
+            f_n_rearms( 0 ),
+            f_n_buffer_waits( 0 )
+    {
+    }
+
+    packet_receiver_uring::~packet_receiver_uring()
+    {
+        cleanup_uring();
+    }
+
+    void packet_receiver_uring::initialize()
+    {
+        out_buffer< 0 >().initialize( f_length );
+
+        if( f_n_buffers == 0 || f_n_buffers > 32768 || ( f_n_buffers & ( f_n_buffers - 1 ) ) != 0 )
+        {
+            throw error() << "[packet_receiver_uring] Number of buffers must be a power of 2 no larger than 32768; got " << f_n_buffers;
+        }
+        if( f_n_buffers < 2 * f_length )
+        {
+            throw error() << "[packet_receiver_uring] Number of buffers (" << f_n_buffers << ") must be at least twice the buffer length (" << f_length << ")";
+        }
+
+        LDEBUG( plog, "Opening UDP socket receiving at " << f_ip << ":" << f_port );
+
+        sockaddr_in t_address;
+        ::memset( &t_address, 0, sizeof(sockaddr_in) );
+        t_address.sin_family = AF_INET;
+        t_address.sin_addr.s_addr = inet_addr( f_ip.c_str() );
+        if( t_address.sin_addr.s_addr == INADDR_NONE )
+        {
+            throw error() << "[packet_receiver_uring] invalid IP address\n";
+        }
+        t_address.sin_port = htons( f_port );
+
+        f_socket = ::socket( AF_INET, SOCK_DGRAM, 0 );
+        if( f_socket < 0 )
+        {
+            f_socket = 0;
+            throw error() << "[packet_receiver_uring] could not create socket:\n\t" << strerror( errno );
+        }
+
+        int optval = 1;
+        ::setsockopt( f_socket, SOL_SOCKET, SO_REUSEADDR, (const void *)&optval , sizeof(int));
+
+        if( f_rcvbuf_size > 0 )
+        {
+            int t_rcvbuf = f_rcvbuf_size;
+            if( ::setsockopt( f_socket, SOL_SOCKET, SO_RCVBUFFORCE, &t_rcvbuf, sizeof(t_rcvbuf) ) < 0 &&
+                    ::setsockopt( f_socket, SOL_SOCKET, SO_RCVBUF, &t_rcvbuf, sizeof(t_rcvbuf) ) < 0 )
+            {
+                LWARN( plog, "Unable to set the receive buffer size:\n\t" << strerror( errno ) );
+            }
+        }
+
+        if( f_timestamps )
+        {
+            int t_on = 1;
+            if( ::setsockopt( f_socket, SOL_SOCKET, SO_TIMESTAMPNS, &t_on, sizeof(t_on) ) < 0 )
+            {
+                throw error() << "[packet_receiver_uring] could not enable timestamps:\n\t" << strerror( errno );
+            }
+        }
+
+        if( ::bind( f_socket, (const sockaddr*)&t_address, sizeof(sockaddr_in) ) < 0 )
+        {
+            throw error() << "[packet_receiver_uring] could not bind socket:\n\t" << strerror( errno );
+        }
+
+        // set up the ring
+        int t_ret = io_uring_queue_init( 64, &f_ring, 0 );
+        if( t_ret < 0 )
+        {
+            throw error() << "[packet_receiver_uring] could not set up io_uring:\n\t" << strerror( -t_ret );
+        }
+        f_ring_initialized = true;
+
+        // the message header only describes the layout of each buffer: no source address is requested,
+        // and the only control data is the receive timestamp, if enabled
+        ::memset( &f_msg, 0, sizeof(msghdr) );
+        if( f_timestamps ) f_msg.msg_controllen = CMSG_SPACE( sizeof(timespec) );
+
+        // each buffer holds the recvmsg header and control data, followed by the packet
+        f_buffer_size = sizeof(io_uring_recvmsg_out) + f_msg.msg_controllen + f_max_packet_size;
+        f_buffer_size = ( f_buffer_size + 63 ) & ~size_t(63);
+        if( ::posix_memalign( (void**)&f_buffer_area, 4096, f_buffer_size * f_n_buffers ) != 0 )
+        {
+            f_buffer_area = nullptr;
+            throw error() << "[packet_receiver_uring] could not allocate " << f_n_buffers << " buffers of " << f_buffer_size << " bytes";
+        }
+        // the references only track whether a buffer is still viewed; the area is freed in cleanup_uring()
+        f_buffer_refs.clear();
+        for( unsigned i_buffer = 0; i_buffer < f_n_buffers; ++i_buffer )
+        {
+            f_buffer_refs.push_back( std::shared_ptr< void >( f_buffer_area + i_buffer * f_buffer_size, []( void* ){} ) );
+        }
+
+        f_buf_ring = io_uring_setup_buf_ring( &f_ring, f_n_buffers, s_buffer_group, 0, &t_ret );
+        if( f_buf_ring == nullptr )
+        {
+            throw error() << "[packet_receiver_uring] could not register the provided-buffer ring:\n\t" << strerror( -t_ret );
+        }
+        for( unsigned i_buffer = 0; i_buffer < f_n_buffers; ++i_buffer )
+        {
+            io_uring_buf_ring_add( f_buf_ring, f_buffer_area + i_buffer * f_buffer_size, f_buffer_size, i_buffer, io_uring_buf_ring_mask( f_n_buffers ), i_buffer );
+        }
+        io_uring_buf_ring_advance( f_buf_ring, f_n_buffers );
+
+        f_outstanding_buffer_ids.clear();
+        f_outstanding_buffer_ids.reserve( f_n_buffers );
+
+        LINFO( plog, "Ready to receive messages at port " << f_ip << ":" << f_port );
+
+        return;
+    }
+
+    void packet_receiver_uring::arm_recv()
+    {
+        io_uring_sqe* t_sqe = io_uring_get_sqe( &f_ring );
+        if( t_sqe == nullptr )
+        {
+            throw error() << "[packet_receiver_uring] no submission queue entry available";
+        }
+        io_uring_prep_recvmsg_multishot( t_sqe, f_socket, &f_msg, 0 );
+        t_sqe->flags |= IOSQE_BUFFER_SELECT;
+        t_sqe->buf_group = s_buffer_group;
+        int t_ret = io_uring_submit( &f_ring );
+        if( t_ret < 0 )
+        {
+            throw error() << "[packet_receiver_uring] could not submit the receive request:\n\t" << strerror( -t_ret );
+        }
+        return;
+    }
+
+    void packet_receiver_uring::recycle_buffer( int a_buffer_id )
+    {
+        io_uring_buf_ring_add( f_buf_ring, f_buffer_area + a_buffer_id * f_buffer_size, f_buffer_size, a_buffer_id, io_uring_buf_ring_mask( f_n_buffers ), 0 );
+        io_uring_buf_ring_advance( f_buf_ring, 1 );
+        return;
+    }
+
+    void packet_receiver_uring::recycle_released_buffers()
+    {
+        // a buffer whose only remaining reference is ours is no longer viewed by any memory_block
+        auto t_end = std::remove_if( f_outstanding_buffer_ids.begin(), f_outstanding_buffer_ids.end(),
+                [this]( int a_buffer_id )
+                {
+                    if( f_buffer_refs[ a_buffer_id ].use_count() != 1 ) return false;
+                    std::atomic_thread_fence( std::memory_order_acquire );
+                    recycle_buffer( a_buffer_id );
+                    return true;
+                } );
+        f_outstanding_buffer_ids.erase( t_end, f_outstanding_buffer_ids.end() );
+        return;
+    }
+
+    void packet_receiver_uring::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet_receiver_uring" );
+
+            if( ! out_stream< 0 >().set( stream::s_start ) ) return;
+
+            __kernel_timespec t_timeout;
+            t_timeout.tv_sec = f_timeout_sec;
+            t_timeout.tv_nsec = 0;
+
+            arm_recv();
+            bool t_armed = true;
+
+            LINFO( plog, "Starting main loop; waiting for packets" );
+            bool t_stream_ok = true;
+            while( t_stream_ok && ! is_canceled() )
+            {
+                if( (out_stream< 0 >().get() == stream::s_stop) )
+                {
+                    LWARN( plog, "Output stream(s) have stop condition" );
+                    break;
+                }
+
+                recycle_released_buffers();
+
+                if( ! t_armed )
+                {
+                    // re-arming with no buffers in the ring would fail straight away with ENOBUFS,
+                    // so wait for the stream slots to release some
+                    if( f_outstanding_buffer_ids.size() >= f_n_buffers )
+                    {
+                        ++f_n_buffer_waits;
+                        std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+                        continue;
+                    }
+                    ++f_n_rearms;
+                    arm_recv();
+                    t_armed = true;
+                }
+
+                io_uring_cqe* t_cqe = nullptr;
+                int t_ret = io_uring_wait_cqe_timeout( &f_ring, &t_cqe, &t_timeout );
+                if( t_ret == -ETIME || t_ret == -EINTR ) continue;
+                if( t_ret < 0 )
+                {
+                    throw error() << "[packet_receiver_uring] error while waiting for packets:\n\t" << strerror( -t_ret );
+                }
+
+                // handle everything that's complete
+                unsigned t_head = 0;
+                unsigned t_n_cqes = 0;
+                bool t_rearm = false;
+                io_uring_for_each_cqe( &f_ring, t_head, t_cqe )
+                {
+                    ++t_n_cqes;
+                    if( ! ( t_cqe->flags & IORING_CQE_F_MORE ) ) t_rearm = true;
+
+                    if( t_cqe->res < 0 )
+                    {
+                        if( t_cqe->res == -ENOBUFS )
+                        {
+                            LDEBUG( plog, "Ran out of packet buffers" );
+                        }
+                        else
+                        {
+                            LWARN( plog, "Unable to receive; error message: " << strerror( -t_cqe->res ) );
+                        }
+                        continue;
+                    }
+                    if( ! ( t_cqe->flags & IORING_CQE_F_BUFFER ) ) continue;
+
+                    int t_buffer_id = t_cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+                    uint8_t* t_buffer = f_buffer_area + t_buffer_id * f_buffer_size;
+
+                    io_uring_recvmsg_out* t_out = io_uring_recvmsg_validate( t_buffer, t_cqe->res, &f_msg );
+                    if( t_out == nullptr || ! t_stream_ok )
+                    {
+                        recycle_buffer( t_buffer_id );
+                        continue;
+                    }
+                    if( t_out->flags & MSG_TRUNC )
+                    {
+                        LWARN( plog, "Packet was truncated to " << f_max_packet_size << " bytes" );
+                    }
+
+                    uint8_t* t_payload = reinterpret_cast< uint8_t* >( io_uring_recvmsg_payload( t_out, &f_msg ) );
+                    unsigned t_payload_len = io_uring_recvmsg_payload_length( t_out, t_cqe->res, &f_msg );
+
+                    ++f_packets_total;
+                    f_bytes_total += t_payload_len;
+
+                    // replacing the view drops this slot's reference to the buffer it viewed before
+                    memory_block* t_block = out_stream< 0 >().data();
+                    t_block->set_view( t_payload, t_payload_len, f_buffer_refs[ t_buffer_id ] );
+                    t_block->set_rx_timestamp_ns( 0 );
+                    if( f_timestamps )
+                    {
+                        for( cmsghdr* t_cmsg = io_uring_recvmsg_cmsg_firsthdr( t_out, &f_msg ); t_cmsg != nullptr; t_cmsg = io_uring_recvmsg_cmsg_nexthdr( t_out, &f_msg, t_cmsg ) )
+                        {
+                            if( t_cmsg->cmsg_level == SOL_SOCKET && t_cmsg->cmsg_type == SCM_TIMESTAMPNS )
+                            {
+                                timespec t_stamp;
+                                ::memcpy( &t_stamp, CMSG_DATA( t_cmsg ), sizeof(timespec) );
+                                t_block->set_rx_timestamp_ns( (uint64_t)t_stamp.tv_sec * 1000000000 + t_stamp.tv_nsec );
+                            }
+                        }
+                    }
+                    f_outstanding_buffer_ids.push_back( t_buffer_id );
+
+                    LTRACE( plog, "Packet (" << t_payload_len << " bytes) written to stream index <" << out_stream< 0 >().get_current_index() << ">" );
+
+                    if( ! out_stream< 0 >().set( stream::s_run ) )
+                    {
+                        LERROR( plog, "Exiting due to stream error" );
+                        t_stream_ok = false;
+                    }
+                }
+                io_uring_cq_advance( &f_ring, t_n_cqes );
+
+                // the request is re-armed at the top of the loop, once there are buffers to receive into
+                if( t_rearm ) t_armed = false;
+            }
+
+            LINFO( plog, "Packet receiver is exiting; " << f_packets_total << " packets (" << f_bytes_total << " bytes) received; receive request re-armed "
+                    << f_n_rearms << " times; waited " << f_n_buffer_waits << " times for buffers to be released" );
+
+            scarab::param_node t_stats;
+            t_stats.add( "packets", scarab::param_value( f_packets_total ) );
+            t_stats.add( "bytes", scarab::param_value( f_bytes_total ) );
+            t_stats.add( "rearms", scarab::param_value( f_n_rearms ) );
+            t_stats.add( "buffer-waits", scarab::param_value( f_n_buffer_waits ) );
+            receiver_stats_house::get_instance()->post( get_name(), t_stats );
+
+            if( ! t_stream_ok ) return;
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void packet_receiver_uring::finalize()
+    {
+        out_buffer< 0 >().finalize();
+
+        cleanup_uring();
+
+        return;
+    }
+
+    void packet_receiver_uring::cleanup_uring()
+    {
+        if( f_ring_initialized )
+        {
+            if( f_buf_ring != nullptr )
+            {
+                io_uring_free_buf_ring( &f_ring, f_buf_ring, f_n_buffers, s_buffer_group );
+                f_buf_ring = nullptr;
+            }
+            io_uring_queue_exit( &f_ring );
+            f_ring_initialized = false;
+        }
+
+        f_buffer_refs.clear();
+        if( f_buffer_area != nullptr )
+        {
+            ::free( f_buffer_area );
+            f_buffer_area = nullptr;
+        }
+
+        f_outstanding_buffer_ids.clear();
+
+        if( f_socket != 0 )
+        {
+            ::close( f_socket );
+            f_socket = 0;
+        }
+
+        return;
+    }
+
+
+    packet_receiver_uring_binding::packet_receiver_uring_binding() :
+            sandfly::_node_binding< packet_receiver_uring, packet_receiver_uring_binding >()
+    {
+    }
+
+    packet_receiver_uring_binding::~packet_receiver_uring_binding()
+    {
+    }
+
+    void packet_receiver_uring_binding::do_apply_config( packet_receiver_uring* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_receiver_uring with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->set_max_packet_size( a_config.get_value( "max-packet-size", a_node->get_max_packet_size() ) );
+        a_node->set_port( a_config.get_value( "port", a_node->get_port() ) );
+        a_node->ip() = a_config.get_value( "ip", a_node->ip() );
+        a_node->set_timeout_sec( a_config.get_value( "timeout-sec", a_node->get_timeout_sec() ) );
+        a_node->set_n_buffers( a_config.get_value( "n-buffers", a_node->get_n_buffers() ) );
+        a_node->set_rcvbuf_size( a_config.get_value( "rcvbuf-size", a_node->get_rcvbuf_size() ) );
+        a_node->set_timestamps( a_config.get_value( "timestamps", a_node->get_timestamps() ) );
+        return;
+    }
+
+    void packet_receiver_uring_binding::do_dump_config( const packet_receiver_uring* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_receiver_uring" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "max-packet-size", scarab::param_value( a_node->get_max_packet_size() ) );
+        a_config.add( "port", scarab::param_value( a_node->get_port() ) );
+        a_config.add( "ip", scarab::param_value( a_node->ip() ) );
+        a_config.add( "timeout-sec", scarab::param_value( a_node->get_timeout_sec() ) );
+        a_config.add( "n-buffers", scarab::param_value( a_node->get_n_buffers() ) );
+        a_config.add( "rcvbuf-size", scarab::param_value( a_node->get_rcvbuf_size() ) );
+        a_config.add( "timestamps", scarab::param_value( a_node->get_timestamps() ) );
+        return;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,128 @@
+/*
+ * packet_receiver_uring.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_RECEIVER_URING_HH_
+#define PSYLLID_PACKET_RECEIVER_URING_HH_
+
+#include "memory_block.hh"
+#include "node_builder.hh"
+
+#include "producer.hh"
+#include "shared_cancel.hh"
+
+#include <liburing.h>
+
+#include <memory>
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+
+    /*!
+     @class packet_receiver_uring
+     @author N. S. Oblath
+
+     @brief A producer to receive UDP packets with io_uring and write them as raw blocks of memory
+
+     @details
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Works in Linux only (5.19 or later for multishot recvmsg with provided-buffer rings), and requires liburing.
+
+     A single multishot recvmsg request keeps delivering packets from a normal UDP socket into buffers taken from a
+     provided-buffer ring registered with io_uring, so there are no per-packet system calls.  No special privileges
+     are needed, and the node works on any interface, including loopback.
+
+     The output memory_blocks are views (see memory_block::set_view()) into the packet buffers, so packets are not copied.
+     Each buffer has a reference that's held by the memory_block viewing it; the buffer is given back to the kernel once no
+     memory_block refers to it anymore, i.e. once its stream slot has been overwritten (or, behind a packet_demux, once the
+     demux output slot it was passed to has been overwritten).  Downstream nodes must not modify the packet, since the
+     view ends where the packet does, and must not keep pointers to it past the release of the slot.  Since up to "length" buffers are held by
+     the stream slots, "n-buffers" must be at least twice "length".
+
+     If the kernel runs out of buffers, the multishot request ends.  It is re-armed (and the event is counted) once buffers
+     have been given back to the ring; until then the node checks for released buffers every 50 us, and counts the waits.
+
+     Node type: "packet-receiver-uring"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "max-packet-size": uint -- Maximum number of bytes to be read for each packet; larger packets will be truncated
+     - "port": uint -- UDP port to listen on for packets
+     - "ip": string -- IP port to listen on for packets; must be in IPV4 numbers-and-dots notation (e.g. 127.0.0.1)
+     - "timeout-sec": uint -- Timeout (in seconds) while waiting for packets; waiting repeats after timeout
+     - "n-buffers": uint -- Number of packet buffers in the provided-buffer ring; must be a power of 2, at most 32768 (default is 1024)
+     - "rcvbuf-size": uint -- Size of the socket receive buffer (SO_RCVBUF) in bytes; 0 (default) keeps the system default
+     - "timestamps": bool -- If true, the kernel receive time of each packet (SO_TIMESTAMPNS) is stored in the output memory_block (default is false)
+
+     Output Streams:
+     - 0: memory_block
+    */
+    class packet_receiver_uring : public midge::_producer< midge::type_list< memory_block > >
+    {
+        public:
+            packet_receiver_uring();
+            virtual ~packet_receiver_uring();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_accessible( uint32_t, max_packet_size );
+            mv_accessible( uint32_t, port );
+            mv_referrable( std::string, ip );
+            mv_accessible( unsigned, timeout_sec );  /// Timeout in seconds for waiting on completions
+            mv_accessible( unsigned, n_buffers );    /// Number of packet buffers in the provided-buffer ring
+            mv_accessible( unsigned, rcvbuf_size );  /// Socket receive buffer size in bytes; 0 for the system default
+            mv_accessible( bool, timestamps );       /// Whether to record kernel receive timestamps
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            void arm_recv();
+            void recycle_buffer( int a_buffer_id );
+            void recycle_released_buffers();
+            void cleanup_uring();
+
+            int f_socket;
+            bool f_ring_initialized;
+            io_uring f_ring;
+            io_uring_buf_ring* f_buf_ring;
+            msghdr f_msg;
+
+            size_t f_buffer_size;
+            uint8_t* f_buffer_area;
+            std::vector< std::shared_ptr< void > > f_buffer_refs; // one per buffer; shared with the memory_blocks viewing it
+            std::vector< int > f_outstanding_buffer_ids;          // buffers that have been output and not yet recycled
+
+            uint64_t f_packets_total;
+            uint64_t f_bytes_total;
+            uint64_t f_n_rearms;
+            uint64_t f_n_buffer_waits;
+    };
+
+    class packet_receiver_uring_binding : public sandfly::_node_binding< packet_receiver_uring, packet_receiver_uring_binding >
+    {
+        public:
+            packet_receiver_uring_binding();
+            virtual ~packet_receiver_uring_binding();
+
+        private:
+            virtual void do_apply_config( packet_receiver_uring* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const packet_receiver_uring* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_RECEIVER_URING_HH_ */
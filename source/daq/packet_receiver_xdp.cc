@@ -0,0 +1,424 @@
+/*
+ * packet_receiver_xdp.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_receiver_xdp.hh"
+
+#include "psyllid_error.hh"
+#include "receiver_stats_house.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/if_ether.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/ip.h>
+#include <linux/udp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( packet_receiver_xdp, "packet-receiver-xdp", packet_receiver_xdp_binding );
+
+    LOGGER( plog, "packet_receiver_xdp" );
+
+    packet_receiver_xdp::packet_receiver_xdp() :
+            f_length( 10 ),
+            f_max_packet_size( 1048576 ),
+            f_port( 23530 ),
+            f_interface( "eth1" ),
+            f_queue_id( 0 ),
+            f_timeout_sec( 1 ),
+            f_n_frames( 4096 ),
+            f_frame_size( 1 << 14 ),
+            f_batch_size( 64 ),
+            f_xdp_mode( "copy" ),
+            f_umem_area( nullptr ),
+            f_umem_size( 0 ),
+            f_umem( nullptr ),
+            f_xsk( nullptr ),
+            f_fill_ring(),
+            f_comp_ring(),
+            f_rx_ring(),
+            f_packets_total( 0 ),
+            f_bytes_total( 0 ),
+            f_packets_output( 0 )
+    {
+    }
+
+    packet_receiver_xdp::~packet_receiver_xdp()
+    {
+        cleanup_xdp();
+    }
+
+    void packet_receiver_xdp::initialize()
+    {
+        out_buffer< 0 >().initialize( f_length );
+
+        bool t_zero_copy = false;
+        if( f_xdp_mode == "zero-copy" ) t_zero_copy = true;
+        else if( f_xdp_mode != "copy" )
+        {
+            throw error() << "[packet_receiver_xdp] Unknown XDP mode <" << f_xdp_mode << ">; options are \"copy\" and \"zero-copy\"";
+        }
+
+        if( f_n_frames == 0 || ( f_n_frames & ( f_n_frames - 1 ) ) != 0 )
+        {
+            throw error() << "[packet_receiver_xdp] Number of frames must be a power of 2; got " << f_n_frames;
+        }
+        if( f_frame_size == 0 || ( f_frame_size & ( f_frame_size - 1 ) ) != 0 )
+        {
+            throw error() << "[packet_receiver_xdp] Frame size must be a power of 2; got " << f_frame_size;
+        }
+
+        LDEBUG( plog, "Preparing AF_XDP socket on interface " << f_interface << ", queue " << f_queue_id << ", at UDP port " << f_port << " in " << f_xdp_mode << " mode" );
+
+        // allocate the UMEM; frames larger than a page need huge pages
+        f_umem_size = (size_t)f_n_frames * f_frame_size;
+        int t_mmap_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+        if( f_frame_size > (unsigned)::sysconf( _SC_PAGESIZE ) ) t_mmap_flags |= MAP_HUGETLB;
+        f_umem_area = (uint8_t*)::mmap( nullptr, f_umem_size, PROT_READ | PROT_WRITE, t_mmap_flags, -1, 0 );
+        if( f_umem_area == MAP_FAILED )
+        {
+            f_umem_area = nullptr;
+            throw error() << "Unable to allocate the UMEM (" << f_umem_size << " bytes):\n\t" << strerror( errno );
+        }
+
+        xsk_umem_config t_umem_config;
+        ::memset( &t_umem_config, 0, sizeof(t_umem_config) );
+        t_umem_config.fill_size = f_n_frames;
+        t_umem_config.comp_size = XSK_RING_CONS__DEFAULT_NUM_DESCS;
+        t_umem_config.frame_size = f_frame_size;
+        t_umem_config.frame_headroom = 0;
+        t_umem_config.flags = 0;
+
+        int t_ret = xsk_umem__create( &f_umem, f_umem_area, f_umem_size, &f_fill_ring, &f_comp_ring, &t_umem_config );
+        if( t_ret != 0 )
+        {
+            f_umem = nullptr;
+            throw error() << "Unable to create the UMEM:\n\t" << strerror( -t_ret );
+        }
+
+        // create the socket; libxdp loads its default program, which redirects the queue to the socket
+        xsk_socket_config t_xsk_config;
+        ::memset( &t_xsk_config, 0, sizeof(t_xsk_config) );
+        t_xsk_config.rx_size = XSK_RING_CONS__DEFAULT_NUM_DESCS;
+        t_xsk_config.tx_size = 0;
+        t_xsk_config.xdp_flags = t_zero_copy ? XDP_FLAGS_DRV_MODE : XDP_FLAGS_SKB_MODE;
+        t_xsk_config.bind_flags = ( t_zero_copy ? XDP_ZEROCOPY : XDP_COPY ) | XDP_USE_NEED_WAKEUP;
+
+        t_ret = xsk_socket__create( &f_xsk, f_interface.c_str(), f_queue_id, f_umem, &f_rx_ring, nullptr, &t_xsk_config );
+        if( t_ret != 0 )
+        {
+            f_xsk = nullptr;
+            throw error() << "Unable to create the AF_XDP socket:\n\t" << strerror( -t_ret );
+        }
+
+        // hand all of the frames to the kernel
+        uint32_t t_idx_fill = 0;
+        if( xsk_ring_prod__reserve( &f_fill_ring, f_n_frames, &t_idx_fill ) != f_n_frames )
+        {
+            throw error() << "Unable to fill the fill ring";
+        }
+        for( unsigned i_frame = 0; i_frame < f_n_frames; ++i_frame )
+        {
+            *xsk_ring_prod__fill_addr( &f_fill_ring, t_idx_fill++ ) = (uint64_t)i_frame * f_frame_size;
+        }
+        xsk_ring_prod__submit( &f_fill_ring, f_n_frames );
+
+        LINFO( plog, "Ready to consume packets on interface <" << f_interface << ">, queue " << f_queue_id );
+
+        return;
+    }
+
+    void packet_receiver_xdp::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet_receiver_xdp" );
+
+            pollfd t_pollfd;
+            ::memset( &t_pollfd, 0, sizeof(pollfd) );
+            t_pollfd.fd = xsk_socket__fd( f_xsk );
+            t_pollfd.events = POLLIN;
+
+            unsigned t_timeout_msec = 1000 * f_timeout_sec;
+
+            size_t t_udp_data_len = 0;
+
+            if( ! out_stream< 0 >().set( stream::s_start ) ) return;
+
+            LINFO( plog, "Starting main loop; waiting for packets" );
+            bool t_stream_ok = true;
+            while( t_stream_ok && ! is_canceled() )
+            {
+                if( (out_stream< 0 >().get() == stream::s_stop) )
+                {
+                    LWARN( plog, "Output stream(s) have stop condition" );
+                    break;
+                }
+
+                uint32_t t_idx_rx = 0;
+                unsigned t_n_received = xsk_ring_cons__peek( &f_rx_ring, f_batch_size, &t_idx_rx );
+                if( t_n_received == 0 )
+                {
+                    // nothing available; poll until there is, with the specified timeout
+                    // polling also wakes up the kernel if it needs the fill ring to be refilled
+                    ::poll( &t_pollfd, 1, t_timeout_msec );
+                    continue;
+                }
+
+                // every frame is either in the kernel's hands or in this batch, so there's always room in the fill ring
+                uint32_t t_idx_fill = 0;
+                while( xsk_ring_prod__reserve( &f_fill_ring, t_n_received, &t_idx_fill ) != t_n_received )
+                {
+                    if( xsk_ring_prod__needs_wakeup( &f_fill_ring ) ) ::poll( &t_pollfd, 1, 0 );
+                }
+
+                LTRACE( plog, "Handling a batch of " << t_n_received << " frames" );
+                for( unsigned i_frame = 0; i_frame < t_n_received; ++i_frame )
+                {
+                    const xdp_desc* t_desc = xsk_ring_cons__rx_desc( &f_rx_ring, t_idx_rx++ );
+                    uint8_t* t_frame = reinterpret_cast< uint8_t* >( xsk_umem__get_data( f_umem_area, t_desc->addr ) );
+
+                    ++f_packets_total;
+                    f_bytes_total += t_desc->len;
+
+                    if( t_stream_ok )
+                    {
+                        uint8_t* t_udp_data = parse_frame( t_frame, t_desc->len, t_udp_data_len );
+                        if( t_udp_data != nullptr )
+                        {
+                            LTRACE( plog, "UDP packet processed; outputing to stream index <" << out_stream< 0 >().get_current_index() << ">" );
+                            if( output_packet( t_udp_data, t_udp_data_len ) )
+                            {
+                                ++f_packets_output;
+                            }
+                            else
+                            {
+                                // keep going through the batch so the frames are returned to the kernel
+                                LERROR( plog, "Exiting due to stream error" );
+                                t_stream_ok = false;
+                            }
+                        }
+                    }
+
+                    // the frame can go back to the kernel now that the payload has been copied
+                    *xsk_ring_prod__fill_addr( &f_fill_ring, t_idx_fill++ ) = xsk_umem__extract_addr( t_desc->addr );
+                }
+
+                xsk_ring_prod__submit( &f_fill_ring, t_n_received );
+                xsk_ring_cons__release( &f_rx_ring, t_n_received );
+            }
+
+            LINFO( plog, "Packet receiver is exiting; " << f_packets_total << " frames (" << f_bytes_total << " bytes) received; " << f_packets_output << " packets output" );
+            post_stats();
+
+            if( ! t_stream_ok ) return;
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    uint8_t* packet_receiver_xdp::parse_frame( uint8_t* a_frame, size_t a_frame_len, size_t& a_udp_data_len ) const
+    {
+        static const unsigned t_udp_hdr_len = sizeof( udphdr );
+
+        if( a_frame_len < ETH_HLEN + sizeof( iphdr ) + t_udp_hdr_len )
+        {
+            LDEBUG( plog, "Runt frame skipped" );
+            return nullptr;
+        }
+
+        ethhdr* t_eth_hdr = reinterpret_cast< ethhdr* >( a_frame );
+        if( t_eth_hdr->h_proto != htons(ETH_P_IP) )
+        {
+            LDEBUG( plog, "Non-IP packet skipped" );
+            return nullptr;
+        }
+
+        iphdr* t_ip_hdr = reinterpret_cast< iphdr* >( a_frame + ETH_HLEN );
+        if( t_ip_hdr->protocol != IPPROTO_UDP )
+        {
+            LDEBUG( plog, "Non-UDP packet skipped" );
+            return nullptr;
+        }
+
+        // fragments (a non-zero offset, or more fragments to come) don't hold a whole UDP packet
+        if( ( t_ip_hdr->frag_off & htons(0x3fff) ) != 0 )
+        {
+            LDEBUG( plog, "IP fragment skipped" );
+            return nullptr;
+        }
+
+        if( t_ip_hdr->ihl < 5 || ETH_HLEN + t_ip_hdr->ihl * 4 + t_udp_hdr_len > a_frame_len )
+        {
+            LDEBUG( plog, "Packet with an invalid IP header length (" << unsigned(t_ip_hdr->ihl) << ") skipped" );
+            return nullptr;
+        }
+
+        udphdr* t_udp_hdr = reinterpret_cast< udphdr* >( (uint8_t*)t_ip_hdr + t_ip_hdr->ihl * 4 );
+        if( ntohs(t_udp_hdr->dest) != f_port )
+        {
+            LDEBUG( plog, "Destination port is incorrect: expected " << f_port << " but got " << ntohs(t_udp_hdr->dest) );
+            return nullptr;
+        }
+
+        if( ntohs(t_udp_hdr->len) < t_udp_hdr_len )
+        {
+            LDEBUG( plog, "Packet with an invalid UDP length (" << ntohs(t_udp_hdr->len) << ") skipped" );
+            return nullptr;
+        }
+
+        uint8_t* t_udp_data = reinterpret_cast< uint8_t* >( t_udp_hdr ) + t_udp_hdr_len;
+        a_udp_data_len = ntohs(t_udp_hdr->len) - t_udp_hdr_len;
+        if( t_udp_data + a_udp_data_len > a_frame + a_frame_len )
+        {
+            LWARN( plog, "UDP packet is larger than the frame (frame size may be too small); skipping" );
+            return nullptr;
+        }
+
+        LTRACE( plog, "UDP sizes (total, header, data): " << ntohs(t_udp_hdr->len) << ", " << t_udp_hdr_len << ", " << a_udp_data_len );
+        return t_udp_data;
+    }
+
+    bool packet_receiver_xdp::output_packet( const uint8_t* a_udp_data, size_t a_udp_data_len )
+    {
+        memory_block* t_mem_block = out_stream< 0 >().data();
+        // size the block to the packet: with packets of constant size, this allocates only the first time round the stream buffer
+        if( a_udp_data_len > f_max_packet_size ) a_udp_data_len = f_max_packet_size;
+        t_mem_block->resize( a_udp_data_len );
+
+        ::memcpy( reinterpret_cast< void* >( t_mem_block->block() ),
+                  reinterpret_cast< const void* >( a_udp_data ),
+                  a_udp_data_len );
+        t_mem_block->set_n_bytes_used( a_udp_data_len );
+
+        return out_stream< 0 >().set( stream::s_run );
+    }
+
+    void packet_receiver_xdp::post_stats()
+    {
+        scarab::param_node t_stats;
+        t_stats.add( "packets", scarab::param_value( f_packets_total ) );
+        t_stats.add( "bytes", scarab::param_value( f_bytes_total ) );
+        t_stats.add( "packets-output", scarab::param_value( f_packets_output ) );
+
+        xdp_statistics t_xdp_stats;
+        socklen_t t_len = sizeof(t_xdp_stats);
+        if( ::getsockopt( xsk_socket__fd( f_xsk ), SOL_XDP, XDP_STATISTICS, &t_xdp_stats, &t_len ) < 0 )
+        {
+            LWARN( plog, "Unable to get the XDP statistics:\n\t" << strerror( errno ) );
+        }
+        else
+        {
+            t_stats.add( "kernel-drops", scarab::param_value( (uint64_t)t_xdp_stats.rx_dropped ) );
+            t_stats.add( "rx-ring-full", scarab::param_value( (uint64_t)t_xdp_stats.rx_ring_full ) );
+            t_stats.add( "fill-ring-empty", scarab::param_value( (uint64_t)t_xdp_stats.rx_fill_ring_empty_descs ) );
+            t_stats.add( "invalid-descs", scarab::param_value( (uint64_t)t_xdp_stats.rx_invalid_descs ) );
+            LINFO( plog, "XDP statistics: " << t_xdp_stats.rx_dropped << " dropped; " << t_xdp_stats.rx_ring_full << " receive-ring full; " << t_xdp_stats.rx_fill_ring_empty_descs << " fill-ring empty" );
+        }
+
+        receiver_stats_house::get_instance()->post( get_name(), t_stats );
+        return;
+    }
+
+    void packet_receiver_xdp::finalize()
+    {
+        out_buffer< 0 >().finalize();
+
+        LINFO( plog, "Closing the AF_XDP socket" );
+        cleanup_xdp();
+
+        return;
+    }
+
+    void packet_receiver_xdp::cleanup_xdp()
+    {
+        if( f_xsk != nullptr )
+        {
+            LDEBUG( plog, "Deleting the AF_XDP socket" );
+            xsk_socket__delete( f_xsk );
+            f_xsk = nullptr;
+        }
+        if( f_umem != nullptr )
+        {
+            LDEBUG( plog, "Deleting the UMEM" );
+            xsk_umem__delete( f_umem );
+            f_umem = nullptr;
+        }
+        if( f_umem_area != nullptr )
+        {
+            ::munmap( f_umem_area, f_umem_size );
+            f_umem_area = nullptr;
+        }
+        return;
+    }
+
+
+    packet_receiver_xdp_binding::packet_receiver_xdp_binding() :
+            sandfly::_node_binding< packet_receiver_xdp, packet_receiver_xdp_binding >()
+    {
+    }
+
+    packet_receiver_xdp_binding::~packet_receiver_xdp_binding()
+    {
+    }
+
+    void packet_receiver_xdp_binding::do_apply_config( packet_receiver_xdp* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_receiver_xdp with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->set_max_packet_size( a_config.get_value( "max-packet-size", a_node->get_max_packet_size() ) );
+        a_node->set_port( a_config.get_value( "port", a_node->get_port() ) );
+        a_node->interface() = a_config.get_value( "interface", a_node->interface() );
+        a_node->set_queue_id( a_config.get_value( "queue-id", a_node->get_queue_id() ) );
+        a_node->set_timeout_sec( a_config.get_value( "timeout-sec", a_node->get_timeout_sec() ) );
+        a_node->set_n_frames( a_config.get_value( "n-frames", a_node->get_n_frames() ) );
+        a_node->set_frame_size( a_config.get_value( "frame-size", a_node->get_frame_size() ) );
+        a_node->set_batch_size( a_config.get_value( "batch-size", a_node->get_batch_size() ) );
+        a_node->xdp_mode() = a_config.get_value( "xdp-mode", a_node->xdp_mode() );
+        return;
+    }
+
+    void packet_receiver_xdp_binding::do_dump_config( const packet_receiver_xdp* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_receiver_xdp" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "max-packet-size", scarab::param_value( a_node->get_max_packet_size() ) );
+        a_config.add( "port", scarab::param_value( a_node->get_port() ) );
+        a_config.add( "interface", scarab::param_value( a_node->interface() ) );
+        a_config.add( "queue-id", scarab::param_value( a_node->get_queue_id() ) );
+        a_config.add( "timeout-sec", scarab::param_value( a_node->get_timeout_sec() ) );
+        a_config.add( "n-frames", scarab::param_value( a_node->get_n_frames() ) );
+        a_config.add( "frame-size", scarab::param_value( a_node->get_frame_size() ) );
+        a_config.add( "batch-size", scarab::param_value( a_node->get_batch_size() ) );
+        a_config.add( "xdp-mode", scarab::param_value( a_node->xdp_mode() ) );
+        return;
+    }
+
+} /* namespace psyllid */
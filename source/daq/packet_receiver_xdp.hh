@@ -0,0 +1,130 @@
+/*
+ * packet_receiver_xdp.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_RECEIVER_XDP_HH_
+#define PSYLLID_PACKET_RECEIVER_XDP_HH_
+
+#include "memory_block.hh"
+#include "node_builder.hh"
+
+#include "producer.hh"
+#include "shared_cancel.hh"
+
+#include <xdp/xsk.h>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+
+    /*!
+     @class packet_receiver_xdp
+     @author N. S. Oblath
+
+     @brief A producer to receive UDP packets via an AF_XDP socket and write them as raw blocks of memory
+
+     @details
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Works in Linux only, and requires libxdp.
+
+     Input: AF_XDP socket bound to one queue of a network interface
+
+     Frames are received into a UMEM area shared with the kernel (and, in zero-copy mode, with the NIC driver).
+     The UDP payload of each packet sent to the configured port is copied into an output memory_block, and the
+     UMEM frame is immediately handed back to the kernel through the fill ring.
+
+     libxdp loads its default XDP program on the interface, which redirects all traffic arriving on the configured
+     queue to this socket.  Frames that are not UDP/IPv4 packets to the configured port are dropped, as are IP fragments and
+     packets whose headers don't fit in the frame, so use a dedicated
+     interface, or steer the ROACH traffic to a dedicated queue (e.g. with `ethtool -N <interface> flow-type udp4 dst-port <port> action <queue>`).
+
+     Modes:
+     - "zero-copy": the driver DMAs frames directly into the UMEM (XDP_ZEROCOPY); requires driver support
+     - "copy": the kernel copies frames into the UMEM (XDP_COPY) from the generic (SKB) XDP hook; works on any interface, including veth pairs
+
+     ROACH packets (8224-byte payloads) need "frame-size" to be larger than the usual 4096-byte page.
+     In that case the UMEM is allocated from huge pages, which must be reserved (e.g. through /proc/sys/vm/nr_hugepages);
+     UMEM chunks larger than a page require Linux 6.6 or later.
+
+     Node type: "packet-receiver-xdp"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "max-packet-size": uint -- Maximum number of bytes to be read for each packet; larger packets will be truncated
+     - "port": uint -- UDP port to listen on for packets
+     - "interface": string -- Name of the network interface to listen on for packets
+     - "queue-id": uint -- Interface queue to bind to (default is 0)
+     - "timeout-sec": uint -- Timeout (in seconds) while listening for incoming packets; listening for packets repeats after timeout
+     - "n-frames": uint -- Number of frames in the UMEM; must be a power of 2 (default is 4096)
+     - "frame-size": uint -- Size of each UMEM frame in bytes; must be a power of 2 (default is 16384)
+     - "batch-size": uint -- Maximum number of packets taken from the receive ring at a time (default is 64)
+     - "xdp-mode": string -- "copy" (default) or "zero-copy"
+
+     Output Streams:
+     - 0: memory_block
+    */
+    class packet_receiver_xdp : public midge::_producer< midge::type_list< memory_block > >
+    {
+        public:
+            packet_receiver_xdp();
+            virtual ~packet_receiver_xdp();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_accessible( uint32_t, max_packet_size );
+            mv_accessible( uint32_t, port );
+            mv_referrable( std::string, interface );
+            mv_accessible( unsigned, queue_id );
+            mv_accessible( unsigned, timeout_sec );  /// Timeout in seconds for waiting on the network interface
+            mv_accessible( unsigned, n_frames );     /// Number of frames in the UMEM
+            mv_accessible( unsigned, frame_size );   /// Size of each UMEM frame in bytes
+            mv_accessible( unsigned, batch_size );   /// Maximum number of packets taken from the receive ring at a time
+            mv_referrable( std::string, xdp_mode );  /// "copy" or "zero-copy"
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            uint8_t* parse_frame( uint8_t* a_frame, size_t a_frame_len, size_t& a_udp_data_len ) const;
+            bool output_packet( const uint8_t* a_udp_data, size_t a_udp_data_len );
+            void post_stats();
+            void cleanup_xdp();
+
+            uint8_t* f_umem_area;
+            size_t f_umem_size;
+            xsk_umem* f_umem;
+            xsk_socket* f_xsk;
+            xsk_ring_prod f_fill_ring;
+            xsk_ring_cons f_comp_ring;
+            xsk_ring_cons f_rx_ring;
+
+            uint64_t f_packets_total;
+            uint64_t f_bytes_total;
+            uint64_t f_packets_output;
+    };
+
+    class packet_receiver_xdp_binding : public sandfly::_node_binding< packet_receiver_xdp, packet_receiver_xdp_binding >
+    {
+        public:
+            packet_receiver_xdp_binding();
+            virtual ~packet_receiver_xdp_binding();
+
+        private:
+            virtual void do_apply_config( packet_receiver_xdp* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const packet_receiver_xdp* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_RECEIVER_XDP_HH_ */
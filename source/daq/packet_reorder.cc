@@ -0,0 +1,363 @@
+/*
+ * packet_reorder.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_reorder.hh"
+
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <cstddef> // for offsetof
+#include <string.h>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( time_data_reorder, "reorder-time-data", time_data_reorder_binding );
+    REGISTER_NODE_AND_BUILDER( freq_data_reorder, "reorder-freq-data", freq_data_reorder_binding );
+
+    LOGGER( plog, "packet_reorder" );
+
+    static const size_t s_header_size = offsetof( roach_packet, f_data );
+
+
+    //********************
+    // _packet_reorder
+    //********************
+
+    template< class x_data_type >
+    _packet_reorder< x_data_type >::_packet_reorder() :
+            f_length( 10 ),
+            f_window( 16 ),
+            f_fill_gaps( false ),
+            f_max_gap( 1024 ),
+            f_packets_in( 0 ),
+            f_packets_reordered( 0 ),
+            f_packets_late( 0 ),
+            f_packets_duplicate( 0 ),
+            f_packets_missing( 0 ),
+            f_placeholders( 0 ),
+            f_restarts( 0 ),
+            f_slots(),
+            f_occupied(),
+            f_n_occupied( 0 ),
+            f_have_sequence( false ),
+            f_next_seq( 0 ),
+            f_highest_seq( 0 ),
+            f_session_counter( 0 ),
+            f_last_output(),
+            f_have_last_output( false )
+    {
+    }
+
+    template< class x_data_type >
+    _packet_reorder< x_data_type >::~_packet_reorder()
+    {
+    }
+
+    template< class x_data_type >
+    void _packet_reorder< x_data_type >::initialize()
+    {
+        if( f_window == 0 )
+        {
+            throw error() << "[packet_reorder] The window must hold at least one packet";
+        }
+        if( f_window > BATCH_COUNTER_SIZE / 4 || f_max_gap > BATCH_COUNTER_SIZE / 4 )
+        {
+            throw error() << "[packet_reorder] The window (" << f_window << ") and max gap (" << f_max_gap << ") must be less than a quarter of the batch counter size (" << BATCH_COUNTER_SIZE << ")";
+        }
+
+        this->template out_buffer< 0 >().initialize( f_length );
+
+        f_slots.resize( f_window );
+        f_occupied.assign( f_window, false );
+        reset();
+        return;
+    }
+
+    template< class x_data_type >
+    void _packet_reorder< x_data_type >::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet reorder with a window of " << f_window << " packets" );
+
+            x_data_type* t_data_in = nullptr;
+
+            LINFO( plog, "Starting main loop (packet reorder)" );
+            while( ! this->is_canceled() )
+            {
+                midge::enum_t t_in_cmd = this->template in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error )
+                {
+                    LDEBUG( plog, "got an s_error on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "got an s_exit on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    LDEBUG( plog, "got an s_stop on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    if( ! flush() ) break;
+                    log_stats();
+                    if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream error while stopping";
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    LDEBUG( plog, "got an s_start on slot <" << this->template in_stream< 0 >().get_current_index() << ">" );
+                    reset();
+                    if( ! this->template out_stream< 0 >().set( stream::s_start ) ) throw midge::node_nonfatal_error() << "Stream error while starting";
+                    continue;
+                }
+                if( t_in_cmd == stream::s_run )
+                {
+                    t_data_in = this->template in_stream< 0 >().data();
+                    if( ! handle_packet( *t_data_in ) )
+                    {
+                        LERROR( plog, "Exiting due to stream error" );
+                        break;
+                    }
+                }
+            }
+
+            LINFO( plog, "Packet reorder is exiting" );
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output stream" );
+            if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output stream" );
+            this->template out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    template< class x_data_type >
+    void _packet_reorder< x_data_type >::finalize()
+    {
+        this->template out_buffer< 0 >().finalize();
+        return;
+    }
+
+    template< class x_data_type >
+    bool _packet_reorder< x_data_type >::handle_packet( x_data_type& a_packet )
+    {
+        ++f_packets_in;
+
+        uint64_t t_batch = a_packet.get_pkt_in_batch() % BATCH_COUNTER_SIZE;
+        if( ! f_have_sequence )
+        {
+            f_next_seq = t_batch;
+            f_highest_seq = t_batch;
+            f_have_sequence = true;
+        }
+
+        // distance from the head of the window, across the counter wrap
+        uint64_t t_offset = ( t_batch + BATCH_COUNTER_SIZE - f_next_seq % BATCH_COUNTER_SIZE ) % BATCH_COUNTER_SIZE;
+        if( t_offset > BATCH_COUNTER_SIZE / 2 )
+        {
+            // behind the head of the window: its place in the sequence has been given up or filled
+            ++f_packets_late;
+            return true;
+        }
+
+        if( t_offset >= f_window + f_max_gap )
+        {
+            LINFO( plog, "Sequence jumped from pkt_in_batch " << f_next_seq % BATCH_COUNTER_SIZE << " to " << t_batch << "; restarting the sequence" );
+            if( ! flush() ) return false;
+            f_next_seq = t_batch;
+            f_highest_seq = t_batch;
+            t_offset = 0;
+            ++f_restarts;
+        }
+
+        // make room: give up on the packets that can't fit before this one in the window
+        while( t_offset >= f_window )
+        {
+            if( ! advance() ) return false;
+            --t_offset;
+        }
+
+        uint64_t t_seq = f_next_seq + t_offset;
+        unsigned t_slot = t_seq % f_window;
+        if( f_occupied[ t_slot ] )
+        {
+            ++f_packets_duplicate;
+            return true;
+        }
+
+        if( t_seq < f_highest_seq ) ++f_packets_reordered;
+        else f_highest_seq = t_seq;
+
+        f_slots[ t_slot ].swap_packet( a_packet );
+        f_slots[ t_slot ].set_rx_timestamp_ns( a_packet.get_rx_timestamp_ns() );
+        f_occupied[ t_slot ] = true;
+        ++f_n_occupied;
+
+        // output whatever is now in order
+        while( f_occupied[ f_next_seq % f_window ] )
+        {
+            if( ! advance() ) return false;
+        }
+        return true;
+    }
+
+    template< class x_data_type >
+    bool _packet_reorder< x_data_type >::advance()
+    {
+        unsigned t_slot = f_next_seq % f_window;
+        bool t_ok = true;
+        if( f_occupied[ t_slot ] )
+        {
+            t_ok = output( f_slots[ t_slot ] );
+            f_occupied[ t_slot ] = false;
+            --f_n_occupied;
+        }
+        else
+        {
+            ++f_packets_missing;
+            if( f_fill_gaps && f_have_last_output ) t_ok = output_placeholder();
+        }
+        ++f_next_seq;
+        return t_ok;
+    }
+
+    template< class x_data_type >
+    bool _packet_reorder< x_data_type >::flush()
+    {
+        while( f_n_occupied != 0 )
+        {
+            if( ! advance() ) return false;
+        }
+        return true;
+    }
+
+    template< class x_data_type >
+    bool _packet_reorder< x_data_type >::output( x_data_type& a_packet )
+    {
+        x_data_type* t_data_out = this->template out_stream< 0 >().data();
+        t_data_out->swap_packet( a_packet );
+        t_data_out->set_rx_timestamp_ns( a_packet.get_rx_timestamp_ns() );
+        t_data_out->set_pkt_in_session( f_session_counter++ );
+        t_data_out->set_placeholder( false );
+
+        ::memcpy( &f_last_output.packet(), &t_data_out->packet(), s_header_size );
+        f_have_last_output = true;
+
+        LTRACE( plog, "Packet output: pkt_in_batch = " << t_data_out->get_pkt_in_batch() << "; pkt_in_session = " << t_data_out->get_pkt_in_session() );
+        return this->template out_stream< 0 >().set( stream::s_run );
+    }
+
+    template< class x_data_type >
+    bool _packet_reorder< x_data_type >::output_placeholder()
+    {
+        x_data_type* t_data_out = this->template out_stream< 0 >().data();
+        roach_packet& t_packet = t_data_out->packet();
+        ::memcpy( &t_packet, &f_last_output.packet(), s_header_size );
+        ::memset( t_packet.f_data, 0, PAYLOAD_SIZE );
+        t_packet.f_pkt_in_batch = f_next_seq % BATCH_COUNTER_SIZE;
+        t_data_out->set_rx_timestamp_ns( 0 );
+        t_data_out->set_pkt_in_session( f_session_counter++ );
+        t_data_out->set_placeholder( true );
+        ++f_placeholders;
+
+        LTRACE( plog, "Placeholder output: pkt_in_batch = " << t_data_out->get_pkt_in_batch() << "; pkt_in_session = " << t_data_out->get_pkt_in_session() );
+        return this->template out_stream< 0 >().set( stream::s_run );
+    }
+
+    template< class x_data_type >
+    void _packet_reorder< x_data_type >::reset()
+    {
+        f_occupied.assign( f_window, false );
+        f_n_occupied = 0;
+        f_have_sequence = false;
+        f_next_seq = 0;
+        f_highest_seq = 0;
+        f_session_counter = 0;
+        f_have_last_output = false;
+
+        f_packets_in = 0;
+        f_packets_reordered = 0;
+        f_packets_late = 0;
+        f_packets_duplicate = 0;
+        f_packets_missing = 0;
+        f_placeholders = 0;
+        f_restarts = 0;
+        return;
+    }
+
+    template< class x_data_type >
+    void _packet_reorder< x_data_type >::log_stats() const
+    {
+        LINFO( plog, "Packets handled by <" << this->get_name() << ">:" <<
+                "\n\treceived: " << f_packets_in <<
+                "\n\tput back in order: " << f_packets_reordered <<
+                "\n\tmissing: " << f_packets_missing << " (" << f_placeholders << " replaced by placeholders)" <<
+                "\n\tdropped as late: " << f_packets_late <<
+                "\n\tdropped as duplicates: " << f_packets_duplicate <<
+                "\n\tsequence restarts: " << f_restarts );
+        return;
+    }
+
+
+    //**************************
+    // _packet_reorder_binding
+    //**************************
+
+    template< class x_data_type >
+    _packet_reorder_binding< x_data_type >::_packet_reorder_binding() :
+            sandfly::_node_binding< _packet_reorder< x_data_type >, _packet_reorder_binding< x_data_type > >()
+    {
+    }
+
+    template< class x_data_type >
+    _packet_reorder_binding< x_data_type >::~_packet_reorder_binding()
+    {
+    }
+
+    template< class x_data_type >
+    void _packet_reorder_binding< x_data_type >::do_apply_config( _packet_reorder< x_data_type >* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_reorder with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->set_window( a_config.get_value( "window", a_node->get_window() ) );
+        a_node->set_fill_gaps( a_config.get_value( "fill-gaps", a_node->get_fill_gaps() ) );
+        a_node->set_max_gap( a_config.get_value( "max-gap", a_node->get_max_gap() ) );
+        return;
+    }
+
+    template< class x_data_type >
+    void _packet_reorder_binding< x_data_type >::do_dump_config( const _packet_reorder< x_data_type >* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_reorder" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "window", scarab::param_value( a_node->get_window() ) );
+        a_config.add( "fill-gaps", scarab::param_value( a_node->get_fill_gaps() ) );
+        a_config.add( "max-gap", scarab::param_value( a_node->get_max_gap() ) );
+        return;
+    }
+
+    template class _packet_reorder< time_data >;
+    template class _packet_reorder< freq_data >;
+
+    template class _packet_reorder_binding< time_data >;
+    template class _packet_reorder_binding< freq_data >;
+
+} /* namespace psyllid */
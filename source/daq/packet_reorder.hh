@@ -0,0 +1,147 @@
+/*
+ * packet_reorder.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_REORDER_HH_
+#define PSYLLID_PACKET_REORDER_HH_
+
+#include "freq_data.hh"
+#include "node_builder.hh"
+#include "time_data.hh"
+
+#include "transformer.hh"
+
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+
+    /*!
+     @class _packet_reorder
+     @author N. S. Oblath
+
+     @brief A transformer that puts a stream of time or frequency packets back in order, using pkt_in_batch
+
+     @details
+     Packets that arrive out of order (e.g. from a multi-queue NIC or a fanout group) are held in a window of "window" packets
+     until the packets before them arrive, and are then output in order.  A packet that is missing when the window is full is
+     given up on: it's either skipped, or, with "fill-gaps", replaced by a placeholder packet.  Placeholders have the header
+     of the previous packet, with the missing pkt_in_batch, a payload of zeros, and get_placeholder() true.  With gap filling,
+     downstream nodes see a dense sequence of pkt_in_batch.
+
+     The pkt_in_batch counter wraps at BATCH_COUNTER_SIZE; the order of two packets is taken to be the one that puts them
+     closer together.  Gaps longer than "max-gap" packets (e.g. after the ROACH was restarted) are never filled: the window is
+     flushed and the sequence restarts at the new packet.  Packets that arrive after their place in the sequence was given up,
+     and duplicates, are dropped.
+
+     pkt_in_session is renumbered to count the output packets (placeholders included) since the stream was started, so with
+     gap filling on both the time and frequency streams, it stays matched between them (as the triggered_writer requires)
+     despite packet loss.
+
+     Packets are not copied: the packet memory of the input, the window, and the output is exchanged (roach_packet_data::swap_packet()).
+
+     The window is flushed when the stream is stopped; a stalled stream holds up to "window" - 1 packets until then.
+     The packet counts are logged when the stream stops.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node types: "reorder-time-data", "reorder-freq-data"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "window": uint -- The number of packets that can be held while waiting for late packets (default is 16)
+     - "fill-gaps": bool -- Whether to output placeholder packets for missing packets (default is false)
+     - "max-gap": uint -- The longest gap (in packets) that's filled with placeholders (default is 1024)
+
+     Input Stream:
+     - 0: time_data or freq_data
+
+     Output Streams:
+     - 0: time_data or freq_data
+    */
+    template< class x_data_type >
+    class _packet_reorder : public midge::_transformer< midge::type_list< x_data_type >, midge::type_list< x_data_type > >
+    {
+        public:
+            _packet_reorder();
+            virtual ~_packet_reorder();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_accessible( unsigned, window );
+            mv_accessible( bool, fill_gaps );
+            mv_accessible( unsigned, max_gap );
+
+            /// Packet counts since the stream was last started (the ones logged when it stops)
+            mv_accessible_noset( uint64_t, packets_in );
+            mv_accessible_noset( uint64_t, packets_reordered );
+            mv_accessible_noset( uint64_t, packets_late );
+            mv_accessible_noset( uint64_t, packets_duplicate );
+            mv_accessible_noset( uint64_t, packets_missing );
+            mv_accessible_noset( uint64_t, placeholders );
+            mv_accessible_noset( uint64_t, restarts );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            /// Adds a packet to the window, and outputs what's ready; returns false if there's a stream error
+            bool handle_packet( x_data_type& a_packet );
+
+            /// Outputs (or skips) the packet at the head of the window and advances the window; returns false if there's a stream error
+            bool advance();
+
+            /// Outputs everything in the window, and empties it; gaps between the packets in the window are filled if requested
+            bool flush();
+
+            /// Outputs a packet, swapping its memory with the output slot; a_packet is left holding the output slot's old memory
+            bool output( x_data_type& a_packet );
+
+            bool output_placeholder();
+
+            void reset();
+
+            void log_stats() const;
+
+            std::vector< x_data_type > f_slots;
+            std::vector< bool > f_occupied;
+            unsigned f_n_occupied;
+            bool f_have_sequence;
+            uint64_t f_next_seq;      // unwrapped sequence number of the head of the window (f_next_seq % BATCH_COUNTER_SIZE is its pkt_in_batch)
+            uint64_t f_highest_seq;   // unwrapped sequence number of the latest packet received
+            uint64_t f_session_counter;
+            x_data_type f_last_output; // header template for placeholders
+            bool f_have_last_output;
+    };
+
+    typedef _packet_reorder< time_data > time_data_reorder;
+    typedef _packet_reorder< freq_data > freq_data_reorder;
+
+    template< class x_data_type >
+    class _packet_reorder_binding : public sandfly::_node_binding< _packet_reorder< x_data_type >, _packet_reorder_binding< x_data_type > >
+    {
+        public:
+            _packet_reorder_binding();
+            virtual ~_packet_reorder_binding();
+
+        private:
+            virtual void do_apply_config( _packet_reorder< x_data_type >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _packet_reorder< x_data_type >* a_node, scarab::param_node& a_config ) const;
+    };
+
+    typedef _packet_reorder_binding< time_data > time_data_reorder_binding;
+    typedef _packet_reorder_binding< freq_data > freq_data_reorder_binding;
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_REORDER_HH_ */
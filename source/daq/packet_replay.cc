@@ -0,0 +1,393 @@
+/*
+ * packet_replay.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_replay.hh"
+
+#include "packet_capture.hh"
+#include "psyllid_error.hh"
+#include "rx_timestamp.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( packet_replay, "packet-replay", packet_replay_binding );
+
+    LOGGER( plog, "packet_replay" );
+
+    packet_replay::packet_replay() :
+            f_length( 10 ),
+            f_filename(),
+            f_timing( "original" ),
+            f_repeat( 1 ),
+            f_start_paused( true ),
+            f_paused( true ),
+            f_original_timing( true ),
+            f_passes_done( 0 ),
+            f_fd( -1 ),
+            f_file_data( nullptr ),
+            f_file_size( 0 ),
+            f_swapped( false ),
+            f_nsec( false ),
+            f_linktype( 0 ),
+            f_packets_replayed( 0 ),
+            f_bytes_replayed( 0 ),
+            f_records_skipped( 0 )
+    {
+    }
+
+    packet_replay::~packet_replay()
+    {
+        cleanup_file();
+    }
+
+    void packet_replay::initialize()
+    {
+        out_buffer< 0 >().initialize( f_length );
+
+        if( f_timing == "original" ) f_original_timing = true;
+        else if( f_timing == "fast" ) f_original_timing = false;
+        else
+        {
+            throw error() << "[packet_replay] Unknown timing <" << f_timing << ">; options are \"original\" and \"fast\"";
+        }
+
+        f_fd = ::open( f_filename.c_str(), O_RDONLY );
+        if( f_fd < 0 )
+        {
+            f_fd = -1;
+            throw error() << "[packet_replay] Unable to open pcap file <" << f_filename << ">:\n\t" << strerror( errno );
+        }
+
+        struct stat t_stat;
+        if( ::fstat( f_fd, &t_stat ) < 0 )
+        {
+            throw error() << "[packet_replay] Unable to get the size of <" << f_filename << ">:\n\t" << strerror( errno );
+        }
+        f_file_size = t_stat.st_size;
+        if( f_file_size < sizeof(pcap_file_header) )
+        {
+            throw error() << "[packet_replay] <" << f_filename << "> is too small to be a pcap file";
+        }
+
+        void* t_map = ::mmap( nullptr, f_file_size, PROT_READ, MAP_PRIVATE, f_fd, 0 );
+        if( t_map == MAP_FAILED )
+        {
+            throw error() << "[packet_replay] Unable to map <" << f_filename << ">:\n\t" << strerror( errno );
+        }
+        f_file_data = static_cast< uint8_t* >( t_map );
+        ::madvise( f_file_data, f_file_size, MADV_SEQUENTIAL );
+
+        pcap_file_header t_header;
+        ::memcpy( &t_header, f_file_data, sizeof(pcap_file_header) );
+        if( t_header.f_magic == s_pcap_magic_usec || t_header.f_magic == s_pcap_magic_nsec ) f_swapped = false;
+        else if( __builtin_bswap32( t_header.f_magic ) == s_pcap_magic_usec || __builtin_bswap32( t_header.f_magic ) == s_pcap_magic_nsec ) f_swapped = true;
+        else
+        {
+            throw error() << "[packet_replay] <" << f_filename << "> is not a pcap file (pcapng is not supported)";
+        }
+        f_nsec = ( f_swapped ? __builtin_bswap32( t_header.f_magic ) : t_header.f_magic ) == s_pcap_magic_nsec;
+        f_linktype = f_swapped ? __builtin_bswap32( t_header.f_linktype ) : t_header.f_linktype;
+        if( f_linktype != s_pcap_linktype_ethernet && f_linktype != s_pcap_linktype_raw && f_linktype != s_pcap_linktype_ipv4 )
+        {
+            throw error() << "[packet_replay] Link type " << f_linktype << " of <" << f_filename << "> is not supported; the options are Ethernet, raw IP, and IPv4";
+        }
+
+        f_paused = f_start_paused;
+        f_passes_done = 0;
+        f_packets_replayed = 0;
+        f_bytes_replayed = 0;
+        f_records_skipped = 0;
+
+        LINFO( plog, "Ready to replay <" << f_filename << "> (" << f_file_size << " bytes) with " << f_timing << " timing" );
+        return;
+    }
+
+    void packet_replay::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet_replay" );
+
+            if( ! f_paused )
+            {
+                if( ! out_stream< 0 >().set( stream::s_start ) ) return;
+            }
+
+            LINFO( plog, "Starting main loop" );
+            while( ! is_canceled() )
+            {
+                if( out_stream< 0 >().get() == stream::s_stop )
+                {
+                    LWARN( plog, "Output stream(s) have stop condition" );
+                    break;
+                }
+
+                if( check_instructions() )
+                {
+                    std::this_thread::sleep_for( std::chrono::milliseconds( 100 ) );
+                    continue;
+                }
+
+                if( f_repeat != 0 && f_passes_done >= f_repeat )
+                {
+                    LINFO( plog, "Finished replaying <" << f_filename << "> " << f_passes_done << " time(s)" );
+                    std::shared_ptr< sandfly::run_control > t_run_control = use_run_control();
+                    if( ! t_run_control ) break;
+
+                    if( ! out_stream< 0 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream 0 error while stopping";
+                    f_paused = true;
+                    t_run_control->stop_run();
+                    continue;
+                }
+
+                if( ! replay_pass() )
+                {
+                    LERROR( plog, "Exiting due to stream error" );
+                    break;
+                }
+                // a pass that's interrupted by a pause or cancelation doesn't count
+                if( ! f_paused && ! is_canceled() ) ++f_passes_done;
+            }
+
+            LINFO( plog, "Packet replay is exiting" );
+            LINFO( plog, "Replayed " << f_packets_replayed << " packets (" << f_bytes_replayed << " bytes); skipped " << f_records_skipped << " records that weren't IPv4 UDP packets" );
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output stream" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output stream" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void packet_replay::finalize()
+    {
+        out_buffer< 0 >().finalize();
+        cleanup_file();
+        return;
+    }
+
+    bool packet_replay::replay_pass()
+    {
+        LDEBUG( plog, "Starting pass " << f_passes_done + 1 << " through <" << f_filename << ">" );
+
+        size_t t_offset = sizeof(pcap_file_header);
+        bool t_first = true;
+        uint64_t t_first_time_ns = 0;
+        std::chrono::steady_clock::time_point t_pass_start;
+
+        pcap_record_header t_rec_header;
+        const uint8_t* t_payload = nullptr;
+        size_t t_payload_len = 0;
+        uint32_t t_source_address = 0;
+        uint16_t t_dest_port = 0;
+
+        while( t_offset + sizeof(pcap_record_header) <= f_file_size && ! is_canceled() )
+        {
+            if( check_instructions() ) return true;
+
+            ::memcpy( &t_rec_header, f_file_data + t_offset, sizeof(pcap_record_header) );
+            if( f_swapped )
+            {
+                t_rec_header.f_ts_sec = __builtin_bswap32( t_rec_header.f_ts_sec );
+                t_rec_header.f_ts_frac = __builtin_bswap32( t_rec_header.f_ts_frac );
+                t_rec_header.f_incl_len = __builtin_bswap32( t_rec_header.f_incl_len );
+            }
+            t_offset += sizeof(pcap_record_header);
+            if( t_offset + t_rec_header.f_incl_len > f_file_size )
+            {
+                LWARN( plog, "The last record in <" << f_filename << "> is truncated" );
+                break;
+            }
+            const uint8_t* t_record = f_file_data + t_offset;
+            t_offset += t_rec_header.f_incl_len;
+
+            if( ! find_payload( t_record, t_rec_header.f_incl_len, t_payload, t_payload_len, t_source_address, t_dest_port ) )
+            {
+                ++f_records_skipped;
+                continue;
+            }
+
+            if( f_original_timing )
+            {
+                uint64_t t_time_ns = uint64_t(t_rec_header.f_ts_sec) * 1000000000 + uint64_t(t_rec_header.f_ts_frac) * ( f_nsec ? 1 : 1000 );
+                if( t_first )
+                {
+                    t_first_time_ns = t_time_ns;
+                    t_pass_start = std::chrono::steady_clock::now();
+                    t_first = false;
+                }
+                // out-of-order timestamps are output right away
+                if( t_time_ns > t_first_time_ns )
+                {
+                    wait_until( t_pass_start + std::chrono::nanoseconds( t_time_ns - t_first_time_ns ) );
+                }
+            }
+
+            memory_block* t_block = out_stream< 0 >().data();
+            if( t_block->is_view() || t_block->get_n_bytes() < t_payload_len ) t_block->resize( t_payload_len );
+            ::memcpy( t_block->block(), t_payload, t_payload_len );
+            t_block->set_n_bytes_used( t_payload_len );
+            t_block->set_source_address( t_source_address );
+            t_block->set_dest_port( t_dest_port );
+            t_block->set_rx_timestamp_ns( rx_clock_now_ns() );
+
+            ++f_packets_replayed;
+            f_bytes_replayed += t_payload_len;
+
+            LTRACE( plog, "Packet (" << t_payload_len << " bytes) written to stream index <" << out_stream< 0 >().get_current_index() << ">" );
+
+            if( ! out_stream< 0 >().set( stream::s_run ) ) return false;
+        }
+        return true;
+    }
+
+    bool packet_replay::find_payload( const uint8_t* a_record, size_t a_record_len, const uint8_t*& a_payload, size_t& a_payload_len, uint32_t& a_source_address, uint16_t& a_dest_port ) const
+    {
+        const uint8_t* t_ip = a_record;
+        size_t t_len = a_record_len;
+
+        if( f_linktype == s_pcap_linktype_ethernet )
+        {
+            if( t_len < 14 ) return false;
+            size_t t_header_len = 14;
+            uint16_t t_ethertype = ( a_record[ 12 ] << 8 ) | a_record[ 13 ];
+            // VLAN tags
+            while( t_ethertype == 0x8100 || t_ethertype == 0x88a8 )
+            {
+                if( t_len < t_header_len + 4 ) return false;
+                t_ethertype = ( a_record[ t_header_len + 2 ] << 8 ) | a_record[ t_header_len + 3 ];
+                t_header_len += 4;
+            }
+            if( t_ethertype != 0x0800 ) return false;
+            t_ip += t_header_len;
+            t_len -= t_header_len;
+        }
+
+        if( t_len < 20 || ( t_ip[ 0 ] >> 4 ) != 4 ) return false;
+        size_t t_ip_header_len = ( t_ip[ 0 ] & 0x0f ) * 4;
+        if( t_ip_header_len < 20 || t_len < t_ip_header_len + 8 || t_ip[ 9 ] != 17 ) return false;
+        // fragments (more-fragments flag or non-zero offset) can't be replayed without reassembly
+        if( ( ( t_ip[ 6 ] << 8 ) | t_ip[ 7 ] ) & 0x3fff ) return false;
+
+        ::memcpy( &a_source_address, t_ip + 12, sizeof(uint32_t) );
+
+        const uint8_t* t_udp = t_ip + t_ip_header_len;
+        a_dest_port = ( t_udp[ 2 ] << 8 ) | t_udp[ 3 ];
+        size_t t_udp_len = ( t_udp[ 4 ] << 8 ) | t_udp[ 5 ];
+        if( t_udp_len < 8 ) return false;
+        // the capture may have been truncated (snap length)
+        t_udp_len = std::min( t_udp_len, t_len - t_ip_header_len );
+
+        a_payload = t_udp + 8;
+        a_payload_len = t_udp_len - 8;
+        return true;
+    }
+
+    void packet_replay::wait_until( std::chrono::steady_clock::time_point a_time )
+    {
+        // sleeping isn't precise enough for packets microseconds apart, so only long waits sleep, and the rest is spent spinning
+        static const std::chrono::microseconds s_spin_time( 200 );
+        std::chrono::steady_clock::time_point t_now = std::chrono::steady_clock::now();
+        while( t_now < a_time && ! is_canceled() )
+        {
+            if( a_time - t_now > s_spin_time ) std::this_thread::sleep_for( a_time - t_now - s_spin_time / 2 );
+            t_now = std::chrono::steady_clock::now();
+        }
+        return;
+    }
+
+    bool packet_replay::check_instructions()
+    {
+        if( have_instruction() )
+        {
+            if( f_paused && use_instruction() == midge::instruction::resume )
+            {
+                LDEBUG( plog, "Packet replay resuming" );
+                if( ! out_stream< 0 >().set( stream::s_start ) ) throw midge::node_nonfatal_error() << "Stream 0 error while starting";
+                f_paused = false;
+                f_passes_done = 0;
+            }
+            else if( ! f_paused && use_instruction() == midge::instruction::pause )
+            {
+                LDEBUG( plog, "Packet replay pausing" );
+                if( ! out_stream< 0 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream 0 error while stopping";
+                f_paused = true;
+            }
+        }
+        return f_paused;
+    }
+
+    void packet_replay::cleanup_file()
+    {
+        if( f_file_data != nullptr )
+        {
+            ::munmap( f_file_data, f_file_size );
+            f_file_data = nullptr;
+        }
+        if( f_fd >= 0 )
+        {
+            ::close( f_fd );
+            f_fd = -1;
+        }
+        return;
+    }
+
+
+    packet_replay_binding::packet_replay_binding() :
+            sandfly::_node_binding< packet_replay, packet_replay_binding >()
+    {
+    }
+
+    packet_replay_binding::~packet_replay_binding()
+    {
+    }
+
+    void packet_replay_binding::do_apply_config( packet_replay* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_replay with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->filename() = a_config.get_value( "filename", a_node->filename() );
+        a_node->timing() = a_config.get_value( "timing", a_node->timing() );
+        a_node->set_repeat( a_config.get_value( "repeat", a_node->get_repeat() ) );
+        a_node->set_start_paused( a_config.get_value( "start-paused", a_node->get_start_paused() ) );
+        return;
+    }
+
+    void packet_replay_binding::do_dump_config( const packet_replay* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_replay" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "filename", scarab::param_value( a_node->filename() ) );
+        a_config.add( "timing", scarab::param_value( a_node->timing() ) );
+        a_config.add( "repeat", scarab::param_value( a_node->get_repeat() ) );
+        a_config.add( "start-paused", scarab::param_value( a_node->get_start_paused() ) );
+        return;
+    }
+
+} /* namespace psyllid */
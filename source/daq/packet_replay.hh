@@ -0,0 +1,129 @@
+/*
+ * packet_replay.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_REPLAY_HH_
+#define PSYLLID_PACKET_REPLAY_HH_
+
+#include "memory_block.hh"
+#include "node_builder.hh"
+
+#include "control_access.hh"
+#include "producer.hh"
+
+#include <chrono>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+
+    /*!
+     @class packet_replay
+     @author N. S. Oblath
+
+     @brief A producer that replays the UDP packets in a pcap file as raw blocks of memory
+
+     @details
+     This is the playback side of packet_capture: it stands in for a packet receiver, so that a recorded stream can be
+     fed through tf_roach_receiver and the rest of a chain (e.g. frequency-mask trigger, event builder, and writer)
+     on any machine, with no ROACH or network involved.  The UDP payloads are output exactly as they were recorded.
+
+     Files written by packet_capture can be replayed, as can captures made with tcpdump or Wireshark (pcap format, not pcapng)
+     with link types Ethernet, raw IP, or IPv4.  Records that aren't unfragmented IPv4 UDP packets are skipped.
+
+     The file is memory-mapped, and each packet is copied into the output memory_block, so the file contents are never modified
+     and can be replayed repeatedly.  The output memory_blocks' receive timestamps are set to the time the packet is output,
+     so the age of the data downstream measures the latency of the chain.
+
+     Timing:
+     - "original": packets are output with the inter-arrival times recorded in the file
+     - "fast": packets are output as fast as the downstream nodes accept them
+
+     Like egg3_reader, the node waits for the resume instruction (i.e. the start of a run) before it outputs anything, unless
+     "start-paused" is false.  After the last pass through the file, the run is stopped.  In psyllid, therefore, each run replays
+     the file "repeat" times.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node type: "packet-replay"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "filename": string -- Path of the pcap file to replay
+     - "timing": string -- "original" (default) or "fast"
+     - "repeat": uint -- Number of passes through the file; 0 repeats until the run is stopped (default is 1)
+     - "start-paused": bool -- Whether to wait for the resume instruction before replaying (default is true)
+
+     Output Streams:
+     - 0: memory_block
+    */
+    class packet_replay : public midge::_producer< midge::type_list< memory_block > >, public sandfly::control_access
+    {
+        public:
+            packet_replay();
+            virtual ~packet_replay();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_referrable( std::string, filename );
+            mv_referrable( std::string, timing );
+            mv_accessible( unsigned, repeat );
+            mv_accessible( bool, start_paused );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            /// Outputs one pass through the file, which ends early if the node is paused or canceled; returns false if there's a stream error
+            bool replay_pass();
+
+            /// Finds the UDP payload in a record; returns false if the record isn't an unfragmented IPv4 UDP packet
+            bool find_payload( const uint8_t* a_record, size_t a_record_len, const uint8_t*& a_payload, size_t& a_payload_len, uint32_t& a_source_address, uint16_t& a_dest_port ) const;
+
+            void wait_until( std::chrono::steady_clock::time_point a_time );
+
+            /// Handles pause/resume instructions; returns true if paused
+            bool check_instructions();
+
+            void cleanup_file();
+
+            bool f_paused;
+            bool f_original_timing;
+            unsigned f_passes_done;
+
+            int f_fd;
+            uint8_t* f_file_data;
+            size_t f_file_size;
+            bool f_swapped;   // file was written on a machine with the other byte order
+            bool f_nsec;      // timestamps have ns (rather than us) resolution
+            uint32_t f_linktype;
+
+            uint64_t f_packets_replayed;
+            uint64_t f_bytes_replayed;
+            uint64_t f_records_skipped;
+    };
+
+
+    class packet_replay_binding : public sandfly::_node_binding< packet_replay, packet_replay_binding >
+    {
+        public:
+            packet_replay_binding();
+            virtual ~packet_replay_binding();
+
+        private:
+            virtual void do_apply_config( packet_replay* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const packet_replay* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_REPLAY_HH_ */
@@ -0,0 +1,154 @@
+/*
+ * packet_unbatch.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_unbatch.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( time_data_unbatch, "unbatch-time-data", time_data_unbatch_binding );
+    REGISTER_NODE_AND_BUILDER( freq_data_unbatch, "unbatch-freq-data", freq_data_unbatch_binding );
+
+    LOGGER( plog, "packet_unbatch" );
+
+
+    //********************
+    // _packet_unbatch
+    //********************
+
+    template< class x_data_type >
+    _packet_unbatch< x_data_type >::_packet_unbatch() :
+            f_length( 10 )
+    {
+    }
+
+    template< class x_data_type >
+    _packet_unbatch< x_data_type >::~_packet_unbatch()
+    {
+    }
+
+    template< class x_data_type >
+    void _packet_unbatch< x_data_type >::initialize()
+    {
+        this->template out_buffer< 0 >().initialize( f_length );
+        return;
+    }
+
+    template< class x_data_type >
+    void _packet_unbatch< x_data_type >::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the packet unbatcher" );
+
+            _packet_batch< x_data_type >* t_batch = nullptr;
+            bool t_stream_ok = true;
+
+            while( ! this->is_canceled() && t_stream_ok )
+            {
+                midge::enum_t t_in_cmd = this->template in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error ) break;
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "Packet unbatcher is exiting" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    LDEBUG( plog, "Packet unbatcher is stopping" );
+                    if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    LDEBUG( plog, "Packet unbatcher is starting" );
+                    if( ! this->template out_stream< 0 >().set( stream::s_start ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_run )
+                {
+                    t_batch = this->template in_stream< 0 >().data();
+                    for_each_packet( *t_batch, [this, &t_stream_ok]( x_data_type& a_packet )
+                    {
+                        if( ! t_stream_ok ) return;
+                        x_data_type* t_data_out = this->template out_stream< 0 >().data();
+                        t_data_out->swap_packet( a_packet );
+                        t_data_out->set_pkt_in_session( a_packet.get_pkt_in_session() );
+                        t_data_out->set_rx_timestamp_ns( a_packet.get_rx_timestamp_ns() );
+                        t_data_out->set_placeholder( a_packet.get_placeholder() );
+                        t_stream_ok = this->template out_stream< 0 >().set( stream::s_run );
+                    } );
+                    if( ! t_stream_ok ) LERROR( plog, "Exiting due to stream error" );
+                }
+            }
+
+            LDEBUG( plog, "Stopping output stream" );
+            if( ! this->template out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output stream" );
+            this->template out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    template< class x_data_type >
+    void _packet_unbatch< x_data_type >::finalize()
+    {
+        this->template out_buffer< 0 >().finalize();
+        return;
+    }
+
+
+    //**************************
+    // _packet_unbatch_binding
+    //**************************
+
+    template< class x_data_type >
+    _packet_unbatch_binding< x_data_type >::_packet_unbatch_binding() :
+            sandfly::_node_binding< _packet_unbatch< x_data_type >, _packet_unbatch_binding< x_data_type > >()
+    {
+    }
+
+    template< class x_data_type >
+    _packet_unbatch_binding< x_data_type >::~_packet_unbatch_binding()
+    {
+    }
+
+    template< class x_data_type >
+    void _packet_unbatch_binding< x_data_type >::do_apply_config( _packet_unbatch< x_data_type >* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring packet_unbatch with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        return;
+    }
+
+    template< class x_data_type >
+    void _packet_unbatch_binding< x_data_type >::do_dump_config( const _packet_unbatch< x_data_type >* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for packet_unbatch" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        return;
+    }
+
+    template class _packet_unbatch< time_data >;
+    template class _packet_unbatch< freq_data >;
+
+    template class _packet_unbatch_binding< time_data >;
+    template class _packet_unbatch_binding< freq_data >;
+
+} /* namespace psyllid */
@@ -0,0 +1,168 @@
+/*
+ * packet_unbatch.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_UNBATCH_HH_
+#define PSYLLID_PACKET_UNBATCH_HH_
+
+#include "node_builder.hh"
+#include "packet_batch.hh"
+
+#include "transformer.hh"
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+
+    /*!
+     @class _packet_unbatch
+     @author N. S. Oblath
+
+     @brief A transformer that outputs the packets of each batch one at a time
+
+     @details
+     This lets batched streams (e.g. from tf_roach_batch_receiver) feed nodes that only take single packets.  The frequency mask trigger,
+     event builder, and triggered writer have batched versions of their own, so they don't need it.  The packets are not copied: their
+     memory is exchanged with the output slots.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node types: "unbatch-time-data", "unbatch-freq-data"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+
+     Input Stream:
+     - 0: time_data_batch or freq_data_batch
+
+     Output Streams:
+     - 0: time_data or freq_data
+    */
+    template< class x_data_type >
+    class _packet_unbatch : public midge::_transformer< midge::type_list< _packet_batch< x_data_type > >, midge::type_list< x_data_type > >
+    {
+        public:
+            _packet_unbatch();
+            virtual ~_packet_unbatch();
+
+        public:
+            mv_accessible( uint64_t, length );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+    };
+
+    typedef _packet_unbatch< time_data > time_data_unbatch;
+    typedef _packet_unbatch< freq_data > freq_data_unbatch;
+
+    template< class x_data_type >
+    class _packet_unbatch_binding : public sandfly::_node_binding< _packet_unbatch< x_data_type >, _packet_unbatch_binding< x_data_type > >
+    {
+        public:
+            _packet_unbatch_binding();
+            virtual ~_packet_unbatch_binding();
+
+        private:
+            virtual void do_apply_config( _packet_unbatch< x_data_type >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _packet_unbatch< x_data_type >* a_node, scarab::param_node& a_config ) const;
+    };
+
+    typedef _packet_unbatch_binding< time_data > time_data_unbatch_binding;
+    typedef _packet_unbatch_binding< freq_data > freq_data_unbatch_binding;
+
+
+    /*!
+     @class _packet_reader
+     @author N. S. Oblath
+
+     @brief Reads an input stream one packet at a time, whether its slots hold single packets or batches
+
+     @details
+     For use inside a node that has to step through two streams in lockstep packet by packet (e.g. the triggered writer, whose
+     time and trigger streams are batched independently).  next() returns s_run for each packet, and moves to the next slot of the
+     stream only once every packet in the current slot has been read; any other command from the stream is returned as it is.
+     With single-packet slots, next() is the same as calling get() on the stream.
+
+     The packet from packet() is valid until the next call to next().
+    */
+    template< class x_slot_type >
+    class _packet_reader
+    {
+        public:
+            typedef typename _slot_traits< x_slot_type >::packet_type packet_type;
+
+            _packet_reader() :
+                    f_slot( nullptr ),
+                    f_n_read( 0 )
+            {}
+
+        public:
+            /// Moves to the next packet, reading the next slot of a_stream if the current one has been used up
+            template< class x_stream >
+            midge::enum_t next( x_stream& a_stream );
+
+            packet_type& packet();
+
+            /// Forgets any packets left in the current slot
+            void clear();
+
+        private:
+            x_slot_type* f_slot;
+            unsigned f_n_read;
+    };
+
+    template< class x_slot_type >
+    template< class x_stream >
+    midge::enum_t _packet_reader< x_slot_type >::next( x_stream& a_stream )
+    {
+        if( f_slot != nullptr && f_n_read < _slot_traits< x_slot_type >::n_packets( *f_slot ) )
+        {
+            ++f_n_read;
+            return midge::stream::s_run;
+        }
+
+        midge::enum_t t_command = a_stream.get();
+        // skip over empty batches
+        while( t_command == midge::stream::s_run && _slot_traits< x_slot_type >::n_packets( *a_stream.data() ) == 0 )
+        {
+            t_command = a_stream.get();
+        }
+
+        if( t_command == midge::stream::s_run )
+        {
+            f_slot = a_stream.data();
+            f_n_read = 1;
+        }
+        else
+        {
+            clear();
+        }
+        return t_command;
+    }
+
+    template< class x_slot_type >
+    inline typename _packet_reader< x_slot_type >::packet_type& _packet_reader< x_slot_type >::packet()
+    {
+        return _slot_traits< x_slot_type >::packet( *f_slot, f_n_read - 1 );
+    }
+
+    template< class x_slot_type >
+    inline void _packet_reader< x_slot_type >::clear()
+    {
+        f_slot = nullptr;
+        f_n_read = 0;
+        return;
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_UNBATCH_HH_ */
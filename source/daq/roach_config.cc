@@ -25,6 +25,22 @@ namespace psyllid
         connection( "tfrr.out_1:term.in_0" );
     }
 
+    REGISTER_PRESET( streaming_1ch_batch, "str-1ch-batch" );
+
+    streaming_1ch_batch::streaming_1ch_batch( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        // packets are passed from the TF ROACH receiver to the writer in batches
+        node( "packet-receiver-socket", "prs" );
+        node( "tf-roach-batch-receiver", "tfrr" );
+        node( "streaming-batch-writer", "strw" );
+        node( "term-freq-batch", "term" );
+
+        connection( "prs.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:strw.in_0" );
+        connection( "tfrr.out_1:term.in_0" );
+    }
+
 #ifdef __linux__
     REGISTER_PRESET( streaming_1ch_fpa, "str-1ch-fpa" );
 
@@ -42,6 +58,79 @@ namespace psyllid
     }
 #endif
 
+#ifdef BUILD_XDP
+    REGISTER_PRESET( streaming_1ch_xdp, "str-1ch-xdp" );
+
+    streaming_1ch_xdp::streaming_1ch_xdp( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        node( "packet-receiver-xdp", "prx" );
+        node( "tf-roach-receiver", "tfrr" );
+        node( "streaming-writer", "strw" );
+        node( "term-freq-data", "term" );
+
+        connection( "prx.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:strw.in_0" );
+        connection( "tfrr.out_1:term.in_0" );
+    }
+#endif
+
+#ifdef __linux__
+    REGISTER_PRESET( streaming_3ch_fpa, "str-3ch-fpa" );
+
+    streaming_3ch_fpa::streaming_3ch_fpa( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        // one ring for all three channels; packets are routed to the channels by the demux
+        node( "packet-receiver-fpa", "prf" );
+        node( "packet-demux-3", "demux" );
+        node( "tf-roach-receiver", "tfrr0" );
+        node( "tf-roach-receiver", "tfrr1" );
+        node( "tf-roach-receiver", "tfrr2" );
+        node( "streaming-writer", "strw0" );
+        node( "streaming-writer", "strw1" );
+        node( "streaming-writer", "strw2" );
+        node( "term-freq-data", "term0" );
+        node( "term-freq-data", "term1" );
+        node( "term-freq-data", "term2" );
+
+        connection( "prf.out_0:demux.in_0" );
+        connection( "demux.out_0:tfrr0.in_0" );
+        connection( "demux.out_1:tfrr1.in_0" );
+        connection( "demux.out_2:tfrr2.in_0" );
+        connection( "tfrr0.out_0:strw0.in_0" );
+        connection( "tfrr1.out_0:strw1.in_0" );
+        connection( "tfrr2.out_0:strw2.in_0" );
+        connection( "tfrr0.out_1:term0.in_0" );
+        connection( "tfrr1.out_1:term1.in_0" );
+        connection( "tfrr2.out_1:term2.in_0" );
+    }
+
+    REGISTER_PRESET( streaming_3ch_fpa_multi, "str-3ch-fpa-multi" );
+
+    streaming_3ch_fpa_multi::streaming_3ch_fpa_multi( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        // one ring and one TF ROACH receiver for all three channels
+        node( "packet-receiver-fpa", "prf" );
+        node( "tf-roach-receiver-3", "tfrr" );
+        node( "streaming-writer", "strw0" );
+        node( "streaming-writer", "strw1" );
+        node( "streaming-writer", "strw2" );
+        node( "term-freq-data", "term0" );
+        node( "term-freq-data", "term1" );
+        node( "term-freq-data", "term2" );
+
+        connection( "prf.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:strw0.in_0" );
+        connection( "tfrr.out_1:term0.in_0" );
+        connection( "tfrr.out_2:strw1.in_0" );
+        connection( "tfrr.out_3:term1.in_0" );
+        connection( "tfrr.out_4:strw2.in_0" );
+        connection( "tfrr.out_5:term2.in_0" );
+    }
+#endif
+
     REGISTER_PRESET( fmask_trigger_1ch,"fmask-1ch");
 
     fmask_trigger_1ch::fmask_trigger_1ch( const std::string& a_name ) :
@@ -62,6 +151,25 @@ namespace psyllid
         connection( "fmt.out_0:trw.in_1" );
     }
 
+    REGISTER_PRESET( fmask_trigger_1ch_paired,"fmask-1ch-paired");
+
+    fmask_trigger_1ch_paired::fmask_trigger_1ch_paired( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        // time and frequency packets are paired before the trigger, so every trigger flag refers to the time packet it was made from
+        node( "packet-receiver-socket", "prs" );
+        node( "tf-roach-pair-receiver", "tfprr");
+        node( "split-tf-pair", "split");
+        node( "frequency-mask-trigger", "fmt");
+        node( "triggered-writer", "trw");
+
+        connection( "prs.out_0:tfprr.in_0" );
+        connection( "tfprr.out_0:split.in_0" );
+        connection( "split.out_0:trw.in_0" );
+        connection( "split.out_1:fmt.in_0" );
+        connection( "fmt.out_0:trw.in_1" );
+    }
+
 #ifdef __linux__
     REGISTER_PRESET( fmask_trigger_1ch_fpa,"fmask-1ch-fpa");
     fmask_trigger_1ch_fpa::fmask_trigger_1ch_fpa( const std::string& a_name ) :
@@ -79,6 +187,23 @@ namespace psyllid
     }
 #endif
 
+#ifdef BUILD_XDP
+    REGISTER_PRESET( fmask_trigger_1ch_xdp,"fmask-1ch-xdp");
+    fmask_trigger_1ch_xdp::fmask_trigger_1ch_xdp( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        node( "packet-receiver-xdp", "prx" );
+        node( "tf-roach-receiver", "tfrr");
+        node( "frequency-mask-trigger", "fmt");
+        node( "triggered-writer", "trw");
+
+        connection( "prx.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:trw.in_0" );
+        connection( "tfrr.out_1:fmt.in_0" );
+        connection( "fmt.out_0:trw.in_1" );
+    }
+#endif
+
     REGISTER_PRESET( event_builder_1ch,"events-1ch");
     event_builder_1ch::event_builder_1ch( const std::string& a_name ) :
             stream_preset( a_name )
@@ -96,6 +221,40 @@ namespace psyllid
         connection( "eb.out_0:trw.in_1" );
     }
 
+    REGISTER_PRESET( event_builder_1ch_batch,"events-1ch-batch");
+    event_builder_1ch_batch::event_builder_1ch_batch( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        node( "packet-receiver-socket", "prs" );
+        node( "tf-roach-batch-receiver", "tfrr");
+        node( "frequency-mask-batch-trigger", "fmt");
+        node( "event-batch-builder", "eb");
+        node( "triggered-batch-writer", "trw");
+
+        connection( "prs.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:trw.in_0" );
+        connection( "tfrr.out_1:fmt.in_0" );
+        connection( "fmt.out_0:eb.in_0");
+        connection( "eb.out_0:trw.in_1" );
+    }
+
+    REGISTER_PRESET( event_builder_1ch_replay,"events-1ch-replay");
+    event_builder_1ch_replay::event_builder_1ch_replay( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        node( "packet-replay", "prp" );
+        node( "tf-roach-receiver", "tfrr");
+        node( "frequency-mask-trigger", "fmt");
+        node( "event-builder", "eb");
+        node( "triggered-writer", "trw");
+
+        connection( "prp.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:trw.in_0" );
+        connection( "tfrr.out_1:fmt.in_0" );
+        connection( "fmt.out_0:eb.in_0");
+        connection( "eb.out_0:trw.in_1" );
+    }
+
 #ifdef __linux__
     REGISTER_PRESET( event_builder_1ch_fpa,"events-1ch-fpa");
     event_builder_1ch_fpa::event_builder_1ch_fpa( const std::string& a_name ) :
@@ -115,6 +274,25 @@ namespace psyllid
     }
 #endif
 
+#ifdef BUILD_XDP
+    REGISTER_PRESET( event_builder_1ch_xdp,"events-1ch-xdp");
+    event_builder_1ch_xdp::event_builder_1ch_xdp( const std::string& a_name ) :
+            stream_preset( a_name )
+    {
+        node( "packet-receiver-xdp", "prx" );
+        node( "tf-roach-receiver", "tfrr");
+        node( "frequency-mask-trigger", "fmt");
+        node( "event-builder", "eb");
+        node( "triggered-writer", "trw");
+
+        connection( "prx.out_0:tfrr.in_0" );
+        connection( "tfrr.out_0:trw.in_0" );
+        connection( "tfrr.out_1:fmt.in_0" );
+        connection( "fmt.out_0:eb.in_0");
+        connection( "eb.out_0:trw.in_1" );
+    }
+#endif
+
 
 } /* namespace psyllid */
 
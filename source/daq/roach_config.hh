@@ -14,19 +14,36 @@ namespace psyllid
 {
 
     DECLARE_PRESET( streaming_1ch );
+    DECLARE_PRESET( streaming_1ch_batch );
 #ifdef __linux__
     DECLARE_PRESET( streaming_1ch_fpa );
 #endif
+#ifdef BUILD_XDP
+    DECLARE_PRESET( streaming_1ch_xdp );
+#endif
+#ifdef __linux__
+    DECLARE_PRESET( streaming_3ch_fpa );
+    DECLARE_PRESET( streaming_3ch_fpa_multi );
+#endif
 
     DECLARE_PRESET( fmask_trigger_1ch );
+    DECLARE_PRESET( fmask_trigger_1ch_paired );
 #ifdef __linux__
     DECLARE_PRESET( fmask_trigger_1ch_fpa );
 #endif
+#ifdef BUILD_XDP
+    DECLARE_PRESET( fmask_trigger_1ch_xdp );
+#endif
 
     DECLARE_PRESET( event_builder_1ch );
+    DECLARE_PRESET( event_builder_1ch_batch );
+    DECLARE_PRESET( event_builder_1ch_replay );
 #ifdef __linux__
     DECLARE_PRESET( event_builder_1ch_fpa );
 #endif
+#ifdef BUILD_XDP
+    DECLARE_PRESET( event_builder_1ch_xdp );
+#endif
 } /* namespace psyllid */
 
 #endif /* PSYLLID_ROACH_CONFIG_HH_ */
@@ -0,0 +1,145 @@
+/*
+ * spectrum_accumulator.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "spectrum_accumulator.hh"
+
+#include "psyllid_error.hh"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PSYLLID_X86_POWER_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace psyllid
+{
+
+    namespace
+    {
+        // 2^32 / 2^15 packets would fill the uint32 sums exactly; fold well before that
+        const unsigned s_fold_interval = 65536;
+
+        void accumulate_power_scalar( const int8_t* a_iq, uint32_t* a_sums, unsigned a_n_bins )
+        {
+            for( unsigned i_bin = 0; i_bin < a_n_bins; ++i_bin )
+            {
+                int32_t t_real = a_iq[ 2 * i_bin ];
+                int32_t t_imag = a_iq[ 2 * i_bin + 1 ];
+                a_sums[ i_bin ] += uint32_t( t_real * t_real + t_imag * t_imag );
+            }
+            return;
+        }
+
+#ifdef PSYLLID_X86_POWER_KERNELS
+        // sign-extend the IQ bytes to int16, then madd squares each component and adds the re/im pair of each bin into one int32
+        __attribute__(( target("avx2") ))
+        void accumulate_power_avx2( const int8_t* a_iq, uint32_t* a_sums, unsigned a_n_bins )
+        {
+            unsigned i_bin = 0;
+            for( ; i_bin + 16 <= a_n_bins; i_bin += 16 )
+            {
+                __m256i t_bytes = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( a_iq + 2 * i_bin ) );
+                __m256i t_low = _mm256_cvtepi8_epi16( _mm256_castsi256_si128( t_bytes ) );
+                __m256i t_high = _mm256_cvtepi8_epi16( _mm256_extracti128_si256( t_bytes, 1 ) );
+                __m256i* t_sums = reinterpret_cast< __m256i* >( a_sums + i_bin );
+                _mm256_storeu_si256( t_sums,     _mm256_add_epi32( _mm256_loadu_si256( t_sums ),     _mm256_madd_epi16( t_low, t_low ) ) );
+                _mm256_storeu_si256( t_sums + 1, _mm256_add_epi32( _mm256_loadu_si256( t_sums + 1 ), _mm256_madd_epi16( t_high, t_high ) ) );
+            }
+            accumulate_power_scalar( a_iq + 2 * i_bin, a_sums + i_bin, a_n_bins - i_bin );
+            return;
+        }
+#endif
+    }
+
+    spectrum_accumulator::spectrum_accumulator( unsigned a_n_bins ) :
+            f_n_bins( a_n_bins ),
+            f_use_simd( simd_kernels_available() ),
+            f_sums( a_n_bins, 0 ),
+            f_totals( a_n_bins, 0 ),
+            f_n_in_sums( 0 ),
+            f_n_packets( 0 )
+    {
+        if( f_n_bins == 0 )
+        {
+            throw error() << "[spectrum_accumulator] The number of bins must be at least 1";
+        }
+    }
+
+    spectrum_accumulator::~spectrum_accumulator()
+    {
+    }
+
+    bool spectrum_accumulator::simd_kernels_available()
+    {
+#ifdef PSYLLID_X86_POWER_KERNELS
+        return __builtin_cpu_supports( "avx2" );
+#else
+        return false;
+#endif
+    }
+
+    unsigned spectrum_accumulator::fold_interval()
+    {
+        return s_fold_interval;
+    }
+
+    void spectrum_accumulator::add( const int8_t* a_iq )
+    {
+#ifdef PSYLLID_X86_POWER_KERNELS
+        if( f_use_simd ) accumulate_power_avx2( a_iq, f_sums.data(), f_n_bins );
+        else accumulate_power_scalar( a_iq, f_sums.data(), f_n_bins );
+#else
+        accumulate_power_scalar( a_iq, f_sums.data(), f_n_bins );
+#endif
+        ++f_n_packets;
+        if( ++f_n_in_sums == s_fold_interval ) fold();
+        return;
+    }
+
+    void spectrum_accumulator::average( float* a_dest ) const
+    {
+        if( f_n_packets == 0 )
+        {
+            std::fill( a_dest, a_dest + f_n_bins, 0.f );
+            return;
+        }
+        double t_scale = 1. / double(f_n_packets);
+        for( unsigned i_bin = 0; i_bin < f_n_bins; ++i_bin )
+        {
+            a_dest[ i_bin ] = float( double( f_totals[ i_bin ] + f_sums[ i_bin ] ) * t_scale );
+        }
+        return;
+    }
+
+    void spectrum_accumulator::clear()
+    {
+        std::fill( f_sums.begin(), f_sums.end(), 0 );
+        std::fill( f_totals.begin(), f_totals.end(), 0 );
+        f_n_in_sums = 0;
+        f_n_packets = 0;
+        return;
+    }
+
+    void spectrum_accumulator::set_use_simd( bool a_flag )
+    {
+        f_use_simd = a_flag && simd_kernels_available();
+        return;
+    }
+
+    void spectrum_accumulator::fold()
+    {
+        for( unsigned i_bin = 0; i_bin < f_n_bins; ++i_bin )
+        {
+            f_totals[ i_bin ] += f_sums[ i_bin ];
+            f_sums[ i_bin ] = 0;
+        }
+        f_n_in_sums = 0;
+        return;
+    }
+
+} /* namespace psyllid */
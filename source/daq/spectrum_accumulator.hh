@@ -0,0 +1,89 @@
+/*
+ * spectrum_accumulator.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_SPECTRUM_ACCUMULATOR_HH_
+#define PSYLLID_SPECTRUM_ACCUMULATOR_HH_
+
+#include <cstdint>
+#include <vector>
+
+namespace psyllid
+{
+
+    /*!
+     @class spectrum_accumulator
+     @author N. S. Oblath
+
+     @brief Sums the power (re^2 + im^2) in each bin of int8 IQ spectra, and gives the average
+
+     @details
+     The power of one int8 IQ bin is at most 2 x 128^2 = 2^15, so the running sums are kept as uint32: add() is a widening
+     multiply-add and an integer add per bin, with no conversion to floating point.  An AVX2 kernel is used where the CPU supports
+     it (8 bins per instruction).  To keep the uint32 sums from overflowing, they're folded into uint64 totals every
+     fold_interval() packets, so any number of packets can be accumulated.
+
+     average() writes the mean power per bin as floats; it's meant to be called once per integration, so it isn't vectorized.
+    */
+    class spectrum_accumulator
+    {
+        public:
+            spectrum_accumulator( unsigned a_n_bins );
+            virtual ~spectrum_accumulator();
+
+            /// Whether the SIMD kernel is built in and supported by this CPU
+            static bool simd_kernels_available();
+
+            /// Number of packets after which the uint32 sums are folded into the totals
+            static unsigned fold_interval();
+
+        public:
+            /// Adds the power of a spectrum of n-bins int8 IQ pairs
+            void add( const int8_t* a_iq );
+
+            /// Writes the mean power of each bin to a_dest (n-bins floats); all zeros if nothing has been added
+            void average( float* a_dest ) const;
+
+            /// Starts a new integration
+            void clear();
+
+            unsigned get_n_bins() const;
+            uint64_t get_n_packets() const;
+
+            /// Whether the SIMD kernel is used (if it's available, by default); turning it off is for testing
+            bool get_use_simd() const;
+            void set_use_simd( bool a_flag );
+
+        private:
+            void fold();
+
+            unsigned f_n_bins;
+            bool f_use_simd;
+
+            std::vector< uint32_t > f_sums;
+            std::vector< uint64_t > f_totals;
+            unsigned f_n_in_sums;
+            uint64_t f_n_packets;
+    };
+
+    inline unsigned spectrum_accumulator::get_n_bins() const
+    {
+        return f_n_bins;
+    }
+
+    inline uint64_t spectrum_accumulator::get_n_packets() const
+    {
+        return f_n_packets;
+    }
+
+    inline bool spectrum_accumulator::get_use_simd() const
+    {
+        return f_use_simd;
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_SPECTRUM_ACCUMULATOR_HH_ */
@@ -0,0 +1,216 @@
+/*
+ * spectrum_integrator.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "spectrum_integrator.hh"
+
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <cmath>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( spectrum_integrator, "spectrum-integrator", spectrum_integrator_binding );
+
+    LOGGER( plog, "spectrum_integrator" );
+
+    spectrum_integrator::spectrum_integrator() :
+            f_length( 10 ),
+            f_n_packets( 1000 ),
+            f_integration_time( 0. ),
+            f_acq_rate( 100 ),
+            f_accumulator(),
+            f_window_is_time( false ),
+            f_window_packets( 0 ),
+            f_first_pkt_in_session( 0 ),
+            f_last_pkt_in_session( 0 ),
+            f_first_rx_timestamp_ns( 0 )
+    {
+    }
+
+    spectrum_integrator::~spectrum_integrator()
+    {
+    }
+
+    void spectrum_integrator::initialize()
+    {
+        f_window_is_time = f_integration_time > 0.;
+        if( f_window_is_time )
+        {
+            if( f_acq_rate == 0 )
+            {
+                throw error() << "[spectrum_integrator] The acquisition rate must be greater than 0";
+            }
+            double t_packet_period = double(PAYLOAD_SIZE / 2) / ( double(f_acq_rate) * 1.e6 ); // s
+            f_window_packets = std::max( llrint( f_integration_time / t_packet_period ), 1LL );
+            LDEBUG( plog, "Integrating over windows of " << f_integration_time << " s (" << f_window_packets << " packet periods)" );
+        }
+        else
+        {
+            if( f_n_packets == 0 )
+            {
+                throw error() << "[spectrum_integrator] The number of packets to integrate must be at least 1";
+            }
+            f_window_packets = f_n_packets;
+            LDEBUG( plog, "Integrating over " << f_window_packets << " packets" );
+        }
+
+        f_accumulator.reset( new spectrum_accumulator( PAYLOAD_SIZE / 2 ) );
+        LDEBUG( plog, "SIMD kernel is " << ( f_accumulator->get_use_simd() ? "" : "not " ) << "in use" );
+
+        out_buffer< 0 >().initialize( f_length );
+        return;
+    }
+
+    void spectrum_integrator::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the spectrum integrator" );
+
+            f_accumulator->clear();
+
+            bool t_stream_ok = true;
+
+            while( ! is_canceled() && t_stream_ok )
+            {
+                midge::enum_t t_in_cmd = in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error ) break;
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "Spectrum integrator is exiting" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    LDEBUG( plog, "Spectrum integrator is stopping" );
+                    if( ! output_spectrum() ) break;
+                    if( ! out_stream< 0 >().set( stream::s_stop ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    LDEBUG( plog, "Spectrum integrator is starting" );
+                    f_accumulator->clear();
+                    if( ! out_stream< 0 >().set( stream::s_start ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_run )
+                {
+                    t_stream_ok = add_packet( *in_stream< 0 >().data() );
+                    if( ! t_stream_ok ) LERROR( plog, "Exiting due to stream error" );
+                }
+            }
+
+            // output whatever is left of the integration
+            if( t_stream_ok && ! output_spectrum() ) return;
+
+            LDEBUG( plog, "Stopping output stream" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output stream" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void spectrum_integrator::finalize()
+    {
+        out_buffer< 0 >().finalize();
+        f_accumulator.reset();
+        return;
+    }
+
+    bool spectrum_integrator::add_packet( const freq_data& a_freq_data )
+    {
+        uint64_t t_pkt_in_session = a_freq_data.get_pkt_in_session();
+        if( f_accumulator->get_n_packets() != 0 )
+        {
+            // a packet from an earlier session, or (with a time window) past the end of the window, starts a new integration
+            bool t_new_session = t_pkt_in_session < f_first_pkt_in_session;
+            bool t_past_window = f_window_is_time && t_pkt_in_session - f_first_pkt_in_session >= f_window_packets;
+            if( ( t_new_session || t_past_window ) && ! output_spectrum() ) return false;
+        }
+
+        if( f_accumulator->get_n_packets() == 0 )
+        {
+            f_first_pkt_in_session = t_pkt_in_session;
+            f_first_rx_timestamp_ns = a_freq_data.get_rx_timestamp_ns();
+        }
+        f_last_pkt_in_session = t_pkt_in_session;
+        f_accumulator->add( &a_freq_data.get_array()[ 0 ][ 0 ] );
+
+        uint64_t t_filled = f_window_is_time ? t_pkt_in_session - f_first_pkt_in_session + 1 : f_accumulator->get_n_packets();
+        if( t_filled >= f_window_packets ) return output_spectrum();
+        return true;
+    }
+
+    bool spectrum_integrator::output_spectrum()
+    {
+        if( f_accumulator->get_n_packets() == 0 ) return true;
+
+        spectrum_data* t_spectrum = out_stream< 0 >().data();
+        t_spectrum->set_array_size( f_accumulator->get_n_bins() );
+        f_accumulator->average( t_spectrum->get_array() );
+        t_spectrum->set_pkt_in_session( f_first_pkt_in_session );
+        t_spectrum->set_rx_timestamp_ns( f_first_rx_timestamp_ns );
+        t_spectrum->set_n_packets( f_accumulator->get_n_packets() );
+        t_spectrum->set_pkt_span( f_last_pkt_in_session - f_first_pkt_in_session + 1 );
+        LTRACE( plog, "Outputting a spectrum of " << t_spectrum->get_n_packets() << " packets, starting at packet " << f_first_pkt_in_session );
+        f_accumulator->clear();
+
+        if( ! out_stream< 0 >().set( stream::s_run ) )
+        {
+            LERROR( plog, "spectrum_integrator error setting output stream to s_run" );
+            return false;
+        }
+        return true;
+    }
+
+
+    spectrum_integrator_binding::spectrum_integrator_binding() :
+            sandfly::_node_binding< spectrum_integrator, spectrum_integrator_binding >()
+    {
+    }
+
+    spectrum_integrator_binding::~spectrum_integrator_binding()
+    {
+    }
+
+    void spectrum_integrator_binding::do_apply_config( spectrum_integrator* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring spectrum_integrator with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->set_n_packets( a_config.get_value( "n-packets", a_node->get_n_packets() ) );
+        a_node->set_integration_time( a_config.get_value( "integration-time", a_node->get_integration_time() ) );
+        a_node->set_acq_rate( a_config.get_value( "acq-rate", a_node->get_acq_rate() ) );
+        return;
+    }
+
+    void spectrum_integrator_binding::do_dump_config( const spectrum_integrator* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for spectrum_integrator" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "n-packets", scarab::param_value( a_node->get_n_packets() ) );
+        a_config.add( "integration-time", scarab::param_value( a_node->get_integration_time() ) );
+        a_config.add( "acq-rate", scarab::param_value( a_node->get_acq_rate() ) );
+        return;
+    }
+
+} /* namespace psyllid */
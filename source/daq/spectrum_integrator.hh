@@ -0,0 +1,109 @@
+/*
+ * spectrum_integrator.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_SPECTRUM_INTEGRATOR_HH_
+#define PSYLLID_SPECTRUM_INTEGRATOR_HH_
+
+#include "freq_data.hh"
+#include "node_builder.hh"
+#include "spectrum_accumulator.hh"
+#include "spectrum_data.hh"
+
+#include "transformer.hh"
+
+#include <memory>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+
+    /*!
+     @class spectrum_integrator
+     @author N. S. Oblath
+
+     @brief A transformer that averages the power spectra of frequency packets over a number of packets or a time window
+
+     @details
+     Each frequency packet's power (re^2 + im^2 in each bin) is added to uint32 sums with a SIMD kernel (see spectrum_accumulator);
+     when the integration is complete, the mean power per bin is output as a float spectrum (spectrum_data).  One spectrum is
+     output per integration, so the output rate is lower than the input rate by that factor.
+
+     The integration is either a fixed number of packets ("n-packets"), or, if "integration-time" is greater than 0, a fixed
+     number of packet periods (the integration time divided by the packet period, PAYLOAD_SIZE / 2 samples at "acq-rate").  In
+     the latter case missed packets don't stretch a spectrum in time: it's output when a packet arrives at or past the end of
+     its window, and its n_packets gives the number of packets that were actually averaged.
+
+     A new integration is also started if pkt_in_session goes backwards (i.e. a new session), and the partial integration is
+     output when the input stream stops or exits.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node type: "spectrum-integrator"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "n-packets": uint -- The number of packets to average (default is 1000); used if "integration-time" is 0
+     - "integration-time": double -- The integration window in seconds (default is 0)
+     - "acq-rate": uint -- acquisition rate in MHz, to convert "integration-time" to a number of packets (default is 100)
+
+     Input Stream:
+     - 0: freq_data
+
+     Output Streams:
+     - 0: spectrum_data
+    */
+    class spectrum_integrator : public midge::_transformer< midge::type_list< freq_data >, midge::type_list< spectrum_data > >
+    {
+        public:
+            spectrum_integrator();
+            virtual ~spectrum_integrator();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_accessible( unsigned, n_packets );
+            mv_accessible( double, integration_time ); // s
+            mv_accessible( unsigned, acq_rate ); // MHz
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            /// Adds a packet, outputting the spectrum if the integration is complete; returns false if there's a stream error
+            bool add_packet( const freq_data& a_freq_data );
+
+            /// Outputs the average of the current integration, if there is one, and starts a new one; returns false if there's a stream error
+            bool output_spectrum();
+
+            std::unique_ptr< spectrum_accumulator > f_accumulator;
+            bool f_window_is_time;
+            uint64_t f_window_packets;
+
+            uint64_t f_first_pkt_in_session;
+            uint64_t f_last_pkt_in_session;
+            uint64_t f_first_rx_timestamp_ns;
+    };
+
+    class spectrum_integrator_binding : public sandfly::_node_binding< spectrum_integrator, spectrum_integrator_binding >
+    {
+        public:
+            spectrum_integrator_binding();
+            virtual ~spectrum_integrator_binding();
+
+        private:
+            virtual void do_apply_config( spectrum_integrator* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const spectrum_integrator* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_SPECTRUM_INTEGRATOR_HH_ */
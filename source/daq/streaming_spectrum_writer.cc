@@ -0,0 +1,234 @@
+/*
+ * streaming_spectrum_writer.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "streaming_spectrum_writer.hh"
+
+#include "butterfly_house.hh"
+#include "psyllid_error.hh"
+#include "roach_packet.hh"
+
+#include "midge_error.hh"
+
+#include "logger.hh"
+
+#include <cmath>
+
+using midge::stream;
+
+using std::vector;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( streaming_spectrum_writer, "streaming-spectrum-writer", streaming_spectrum_writer_binding );
+
+    LOGGER( plog, "streaming_spectrum_writer" );
+
+    streaming_spectrum_writer::streaming_spectrum_writer() :
+            egg_writer(),
+            f_file_num( 0 ),
+            f_record_size( PAYLOAD_SIZE / 2 ),
+            f_acq_rate( 100 ),
+            f_center_freq( 50.e6 ),
+            f_freq_range( 100.e6 ),
+            f_monarch_ptr(),
+            f_stream_no( 0 )
+    {
+    }
+
+    streaming_spectrum_writer::~streaming_spectrum_writer()
+    {
+    }
+
+    void streaming_spectrum_writer::prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr )
+    {
+        f_monarch_ptr = a_mw_ptr;
+
+        vector< unsigned > t_chan_vec;
+        f_stream_no = a_hw_ptr->header().AddStream( "Psyllid - integrated spectra",
+                f_acq_rate, f_record_size, 1, sizeof( float ),
+                monarch3::sAnalog, 8 * sizeof( float ), monarch3::sBitsAlignedLeft, &t_chan_vec );
+
+        for( std::vector< unsigned >::const_iterator it = t_chan_vec.begin(); it != t_chan_vec.end(); ++it )
+        {
+            a_hw_ptr->header().GetChannelHeaders()[ *it ].SetFrequencyMin( f_center_freq - 0.5 * f_freq_range );
+            a_hw_ptr->header().GetChannelHeaders()[ *it ].SetFrequencyRange( f_freq_range );
+        }
+
+        return;
+    }
+
+    void streaming_spectrum_writer::initialize()
+    {
+        butterfly_house::get_instance()->register_writer( this, f_file_num );
+        return;
+    }
+
+    void streaming_spectrum_writer::execute( midge::diptera* a_midge )
+    {
+        LDEBUG( plog, "execute streaming spectrum writer" );
+        try
+        {
+            midge::enum_t t_command = stream::s_none;
+
+            spectrum_data* t_spectrum = nullptr;
+
+            stream_wrap_ptr t_swrap_ptr;
+
+            uint64_t t_bytes_per_record = f_record_size * sizeof( float );
+            double t_packet_length_nsec = (double)(PAYLOAD_SIZE / 2) / (double)f_acq_rate * 1.e3;
+
+            uint64_t t_first_pkt_in_run = 0;
+            uint64_t t_next_pkt_in_session = 0;
+
+            bool t_is_new_acquisition = true;
+            bool t_start_file_with_next_data = false;
+
+            while( ! is_canceled() )
+            {
+                t_command = in_stream< 0 >().get();
+                if( t_command == stream::s_none ) continue;
+                if( t_command == stream::s_error ) break;
+
+                LTRACE( plog, "Spectrum writer reading stream 0 at index " << in_stream< 0 >().get_current_index() );
+
+                if( t_command == stream::s_exit )
+                {
+                    LDEBUG( plog, "Spectrum writer is exiting" );
+
+                    if( t_swrap_ptr )
+                    {
+                        f_monarch_ptr->finish_stream( f_stream_no );
+                        t_swrap_ptr.reset();
+                    }
+
+                    break;
+                }
+
+                if( t_command == stream::s_stop )
+                {
+                    LDEBUG( plog, "Spectrum writer is stopping" );
+
+                    if( t_swrap_ptr )
+                    {
+                        f_monarch_ptr->finish_stream( f_stream_no );
+                        t_swrap_ptr.reset();
+                    }
+
+                    continue;
+                }
+
+                if( t_command == stream::s_start )
+                {
+                    LDEBUG( plog, "Will start file with next data" );
+
+                    if( t_swrap_ptr ) t_swrap_ptr.reset();
+
+                    LDEBUG( plog, "Getting stream <" << f_stream_no << ">" );
+                    t_swrap_ptr = f_monarch_ptr->get_stream( f_stream_no );
+
+                    t_start_file_with_next_data = true;
+                    continue;
+                }
+
+                if( t_command == stream::s_run )
+                {
+                    t_spectrum = in_stream< 0 >().data();
+
+                    if( t_spectrum->get_array_size() != f_record_size )
+                    {
+                        throw error() << "[streaming_spectrum_writer] Spectrum size (" << t_spectrum->get_array_size() << ") does not match the record size (" << f_record_size << ")";
+                    }
+
+                    if( t_start_file_with_next_data )
+                    {
+                        LDEBUG( plog, "Handling first spectrum in run" );
+
+                        t_first_pkt_in_run = t_spectrum->get_pkt_in_session();
+
+                        t_is_new_acquisition = true;
+
+                        t_start_file_with_next_data = false;
+                    }
+
+                    uint64_t t_spectrum_id = t_spectrum->get_pkt_in_session();
+                    LTRACE( plog, "Writing spectrum starting at packet (in session) " << t_spectrum_id );
+
+                    if( ! t_is_new_acquisition && t_spectrum_id != t_next_pkt_in_session ) t_is_new_acquisition = true;
+                    t_next_pkt_in_session = t_spectrum_id + t_spectrum->get_pkt_span();
+
+                    uint64_t t_record_time = llrint( t_packet_length_nsec * (double)( t_spectrum_id - t_first_pkt_in_run ) );
+                    if( ! t_swrap_ptr->write_record( t_spectrum_id, t_record_time, t_spectrum->get_array(), t_bytes_per_record, t_is_new_acquisition ) )
+                    {
+                        throw midge::node_nonfatal_error() << "Unable to write record to file; record ID: " << t_spectrum_id;
+                    }
+
+                    LTRACE( plog, "Spectrum written (" << t_spectrum_id << ")" );
+
+                    t_is_new_acquisition = false;
+
+                    continue;
+                }
+
+            } // end while( ! is_cancelled() )
+
+            // final attempt to finish the stream if the outer while loop is broken without the stream having been stopped or exited
+            if( t_swrap_ptr )
+            {
+                f_monarch_ptr->finish_stream( f_stream_no );
+                t_swrap_ptr.reset();
+            }
+
+            return;
+        }
+        catch(...)
+        {
+            LWARN( plog, "an error occurred executing streaming spectrum writer" );
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void streaming_spectrum_writer::finalize()
+    {
+        LDEBUG( plog, "finalize streaming spectrum writer" );
+        butterfly_house::get_instance()->unregister_writer( this );
+        return;
+    }
+
+
+    streaming_spectrum_writer_binding::streaming_spectrum_writer_binding() :
+            sandfly::_node_binding< streaming_spectrum_writer, streaming_spectrum_writer_binding >()
+    {
+    }
+
+    streaming_spectrum_writer_binding::~streaming_spectrum_writer_binding()
+    {
+    }
+
+    void streaming_spectrum_writer_binding::do_apply_config( streaming_spectrum_writer* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring streaming_spectrum_writer with:\n" << a_config );
+        a_node->set_file_num( a_config.get_value( "file-num", a_node->get_file_num() ) );
+        a_node->set_record_size( a_config.get_value( "record-size", a_node->get_record_size() ) );
+        a_node->set_acq_rate( a_config.get_value( "acq-rate", a_node->get_acq_rate() ) );
+        a_node->set_center_freq( a_config.get_value( "center-freq", a_node->get_center_freq() ) );
+        a_node->set_freq_range( a_config.get_value( "freq-range", a_node->get_freq_range() ) );
+        return;
+    }
+
+    void streaming_spectrum_writer_binding::do_dump_config( const streaming_spectrum_writer* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping configuration for streaming_spectrum_writer" );
+        a_config.add( "file-num", scarab::param_value( a_node->get_file_num() ) );
+        a_config.add( "record-size", scarab::param_value( a_node->get_record_size() ) );
+        a_config.add( "acq-rate", scarab::param_value( a_node->get_acq_rate() ) );
+        a_config.add( "center-freq", scarab::param_value( a_node->get_center_freq() ) );
+        a_config.add( "freq-range", scarab::param_value( a_node->get_freq_range() ) );
+        return;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,93 @@
+/*
+ * streaming_spectrum_writer.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_STREAMING_SPECTRUM_WRITER_HH_
+#define PSYLLID_STREAMING_SPECTRUM_WRITER_HH_
+
+#include "egg_writer.hh"
+#include "node_builder.hh"
+#include "spectrum_data.hh"
+
+#include "consumer.hh"
+
+namespace psyllid
+{
+
+    /*!
+     @class streaming_spectrum_writer
+     @author N. S. Oblath
+
+     @brief A consumer that writes all integrated spectra (e.g. from a spectrum_integrator) to an egg file.
+
+     @details
+     Each spectrum is one record of "record-size" 4-byte floating-point values (Monarch's analog format), the mean power per bin.
+     The record ID is the pkt_in_session of the spectrum's first packet, and the record time is the time of that packet from the
+     start of the run; a new acquisition is started whenever a spectrum doesn't follow on from the previous one (i.e. its first
+     packet isn't the one after the end of the previous spectrum).
+
+     WARNING! As with the streaming_frequency_writer, the output of this node is not a proper egg file: the records are spectra, not time series.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node type: "streaming-spectrum-writer"
+
+     Available configuration values:
+     - "file-num": uint -- the file number to write to
+     - "record-size": uint -- number of bins in each spectrum (default is 4096, PAYLOAD_SIZE / 2)
+     - "acq-rate": uint -- acquisition rate of the packets in MHz, for the record times (default is 100)
+     - "center-freq": double -- the center frequency of the data being digitized in Hz
+     - "freq-range": double -- the frequency window (bandwidth) of the data being digitized in Hz
+
+     Input Stream:
+     - 0: spectrum_data
+
+     Output Streams: (none)
+    */
+    class streaming_spectrum_writer :
+            public midge::_consumer< midge::type_list< spectrum_data > >,
+            public egg_writer
+    {
+        public:
+            streaming_spectrum_writer();
+            virtual ~streaming_spectrum_writer();
+
+        public:
+            mv_accessible( unsigned, file_num );
+
+            mv_accessible( unsigned, record_size ); // # of bins
+            mv_accessible( unsigned, acq_rate ); // MHz
+            mv_accessible( double, center_freq ); // Hz
+            mv_accessible( double, freq_range ); // Hz
+
+        public:
+            virtual void prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr );
+
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            monarch_wrap_ptr f_monarch_ptr;
+            unsigned f_stream_no;
+
+    };
+
+
+    class streaming_spectrum_writer_binding : public sandfly::_node_binding< streaming_spectrum_writer, streaming_spectrum_writer_binding >
+    {
+        public:
+            streaming_spectrum_writer_binding();
+            virtual ~streaming_spectrum_writer_binding();
+
+        private:
+            virtual void do_apply_config( streaming_spectrum_writer* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const streaming_spectrum_writer* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_STREAMING_SPECTRUM_WRITER_HH_ */
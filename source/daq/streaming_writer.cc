@@ -26,10 +26,12 @@ using std::vector;
 namespace psyllid
 {
     REGISTER_NODE_AND_BUILDER( streaming_writer, "streaming-writer", streaming_writer_binding );
+    REGISTER_NODE_AND_BUILDER( streaming_batch_writer, "streaming-batch-writer", streaming_batch_writer_binding );
 
     LOGGER( plog, "streaming_writer" );
 
-    streaming_writer::streaming_writer() :
+    template< class x_input_type >
+    _streaming_writer< x_input_type >::_streaming_writer() :
             egg_writer(),
             f_file_num( 0 ),
             f_bit_depth( 8 ),
@@ -41,17 +43,20 @@ namespace psyllid
             f_v_range( 0.5 ),
             f_center_freq( 50.e6 ),
             f_freq_range( 100.e6 ),
+            f_rx_record_time( false ),
             f_last_pkt_in_batch( 0 ),
             f_monarch_ptr(),
             f_stream_no( 0 )
     {
     }
 
-    streaming_writer::~streaming_writer()
+    template< class x_input_type >
+    _streaming_writer< x_input_type >::~_streaming_writer()
     {
     }
 
-    void streaming_writer::prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr )
+    template< class x_input_type >
+    void _streaming_writer< x_input_type >::prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr )
     {
         f_monarch_ptr = a_mw_ptr;
 
@@ -78,20 +83,22 @@ namespace psyllid
         return;
     }
 
-    void streaming_writer::initialize()
+    template< class x_input_type >
+    void _streaming_writer< x_input_type >::initialize()
     {
         butterfly_house::get_instance()->register_writer( this, f_file_num );
         return;
     }
 
-    void streaming_writer::execute( midge::diptera* a_midge )
+    template< class x_input_type >
+    void _streaming_writer< x_input_type >::execute( midge::diptera* a_midge )
     {
         LDEBUG( plog, "execute streaming writer" );
         try
         {
             midge::enum_t t_time_command = stream::s_none;
 
-            time_data* t_time_data = nullptr;
+            x_input_type* t_input = nullptr;
 
             stream_wrap_ptr t_swrap_ptr;
 
@@ -99,17 +106,18 @@ namespace psyllid
             uint64_t t_record_length_nsec = llrint( (double)(PAYLOAD_SIZE / 2) / (double)f_acq_rate * 1.e3 );
 
             uint64_t t_first_pkt_in_run = 0;
+            uint64_t t_first_rx_timestamp_ns = 0;
 
             bool t_is_new_acquisition = true;
             bool t_start_file_with_next_data = false;
 
-            while( ! is_canceled() )
+            while( ! this->is_canceled() )
             {
-                t_time_command = in_stream< 0 >().get();
+                t_time_command = this->template in_stream< 0 >().get();
                 if( t_time_command == stream::s_none ) continue;
                 if( t_time_command == stream::s_error ) break;
 
-                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << in_stream< 0 >().get_current_index() );
+                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << this->template in_stream< 0 >().get_current_index() );
 
                 if( t_time_command == stream::s_exit )
                 {
@@ -152,35 +160,49 @@ namespace psyllid
 
                 if( t_time_command == stream::s_run )
                 {
-                    t_time_data = in_stream< 0 >().data();
+                    t_input = this->template in_stream< 0 >().data();
 
-                    if( t_start_file_with_next_data )
+                    for_each_packet( *t_input, [&]( time_data& a_time_data )
                     {
-                        LDEBUG( plog, "Handling first packet in run" );
+                        if( t_start_file_with_next_data )
+                        {
+                            LDEBUG( plog, "Handling first packet in run" );
 
-                        t_first_pkt_in_run = t_time_data->get_pkt_in_session();
+                            t_first_pkt_in_run = a_time_data.get_pkt_in_session();
+                            t_first_rx_timestamp_ns = a_time_data.get_rx_timestamp_ns();
+                            if( f_rx_record_time && t_first_rx_timestamp_ns == 0 )
+                            {
+                                LWARN( plog, "Record times from receive timestamps were requested, but the first packet has no timestamp; record times will be calculated from the packet count" );
+                            }
 
-                        t_is_new_acquisition = true;
+                            t_is_new_acquisition = true;
 
-                        t_start_file_with_next_data = false;
-                    }
+                            t_start_file_with_next_data = false;
+                        }
 
-                    uint64_t t_time_id = t_time_data->get_pkt_in_session();
-                    LTRACE( plog, "Writing packet (in session) " << t_time_id );
+                        uint64_t t_time_id = a_time_data.get_pkt_in_session();
+                        LTRACE( plog, "Writing packet (in session) " << t_time_id );
 
-                    uint32_t t_expected_pkt_in_batch = f_last_pkt_in_batch + 1;
-                    if( t_expected_pkt_in_batch >= BATCH_COUNTER_SIZE ) t_expected_pkt_in_batch = 0;
-                    if( ! t_is_new_acquisition && t_time_data->get_pkt_in_batch() != t_expected_pkt_in_batch ) t_is_new_acquisition = true;
-                    f_last_pkt_in_batch = t_time_data->get_pkt_in_batch();
+                        uint32_t t_expected_pkt_in_batch = f_last_pkt_in_batch + 1;
+                        if( t_expected_pkt_in_batch >= BATCH_COUNTER_SIZE ) t_expected_pkt_in_batch = 0;
+                        if( ! t_is_new_acquisition && a_time_data.get_pkt_in_batch() != t_expected_pkt_in_batch ) t_is_new_acquisition = true;
+                        f_last_pkt_in_batch = a_time_data.get_pkt_in_batch();
 
-                    if( ! t_swrap_ptr->write_record( t_time_id, t_record_length_nsec * ( t_time_id - t_first_pkt_in_run ), t_time_data->get_raw_array(), t_bytes_per_record, t_is_new_acquisition ) )
-                    {
-                        throw midge::node_nonfatal_error() << "Unable to write record to file; record ID: " << t_time_id;
-                    }
+                        uint64_t t_record_time = t_record_length_nsec * ( t_time_id - t_first_pkt_in_run );
+                        if( f_rx_record_time && t_first_rx_timestamp_ns != 0 && a_time_data.get_rx_timestamp_ns() >= t_first_rx_timestamp_ns )
+                        {
+                            t_record_time = a_time_data.get_rx_timestamp_ns() - t_first_rx_timestamp_ns;
+                        }
 
-                    LTRACE( plog, "Packet written (" << t_time_id << ")" );
+                        if( ! t_swrap_ptr->write_record( t_time_id, t_record_time, a_time_data.get_raw_array(), t_bytes_per_record, t_is_new_acquisition ) )
+                        {
+                            throw midge::node_nonfatal_error() << "Unable to write record to file; record ID: " << t_time_id;
+                        }
 
-                    t_is_new_acquisition = false;
+                        LTRACE( plog, "Packet written (" << t_time_id << ")" );
+
+                        t_is_new_acquisition = false;
+                    } );
 
                     continue;
                 }
@@ -205,7 +227,8 @@ namespace psyllid
         }
     }
 
-    void streaming_writer::finalize()
+    template< class x_input_type >
+    void _streaming_writer< x_input_type >::finalize()
     {
         LDEBUG( plog, "finalize streaming writer" );
         butterfly_house::get_instance()->unregister_writer( this );
@@ -213,16 +236,19 @@ namespace psyllid
     }
 
 
-    streaming_writer_binding::streaming_writer_binding() :
-            sandfly::_node_binding< streaming_writer, streaming_writer_binding >()
+    template< class x_input_type >
+    _streaming_writer_binding< x_input_type >::_streaming_writer_binding() :
+            sandfly::_node_binding< _streaming_writer< x_input_type >, _streaming_writer_binding< x_input_type > >()
     {
     }
 
-    streaming_writer_binding::~streaming_writer_binding()
+    template< class x_input_type >
+    _streaming_writer_binding< x_input_type >::~_streaming_writer_binding()
     {
     }
 
-    void streaming_writer_binding::do_apply_config( streaming_writer* a_node, const scarab::param_node& a_config ) const
+    template< class x_input_type >
+    void _streaming_writer_binding< x_input_type >::do_apply_config( _streaming_writer< x_input_type >* a_node, const scarab::param_node& a_config ) const
     {
         LDEBUG( plog, "Configuring streaming_writer with:\n" << a_config );
         a_node->set_file_num( a_config.get_value( "file-num", a_node->get_file_num() ) );
@@ -239,10 +265,12 @@ namespace psyllid
         }
         a_node->set_center_freq( a_config.get_value( "center-freq", a_node->get_center_freq() ) );
         a_node->set_freq_range( a_config.get_value( "freq-range", a_node->get_freq_range() ) );
+        a_node->set_rx_record_time( a_config.get_value( "rx-record-time", a_node->get_rx_record_time() ) );
         return;
     }
 
-    void streaming_writer_binding::do_dump_config( const streaming_writer* a_node, scarab::param_node& a_config ) const
+    template< class x_input_type >
+    void _streaming_writer_binding< x_input_type >::do_dump_config( const _streaming_writer< x_input_type >* a_node, scarab::param_node& a_config ) const
     {
         LDEBUG( plog, "Dumping configuration for streaming_writer" );
         a_config.add( "file-num", a_node->get_file_num() );
@@ -257,8 +285,14 @@ namespace psyllid
         a_config.add( "device", t_dev_node );
         a_config.add( "center-freq", a_node->get_center_freq() );
         a_config.add( "freq-range", a_node->get_freq_range() );
+        a_config.add( "rx-record-time", a_node->get_rx_record_time() );
         return;
     }
 
+    template class _streaming_writer< time_data >;
+    template class _streaming_writer< time_data_batch >;
+
+    template class _streaming_writer_binding< time_data >;
+    template class _streaming_writer_binding< time_data_batch >;
 
 } /* namespace psyllid */
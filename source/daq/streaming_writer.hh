@@ -10,6 +10,7 @@
 
 #include "egg_writer.hh"
 #include "node_builder.hh"
+#include "packet_batch.hh"
 #include "time_data.hh"
 
 #include "consumer.hh"
@@ -18,16 +19,18 @@ namespace psyllid
 {
 
     /*!
-     @class streaming_writer
+     @class _streaming_writer
      @author N. S. Oblath
 
      @brief A consumer to that writes all time ROACH packets to an egg file.
 
      @details
+     The writer takes either single packets (streaming_writer) or batches of packets (streaming_batch_writer, for use with
+     tf_roach_batch_receiver); each packet is written as a record in either case.
 
      Parameter setting is not thread-safe.  Executing is thread-safe.
 
-     Node type: "streaming-writer"
+     Node types: "streaming-writer" (single packets), "streaming-batch-writer" (batches)
 
      Available configuration values:
      - "device": node -- digitizer parameters
@@ -40,22 +43,25 @@ namespace psyllid
        - "v-range": double -- voltage range for ADC calibration
      - "center-freq": double -- the center frequency of the data being digitized in Hz
      - "freq-range": double -- the frequency window (bandwidth) of the data being digitized in Hz
+     - "rx-record-time": bool -- if true, the record time is the kernel receive time of the packet relative to the first packet in the file;
+                                 otherwise (default) it's calculated from the packet count.  Requires a packet receiver that records receive timestamps.
 
      ADC calibration: analog (V) = digital * gain + v-offset
                       gain = v-range / # of digital levels
 
      Input Stream:
-     - 0: time_data
+     - 0: time_data or time_data_batch
 
      Output Streams: (none)
     */
-    class streaming_writer :
-            public midge::_consumer< midge::type_list< time_data > >,
+    template< class x_input_type >
+    class _streaming_writer :
+            public midge::_consumer< midge::type_list< x_input_type > >,
             public egg_writer
     {
         public:
-            streaming_writer();
-            virtual ~streaming_writer();
+            _streaming_writer();
+            virtual ~_streaming_writer();
 
         public:
             mv_accessible( unsigned, file_num );
@@ -70,6 +76,8 @@ namespace psyllid
             mv_accessible( double, center_freq ); // Hz
             mv_accessible( double, freq_range ); // Hz
 
+            mv_accessible( bool, rx_record_time );
+
         public:
             virtual void prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr );
 
@@ -86,17 +94,25 @@ namespace psyllid
     };
 
 
-    class streaming_writer_binding : public sandfly::_node_binding< streaming_writer, streaming_writer_binding >
+    typedef _streaming_writer< time_data > streaming_writer;
+    typedef _streaming_writer< time_data_batch > streaming_batch_writer;
+
+
+    template< class x_input_type >
+    class _streaming_writer_binding : public sandfly::_node_binding< _streaming_writer< x_input_type >, _streaming_writer_binding< x_input_type > >
     {
         public:
-            streaming_writer_binding();
-            virtual ~streaming_writer_binding();
+            _streaming_writer_binding();
+            virtual ~_streaming_writer_binding();
 
         private:
-            virtual void do_apply_config( streaming_writer* a_node, const scarab::param_node& a_config ) const;
-            virtual void do_dump_config( const streaming_writer* a_node, scarab::param_node& a_config ) const;
+            virtual void do_apply_config( _streaming_writer< x_input_type >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _streaming_writer< x_input_type >* a_node, scarab::param_node& a_config ) const;
     };
 
+    typedef _streaming_writer_binding< time_data > streaming_writer_binding;
+    typedef _streaming_writer_binding< time_data_batch > streaming_batch_writer_binding;
+
 } /* namespace psyllid */
 
 #endif /* PSYLLID_STREAMING_WRITER_HH_ */
@@ -18,6 +18,10 @@ namespace psyllid
     REGISTER_NODE_AND_BUILDER( terminator_time_data, "term-time-data", terminator_time_data_binding );
     REGISTER_NODE_AND_BUILDER( terminator_freq_data, "term-freq-data", terminator_freq_data_binding );
     REGISTER_NODE_AND_BUILDER( terminator_trigger_flag, "term-trig-flag", terminator_trigger_flag_binding );
+    REGISTER_NODE_AND_BUILDER( terminator_tf_pair_data, "term-tf-pair", terminator_tf_pair_data_binding );
+    REGISTER_NODE_AND_BUILDER( terminator_time_data_batch, "term-time-batch", terminator_time_data_batch_binding );
+    REGISTER_NODE_AND_BUILDER( terminator_freq_data_batch, "term-freq-batch", terminator_freq_data_batch_binding );
+    REGISTER_NODE_AND_BUILDER( terminator_spectrum_data, "term-spectrum", terminator_spectrum_data_binding );
 
     LOGGER( plog, "terminator" );
 
@@ -189,6 +193,10 @@ namespace psyllid
 
 
     IMPLEMENT_TERMINATOR (trigger_flag);
+    IMPLEMENT_TERMINATOR (tf_pair_data);
+    IMPLEMENT_TERMINATOR (time_data_batch);
+    IMPLEMENT_TERMINATOR (freq_data_batch);
+    IMPLEMENT_TERMINATOR (spectrum_data);
     /*
     terminator_trigger_flag::terminator_trigger_flag()
     {
@@ -13,6 +13,9 @@
 #include "consumer.hh"
 
 #include "freq_data.hh"
+#include "packet_batch.hh"
+#include "spectrum_data.hh"
+#include "tf_pair_data.hh"
 #include "time_data.hh"
 #include "trigger_flag.hh"
 
@@ -139,6 +142,10 @@ namespace psyllid
 
 
     DEFINE_TERMINATOR( trigger_flag );
+    DEFINE_TERMINATOR( tf_pair_data );
+    DEFINE_TERMINATOR( time_data_batch );
+    DEFINE_TERMINATOR( freq_data_batch );
+    DEFINE_TERMINATOR( spectrum_data );
 /*
     class terminator_trig_flag_data :
             public midge::_consumer< terminator_trig_flag_data, typelist_1( trigger_flag ) >
@@ -0,0 +1,145 @@
+/*
+ * tf_pair_split.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "tf_pair_split.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( tf_pair_split, "split-tf-pair", tf_pair_split_binding );
+
+    LOGGER( plog, "tf_pair_split" );
+
+    tf_pair_split::tf_pair_split() :
+            f_time_length( 10 ),
+            f_freq_length( 10 )
+    {
+    }
+
+    tf_pair_split::~tf_pair_split()
+    {
+    }
+
+    void tf_pair_split::initialize()
+    {
+        out_buffer< 0 >().initialize( f_time_length );
+        out_buffer< 1 >().initialize( f_freq_length );
+        return;
+    }
+
+    void tf_pair_split::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the TF pair split" );
+
+            tf_pair_data* t_pair = nullptr;
+            time_data* t_time_data = nullptr;
+            freq_data* t_freq_data = nullptr;
+
+            while( ! is_canceled() )
+            {
+                midge::enum_t t_in_cmd = in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error ) break;
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "TF pair split is exiting" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    LDEBUG( plog, "TF pair split is stopping" );
+                    if( ! out_stream< 0 >().set( stream::s_stop ) ) break;
+                    if( ! out_stream< 1 >().set( stream::s_stop ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    LDEBUG( plog, "TF pair split is starting" );
+                    if( ! out_stream< 0 >().set( stream::s_start ) ) break;
+                    if( ! out_stream< 1 >().set( stream::s_start ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_run )
+                {
+                    t_pair = in_stream< 0 >().data();
+
+                    t_time_data = out_stream< 0 >().data();
+                    t_time_data->swap_packet( t_pair->time() );
+                    t_time_data->set_pkt_in_session( t_pair->get_pkt_in_session() );
+                    t_time_data->set_rx_timestamp_ns( t_pair->time().get_rx_timestamp_ns() );
+
+                    t_freq_data = out_stream< 1 >().data();
+                    t_freq_data->swap_packet( t_pair->freq() );
+                    t_freq_data->set_pkt_in_session( t_pair->get_pkt_in_session() );
+                    t_freq_data->set_rx_timestamp_ns( t_pair->freq().get_rx_timestamp_ns() );
+
+                    // the frequency packet goes out first, so that a trigger decision on it can be made while the time packet is written
+                    if( ! out_stream< 1 >().set( stream::s_run ) || ! out_stream< 0 >().set( stream::s_run ) )
+                    {
+                        LERROR( plog, "Exiting due to stream error" );
+                        break;
+                    }
+                }
+            }
+
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+            if( ! out_stream< 1 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            out_stream< 0 >().set( stream::s_exit );
+            out_stream< 1 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void tf_pair_split::finalize()
+    {
+        out_buffer< 0 >().finalize();
+        out_buffer< 1 >().finalize();
+        return;
+    }
+
+
+    tf_pair_split_binding::tf_pair_split_binding() :
+            sandfly::_node_binding< tf_pair_split, tf_pair_split_binding >()
+    {
+    }
+
+    tf_pair_split_binding::~tf_pair_split_binding()
+    {
+    }
+
+    void tf_pair_split_binding::do_apply_config( tf_pair_split* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring tf_pair_split with:\n" << a_config );
+        a_node->set_time_length( a_config.get_value( "time-length", a_node->get_time_length() ) );
+        a_node->set_freq_length( a_config.get_value( "freq-length", a_node->get_freq_length() ) );
+        return;
+    }
+
+    void tf_pair_split_binding::do_dump_config( const tf_pair_split* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping tf_pair_split configuration" );
+        a_config.add( "time-length", scarab::param_value( a_node->get_time_length() ) );
+        a_config.add( "freq-length", scarab::param_value( a_node->get_freq_length() ) );
+        return;
+    }
+
+} /* namespace psyllid */
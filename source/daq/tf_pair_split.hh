@@ -0,0 +1,82 @@
+/*
+ * tf_pair_split.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_TF_PAIR_SPLIT_HH_
+#define PSYLLID_TF_PAIR_SPLIT_HH_
+
+#include "freq_data.hh"
+#include "node_builder.hh"
+#include "tf_pair_data.hh"
+#include "time_data.hh"
+
+#include "transformer.hh"
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+    /*!
+     @class tf_pair_split
+     @author N. S. Oblath
+
+     @brief A transformer that splits time/frequency pairs into a time stream and a frequency stream.
+
+     @details
+     This lets the output of tf_roach_pair_receiver feed nodes that take separate time and frequency streams (e.g. the
+     frequency_mask_trigger and the triggered_writer).  Each pair gives exactly one time packet and one frequency packet with the pair's
+     pkt_in_session, so the two streams always match packet for packet.
+
+     The packets are not copied: their memory is exchanged with the output slots.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node type: "split-tf-pair"
+
+     Available configuration values:
+     - "time-length": uint -- The size of the output time-data buffer
+     - "freq-length": uint -- The size of the output frequency-data buffer
+
+     Input Stream:
+     - 0: tf_pair_data
+
+     Output Streams:
+     - 0: time_data
+     - 1: freq_data
+    */
+    class tf_pair_split : public midge::_transformer< midge::type_list< tf_pair_data >, midge::type_list< time_data, freq_data > >
+    {
+        public:
+            tf_pair_split();
+            virtual ~tf_pair_split();
+
+        public:
+            mv_accessible( uint64_t, time_length );
+            mv_accessible( uint64_t, freq_length );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+    };
+
+    class tf_pair_split_binding : public sandfly::_node_binding< tf_pair_split, tf_pair_split_binding >
+    {
+        public:
+            tf_pair_split_binding();
+            virtual ~tf_pair_split_binding();
+
+        private:
+            virtual void do_apply_config( tf_pair_split* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const tf_pair_split* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_TF_PAIR_SPLIT_HH_ */
@@ -0,0 +1,314 @@
+/*
+ * tf_roach_batch_receiver.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "tf_roach_batch_receiver.hh"
+
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( tf_roach_batch_receiver, "tf-roach-batch-receiver", tf_roach_batch_receiver_binding );
+
+    LOGGER( plog, "tf_roach_batch_receiver" );
+
+    tf_roach_batch_receiver::tf_roach_batch_receiver() :
+            f_time_length( 10 ),
+            f_freq_length( 10 ),
+            f_batch_size( 16 ),
+            f_udp_buffer_size( sizeof( roach_packet ) ),
+            f_start_paused( true ),
+            f_force_time_first( false ),
+            f_hand_off( true ),
+            f_freq_only( false ),
+            f_freq_only_this_run( false ),
+            f_paused( true ),
+            f_time_pkt_received( true ),
+            f_n_time_in_batch( 0 ),
+            f_n_freq_in_batch( 0 ),
+            f_time_session_pkt_counter( 0 ),
+            f_freq_session_pkt_counter( 0 ),
+            f_packets_short( 0 )
+    {
+    }
+
+    tf_roach_batch_receiver::~tf_roach_batch_receiver()
+    {
+    }
+
+    void tf_roach_batch_receiver::switch_to_freq_only()
+    {
+        LDEBUG( plog, "Requesting switch to frequency-only mode at the next resume" );
+        f_freq_only.store( true );
+        return;
+    }
+
+    void tf_roach_batch_receiver::switch_to_time_and_freq()
+    {
+        LDEBUG( plog, "Requesting switch to time-and-frequency mode at the next resume" );
+        f_freq_only.store( false );
+        return;
+    }
+
+    void tf_roach_batch_receiver::initialize()
+    {
+        if( f_batch_size == 0 )
+        {
+            throw error() << "[tf_roach_batch_receiver] The batch size must be at least 1";
+        }
+        out_buffer< 0 >().initialize( f_time_length );
+        out_buffer< 1 >().initialize( f_freq_length );
+        return;
+    }
+
+    void tf_roach_batch_receiver::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the TF ROACH batch receiver with batches of " << f_batch_size << " packets" );
+
+            f_paused = true;
+            if( ! f_start_paused )
+            {
+                LDEBUG( plog, "TF ROACH batch receiver starting unpaused" );
+                resume();
+            }
+
+            memory_block* t_block = nullptr;
+
+            LPROG( plog, "Starting main loop; waiting for packets" );
+            while( ! is_canceled() )
+            {
+                check_instructions();
+
+                midge::enum_t t_in_cmd = in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error )
+                {
+                    LTRACE( plog, "tfbr read s_error" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "TF ROACH batch receiver is exiting" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    // receiving a stop command from upstream overrides the pause/unpause commands
+                    LDEBUG( plog, "TF ROACH batch receiver is stopping" );
+                    if( ! flush_batches() || ! set_outputs( stream::s_stop ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    // output streams are not started here because this is controlled by the pause/unpause commands
+                    LDEBUG( plog, "TF ROACH batch receiver is starting" );
+                    continue;
+                }
+
+                // do nothing if paused
+                if( f_paused || t_in_cmd != stream::s_run ) continue;
+
+                t_block = in_stream< 0 >().data();
+                if( t_block->get_n_bytes_used() != f_udp_buffer_size )
+                {
+                    LWARN( plog, "Improper packet size; packet may be malformed: received " << t_block->get_n_bytes_used() << " bytes; expected " << f_udp_buffer_size << " bytes" );
+                    // a short block is only as large as its packet, so it can't be unpacked
+                    if( t_block->get_n_bytes_used() < sizeof( raw_roach_packet ) )
+                    {
+                        ++f_packets_short;
+                        continue;
+                    }
+                }
+
+                bool t_ok = true;
+                if( raw_freq_not_time( reinterpret_cast< const raw_roach_packet* >( t_block->block() ) ) )
+                {
+                    if( ! f_time_pkt_received ) continue;
+                    t_ok = add_to_batch< 1 >( *t_block, f_n_freq_in_batch, f_freq_session_pkt_counter );
+                }
+                else
+                {
+                    if( f_freq_only_this_run ) continue;
+                    f_time_pkt_received = true;
+                    t_ok = add_to_batch< 0 >( *t_block, f_n_time_in_batch, f_time_session_pkt_counter );
+                }
+                if( ! t_ok )
+                {
+                    LERROR( plog, "Exiting due to stream error" );
+                    break;
+                }
+            }
+
+            LINFO( plog, "TF ROACH batch receiver is exiting" );
+            if( f_packets_short != 0 ) LWARN( plog, "Dropped " << f_packets_short << " packets shorter than a ROACH packet" );
+
+            // normal exit condition
+            if( ! flush_batches() ) return;
+
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) || ! out_stream< 1 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            out_stream< 0 >().set( stream::s_exit );
+            out_stream< 1 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void tf_roach_batch_receiver::finalize()
+    {
+        out_buffer< 0 >().finalize();
+        out_buffer< 1 >().finalize();
+        return;
+    }
+
+    template< unsigned x_index >
+    bool tf_roach_batch_receiver::add_to_batch( memory_block& a_block, unsigned& a_n_in_batch, uint64_t& a_session_counter )
+    {
+        auto* t_batch = out_stream< x_index >().data();
+        if( a_n_in_batch == 0 && t_batch->get_capacity() != f_batch_size )
+        {
+            // first use of this slot (or the batch size changed)
+            t_batch->set_capacity( f_batch_size );
+        }
+
+        auto& t_data = (*t_batch)[ a_n_in_batch++ ];
+        t_data.set_pkt_in_session( a_session_counter++ );
+        t_data.set_rx_timestamp_ns( a_block.get_rx_timestamp_ns() );
+        unpack_roach_packet( a_block, t_data, f_hand_off );
+
+        if( a_n_in_batch < f_batch_size ) return true;
+        return flush_batch< x_index >( a_n_in_batch );
+    }
+
+    template< unsigned x_index >
+    bool tf_roach_batch_receiver::flush_batch( unsigned& a_n_in_batch )
+    {
+        if( a_n_in_batch == 0 ) return true;
+
+        auto* t_batch = out_stream< x_index >().data();
+        t_batch->set_n_packets( a_n_in_batch );
+        a_n_in_batch = 0;
+
+        LTRACE( plog, "Batch of " << t_batch->get_n_packets() << ( x_index == 0 ? " time" : " frequency" ) << " packets written to stream index <" << out_stream< x_index >().get_current_index() << ">" );
+        return out_stream< x_index >().set( stream::s_run );
+    }
+
+    bool tf_roach_batch_receiver::flush_batches()
+    {
+        bool t_time_ok = flush_batch< 0 >( f_n_time_in_batch );
+        bool t_freq_ok = flush_batch< 1 >( f_n_freq_in_batch );
+        return t_time_ok && t_freq_ok;
+    }
+
+    bool tf_roach_batch_receiver::set_outputs( midge::enum_t a_command )
+    {
+        bool t_ok = true;
+        if( ! f_freq_only_this_run ) t_ok = out_stream< 0 >().set( a_command );
+        return out_stream< 1 >().set( a_command ) && t_ok;
+    }
+
+    void tf_roach_batch_receiver::resume()
+    {
+        f_freq_only_this_run = f_freq_only.load();
+        LDEBUG( plog, "TF ROACH batch receiver resuming in " << ( f_freq_only_this_run ? "frequency-only" : "time-and-frequency" ) << " mode" );
+        f_time_session_pkt_counter = 0;
+        f_freq_session_pkt_counter = 0;
+        f_n_time_in_batch = 0;
+        f_n_freq_in_batch = 0;
+        f_time_pkt_received = ! f_force_time_first;
+        if( ! set_outputs( stream::s_start ) ) throw midge::node_nonfatal_error() << "Stream error while starting";
+        f_paused = false;
+        return;
+    }
+
+    void tf_roach_batch_receiver::check_instructions()
+    {
+        if( ! have_instruction() ) return;
+
+        midge::instruction t_instruction = use_instruction();
+        if( f_paused && t_instruction == midge::instruction::resume )
+        {
+            resume();
+        }
+        else if( ! f_paused && t_instruction == midge::instruction::pause )
+        {
+            LDEBUG( plog, "TF ROACH batch receiver pausing" );
+            if( ! flush_batches() || ! set_outputs( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream error while stopping";
+            f_paused = true;
+        }
+        return;
+    }
+
+
+    tf_roach_batch_receiver_binding::tf_roach_batch_receiver_binding() :
+            sandfly::_node_binding< tf_roach_batch_receiver, tf_roach_batch_receiver_binding >()
+    {
+    }
+
+    tf_roach_batch_receiver_binding::~tf_roach_batch_receiver_binding()
+    {
+    }
+
+    void tf_roach_batch_receiver_binding::do_apply_config( tf_roach_batch_receiver* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring tf_roach_batch_receiver with:\n" << a_config );
+        a_node->set_time_length( a_config.get_value( "time-length", a_node->get_time_length() ) );
+        a_node->set_freq_length( a_config.get_value( "freq-length", a_node->get_freq_length() ) );
+        a_node->set_batch_size( a_config.get_value( "batch-size", a_node->get_batch_size() ) );
+        a_node->set_udp_buffer_size( a_config.get_value( "udp-buffer-size", a_node->get_udp_buffer_size() ) );
+        a_node->set_start_paused( a_config.get_value( "start-paused", a_node->get_start_paused() ) );
+        a_node->set_force_time_first( a_config.get_value( "force-time-first", a_node->get_force_time_first() ) );
+        a_node->set_hand_off( a_config.get_value( "hand-off", a_node->get_hand_off() ) );
+        return;
+    }
+
+    void tf_roach_batch_receiver_binding::do_dump_config( const tf_roach_batch_receiver* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping tf_roach_batch_receiver configuration" );
+        a_config.add( "time-length", scarab::param_value( a_node->get_time_length() ) );
+        a_config.add( "freq-length", scarab::param_value( a_node->get_freq_length() ) );
+        a_config.add( "batch-size", scarab::param_value( a_node->get_batch_size() ) );
+        a_config.add( "udp-buffer-size", scarab::param_value( a_node->get_udp_buffer_size() ) );
+        a_config.add( "start-paused", scarab::param_value( a_node->get_start_paused() ) );
+        a_config.add( "force-time-first", scarab::param_value( a_node->get_force_time_first() ) );
+        a_config.add( "hand-off", scarab::param_value( a_node->get_hand_off() ) );
+        return;
+    }
+
+    bool tf_roach_batch_receiver_binding::do_run_command( tf_roach_batch_receiver* a_node, const std::string& a_cmd, const scarab::param_node& ) const
+    {
+        if( a_cmd == "freq-only" )
+        {
+            a_node->switch_to_freq_only();
+            return true;
+        }
+        else if( a_cmd == "time-and-freq" )
+        {
+            a_node->switch_to_time_and_freq();
+            return true;
+        }
+        else
+        {
+            LWARN( plog, "Unrecognized command: <" << a_cmd << ">" );
+            return false;
+        }
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,306 @@
+/*
+ * tf_roach_pair_receiver.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "tf_roach_pair_receiver.hh"
+
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( tf_roach_pair_receiver, "tf-roach-pair-receiver", tf_roach_pair_receiver_binding );
+
+    LOGGER( plog, "tf_roach_pair_receiver" );
+
+    tf_roach_pair_receiver::tf_roach_pair_receiver() :
+            f_length( 10 ),
+            f_udp_buffer_size( sizeof( roach_packet ) ),
+            f_start_paused( true ),
+            f_hand_off( true ),
+            f_max_pending( 16 ),
+            f_pending(),
+            f_n_arrived( 0 ),
+            f_paused( true ),
+            f_session_pkt_counter( 0 ),
+            f_pairs_out( 0 ),
+            f_unpaired_time( 0 ),
+            f_unpaired_freq( 0 ),
+            f_duplicates( 0 ),
+            f_packets_short( 0 )
+    {
+    }
+
+    tf_roach_pair_receiver::~tf_roach_pair_receiver()
+    {
+    }
+
+    void tf_roach_pair_receiver::initialize()
+    {
+        if( f_max_pending == 0 )
+        {
+            throw error() << "[tf_roach_pair_receiver] At least one packet must be able to wait for its partner";
+        }
+
+        out_buffer< 0 >().initialize( f_length );
+
+        f_pending.resize( f_max_pending );
+        for( pending_packet& t_pending : f_pending )
+        {
+            t_pending.f_occupied = false;
+        }
+        return;
+    }
+
+    void tf_roach_pair_receiver::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the TF ROACH pair receiver" );
+
+            f_pairs_out = 0;
+            f_unpaired_time = 0;
+            f_unpaired_freq = 0;
+            f_duplicates = 0;
+            f_packets_short = 0;
+
+            f_paused = true;
+            if( ! f_start_paused )
+            {
+                LDEBUG( plog, "TF ROACH pair receiver starting unpaused" );
+                resume();
+            }
+
+            memory_block* t_block = nullptr;
+
+            LPROG( plog, "Starting main loop; waiting for packets" );
+            while( ! is_canceled() )
+            {
+                check_instructions();
+
+                midge::enum_t t_in_cmd = in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error )
+                {
+                    LTRACE( plog, "tfprr read s_error" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "TF ROACH pair receiver is exiting" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    // receiving a stop command from upstream overrides the pause/unpause commands
+                    LDEBUG( plog, "TF ROACH pair receiver is stopping" );
+                    clear_pending();
+                    log_stats();
+                    if( ! out_stream< 0 >().set( stream::s_stop ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    // the output stream is not started here because this is controlled by the pause/unpause commands
+                    LDEBUG( plog, "TF ROACH pair receiver is starting" );
+                    continue;
+                }
+
+                // do nothing if paused
+                if( f_paused || t_in_cmd != stream::s_run ) continue;
+
+                t_block = in_stream< 0 >().data();
+                if( t_block->get_n_bytes_used() != f_udp_buffer_size )
+                {
+                    LWARN( plog, "Improper packet size; packet may be malformed: received " << t_block->get_n_bytes_used() << " bytes; expected " << f_udp_buffer_size << " bytes" );
+                    // a short block is only as large as its packet, so it can't be unpacked
+                    if( t_block->get_n_bytes_used() < sizeof( raw_roach_packet ) )
+                    {
+                        ++f_packets_short;
+                        continue;
+                    }
+                }
+
+                if( ! handle_packet( *t_block ) )
+                {
+                    LERROR( plog, "Exiting due to stream error" );
+                    break;
+                }
+            }
+
+            clear_pending();
+            log_stats();
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output stream" );
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) return;
+
+            LDEBUG( plog, "Exiting output stream" );
+            out_stream< 0 >().set( stream::s_exit );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    void tf_roach_pair_receiver::finalize()
+    {
+        out_buffer< 0 >().finalize();
+        return;
+    }
+
+    bool tf_roach_pair_receiver::handle_packet( memory_block& a_block )
+    {
+        const raw_roach_packet* t_raw_packet = reinterpret_cast< const raw_roach_packet* >( a_block.block() );
+        uint64_t t_id = raw_packet_id( t_raw_packet );
+        bool t_freq_not_time = raw_freq_not_time( t_raw_packet );
+
+        // look for the partner, and for the slot that has been waiting longest in case there's no room
+        pending_packet* t_free = nullptr;
+        pending_packet* t_oldest = nullptr;
+        for( pending_packet& t_pending : f_pending )
+        {
+            if( ! t_pending.f_occupied )
+            {
+                if( t_free == nullptr ) t_free = &t_pending;
+                continue;
+            }
+            if( t_pending.f_id == t_id )
+            {
+                if( t_pending.f_freq_not_time == t_freq_not_time )
+                {
+                    ++f_duplicates;
+                    return true;
+                }
+
+                tf_pair_data* t_pair = out_stream< 0 >().data();
+                roach_packet_data& t_arrived = t_freq_not_time ? static_cast< roach_packet_data& >( t_pair->freq() ) : static_cast< roach_packet_data& >( t_pair->time() );
+                roach_packet_data& t_waiting = t_freq_not_time ? static_cast< roach_packet_data& >( t_pair->time() ) : static_cast< roach_packet_data& >( t_pair->freq() );
+
+                t_arrived.set_rx_timestamp_ns( a_block.get_rx_timestamp_ns() );
+                unpack_roach_packet( a_block, t_arrived, f_hand_off );
+                t_waiting.swap_packet( t_pending.f_data );
+                t_waiting.set_rx_timestamp_ns( t_pending.f_data.get_rx_timestamp_ns() );
+                t_pending.f_occupied = false;
+
+                t_pair->set_pkt_in_session( f_session_pkt_counter++ );
+                ++f_pairs_out;
+
+                LTRACE( plog, "Pair output:  time = " << t_pair->get_unix_time() << "  pkt_session = " << t_pair->get_pkt_in_session() << "  pkt_batch = " << t_pair->get_pkt_in_batch() );
+                return out_stream< 0 >().set( stream::s_run );
+            }
+            if( t_oldest == nullptr || t_pending.f_arrival < t_oldest->f_arrival ) t_oldest = &t_pending;
+        }
+
+        if( t_free == nullptr )
+        {
+            if( t_oldest->f_freq_not_time ) ++f_unpaired_freq;
+            else ++f_unpaired_time;
+            t_free = t_oldest;
+        }
+
+        t_free->f_occupied = true;
+        t_free->f_freq_not_time = t_freq_not_time;
+        t_free->f_id = t_id;
+        t_free->f_arrival = f_n_arrived++;
+        t_free->f_data.set_rx_timestamp_ns( a_block.get_rx_timestamp_ns() );
+        unpack_roach_packet( a_block, t_free->f_data, f_hand_off );
+        return true;
+    }
+
+    void tf_roach_pair_receiver::clear_pending()
+    {
+        for( pending_packet& t_pending : f_pending )
+        {
+            if( ! t_pending.f_occupied ) continue;
+            if( t_pending.f_freq_not_time ) ++f_unpaired_freq;
+            else ++f_unpaired_time;
+            t_pending.f_occupied = false;
+        }
+        return;
+    }
+
+    void tf_roach_pair_receiver::resume()
+    {
+        LDEBUG( plog, "TF ROACH pair receiver resuming" );
+        out_stream< 0 >().data()->set_pkt_in_session( 0 );
+        if( ! out_stream< 0 >().set( stream::s_start ) ) throw midge::node_nonfatal_error() << "Stream 0 error while starting";
+        f_session_pkt_counter = 0;
+        f_paused = false;
+        return;
+    }
+
+    void tf_roach_pair_receiver::check_instructions()
+    {
+        if( ! have_instruction() ) return;
+
+        midge::instruction t_instruction = use_instruction();
+        if( f_paused && t_instruction == midge::instruction::resume )
+        {
+            resume();
+        }
+        else if( ! f_paused && t_instruction == midge::instruction::pause )
+        {
+            LDEBUG( plog, "TF ROACH pair receiver pausing" );
+            clear_pending();
+            if( ! out_stream< 0 >().set( stream::s_stop ) ) throw midge::node_nonfatal_error() << "Stream 0 error while stopping";
+            f_paused = true;
+        }
+        return;
+    }
+
+    void tf_roach_pair_receiver::log_stats() const
+    {
+        LINFO( plog, "Packets handled by <" << get_name() << ">:" <<
+                "\n\tpairs output: " << f_pairs_out <<
+                "\n\tunpaired time packets (dropped): " << f_unpaired_time <<
+                "\n\tunpaired frequency packets (dropped): " << f_unpaired_freq <<
+                "\n\tduplicates (dropped): " << f_duplicates <<
+                "\n\tshort packets (dropped): " << f_packets_short );
+        return;
+    }
+
+
+    tf_roach_pair_receiver_binding::tf_roach_pair_receiver_binding() :
+            sandfly::_node_binding< tf_roach_pair_receiver, tf_roach_pair_receiver_binding >()
+    {
+    }
+
+    tf_roach_pair_receiver_binding::~tf_roach_pair_receiver_binding()
+    {
+    }
+
+    void tf_roach_pair_receiver_binding::do_apply_config( tf_roach_pair_receiver* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring tf_roach_pair_receiver with:\n" << a_config );
+        a_node->set_length( a_config.get_value( "length", a_node->get_length() ) );
+        a_node->set_udp_buffer_size( a_config.get_value( "udp-buffer-size", a_node->get_udp_buffer_size() ) );
+        a_node->set_start_paused( a_config.get_value( "start-paused", a_node->get_start_paused() ) );
+        a_node->set_hand_off( a_config.get_value( "hand-off", a_node->get_hand_off() ) );
+        a_node->set_max_pending( a_config.get_value( "max-pending", a_node->get_max_pending() ) );
+        return;
+    }
+
+    void tf_roach_pair_receiver_binding::do_dump_config( const tf_roach_pair_receiver* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping tf_roach_pair_receiver configuration" );
+        a_config.add( "length", scarab::param_value( a_node->get_length() ) );
+        a_config.add( "udp-buffer-size", scarab::param_value( a_node->get_udp_buffer_size() ) );
+        a_config.add( "start-paused", scarab::param_value( a_node->get_start_paused() ) );
+        a_config.add( "hand-off", scarab::param_value( a_node->get_hand_off() ) );
+        a_config.add( "max-pending", scarab::param_value( a_node->get_max_pending() ) );
+        return;
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,130 @@
+/*
+ * tf_roach_pair_receiver.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_TF_ROACH_PAIR_RECEIVER_HH_
+#define PSYLLID_TF_ROACH_PAIR_RECEIVER_HH_
+
+#include "memory_block.hh"
+#include "node_builder.hh"
+#include "tf_pair_data.hh"
+
+#include "transformer.hh"
+
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+    /*!
+     @class tf_roach_pair_receiver
+     @author N. S. Oblath
+
+     @brief A transformer that receives raw ROACH packets, and outputs each time packet together with the frequency packet that describes the same data.
+
+     @details
+     Time and frequency packets are joined on their first header word: unix_time, pkt_in_batch, digital_id, and if_id.
+     The first packet of a pair to arrive is held until its partner arrives, and the pair is then output as a single tf_pair_data,
+     so a decision made on the frequency packet refers to exactly the time packet it describes.  Both packets of the pair get
+     the pair's pkt_in_session.
+
+     Up to "max-pending" packets can wait for their partners.  When a packet arrives and that many are waiting, the packet that has
+     waited longest is dropped as unpaired; so are the waiting packets when the node is paused or stopped.  A packet whose half of a pair
+     is already waiting is dropped as a duplicate.  Those counts are logged when the node stops or exits.
+
+     Packets of several channels can be received by one node: packets are only paired within a channel.  Pairs are output in the order they
+     are completed.
+
+     Packets are handed off as in tf_roach_receiver (see unpack_roach_packet()): a pair is assembled by exchanging packet memory, not by copying.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node type: "tf-roach-pair-receiver"
+
+     Available configuration values:
+     - "length": uint -- The size of the output buffer
+     - "udp-buffer-size": uint -- The expected number of bytes in a packet
+     - "start-paused": bool -- Whether to start execution paused and wait for an unpause command
+     - "hand-off": bool -- If true (the default), packets take over the memory of the input blocks instead of being copied
+     - "max-pending": uint -- The number of packets that can wait for their partners (default is 16)
+
+     Input Stream:
+     - 0: memory_block
+
+     Output Streams:
+     - 0: tf_pair_data
+    */
+    class tf_roach_pair_receiver : public midge::_transformer< midge::type_list< memory_block >, midge::type_list< tf_pair_data > >
+    {
+        public:
+            tf_roach_pair_receiver();
+            virtual ~tf_roach_pair_receiver();
+
+        public:
+            mv_accessible( uint64_t, length );
+            mv_accessible( uint64_t, udp_buffer_size );
+            mv_accessible( bool, start_paused );
+            mv_accessible( bool, hand_off );
+            mv_accessible( unsigned, max_pending );
+
+        public:
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            /// Pairs the packet with a waiting packet and outputs the pair, or adds it to the waiting packets; returns false if there's a stream error
+            bool handle_packet( memory_block& a_block );
+
+            /// Drops all waiting packets as unpaired
+            void clear_pending();
+
+            /// Handles pause/resume instructions
+            void check_instructions();
+
+            void resume();
+
+            void log_stats() const;
+
+            struct pending_packet
+            {
+                bool f_occupied;
+                bool f_freq_not_time;
+                uint64_t f_id;
+                uint64_t f_arrival;
+                roach_packet_data f_data;
+            };
+            std::vector< pending_packet > f_pending;
+            uint64_t f_n_arrived;
+
+            bool f_paused;
+            uint64_t f_session_pkt_counter;
+
+            uint64_t f_pairs_out;
+            uint64_t f_unpaired_time;
+            uint64_t f_unpaired_freq;
+            uint64_t f_duplicates;
+            uint64_t f_packets_short;
+    };
+
+    class tf_roach_pair_receiver_binding : public sandfly::_node_binding< tf_roach_pair_receiver, tf_roach_pair_receiver_binding >
+    {
+        public:
+            tf_roach_pair_receiver_binding();
+            virtual ~tf_roach_pair_receiver_binding();
+
+        private:
+            virtual void do_apply_config( tf_roach_pair_receiver* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const tf_roach_pair_receiver* a_node, scarab::param_node& a_config ) const;
+    };
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_TF_ROACH_PAIR_RECEIVER_HH_ */
@@ -33,12 +33,14 @@ namespace psyllid
             f_start_paused( true ),
             f_force_time_first( false ),
             f_skip_after_stop( 0 ),
+            f_hand_off( true ),
             f_exe_func( &tf_roach_receiver::exe_time_and_freq ),
             f_exe_func_mutex(),
             f_break_exe_func( false ),
             f_paused( true ),
             f_time_session_pkt_counter( 0 ),
-            f_freq_session_pkt_counter( 0 )
+            f_freq_session_pkt_counter( 0 ),
+            f_packets_short( 0 )
     {
     }
 
@@ -137,6 +139,7 @@ namespace psyllid
             }
 
             LINFO( plog, "TF ROACH receiver is exiting" );
+            if( f_packets_short != 0 ) LWARN( plog, "Dropped " << f_packets_short << " packets shorter than a ROACH packet" );
 
             // normal exit condition
             LDEBUG( plog, "Stopping output streams" );
@@ -256,19 +259,23 @@ namespace psyllid
                     if( a_ctx.f_pkt_size != f_udp_buffer_size )
                     {
                         LWARN( plog, "Improper packet size; packet may be malformed: received " << a_ctx.f_memory_block->get_n_bytes_used() << " bytes; expected " << f_udp_buffer_size << " bytes" );
-                        if( a_ctx.f_pkt_size == 0 ) continue;
+                        // a short block is only as large as its packet, so it can't be unpacked
+                        if( a_ctx.f_pkt_size < sizeof( raw_roach_packet ) )
+                        {
+                            ++f_packets_short;
+                            continue;
+                        }
                     }
 
-                    byteswap_inplace( reinterpret_cast< raw_roach_packet* >( a_ctx.f_memory_block->block() ) );
-                    roach_packet* t_roach_packet = reinterpret_cast< roach_packet* >( a_ctx.f_memory_block->block() );
+                    // the packet is still in network byte order; it's swapped as it's copied to the output
+                    const raw_roach_packet* t_raw_packet = reinterpret_cast< const raw_roach_packet* >( a_ctx.f_memory_block->block() );
 
                     // debug purposes only
     #ifndef NDEBUG
-                    raw_roach_packet* t_raw_packet = reinterpret_cast< raw_roach_packet* >( a_ctx.f_memory_block->block() );
                     LTRACE( plog, "Raw packet header: " << std::hex << t_raw_packet->f_word_0 << ", " << t_raw_packet->f_word_1 << ", " << t_raw_packet->f_word_2 << ", " << t_raw_packet->f_word_3 );
     #endif
 
-                    if( t_roach_packet->f_freq_not_time )
+                    if( raw_freq_not_time( t_raw_packet ) )
                     {
                         // packet is frequency data
                         if( ! t_time_pkt_received ) continue;
@@ -276,12 +283,13 @@ namespace psyllid
 
                         a_ctx.f_freq_data = out_stream< 1 >().data();
                         a_ctx.f_freq_data->set_pkt_in_session( f_freq_session_pkt_counter++ );
-                        ::memcpy( &a_ctx.f_freq_data->packet(), t_roach_packet, a_ctx.f_pkt_size );
+                        a_ctx.f_freq_data->set_rx_timestamp_ns( a_ctx.f_memory_block->get_rx_timestamp_ns() );
+                        unpack_roach_packet( *a_ctx.f_memory_block, *a_ctx.f_freq_data, f_hand_off );
 
                         LTRACE( plog, "Frequency data received (" << a_ctx.f_pkt_size << " bytes):  chan = " << a_ctx.f_freq_data->get_digital_id() <<
                                "  time = " << a_ctx.f_freq_data->get_unix_time() <<
                                "  pkt_session = " << a_ctx.f_freq_data->get_pkt_in_session() <<
-                               "  pkt_batch = " << t_roach_packet->f_pkt_in_batch <<
+                               "  pkt_batch = " << a_ctx.f_freq_data->get_pkt_in_batch() <<
                                "  freqNotTime = " << a_ctx.f_freq_data->get_freq_not_time() <<
                                "  first 8 bins: " << (int)a_ctx.f_freq_data->get_array()[ 0 ][ 0 ]  << ", " << (int)a_ctx.f_freq_data->get_array()[ 0 ][ 1 ] << " -- " << (int)a_ctx.f_freq_data->get_array()[ 1 ][ 0 ] << ", " << (int)a_ctx.f_freq_data->get_array()[ 1 ][ 1 ] << " -- " << (int)a_ctx.f_freq_data->get_array()[ 2 ][ 0 ] << ", " << (int)a_ctx.f_freq_data->get_array()[ 2 ][ 1 ] << " -- " << (int)a_ctx.f_freq_data->get_array()[ 3 ][ 0 ] << ", " << (int)a_ctx.f_freq_data->get_array()[ 3 ][ 1 ]);
                         LTRACE( plog, "Frequency data written to stream index <" << out_stream< 1 >().get_current_index() << ">" );
@@ -299,12 +307,13 @@ namespace psyllid
 
                         a_ctx.f_time_data = out_stream< 0 >().data();
                         a_ctx.f_time_data->set_pkt_in_session( f_time_session_pkt_counter++ );
-                        ::memcpy( &a_ctx.f_time_data->packet(), t_roach_packet, a_ctx.f_pkt_size );
+                        a_ctx.f_time_data->set_rx_timestamp_ns( a_ctx.f_memory_block->get_rx_timestamp_ns() );
+                        unpack_roach_packet( *a_ctx.f_memory_block, *a_ctx.f_time_data, f_hand_off );
 
                         LTRACE( plog, "Time data received (" << a_ctx.f_pkt_size << " bytes):  chan = " << a_ctx.f_time_data->get_digital_id() <<
                                "  time = " << a_ctx.f_time_data->get_unix_time() <<
                                "  pkt_session = " << a_ctx.f_time_data->get_pkt_in_session() <<
-                               "  pkt_batch = " << t_roach_packet->f_pkt_in_batch <<
+                               "  pkt_batch = " << a_ctx.f_time_data->get_pkt_in_batch() <<
                                "  freqNotTime = " << a_ctx.f_time_data->get_freq_not_time() <<
                                "  first 8 bins: " << (int)a_ctx.f_time_data->get_array()[ 0 ][ 0 ]  << ", " << (int)a_ctx.f_time_data->get_array()[ 0 ][ 1 ] << " -- " << (int)a_ctx.f_time_data->get_array()[ 1 ][ 0 ] << ", " << (int)a_ctx.f_time_data->get_array()[ 1 ][ 1 ] << " -- " << (int)a_ctx.f_time_data->get_array()[ 2 ][ 0 ] << ", " << (int)a_ctx.f_time_data->get_array()[ 2 ][ 1 ] << " -- " << (int)a_ctx.f_time_data->get_array()[ 3 ][ 0 ] << ", " << (int)a_ctx.f_time_data->get_array()[ 3 ][ 1 ]);
                         LTRACE( plog, "Time data written to stream index <" << out_stream< 1 >().get_current_index() << ">" );
@@ -427,31 +436,36 @@ namespace psyllid
                     if( a_ctx.f_pkt_size != f_udp_buffer_size )
                     {
                         LWARN( plog, "Improper packet size; packet may be malformed: received " << a_ctx.f_memory_block->get_n_bytes_used() << " bytes; expected " << f_udp_buffer_size << " bytes" );
-                        if( a_ctx.f_pkt_size == 0 ) continue;
+                        // a short block is only as large as its packet, so it can't be unpacked
+                        if( a_ctx.f_pkt_size < sizeof( raw_roach_packet ) )
+                        {
+                            ++f_packets_short;
+                            continue;
+                        }
                     }
 
-                    byteswap_inplace( reinterpret_cast< raw_roach_packet* >( a_ctx.f_memory_block->block() ) );
-                    roach_packet* t_roach_packet = reinterpret_cast< roach_packet* >( a_ctx.f_memory_block->block() );
+                    // the packet is still in network byte order; it's swapped as it's copied to the output
+                    const raw_roach_packet* t_raw_packet = reinterpret_cast< const raw_roach_packet* >( a_ctx.f_memory_block->block() );
 
                     // debug purposes only
     #ifndef NDEBUG
-                    raw_roach_packet* t_raw_packet = reinterpret_cast< raw_roach_packet* >( a_ctx.f_memory_block->block() );
                     LTRACE( plog, "Raw packet header: " << std::hex << t_raw_packet->f_word_0 << ", " << t_raw_packet->f_word_1 << ", " << t_raw_packet->f_word_2 << ", " << t_raw_packet->f_word_3 );
     #endif
 
-                    if( t_roach_packet->f_freq_not_time )
+                    if( raw_freq_not_time( t_raw_packet ) )
                     {
                         // packet is frequency data
                         //t_freq_batch_pkt = t_roach_packet->f_pkt_in_batch;
 
                         a_ctx.f_freq_data = out_stream< 1 >().data();
                         a_ctx.f_freq_data->set_pkt_in_session( f_freq_session_pkt_counter++ );
-                        ::memcpy( &a_ctx.f_freq_data->packet(), t_roach_packet, a_ctx.f_pkt_size );
+                        a_ctx.f_freq_data->set_rx_timestamp_ns( a_ctx.f_memory_block->get_rx_timestamp_ns() );
+                        unpack_roach_packet( *a_ctx.f_memory_block, *a_ctx.f_freq_data, f_hand_off );
 
                         LTRACE( plog, "Frequency data received (" << a_ctx.f_pkt_size << " bytes):  chan = " << a_ctx.f_freq_data->get_digital_id() <<
                                "  time = " << a_ctx.f_freq_data->get_unix_time() <<
                                "  pkt_session = " << a_ctx.f_freq_data->get_pkt_in_session() <<
-                               "  pkt_batch = " << t_roach_packet->f_pkt_in_batch <<
+                               "  pkt_batch = " << a_ctx.f_freq_data->get_pkt_in_batch() <<
                                "  freqNotTime = " << a_ctx.f_freq_data->get_freq_not_time() <<
                                "  first 8 bins: " << (int)a_ctx.f_freq_data->get_array()[ 0 ][ 0 ]  << ", " << (int)a_ctx.f_freq_data->get_array()[ 0 ][ 1 ] << " -- " << (int)a_ctx.f_freq_data->get_array()[ 1 ][ 0 ] << ", " << (int)a_ctx.f_freq_data->get_array()[ 1 ][ 1 ] << " -- " << (int)a_ctx.f_freq_data->get_array()[ 2 ][ 0 ] << ", " << (int)a_ctx.f_freq_data->get_array()[ 2 ][ 1 ] << " -- " << (int)a_ctx.f_freq_data->get_array()[ 3 ][ 0 ] << ", " << (int)a_ctx.f_freq_data->get_array()[ 3 ][ 1 ]);
                         LTRACE( plog, "Frequency data written to stream index <" << out_stream< 1 >().get_current_index() << ">" );
@@ -498,6 +512,7 @@ namespace psyllid
         a_node->set_time_sync_tol( a_config.get_value( "time-sync-tol", a_node->get_time_sync_tol() ) );
         a_node->set_start_paused( a_config.get_value( "start-paused", a_node->get_start_paused() ) );
         a_node->set_force_time_first( a_config.get_value( "force-time-first", a_node->get_force_time_first() ) );
+        a_node->set_hand_off( a_config.get_value( "hand-off", a_node->get_hand_off() ) );
         return;
     }
 
@@ -510,6 +525,7 @@ namespace psyllid
         a_config.add( "time-sync-tol", scarab::param_value( a_node->get_time_sync_tol() ) );
         a_config.add( "start-paused", scarab::param_value( a_node->get_start_paused() ) );
         a_config.add( "force-time-first", scarab::param_value( a_node->get_force_time_first() ) );
+        a_config.add( "hand-off", scarab::param_value( a_node->get_hand_off() ) );
         return;
 
     }
@@ -33,6 +33,16 @@ namespace psyllid
 
      @details
 
+     Packets are byte-swapped in place, and the output time_data or freq_data then adopts the input memory_block's memory, giving
+     its own memory to the input slot in exchange (see roach_packet_data::adopt_packet()).  A packet is therefore written once by
+     the receiver and not copied again on the way to the writer.  Input blocks that are views (e.g. from the FPA receiver's ring in zero-copy mode,
+     or from GRO), and all blocks if "hand-off" is false, are instead byte-swapped into the output in a single pass.
+     Blocks shorter than a ROACH packet are dropped (and counted) before anything in them is read.
+
+     Only blocks whose memory is the size of a packet are adopted (see roach_packet_data::can_adopt()), so the output slots
+     always hold packet-sized memory.  The FPA and XDP receivers size their blocks to the packets; blocks from the socket receiver
+     are sized to "max-packet-size", so unless that's set to the ROACH packet size (8224 bytes) they're byte-swapped into the output.
+
      Parameter setting is not thread-safe.  Executing is thread-safe.
 
      Node type: "tf-roach-receiver"
@@ -44,6 +54,7 @@ namespace psyllid
      - "time-sync-tol": uint -- (currently unused) Tolerance for time synchronization between the ROACH and the server (seconds)
      - "start-paused": bool -- Whether to start execution paused and wait for an unpause command
      - "force-time-first": bool -- If true, when starting ignore f packets before the first t packet
+     - "hand-off": bool -- If true (the default), output packets take over the memory of the input blocks instead of being copied (see below)
 
      Available DAQ commands:
      - "freq-only" (no args) -- Switch the execution mode to frequency-only
@@ -71,6 +82,7 @@ namespace psyllid
             mv_accessible( bool, start_paused );
             mv_accessible( bool, force_time_first );
             mv_accessible( unsigned, skip_after_stop );
+            mv_accessible( bool, hand_off );
 
         public:
             void switch_to_freq_only();
@@ -104,6 +116,8 @@ namespace psyllid
             uint64_t f_time_session_pkt_counter;
             uint64_t f_freq_session_pkt_counter;
 
+            uint64_t f_packets_short; // dropped
+
     };
 
     class tf_roach_receiver_binding : public sandfly::_node_binding< tf_roach_receiver, tf_roach_receiver_binding >
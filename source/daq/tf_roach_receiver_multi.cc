@@ -0,0 +1,436 @@
+/*
+ * tf_roach_receiver_multi.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "tf_roach_receiver_multi.hh"
+
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+#include "param.hh"
+
+#include <sstream>
+
+using midge::stream;
+
+namespace psyllid
+{
+    REGISTER_NODE_AND_BUILDER( tf_roach_receiver_2, "tf-roach-receiver-2", tf_roach_receiver_2_binding );
+    REGISTER_NODE_AND_BUILDER( tf_roach_receiver_3, "tf-roach-receiver-3", tf_roach_receiver_3_binding );
+    REGISTER_NODE_AND_BUILDER( tf_roach_receiver_4, "tf-roach-receiver-4", tf_roach_receiver_4_binding );
+
+    LOGGER( plog, "tf_roach_receiver_multi" );
+
+
+    //***************************
+    // _tf_roach_receiver_multi
+    //***************************
+
+    template< unsigned x_n_channels >
+    _tf_roach_receiver_multi< x_n_channels >::_tf_roach_receiver_multi() :
+            f_time_length( 10 ),
+            f_freq_length( 10 ),
+            f_udp_buffer_size( sizeof( roach_packet ) ),
+            f_start_paused( true ),
+            f_force_time_first( false ),
+            f_hand_off( true ),
+            f_digital_ids(),
+            f_if_ids(),
+            f_freq_only( false ),
+            f_freq_only_this_run( false ),
+            f_paused( true ),
+            f_session_pkt_counters( 2 * x_n_channels, 0 ),
+            f_time_pkt_received( x_n_channels, true ),
+            f_packets_received( x_n_channels, 0 ),
+            f_packets_unrouted( 0 ),
+            f_packets_short( 0 )
+    {
+    }
+
+    template< unsigned x_n_channels >
+    _tf_roach_receiver_multi< x_n_channels >::~_tf_roach_receiver_multi()
+    {
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::switch_to_freq_only()
+    {
+        LDEBUG( plog, "Requesting switch to frequency-only mode at the next resume" );
+        f_freq_only.store( true );
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::switch_to_time_and_freq()
+    {
+        LDEBUG( plog, "Requesting switch to time-and-frequency mode at the next resume" );
+        f_freq_only.store( false );
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::initialize()
+    {
+        if( f_digital_ids.size() != x_n_channels )
+        {
+            throw error() << "[tf_roach_receiver_multi] There must be one digital ID per channel; " << x_n_channels << " channels and " << f_digital_ids.size() << " digital IDs were given";
+        }
+        if( ! f_if_ids.empty() && f_if_ids.size() != x_n_channels )
+        {
+            throw error() << "[tf_roach_receiver_multi] If IF IDs are given, there must be one per channel; " << x_n_channels << " channels and " << f_if_ids.size() << " IF IDs were given";
+        }
+        for( unsigned i_chan = 0; i_chan < x_n_channels; ++i_chan )
+        {
+            for( unsigned i_other = 0; i_other < i_chan; ++i_other )
+            {
+                if( f_digital_ids[ i_chan ] == f_digital_ids[ i_other ] && ( f_if_ids.empty() || f_if_ids[ i_chan ] == f_if_ids[ i_other ] ) )
+                {
+                    throw error() << "[tf_roach_receiver_multi] Channels " << i_other << " and " << i_chan << " have the same IDs";
+                }
+            }
+        }
+
+        initialize_buffers( std::make_index_sequence< 2 * x_n_channels >() );
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    template< std::size_t... x_indices >
+    void _tf_roach_receiver_multi< x_n_channels >::initialize_buffers( std::index_sequence< x_indices... > )
+    {
+        ( this->template out_buffer< x_indices >().initialize( x_indices % 2 == 0 ? f_time_length : f_freq_length ), ... );
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    template< std::size_t... x_indices >
+    void _tf_roach_receiver_multi< x_n_channels >::finalize_buffers( std::index_sequence< x_indices... > )
+    {
+        ( this->template out_buffer< x_indices >().finalize(), ... );
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    template< std::size_t... x_indices >
+    bool _tf_roach_receiver_multi< x_n_channels >::set_outputs( midge::enum_t a_command, bool a_time, bool a_freq, std::index_sequence< x_indices... > )
+    {
+        bool t_ok = true;
+        ( ( ( x_indices % 2 == 0 ? a_time : a_freq ) ? ( t_ok = this->template out_stream< x_indices >().set( a_command ) && t_ok ) : true ), ... );
+        return t_ok;
+    }
+
+    template< unsigned x_n_channels >
+    template< std::size_t... x_indices >
+    void _tf_roach_receiver_multi< x_n_channels >::reset_session_counters( std::index_sequence< x_indices... > )
+    {
+        ( this->template out_stream< x_indices >().data()->set_pkt_in_session( 0 ), ... );
+        f_session_pkt_counters.assign( 2 * x_n_channels, 0 );
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    template< std::size_t... x_indices >
+    bool _tf_roach_receiver_multi< x_n_channels >::output( unsigned a_output, memory_block& a_block, std::index_sequence< x_indices... > )
+    {
+        bool t_ok = true;
+        ( ( a_output == x_indices ? ( t_ok = output_to< x_indices >( a_block ) ) : true ), ... );
+        return t_ok;
+    }
+
+    template< unsigned x_n_channels >
+    template< std::size_t x_index >
+    bool _tf_roach_receiver_multi< x_n_channels >::output_to( memory_block& a_block )
+    {
+        auto* t_data = this->template out_stream< x_index >().data();
+        t_data->set_pkt_in_session( f_session_pkt_counters[ x_index ]++ );
+        t_data->set_rx_timestamp_ns( a_block.get_rx_timestamp_ns() );
+        unpack_roach_packet( a_block, *t_data, f_hand_off );
+
+        LTRACE( plog, "Packet for channel " << x_index / 2 << " (" << ( x_index % 2 == 0 ? "time" : "freq" ) << "):  time = " << t_data->get_unix_time() <<
+                "  pkt_session = " << t_data->get_pkt_in_session() << "  pkt_batch = " << t_data->get_pkt_in_batch() );
+        return this->template out_stream< x_index >().set( stream::s_run );
+    }
+
+    template< unsigned x_n_channels >
+    int _tf_roach_receiver_multi< x_n_channels >::find_channel( const raw_roach_packet* a_pkt ) const
+    {
+        uint32_t t_digital_id = raw_digital_id( a_pkt );
+        for( unsigned i_chan = 0; i_chan < x_n_channels; ++i_chan )
+        {
+            if( f_digital_ids[ i_chan ] != t_digital_id ) continue;
+            if( ! f_if_ids.empty() && f_if_ids[ i_chan ] != raw_if_id( a_pkt ) ) continue;
+            return i_chan;
+        }
+        return -1;
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::resume()
+    {
+        f_freq_only_this_run = f_freq_only.load();
+        LDEBUG( plog, "Multi-channel TF ROACH receiver resuming in " << ( f_freq_only_this_run ? "frequency-only" : "time-and-frequency" ) << " mode" );
+        reset_session_counters( std::make_index_sequence< 2 * x_n_channels >() );
+        f_time_pkt_received.assign( x_n_channels, ! f_force_time_first );
+        if( ! set_outputs( stream::s_start, ! f_freq_only_this_run, true, std::make_index_sequence< 2 * x_n_channels >() ) )
+        {
+            throw midge::node_nonfatal_error() << "Stream error while starting";
+        }
+        f_paused = false;
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::check_instructions()
+    {
+        if( ! this->have_instruction() ) return;
+
+        midge::instruction t_instruction = this->use_instruction();
+        if( f_paused && t_instruction == midge::instruction::resume )
+        {
+            resume();
+        }
+        else if( ! f_paused && t_instruction == midge::instruction::pause )
+        {
+            LDEBUG( plog, "Multi-channel TF ROACH receiver pausing" );
+            if( ! set_outputs( stream::s_stop, ! f_freq_only_this_run, true, std::make_index_sequence< 2 * x_n_channels >() ) )
+            {
+                throw midge::node_nonfatal_error() << "Stream error while stopping";
+            }
+            f_paused = true;
+        }
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::execute( midge::diptera* a_midge )
+    {
+        try
+        {
+            LDEBUG( plog, "Executing the TF ROACH receiver for " << x_n_channels << " channels" );
+
+            const std::make_index_sequence< 2 * x_n_channels > t_outputs;
+
+            f_packets_received.assign( x_n_channels, 0 );
+            f_packets_unrouted = 0;
+            f_packets_short = 0;
+
+            f_paused = true;
+            if( ! f_start_paused )
+            {
+                LDEBUG( plog, "Multi-channel TF ROACH receiver starting unpaused" );
+                resume();
+            }
+
+            memory_block* t_block = nullptr;
+
+            LPROG( plog, "Starting main loop; waiting for packets" );
+            while( ! this->is_canceled() )
+            {
+                check_instructions();
+
+                midge::enum_t t_in_cmd = this->template in_stream< 0 >().get();
+                if( t_in_cmd == stream::s_none ) continue;
+                if( t_in_cmd == stream::s_error )
+                {
+                    LTRACE( plog, "tfrr read s_error" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_exit )
+                {
+                    LDEBUG( plog, "Multi-channel TF ROACH receiver is exiting" );
+                    break;
+                }
+                if( t_in_cmd == stream::s_stop )
+                {
+                    // receiving a stop command from upstream overrides the pause/unpause commands
+                    LDEBUG( plog, "Multi-channel TF ROACH receiver is stopping" );
+                    if( ! set_outputs( stream::s_stop, ! f_freq_only_this_run, true, t_outputs ) ) break;
+                    continue;
+                }
+                if( t_in_cmd == stream::s_start )
+                {
+                    // output streams are not started here because this is controlled by the pause/unpause commands
+                    LDEBUG( plog, "Multi-channel TF ROACH receiver is starting" );
+                    continue;
+                }
+
+                // do nothing if paused
+                if( f_paused || t_in_cmd != stream::s_run ) continue;
+
+                t_block = this->template in_stream< 0 >().data();
+                if( t_block->get_n_bytes_used() != f_udp_buffer_size )
+                {
+                    LWARN( plog, "Improper packet size; packet may be malformed: received " << t_block->get_n_bytes_used() << " bytes; expected " << f_udp_buffer_size << " bytes" );
+                    // a short block is only as large as its packet, so it can't be unpacked
+                    if( t_block->get_n_bytes_used() < sizeof( raw_roach_packet ) )
+                    {
+                        ++f_packets_short;
+                        continue;
+                    }
+                }
+
+                const raw_roach_packet* t_raw_packet = reinterpret_cast< const raw_roach_packet* >( t_block->block() );
+                int t_channel = find_channel( t_raw_packet );
+                if( t_channel < 0 )
+                {
+                    ++f_packets_unrouted;
+                    continue;
+                }
+                ++f_packets_received[ t_channel ];
+
+                unsigned t_output = 2 * t_channel;
+                if( raw_freq_not_time( t_raw_packet ) )
+                {
+                    if( ! f_time_pkt_received[ t_channel ] ) continue;
+                    t_output += 1;
+                }
+                else
+                {
+                    if( f_freq_only_this_run ) continue;
+                    f_time_pkt_received[ t_channel ] = true;
+                }
+
+                if( ! output( t_output, *t_block, t_outputs ) )
+                {
+                    LERROR( plog, "Exiting due to stream error" );
+                    break;
+                }
+            }
+
+            std::stringstream t_counts;
+            for( unsigned i_chan = 0; i_chan < x_n_channels; ++i_chan )
+            {
+                t_counts << "\n\tchannel " << i_chan << " (digital ID " << f_digital_ids[ i_chan ] << "): " << f_packets_received[ i_chan ];
+            }
+            LINFO( plog, "Packets received by <" << this->get_name() << ">:" << t_counts.str() << "\n\tunrouted (dropped): " << f_packets_unrouted << "\n\tshort (dropped): " << f_packets_short );
+
+            // normal exit condition
+            LDEBUG( plog, "Stopping output streams" );
+            if( ! set_outputs( stream::s_stop, true, true, t_outputs ) ) return;
+
+            LDEBUG( plog, "Exiting output streams" );
+            set_outputs( stream::s_exit, true, true, t_outputs );
+
+            return;
+        }
+        catch(...)
+        {
+            if( a_midge ) a_midge->throw_ex( std::current_exception() );
+            else throw;
+        }
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi< x_n_channels >::finalize()
+    {
+        finalize_buffers( std::make_index_sequence< 2 * x_n_channels >() );
+        return;
+    }
+
+
+    //***********************************
+    // _tf_roach_receiver_multi_binding
+    //***********************************
+
+    template< unsigned x_n_channels >
+    _tf_roach_receiver_multi_binding< x_n_channels >::_tf_roach_receiver_multi_binding() :
+            sandfly::_node_binding< _tf_roach_receiver_multi< x_n_channels >, _tf_roach_receiver_multi_binding< x_n_channels > >()
+    {
+    }
+
+    template< unsigned x_n_channels >
+    _tf_roach_receiver_multi_binding< x_n_channels >::~_tf_roach_receiver_multi_binding()
+    {
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi_binding< x_n_channels >::do_apply_config( _tf_roach_receiver_multi< x_n_channels >* a_node, const scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Configuring tf_roach_receiver_multi with:\n" << a_config );
+        a_node->set_time_length( a_config.get_value( "time-length", a_node->get_time_length() ) );
+        a_node->set_freq_length( a_config.get_value( "freq-length", a_node->get_freq_length() ) );
+        a_node->set_udp_buffer_size( a_config.get_value( "udp-buffer-size", a_node->get_udp_buffer_size() ) );
+        a_node->set_start_paused( a_config.get_value( "start-paused", a_node->get_start_paused() ) );
+        a_node->set_force_time_first( a_config.get_value( "force-time-first", a_node->get_force_time_first() ) );
+        a_node->set_hand_off( a_config.get_value( "hand-off", a_node->get_hand_off() ) );
+        if( a_config.has( "digital-ids" ) )
+        {
+            a_node->digital_ids().clear();
+            const scarab::param_array& t_ids = a_config["digital-ids"].as_array();
+            for( unsigned i_id = 0; i_id < t_ids.size(); ++i_id )
+            {
+                a_node->digital_ids().push_back( t_ids[ i_id ]().as_uint() );
+            }
+        }
+        if( a_config.has( "if-ids" ) )
+        {
+            a_node->if_ids().clear();
+            const scarab::param_array& t_ids = a_config["if-ids"].as_array();
+            for( unsigned i_id = 0; i_id < t_ids.size(); ++i_id )
+            {
+                a_node->if_ids().push_back( t_ids[ i_id ]().as_uint() );
+            }
+        }
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    void _tf_roach_receiver_multi_binding< x_n_channels >::do_dump_config( const _tf_roach_receiver_multi< x_n_channels >* a_node, scarab::param_node& a_config ) const
+    {
+        LDEBUG( plog, "Dumping tf_roach_receiver_multi configuration" );
+        a_config.add( "time-length", scarab::param_value( a_node->get_time_length() ) );
+        a_config.add( "freq-length", scarab::param_value( a_node->get_freq_length() ) );
+        a_config.add( "udp-buffer-size", scarab::param_value( a_node->get_udp_buffer_size() ) );
+        a_config.add( "start-paused", scarab::param_value( a_node->get_start_paused() ) );
+        a_config.add( "force-time-first", scarab::param_value( a_node->get_force_time_first() ) );
+        a_config.add( "hand-off", scarab::param_value( a_node->get_hand_off() ) );
+        scarab::param_array t_digital_ids;
+        for( unsigned t_id : a_node->digital_ids() )
+        {
+            t_digital_ids.push_back( scarab::param_value( t_id ) );
+        }
+        a_config.add( "digital-ids", t_digital_ids );
+        if( ! a_node->if_ids().empty() )
+        {
+            scarab::param_array t_if_ids;
+            for( unsigned t_id : a_node->if_ids() )
+            {
+                t_if_ids.push_back( scarab::param_value( t_id ) );
+            }
+            a_config.add( "if-ids", t_if_ids );
+        }
+        return;
+    }
+
+    template< unsigned x_n_channels >
+    bool _tf_roach_receiver_multi_binding< x_n_channels >::do_run_command( _tf_roach_receiver_multi< x_n_channels >* a_node, const std::string& a_cmd, const scarab::param_node& ) const
+    {
+        if( a_cmd == "freq-only" )
+        {
+            a_node->switch_to_freq_only();
+            return true;
+        }
+        else if( a_cmd == "time-and-freq" )
+        {
+            a_node->switch_to_time_and_freq();
+            return true;
+        }
+        else
+        {
+            LWARN( plog, "Unrecognized command: <" << a_cmd << ">" );
+            return false;
+        }
+    }
+
+    template class _tf_roach_receiver_multi< 2 >;
+    template class _tf_roach_receiver_multi< 3 >;
+    template class _tf_roach_receiver_multi< 4 >;
+
+    template class _tf_roach_receiver_multi_binding< 2 >;
+    template class _tf_roach_receiver_multi_binding< 3 >;
+    template class _tf_roach_receiver_multi_binding< 4 >;
+
+} /* namespace psyllid */
@@ -0,0 +1,173 @@
+/*
+ * tf_roach_receiver_multi.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_TF_ROACH_RECEIVER_MULTI_HH_
+#define PSYLLID_TF_ROACH_RECEIVER_MULTI_HH_
+
+#include "freq_data.hh"
+#include "memory_block.hh"
+#include "node_builder.hh"
+#include "time_data.hh"
+
+#include "transformer.hh"
+
+#include <atomic>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace scarab
+{
+    class param_node;
+}
+
+namespace psyllid
+{
+    template< class x_indices >
+    struct tf_multi_type_list;
+
+    // even outputs are time data, odd outputs are frequency data
+    template< std::size_t... x_indices >
+    struct tf_multi_type_list< std::index_sequence< x_indices... > >
+    {
+        typedef midge::type_list< typename std::conditional< x_indices % 2 == 0, time_data, freq_data >::type... > type;
+    };
+
+    /*!
+     @class _tf_roach_receiver_multi
+     @author N. S. Oblath
+
+     @brief A transformer that receives raw ROACH packets for several digital channels, and distributes them as time and frequency data for each channel.
+
+     @details
+     This does the job of a tf_roach_receiver per channel (and of a packet_demux in front of them) in a single node, so a multi-channel
+     system has one decoding thread rather than one per channel, and the packets of all channels are handled in the order they arrived.
+
+     Each packet is assigned to a channel by its digital_id and, if "if-ids" is given, its if_id.  Channel i has its time data on output 2i
+     and its frequency data on output 2i+1.  Each channel has its own session packet counters, and "force-time-first" applies to each
+     channel separately.  Packets that match no channel are dropped and counted; the counts are logged when the node exits.
+
+     Packets are handed off to the outputs as in tf_roach_receiver (see unpack_roach_packet()).
+
+     The execution mode ("time-and-freq" or "freq-only") takes effect at the next resume; in frequency-only mode time packets are dropped
+     and the time-data outputs are not started.
+
+     Parameter setting is not thread-safe.  Executing is thread-safe.
+
+     Node types: "tf-roach-receiver-2", "tf-roach-receiver-3", "tf-roach-receiver-4", for 2, 3, or 4 channels
+
+     Available configuration values:
+     - "time-length": uint -- The size of each output time-data buffer
+     - "freq-length": uint -- The size of each output frequency-data buffer
+     - "udp-buffer-size": uint -- The expected number of bytes in a packet
+     - "start-paused": bool -- Whether to start execution paused and wait for an unpause command
+     - "force-time-first": bool -- If true, when starting ignore each channel's f packets before its first t packet
+     - "hand-off": bool -- If true (the default), output data take over the memory of the input blocks instead of copying the packets
+     - "digital-ids": array of uints -- Digital ID of each channel, in output order (e.g. [0, 1, 3]); one per channel
+     - "if-ids": array of uints -- (optional) IF ID of each channel; if given, a packet must match both IDs of a channel
+
+     Available DAQ commands:
+     - "freq-only" (no args) -- Switch the execution mode to frequency-only
+     - "time-and-freq" (no args) -- Switch the execution mode to time-and-frequency
+
+     Input Stream:
+     - 0: memory_block
+
+     Output Streams:
+     - 2i: time_data for channel i
+     - 2i+1: freq_data for channel i
+    */
+    template< unsigned x_n_channels >
+    class _tf_roach_receiver_multi :
+            public midge::_transformer< midge::type_list< memory_block >, typename tf_multi_type_list< std::make_index_sequence< 2 * x_n_channels > >::type >
+    {
+        public:
+            _tf_roach_receiver_multi();
+            virtual ~_tf_roach_receiver_multi();
+
+        public:
+            mv_accessible( uint64_t, time_length );
+            mv_accessible( uint64_t, freq_length );
+            mv_accessible( uint64_t, udp_buffer_size );
+            mv_accessible( bool, start_paused );
+            mv_accessible( bool, force_time_first );
+            mv_accessible( bool, hand_off );
+            mv_referrable( std::vector< unsigned >, digital_ids );
+            mv_referrable( std::vector< unsigned >, if_ids );
+
+        public:
+            void switch_to_freq_only();
+            void switch_to_time_and_freq();
+
+            virtual void initialize();
+            virtual void execute( midge::diptera* a_midge = nullptr );
+            virtual void finalize();
+
+        private:
+            /// Returns the channel of the packet, or -1 if it matches none
+            int find_channel( const raw_roach_packet* a_pkt ) const;
+
+            /// Handles pause/resume instructions
+            void check_instructions();
+
+            void resume();
+
+            template< std::size_t... x_indices >
+            void initialize_buffers( std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            void finalize_buffers( std::index_sequence< x_indices... > );
+
+            /// Sets the command on the time outputs (if a_time) and the frequency outputs (if a_freq); every output is set even if one fails
+            template< std::size_t... x_indices >
+            bool set_outputs( midge::enum_t a_command, bool a_time, bool a_freq, std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            void reset_session_counters( std::index_sequence< x_indices... > );
+
+            template< std::size_t... x_indices >
+            bool output( unsigned a_output, memory_block& a_block, std::index_sequence< x_indices... > );
+
+            template< std::size_t x_index >
+            bool output_to( memory_block& a_block );
+
+            std::atomic< bool > f_freq_only;
+            bool f_freq_only_this_run;
+            bool f_paused;
+
+            std::vector< uint64_t > f_session_pkt_counters; // per output
+            std::vector< bool > f_time_pkt_received;         // per channel
+            std::vector< uint64_t > f_packets_received;      // per channel
+            uint64_t f_packets_unrouted;
+            uint64_t f_packets_short;
+    };
+
+    typedef _tf_roach_receiver_multi< 2 > tf_roach_receiver_2;
+    typedef _tf_roach_receiver_multi< 3 > tf_roach_receiver_3;
+    typedef _tf_roach_receiver_multi< 4 > tf_roach_receiver_4;
+
+    template< unsigned x_n_channels >
+    class _tf_roach_receiver_multi_binding : public sandfly::_node_binding< _tf_roach_receiver_multi< x_n_channels >, _tf_roach_receiver_multi_binding< x_n_channels > >
+    {
+        public:
+            _tf_roach_receiver_multi_binding();
+            virtual ~_tf_roach_receiver_multi_binding();
+
+        private:
+            virtual void do_apply_config( _tf_roach_receiver_multi< x_n_channels >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _tf_roach_receiver_multi< x_n_channels >* a_node, scarab::param_node& a_config ) const;
+
+            virtual bool do_run_command( _tf_roach_receiver_multi< x_n_channels >* a_node, const std::string& a_cmd, const scarab::param_node& ) const;
+    };
+
+    typedef _tf_roach_receiver_multi_binding< 2 > tf_roach_receiver_2_binding;
+    typedef _tf_roach_receiver_multi_binding< 3 > tf_roach_receiver_3_binding;
+    typedef _tf_roach_receiver_multi_binding< 4 > tf_roach_receiver_4_binding;
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_TF_ROACH_RECEIVER_MULTI_HH_ */
@@ -24,10 +24,12 @@ using std::vector;
 namespace psyllid
 {
     REGISTER_NODE_AND_BUILDER( triggered_writer, "triggered-writer", triggered_writer_binding );
+    REGISTER_NODE_AND_BUILDER( triggered_batch_writer, "triggered-batch-writer", triggered_batch_writer_binding );
 
     LOGGER( plog, "triggered_writer" );
 
-    triggered_writer::triggered_writer() :
+    template< class x_time_type, class x_trig_type >
+    _triggered_writer< x_time_type, x_trig_type >::_triggered_writer() :
             egg_writer(),
             f_file_num( 0 ),
             f_bit_depth( 8 ),
@@ -39,16 +41,19 @@ namespace psyllid
             f_v_range( 0.5 ),
             f_center_freq( 50.e6 ),
             f_freq_range( 100.e6 ),
+            f_rx_record_time( false ),
             f_monarch_ptr(),
             f_stream_no( 0 )
     {
     }
 
-    triggered_writer::~triggered_writer()
+    template< class x_time_type, class x_trig_type >
+    _triggered_writer< x_time_type, x_trig_type >::~_triggered_writer()
     {
     }
 
-    void triggered_writer::prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr )
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer< x_time_type, x_trig_type >::prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr )
     {
         f_monarch_ptr = a_mw_ptr;
 
@@ -75,13 +80,15 @@ namespace psyllid
         return;
     }
 
-    void triggered_writer::initialize()
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer< x_time_type, x_trig_type >::initialize()
     {
         butterfly_house::get_instance()->register_writer( this, f_file_num );
         return;
     }
 
-    void triggered_writer::execute( midge::diptera* a_midge )
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer< x_time_type, x_trig_type >::execute( midge::diptera* a_midge )
     {
         try
         {
@@ -92,10 +99,11 @@ namespace psyllid
             t_ctx.f_stream_no = 0;
             t_ctx.f_start_file_with_next_data = false;
             t_ctx.f_first_pkt_in_run = 0;
+            t_ctx.f_first_rx_timestamp_ns = 0;
             t_ctx.f_is_new_event = true;
 
             // outer while loop to switch between the two exe loops until canceled
-            while( ! is_canceled() && ! t_ctx.f_should_exit )
+            while( ! this->is_canceled() && ! t_ctx.f_should_exit )
             {
                 if( t_ctx.f_is_running )
                 {
@@ -116,16 +124,17 @@ namespace psyllid
         }
     }
 
-    void triggered_writer::exe_loop_not_running( exe_loop_context& a_ctx )
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer< x_time_type, x_trig_type >::exe_loop_not_running( exe_loop_context& a_ctx )
     {
         midge::enum_t t_trig_command = stream::s_none;
         midge::enum_t t_time_command = stream::s_none;
 
         //time_data* t_time_data = nullptr;
 
-        while( ! is_canceled() )
+        while( ! this->is_canceled() )
         {
-            t_time_command = in_stream< 0 >().get();
+            t_time_command = a_ctx.f_time_reader.next( this->template in_stream< 0 >() );
             if( t_time_command == stream::s_none ) continue;
             if( t_time_command == stream::s_error )
             {
@@ -133,7 +142,7 @@ namespace psyllid
                 break;
             }
 
-            LTRACE( plog, "Triggered writer reading stream 0 (time) at index " << in_stream< 0 >().get_current_index() );
+            LTRACE( plog, "Triggered writer reading stream 0 (time) at index " << this->template in_stream< 0 >().get_current_index() );
 
             if( t_time_command == stream::s_exit )
             {
@@ -159,13 +168,13 @@ namespace psyllid
                 LDEBUG( plog, "Triggered writer received start command on the time stream; looking for start command on the trigger stream" );
 
                 // do this in a while loop so we don't re-do the time stream get()
-                while( ! is_canceled() )
+                while( ! this->is_canceled() )
                 {
                     t_trig_command = stream::s_none;
                     for( unsigned i_attempt = 0; i_attempt < 10 && t_trig_command != stream::s_start; ++i_attempt )
                     {
-                        t_trig_command = in_stream< 1 >().get();
-                        LTRACE( plog, "(attempt " << i_attempt << ") Triggered writer reading stream 1 (trig) at index " << in_stream< 1 >().get_current_index() );
+                        t_trig_command = a_ctx.f_trig_reader.next( this->template in_stream< 1 >() );
+                        LTRACE( plog, "(attempt " << i_attempt << ") Triggered writer reading stream 1 (trig) at index " << this->template in_stream< 1 >().get_current_index() );
                     }
 
                     if( t_trig_command == stream::s_start )
@@ -202,7 +211,8 @@ namespace psyllid
         return;
     }
 
-    void triggered_writer::exe_loop_is_running( exe_loop_context& a_ctx )
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer< x_time_type, x_trig_type >::exe_loop_is_running( exe_loop_context& a_ctx )
     {
         midge::enum_t t_trig_command = stream::s_none;
         midge::enum_t t_time_command = stream::s_none;
@@ -213,16 +223,18 @@ namespace psyllid
         uint64_t t_bytes_per_record = f_record_size * f_sample_size * f_data_type_size;
         uint64_t t_record_length_nsec = llrint( (double)(PAYLOAD_SIZE / 2) / (double)f_acq_rate * 1.e3 );
 
-        while( ! is_canceled() )
+        while( ! this->is_canceled() )
         {
-            t_trig_command = in_stream< 1 >().get();
-            LTRACE( plog, "Egg writer reading stream 1 (trig) at index " << in_stream< 1 >().get_current_index() );
+            t_trig_command = a_ctx.f_trig_reader.next( this->template in_stream< 1 >() );
+            LTRACE( plog, "Egg writer reading stream 1 (trig) at index " << this->template in_stream< 1 >().get_current_index() );
 
             if( t_trig_command == stream::s_none )
             {
                 LDEBUG( plog, "Egg writer received none command on the trig stream while run is in progress");
-                t_time_command = in_stream< 0 >().get();
-                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << in_stream< 0 >().get_current_index() );
+                // batches on the two streams don't line up, so there's no time slot to match a none on the trig stream
+                if( _slot_traits< x_trig_type >::s_is_batch ) continue;
+                t_time_command = a_ctx.f_time_reader.next( this->template in_stream< 0 >() );
+                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << this->template in_stream< 0 >().get_current_index() );
                 LDEBUG( plog, "Advancing time stream; time command matched trig command? trig command = " << t_trig_command << "; time command = " << t_time_command );
                 if( t_time_command != stream::s_none )
                 {
@@ -262,8 +274,8 @@ namespace psyllid
                     f_monarch_ptr->finish_stream( a_ctx.f_stream_no );
                     a_ctx.f_swrap_ptr.reset();
                 }
-                t_time_command = in_stream< 0 >().get();
-                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << in_stream< 0 >().get_current_index() );
+                t_time_command = a_ctx.f_time_reader.next( this->template in_stream< 0 >() );
+                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << this->template in_stream< 0 >().get_current_index() );
                 LDEBUG( plog, "Advancing time stream; time command matched trig command? trig command = " << t_trig_command << "; time command = " << t_time_command );
                 LDEBUG( plog, "Breaking out of is-running exe loop" );
                 a_ctx.f_is_running = false;
@@ -278,16 +290,16 @@ namespace psyllid
                     f_monarch_ptr->finish_stream( a_ctx.f_stream_no );
                     a_ctx.f_swrap_ptr.reset();
                 }
-                t_time_command = in_stream< 0 >().get();
-                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << in_stream< 0 >().get_current_index() );
+                t_time_command = a_ctx.f_time_reader.next( this->template in_stream< 0 >() );
+                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << this->template in_stream< 0 >().get_current_index() );
                 LDEBUG( plog, "Advancing time stream; time command matched trig command? trig command = " << t_trig_command << "; time command = " << t_time_command );
                 throw midge::node_nonfatal_error() << "Egg writer received unexpected start command on the trig stream while running";
             }
 
             if( t_trig_command == stream::s_run )
             {
-                t_time_command = in_stream< 0 >().get();
-                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << in_stream< 0 >().get_current_index() );
+                t_time_command = a_ctx.f_time_reader.next( this->template in_stream< 0 >() );
+                LTRACE( plog, "Egg writer reading stream 0 (time) at index " << this->template in_stream< 0 >().get_current_index() );
                 LTRACE( plog, "Advancing time stream; time command matched trig command? trig command = " << t_trig_command << "; time command = " << t_time_command );
                 if( t_time_command != stream::s_run )
                 {
@@ -298,7 +310,7 @@ namespace psyllid
                     }
                     if (t_time_command == stream::s_stop)
                     {
-                        t_trig_command = in_stream< 1 >().get();
+                        t_trig_command = a_ctx.f_trig_reader.next( this->template in_stream< 1 >() );
                         LDEBUG( plog, "Egg writer received stop command on the time stream while run in progress.");
                         LDEBUG( plog, "Advancing trig stream; time command matched trig command? trig command = " << t_trig_command << "; time command = " << t_time_command );
                         LDEBUG( plog, "Breaking out of is-running exe loop" );
@@ -313,14 +325,19 @@ namespace psyllid
 
                 // everything agrees that we're running
 
-                t_time_data = in_stream< 0 >().data();
-                t_trig_data = in_stream< 1 >().data();
+                t_time_data = &a_ctx.f_time_reader.packet();
+                t_trig_data = &a_ctx.f_trig_reader.packet();
 
                 if( a_ctx.f_start_file_with_next_data )
                 {
                     LDEBUG( plog, "Handling first packet in run" );
 
                     a_ctx.f_first_pkt_in_run = t_time_data->get_pkt_in_session();
+                    a_ctx.f_first_rx_timestamp_ns = t_time_data->get_rx_timestamp_ns();
+                    if( f_rx_record_time && a_ctx.f_first_rx_timestamp_ns == 0 )
+                    {
+                        LWARN( plog, "Record times from receive timestamps were requested, but the first packet has no timestamp; record times will be calculated from the packet count" );
+                    }
 
                     a_ctx.f_is_new_event = true;
 
@@ -346,15 +363,15 @@ namespace psyllid
                     while( t_time_id < t_trig_id )
                     {
                         LDEBUG( plog, "Moving time stream forward" );
-                        t_time_command = in_stream< 0 >().get();
-                        t_time_data = in_stream< 0 >().data();
+                        t_time_command = a_ctx.f_time_reader.next( this->template in_stream< 0 >() );
+                        t_time_data = this->template in_stream< 0 >().data();
                         t_time_id = t_time_data->get_pkt_in_session();
                     }
                     while( t_time_id > t_trig_id )
                     {
                         LTRACE( plog, "Moving trig stream forward" );
-                        t_trig_command = in_stream< 1 >().get();
-                        t_trig_data = in_stream< 1 >().data();
+                        t_trig_command = a_ctx.f_trig_reader.next( this->template in_stream< 1 >() );
+                        t_trig_data = this->template in_stream< 1 >().data();
                         t_trig_id = t_trig_data->get_id();
                     }
                     if( t_time_id != t_trig_id )
@@ -374,7 +391,13 @@ namespace psyllid
                     {
                         LDEBUG( plog, "New event" );
                     }
-                    if( ! a_ctx.f_swrap_ptr->write_record( t_time_id, t_record_length_nsec * ( t_time_id - a_ctx.f_first_pkt_in_run ), t_time_data->get_raw_array(), t_bytes_per_record, a_ctx.f_is_new_event ) )
+                    uint64_t t_record_time = t_record_length_nsec * ( t_time_id - a_ctx.f_first_pkt_in_run );
+                    if( f_rx_record_time && a_ctx.f_first_rx_timestamp_ns != 0 && t_time_data->get_rx_timestamp_ns() >= a_ctx.f_first_rx_timestamp_ns )
+                    {
+                        t_record_time = t_time_data->get_rx_timestamp_ns() - a_ctx.f_first_rx_timestamp_ns;
+                    }
+
+                    if( ! a_ctx.f_swrap_ptr->write_record( t_time_id, t_record_time, t_time_data->get_raw_array(), t_bytes_per_record, a_ctx.f_is_new_event ) )
                     {
                         throw midge::node_nonfatal_error() << "Unable to write record to file; record ID: " << t_time_id;
                     }
@@ -404,23 +427,27 @@ namespace psyllid
         return;
     }
 
-    void triggered_writer::finalize()
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer< x_time_type, x_trig_type >::finalize()
     {
         butterfly_house::get_instance()->unregister_writer( this );
         return;
     }
 
 
-    triggered_writer_binding::triggered_writer_binding() :
-            sandfly::_node_binding< triggered_writer, triggered_writer_binding >()
+    template< class x_time_type, class x_trig_type >
+    _triggered_writer_binding< x_time_type, x_trig_type >::_triggered_writer_binding() :
+            sandfly::_node_binding< _triggered_writer< x_time_type, x_trig_type >, _triggered_writer_binding< x_time_type, x_trig_type > >()
     {
     }
 
-    triggered_writer_binding::~triggered_writer_binding()
+    template< class x_time_type, class x_trig_type >
+    _triggered_writer_binding< x_time_type, x_trig_type >::~_triggered_writer_binding()
     {
     }
 
-    void triggered_writer_binding::do_apply_config( triggered_writer* a_node, const scarab::param_node& a_config ) const
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer_binding< x_time_type, x_trig_type >::do_apply_config( _triggered_writer< x_time_type, x_trig_type >* a_node, const scarab::param_node& a_config ) const
     {
         LDEBUG( plog, "Configuring triggered_writer with:\n" << a_config );
         a_node->set_file_num( a_config.get_value( "file-num", a_node->get_file_num() ) );
@@ -437,10 +464,12 @@ namespace psyllid
         }
         a_node->set_center_freq( a_config.get_value( "center-freq", a_node->get_center_freq() ) );
         a_node->set_freq_range( a_config.get_value( "freq-range", a_node->get_freq_range() ) );
+        a_node->set_rx_record_time( a_config.get_value( "rx-record-time", a_node->get_rx_record_time() ) );
         return;
     }
 
-    void triggered_writer_binding::do_dump_config( const triggered_writer* a_node, scarab::param_node& a_config ) const
+    template< class x_time_type, class x_trig_type >
+    void _triggered_writer_binding< x_time_type, x_trig_type >::do_dump_config( const _triggered_writer< x_time_type, x_trig_type >* a_node, scarab::param_node& a_config ) const
     {
         LDEBUG( plog, "Dumping configuration for triggered_writer" );
         a_config.add( "file-num", a_node->get_file_num() );
@@ -455,7 +484,14 @@ namespace psyllid
         a_config.add( "device", t_dev_node );
         a_config.add( "center-freq", a_node->get_center_freq() );
         a_config.add( "freq-range", a_node->get_freq_range() );
+        a_config.add( "rx-record-time", a_node->get_rx_record_time() );
         return;
     }
 
+    template class _triggered_writer< time_data, trigger_flag >;
+    template class _triggered_writer< time_data_batch, trigger_flag_batch >;
+
+    template class _triggered_writer_binding< time_data, trigger_flag >;
+    template class _triggered_writer_binding< time_data_batch, trigger_flag_batch >;
+
 } /* namespace psyllid */
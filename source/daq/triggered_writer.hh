@@ -10,6 +10,8 @@
 
 #include "egg_writer.hh"
 #include "node_builder.hh"
+#include "packet_batch.hh"
+#include "packet_unbatch.hh"
 #include "trigger_flag.hh"
 #include "time_data.hh"
 
@@ -19,16 +21,19 @@ namespace psyllid
 {
 
     /*!
-     @class triggered_writer
+     @class _triggered_writer
      @author N. S. Oblath
 
      @brief A consumer to that writes triggered time ROACH packets to an egg file.
 
      @details
+     The writer takes either single packets and flags (triggered_writer) or batches of them (triggered_batch_writer, for use with
+     tf_roach_batch_receiver and event_batch_builder).  The two streams are matched packet by packet, so the time and trigger
+     batches don't have to line up with each other.
 
      Parameter setting is not thread-safe.  Executing is thread-safe.
 
-     Node type: "triggered-writer"
+     Node types: "triggered-writer" (single packets), "triggered-batch-writer" (batches)
 
      Available configuration values:
      - "device": node -- digitizer parameters
@@ -41,23 +46,26 @@ namespace psyllid
        - "v-range": double -- voltage range for ADC calibration
      - "center-freq": double -- the center frequency of the data being digitized in Hz
      - "freq-range": double -- the frequency window (bandwidth) of the data being digitized in Hz
+     - "rx-record-time": bool -- if true, the record time is the kernel receive time of the packet relative to the first packet in the file;
+                                 otherwise (default) it's calculated from the packet count.  Requires a packet receiver that records receive timestamps.
 
      ADC calibration: analog (V) = digital * gain + v-offset
                       gain = v-range / # of digital levels
 
      Input Stream:
-     - 0: time_data
-     - 1: trigger_flag
+     - 0: time_data or time_data_batch
+     - 1: trigger_flag or trigger_flag_batch
 
      Output Streams: (none)
     */
-    class triggered_writer :
-            public midge::_consumer< midge::type_list< time_data, trigger_flag > >,
+    template< class x_time_type, class x_trig_type >
+    class _triggered_writer :
+            public midge::_consumer< midge::type_list< x_time_type, x_trig_type > >,
             public egg_writer
     {
         public:
-            triggered_writer();
-            virtual ~triggered_writer();
+            _triggered_writer();
+            virtual ~_triggered_writer();
 
         public:
             mv_accessible( unsigned, file_num );
@@ -72,6 +80,8 @@ namespace psyllid
             mv_accessible( double, center_freq ); // Hz
             mv_accessible( double, freq_range ); // Hz
 
+            mv_accessible( bool, rx_record_time );
+
         public:
             virtual void prepare_to_write( monarch_wrap_ptr a_mw_ptr, header_wrap_ptr a_hw_ptr );
 
@@ -89,7 +99,10 @@ namespace psyllid
                 unsigned f_stream_no;
                 bool f_start_file_with_next_data;
                 uint64_t f_first_pkt_in_run;
+                uint64_t f_first_rx_timestamp_ns;
                 bool f_is_new_event;
+                _packet_reader< x_time_type > f_time_reader;
+                _packet_reader< x_trig_type > f_trig_reader;
             };
 
             void exe_loop_not_running( exe_loop_context& a_ctx );
@@ -99,18 +112,26 @@ namespace psyllid
             unsigned f_stream_no;
     };
 
+    typedef _triggered_writer< time_data, trigger_flag > triggered_writer;
+    typedef _triggered_writer< time_data_batch, trigger_flag_batch > triggered_batch_writer;
+
 
-    class triggered_writer_binding : public sandfly::_node_binding< triggered_writer, triggered_writer_binding >
+    template< class x_time_type, class x_trig_type >
+    class _triggered_writer_binding :
+            public sandfly::_node_binding< _triggered_writer< x_time_type, x_trig_type >, _triggered_writer_binding< x_time_type, x_trig_type > >
     {
         public:
-            triggered_writer_binding();
-            virtual ~triggered_writer_binding();
+            _triggered_writer_binding();
+            virtual ~_triggered_writer_binding();
 
         private:
-            virtual void do_apply_config( triggered_writer* a_node, const scarab::param_node& a_config ) const;
-            virtual void do_dump_config( const triggered_writer* a_node, scarab::param_node& a_config ) const;
+            virtual void do_apply_config( _triggered_writer< x_time_type, x_trig_type >* a_node, const scarab::param_node& a_config ) const;
+            virtual void do_dump_config( const _triggered_writer< x_time_type, x_trig_type >* a_node, scarab::param_node& a_config ) const;
     };
 
+    typedef _triggered_writer_binding< time_data, trigger_flag > triggered_writer_binding;
+    typedef _triggered_writer_binding< time_data_batch, trigger_flag_batch > triggered_batch_writer_binding;
+
 } /* namespace psyllid */
 
 #endif /* PSYLLID_TRIGGERED_WRITER_HH_ */
@@ -0,0 +1,150 @@
+/*
+ * block_pool.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "block_pool.hh"
+
+#include "psyllid_error.hh"
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace psyllid
+{
+
+    block_pool* block_pool::get_pool( size_t a_n_bytes )
+    {
+        // the registry and its pools are deliberately never destroyed, so blocks that outlive static destruction can still release their memory
+        static std::mutex* s_registry_mutex = new std::mutex();
+        static std::map< size_t, block_pool* >* s_registry = new std::map< size_t, block_pool* >();
+
+        size_t t_chunk_size = chunk_size_for( a_n_bytes );
+        std::unique_lock< std::mutex > t_lock( *s_registry_mutex );
+        block_pool*& t_pool = (*s_registry)[ t_chunk_size ];
+        if( t_pool == nullptr ) t_pool = new block_pool( t_chunk_size );
+        return t_pool;
+    }
+
+    block_pool::block_pool( size_t a_chunk_size ) :
+            f_chunk_size( a_chunk_size ),
+            f_slab_size( ( a_chunk_size + s_slab_alignment - 1 ) / s_slab_alignment * s_slab_alignment ),
+            f_chunks_per_slab( f_slab_size / a_chunk_size ),
+            f_n_chunks( 0 ),
+            f_free(),
+            f_slab_nodes(),
+            f_mutex()
+    {
+    }
+
+    unsigned block_pool::current_node()
+    {
+#if defined(__linux__) && defined(SYS_getcpu)
+        unsigned t_cpu = 0, t_node = 0;
+        if( ::syscall( SYS_getcpu, &t_cpu, &t_node, nullptr ) == 0 ) return t_node;
+#endif
+        return 0;
+    }
+
+    uint8_t* block_pool::allocate()
+    {
+        unsigned t_node = current_node();
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        if( t_node >= f_free.size() ) f_free.resize( t_node + 1 );
+        if( f_free[ t_node ].empty() ) add_slab( t_node );
+        uint8_t* t_chunk = f_free[ t_node ].back();
+        f_free[ t_node ].pop_back();
+        return t_chunk;
+    }
+
+    void block_pool::release( uint8_t* a_chunk )
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        // the last slab starting at or before the chunk is the one it's in
+        std::map< const uint8_t*, unsigned >::const_iterator t_slab = f_slab_nodes.upper_bound( a_chunk );
+        if( t_slab == f_slab_nodes.begin() )
+        {
+            throw error() << "[block_pool] Released a chunk that's not from this pool";
+        }
+        --t_slab;
+        f_free[ t_slab->second ].push_back( a_chunk );
+        return;
+    }
+
+    size_t block_pool::get_n_chunks() const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        return f_n_chunks;
+    }
+
+    size_t block_pool::get_n_free() const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        size_t t_n_free = 0;
+        for( const std::vector< uint8_t* >& t_free : f_free ) t_n_free += t_free.size();
+        return t_n_free;
+    }
+
+    size_t block_pool::get_n_free( unsigned a_node ) const
+    {
+        std::unique_lock< std::mutex > t_lock( f_mutex );
+        return a_node < f_free.size() ? f_free[ a_node ].size() : 0;
+    }
+
+    void block_pool::add_slab( unsigned a_node )
+    {
+        // over-map by one alignment unit, then trim the ends so the slab starts on a huge-page boundary
+        size_t t_map_size = f_slab_size + s_slab_alignment;
+        void* t_map = ::mmap( nullptr, t_map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+        if( t_map == MAP_FAILED )
+        {
+            throw error() << "[block_pool] Unable to map a slab of " << f_slab_size << " bytes: " << strerror( errno );
+        }
+
+        uintptr_t t_map_begin = reinterpret_cast< uintptr_t >( t_map );
+        uintptr_t t_slab_begin = ( t_map_begin + s_slab_alignment - 1 ) / s_slab_alignment * s_slab_alignment;
+        uintptr_t t_slab_end = t_slab_begin + f_slab_size;
+        if( t_slab_begin != t_map_begin ) ::munmap( t_map, t_slab_begin - t_map_begin );
+        if( t_slab_end != t_map_begin + t_map_size ) ::munmap( reinterpret_cast< void* >( t_slab_end ), t_map_begin + t_map_size - t_slab_end );
+
+        uint8_t* t_slab = reinterpret_cast< uint8_t* >( t_slab_begin );
+#ifdef MADV_HUGEPAGE
+        // advisory only: without transparent huge pages the slab is simply backed by normal pages
+        ::madvise( t_slab, f_slab_size, MADV_HUGEPAGE );
+#endif
+#if defined(__linux__) && defined(SYS_mbind)
+        // also advisory: fails without NUMA support, in which case the pages are placed on first touch
+        if( a_node < 8 * sizeof(unsigned long) )
+        {
+            unsigned long t_node_mask = 1UL << a_node;
+            ::syscall( SYS_mbind, t_slab, f_slab_size, MPOL_PREFERRED, &t_node_mask, 8 * sizeof(unsigned long), 0 );
+        }
+#endif
+        f_slab_nodes[ t_slab ] = a_node;
+
+        // hand out the lowest addresses first
+        std::vector< uint8_t* >& t_free = f_free[ a_node ];
+        t_free.reserve( t_free.size() + f_chunks_per_slab );
+        for( size_t i_chunk = f_chunks_per_slab; i_chunk > 0; --i_chunk )
+        {
+            t_free.push_back( t_slab + ( i_chunk - 1 ) * f_chunk_size );
+        }
+        f_n_chunks += f_chunks_per_slab;
+        return;
+    }
+
+} /* namespace psyllid */
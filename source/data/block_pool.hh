@@ -0,0 +1,103 @@
+/*
+ * block_pool.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef DATA_BLOCK_POOL_HH_
+#define DATA_BLOCK_POOL_HH_
+
+#include <cstdint>
+#include <cstddef> // for size_t
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace psyllid
+{
+
+    /*!
+     @class block_pool
+     @author N. S. Oblath
+
+     @brief A slab allocator for the memory of memory_blocks
+
+     @details
+     Each pool hands out chunks of a single size, carved from slabs of (at least) 2 MiB that are mapped aligned to 2 MiB.
+     Where transparent huge pages are available the slabs are marked for them, so a stream buffer full of packets is covered
+     by a few TLB entries instead of one per 4 kB page.  Chunks are aligned to, and sized in multiples of, the cache-line size,
+     so a packet of 8224 bytes takes 8256 bytes rather than the next page or power of two.
+
+     NUMA placement:
+     Each slab belongs to the NUMA node of the thread that needed it (found with getcpu), and on Linux its pages are bound to that
+     node with a preferred-node policy (mbind), so they're placed there whichever thread first touches them.  The pool keeps one
+     free list per node: allocate() takes a chunk from the calling thread's node, and release() puts a chunk back on the list of
+     the node its slab belongs to, whichever thread releases it.  So a chunk that's allocated is always local to the allocating
+     thread, even after it's been used elsewhere.  Memory that's exchanged rather than allocated (memory_block::swap(), e.g. the
+     packet hand-off in tf_roach_receiver) stays on its original node: it's shared by the threads on both sides of the hand-off.
+     Without NUMA support (or on a single node) everything is on node 0.
+
+     Released chunks go back on a free list for reuse; slabs are never unmapped.  The pools are process-wide (one per
+     chunk size, see get_pool()) and live until the process exits.
+
+     Allocating and releasing are thread-safe.
+    */
+    class block_pool
+    {
+        public:
+            /// Returns the process-wide pool whose chunks fit a_n_bytes (a_n_bytes must be non-zero)
+            static block_pool* get_pool( size_t a_n_bytes );
+
+            /// The chunk size used for blocks of a_n_bytes
+            static size_t chunk_size_for( size_t a_n_bytes );
+
+            static const size_t s_chunk_alignment = 64;
+            static const size_t s_slab_alignment = 2097152; // 2 MiB: the x86-64 huge page size
+
+        public:
+            /// Returns a chunk of get_chunk_size() bytes; throws psyllid::error if the memory can't be mapped
+            uint8_t* allocate();
+
+            /// Returns a chunk from allocate() to the pool
+            void release( uint8_t* a_chunk );
+
+            size_t get_chunk_size() const;
+            size_t get_n_chunks() const;
+            size_t get_n_free() const;
+            /// Free chunks on a_node's list
+            size_t get_n_free( unsigned a_node ) const;
+
+            /// The NUMA node of the CPU the calling thread is running on; 0 if that's unknown
+            static unsigned current_node();
+
+        private:
+            block_pool( size_t a_chunk_size );
+            block_pool( const block_pool& ) = delete;
+            block_pool& operator=( const block_pool& ) = delete;
+            ~block_pool() = delete;
+
+            void add_slab( unsigned a_node ); // call with f_mutex locked
+
+            size_t f_chunk_size;
+            size_t f_slab_size;
+            size_t f_chunks_per_slab;
+            size_t f_n_chunks;
+            std::vector< std::vector< uint8_t* > > f_free; // one free list per NUMA node
+            std::map< const uint8_t*, unsigned > f_slab_nodes; // start of each slab -> its node
+            mutable std::mutex f_mutex;
+    };
+
+    inline size_t block_pool::chunk_size_for( size_t a_n_bytes )
+    {
+        return ( a_n_bytes + s_chunk_alignment - 1 ) / s_chunk_alignment * s_chunk_alignment;
+    }
+
+    inline size_t block_pool::get_chunk_size() const
+    {
+        return f_chunk_size;
+    }
+
+} /* namespace psyllid */
+
+#endif /* DATA_BLOCK_POOL_HH_ */
@@ -13,7 +13,6 @@ namespace psyllid
     freq_data::freq_data() :
             roach_packet_data(),
             f_pkt_in_session( 0 ),
-            f_array( reinterpret_cast< iq_t* >( f_packet.f_data ) ),
             f_array_size( PAYLOAD_SIZE / 2 )
     {
     }
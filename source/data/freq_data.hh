@@ -32,18 +32,17 @@ namespace psyllid
             mv_accessible( uint64_t, pkt_in_session );
 
         private:
-            iq_t* f_array;
             size_t f_array_size;
     };
 
     inline const freq_data::iq_t* freq_data::get_array() const
     {
-        return f_array;
+        return reinterpret_cast< const iq_t* >( f_packet->f_data );
     }
 
     inline freq_data::iq_t* freq_data::get_array()
     {
-        return f_array;
+        return reinterpret_cast< iq_t* >( f_packet->f_data );
     }
 
     inline size_t freq_data::get_array_size() const
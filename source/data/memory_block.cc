@@ -7,7 +7,9 @@
 
 #include "memory_block.hh"
 
-#include <cstdlib>
+#include "block_pool.hh"
+
+#include <utility>
 
 namespace psyllid
 {
@@ -15,23 +17,85 @@ namespace psyllid
     memory_block::memory_block() :
             f_n_bytes( 0 ),
             f_n_bytes_used( 0 ),
-            f_block( nullptr )
+            f_rx_timestamp_ns( 0 ),
+            f_source_address( 0 ),
+            f_dest_port( 0 ),
+            f_block( nullptr ),
+            f_pool( nullptr ),
+            f_view_owner()
     {
     }
 
     memory_block::~memory_block()
     {
-        if( f_n_bytes != 0 ) free( (void*)f_block );
+        if( is_view() ) return;
+        release_memory();
     }
 
     void memory_block::resize( size_t a_n_bytes )
     {
+        if( is_view() ) release_view();
         if( a_n_bytes == f_n_bytes ) return;
-        if( f_n_bytes != 0 ) ::free( (void*)f_block );
-        if( a_n_bytes != 0 ) f_block = (uint8_t*)::malloc( a_n_bytes );
-        else f_block = nullptr;
+        if( f_pool != nullptr && a_n_bytes != 0 && a_n_bytes <= f_pool->get_chunk_size() )
+        {
+            // the current chunk already fits, so packets of varying size don't churn the pools
+            f_n_bytes = a_n_bytes;
+            return;
+        }
+        release_memory();
+        if( a_n_bytes != 0 )
+        {
+            f_pool = block_pool::get_pool( a_n_bytes );
+            f_block = f_pool->allocate();
+        }
         f_n_bytes = a_n_bytes;
         return;
     }
 
+    size_t memory_block::get_capacity() const
+    {
+        return f_pool != nullptr ? f_pool->get_chunk_size() : f_n_bytes;
+    }
+
+    void memory_block::set_view( uint8_t* a_view, size_t a_n_bytes, std::shared_ptr< void > a_owner )
+    {
+        if( ! is_view() ) release_memory();
+        f_block = a_view;
+        f_n_bytes = a_n_bytes;
+        f_n_bytes_used = a_n_bytes;
+        f_view_owner = std::move( a_owner );
+        return;
+    }
+
+    void memory_block::swap( memory_block& a_other )
+    {
+        std::swap( f_block, a_other.f_block );
+        std::swap( f_pool, a_other.f_pool );
+        std::swap( f_n_bytes, a_other.f_n_bytes );
+        std::swap( f_n_bytes_used, a_other.f_n_bytes_used );
+        std::swap( f_rx_timestamp_ns, a_other.f_rx_timestamp_ns );
+        std::swap( f_source_address, a_other.f_source_address );
+        std::swap( f_dest_port, a_other.f_dest_port );
+        f_view_owner.swap( a_other.f_view_owner );
+        return;
+    }
+
+    void memory_block::release_view()
+    {
+        if( ! is_view() ) return;
+        f_view_owner.reset();
+        f_block = nullptr;
+        f_n_bytes = 0;
+        f_n_bytes_used = 0;
+        return;
+    }
+
+    void memory_block::release_memory()
+    {
+        if( f_pool != nullptr ) f_pool->release( f_block );
+        f_pool = nullptr;
+        f_block = nullptr;
+        return;
+    }
+
 } /* namespace psyllid */
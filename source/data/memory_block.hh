@@ -9,13 +9,33 @@
 #define DATA_MEMORY_BLOCK_HH_
 
 #include "member_variables.hh"
+#include "rx_timestamp.hh"
 
 #include <cstdint>
 #include <cstddef> // for size_t
+#include <memory>
 
 namespace psyllid
 {
+    class block_pool;
 
+    /*!
+     @class memory_block
+     @author N. S. Oblath
+
+     @brief A block of raw memory, either owned by the block or viewed from elsewhere
+
+     @details
+     By default the block owns its memory, which is allocated with resize() from the process-wide block_pool for its size.
+     Resizing to any size that fits in the current chunk (see get_capacity()) keeps the memory, and swap() exchanges the memory
+     along with the pool it came from, so once every block in a chain has its memory there's no further allocation, even if
+     the packet size varies.
+
+     With set_view() the block instead points at memory owned by someone else (e.g. a frame in a
+     packet mmap ring).  The owner shared pointer is held until the view is replaced, the block is
+     resized, or the block is destroyed; whatever the owner's deleter does (e.g. return a ring block to
+     the kernel) therefore happens only once no memory_block refers to it anymore.
+    */
     class memory_block
     {
         public:
@@ -24,16 +44,45 @@ namespace psyllid
 
         public:
             void resize( size_t a_n_bytes );
+            /// Size of the memory held: the pool chunk size for owned memory (at least get_n_bytes()), or get_n_bytes() for a view
+            size_t get_capacity() const;
+            void set_view( uint8_t* a_view, size_t a_n_bytes, std::shared_ptr< void > a_owner );
+            void release_view();
+            bool is_view() const;
+
+            /// Exchanges the memory (owned or viewed) and sizes of two blocks without copying
+            void swap( memory_block& a_other );
+
             uint8_t* block();
             const uint8_t* block() const;
 
             mv_accessible( size_t, n_bytes );
             mv_accessible( size_t, n_bytes_used );
+            mv_accessible( uint64_t, rx_timestamp_ns ); /// Time the packet was received by the kernel, in ns since the epoch (see rx_timestamp.hh); 0 if unknown
+            mv_accessible( uint32_t, source_address );  /// IPv4 source address of the packet, in network byte order; 0 if unknown
+            mv_accessible( uint16_t, dest_port );       /// UDP destination port of the packet; 0 if unknown
+
+            /// Time since the packet was received by the kernel, in ns; 0 if the receive time is unknown
+            uint64_t get_rx_age_ns() const;
 
         private:
+            void release_memory();
+
             uint8_t* f_block;
+            block_pool* f_pool; // pool of the owned memory; nullptr if nothing is owned
+            std::shared_ptr< void > f_view_owner;
     };
 
+    inline bool memory_block::is_view() const
+    {
+        return static_cast< bool >( f_view_owner );
+    }
+
+    inline uint64_t memory_block::get_rx_age_ns() const
+    {
+        return rx_age_ns( f_rx_timestamp_ns );
+    }
+
     inline uint8_t* memory_block::block()
     {
         return f_block;
@@ -0,0 +1,37 @@
+/*
+ * packet_batch.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "packet_batch.hh"
+
+namespace psyllid
+{
+
+    template< class x_data_type >
+    _packet_batch< x_data_type >::_packet_batch() :
+            f_n_packets( 0 ),
+            f_packets()
+    {
+    }
+
+    template< class x_data_type >
+    _packet_batch< x_data_type >::~_packet_batch()
+    {
+    }
+
+    template< class x_data_type >
+    void _packet_batch< x_data_type >::set_capacity( unsigned a_capacity )
+    {
+        f_packets.resize( a_capacity );
+        if( f_n_packets > a_capacity ) f_n_packets = a_capacity;
+        return;
+    }
+
+    template class _packet_batch< time_data >;
+    template class _packet_batch< freq_data >;
+    template class _packet_batch< trigger_flag >;
+
+} /* namespace psyllid */
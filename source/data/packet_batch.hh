@@ -0,0 +1,167 @@
+/*
+ * packet_batch.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_PACKET_BATCH_HH_
+#define PSYLLID_PACKET_BATCH_HH_
+
+#include "freq_data.hh"
+#include "time_data.hh"
+#include "trigger_flag.hh"
+
+#include "member_variables.hh"
+
+#include <vector>
+
+
+namespace psyllid
+{
+
+    /*!
+     @class _packet_batch
+     @author N. S. Oblath
+
+     @brief Several consecutive time or frequency packets, passed between nodes in a single stream slot
+
+     @details
+     Passing packets in batches pays the cost of a stream hand-off (set() by the writer, and get() by the reader) once per batch
+     rather than once per packet.
+
+     The batch holds up to get_capacity() packets, of which the first get_n_packets() are valid.  The capacity is set by the node
+     that fills the batch; stream slots start out empty, so the node sets the capacity the first time it uses each slot.
+     A batch can be output with fewer packets than its capacity (e.g. when a run stops).
+
+     Use for_each_packet() or _slot_traits to write code that takes either single packets or batches.
+    */
+    template< class x_data_type >
+    class _packet_batch
+    {
+        public:
+            typedef x_data_type packet_type;
+
+            _packet_batch();
+            virtual ~_packet_batch();
+
+        public:
+            unsigned get_capacity() const;
+            /// Resizes the batch; the packets already in the batch are kept if they fit
+            void set_capacity( unsigned a_capacity );
+
+            mv_accessible( unsigned, n_packets );
+
+            bool is_full() const;
+
+            const x_data_type& operator[]( unsigned a_index ) const;
+            x_data_type& operator[]( unsigned a_index );
+
+        private:
+            std::vector< x_data_type > f_packets;
+    };
+
+    typedef _packet_batch< time_data > time_data_batch;
+    typedef _packet_batch< freq_data > freq_data_batch;
+    typedef _packet_batch< trigger_flag > trigger_flag_batch;
+
+
+    /*!
+     @brief Access to the packets in a stream slot, which holds either a single packet or a batch
+
+     Nodes that are templated on their stream types (e.g. _frequency_mask_trigger) use this to handle both with the same code.
+    */
+    template< class x_slot_type >
+    struct _slot_traits
+    {
+        typedef x_slot_type packet_type;
+        static const bool s_is_batch = false;
+
+        static unsigned n_packets( const x_slot_type& ) { return 1; }
+        static unsigned capacity( const x_slot_type& ) { return 1; }
+        static packet_type& packet( x_slot_type& a_slot, unsigned ) { return a_slot; }
+        /// a_n_packets must be 1 for a single packet
+        static void set_n_packets( x_slot_type&, unsigned ) {}
+    };
+
+    template< class x_data_type >
+    struct _slot_traits< _packet_batch< x_data_type > >
+    {
+        typedef x_data_type packet_type;
+        static const bool s_is_batch = true;
+
+        static unsigned n_packets( const _packet_batch< x_data_type >& a_slot ) { return a_slot.get_n_packets(); }
+        static unsigned capacity( const _packet_batch< x_data_type >& a_slot ) { return a_slot.get_capacity(); }
+        static packet_type& packet( _packet_batch< x_data_type >& a_slot, unsigned a_index ) { return a_slot[ a_index ]; }
+        /// Grows the batch if a_n_packets is more than its capacity
+        static void set_n_packets( _packet_batch< x_data_type >& a_slot, unsigned a_n_packets )
+        {
+            if( a_n_packets > a_slot.get_capacity() ) a_slot.set_capacity( a_n_packets );
+            a_slot.set_n_packets( a_n_packets );
+        }
+    };
+
+
+    /// Calls a_func for a single packet
+    template< class x_func >
+    inline void for_each_packet( time_data& a_data, x_func a_func )
+    {
+        a_func( a_data );
+        return;
+    }
+
+    /// Calls a_func for a single packet
+    template< class x_func >
+    inline void for_each_packet( freq_data& a_data, x_func a_func )
+    {
+        a_func( a_data );
+        return;
+    }
+
+    /// Calls a_func for a single trigger flag
+    template< class x_func >
+    inline void for_each_packet( trigger_flag& a_data, x_func a_func )
+    {
+        a_func( a_data );
+        return;
+    }
+
+    /// Calls a_func for each packet in the batch, in order
+    template< class x_data_type, class x_func >
+    inline void for_each_packet( _packet_batch< x_data_type >& a_batch, x_func a_func )
+    {
+        for( unsigned i_packet = 0; i_packet < a_batch.get_n_packets(); ++i_packet )
+        {
+            a_func( a_batch[ i_packet ] );
+        }
+        return;
+    }
+
+
+    template< class x_data_type >
+    inline unsigned _packet_batch< x_data_type >::get_capacity() const
+    {
+        return f_packets.size();
+    }
+
+    template< class x_data_type >
+    inline bool _packet_batch< x_data_type >::is_full() const
+    {
+        return f_n_packets == f_packets.size();
+    }
+
+    template< class x_data_type >
+    inline const x_data_type& _packet_batch< x_data_type >::operator[]( unsigned a_index ) const
+    {
+        return f_packets[ a_index ];
+    }
+
+    template< class x_data_type >
+    inline x_data_type& _packet_batch< x_data_type >::operator[]( unsigned a_index )
+    {
+        return f_packets[ a_index ];
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_PACKET_BATCH_HH_ */
@@ -8,32 +8,281 @@
 #include "roach_packet.hh"
 
 #include "byte_swap.hh"
+#include "psyllid_error.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define PSYLLID_X86_SWAP_KERNELS
+#include <immintrin.h>
+#endif
 
 namespace psyllid
 {
 
     roach_packet_data::roach_packet_data() :
-            f_packet()
-    {}
+            f_rx_timestamp_ns( 0 ),
+            f_placeholder( false ),
+            f_storage(),
+            f_packet( nullptr )
+    {
+        f_storage.resize( sizeof( roach_packet ) );
+        ::memset( f_storage.block(), 0, sizeof( roach_packet ) );
+        f_packet = reinterpret_cast< roach_packet* >( f_storage.block() );
+    }
+
+    roach_packet_data::roach_packet_data( const roach_packet_data& a_orig ) :
+            f_rx_timestamp_ns( a_orig.f_rx_timestamp_ns ),
+            f_placeholder( a_orig.f_placeholder ),
+            f_storage(),
+            f_packet( nullptr )
+    {
+        f_storage.resize( sizeof( roach_packet ) );
+        ::memcpy( f_storage.block(), a_orig.f_packet, sizeof( roach_packet ) );
+        f_packet = reinterpret_cast< roach_packet* >( f_storage.block() );
+    }
 
     roach_packet_data::~roach_packet_data()
     {}
 
-    void byteswap_inplace( raw_roach_packet* a_pkt )
+    roach_packet_data& roach_packet_data::operator=( const roach_packet_data& a_rhs )
+    {
+        if( this == &a_rhs ) return *this;
+        f_rx_timestamp_ns = a_rhs.f_rx_timestamp_ns;
+        f_placeholder = a_rhs.f_placeholder;
+        ::memcpy( f_packet, a_rhs.f_packet, sizeof( roach_packet ) );
+        return *this;
+    }
+
+    bool roach_packet_data::adopt_packet( memory_block& a_block )
     {
-        a_pkt->f_word_0 = be64toh( a_pkt->f_word_0 );
-        a_pkt->f_word_1 = be64toh( a_pkt->f_word_1 );
-        a_pkt->f_word_2 = be64toh( a_pkt->f_word_2 );
-        a_pkt->f_word_3 = be64toh( a_pkt->f_word_3 );
-        static const unsigned n_words = PAYLOAD_SIZE / 8;
-        uint64_t* t_data_64bit = reinterpret_cast< uint64_t* >( a_pkt->f_data );
-        for( unsigned i_word = 0; i_word < n_words; ++i_word )
+        if( ! can_adopt( a_block ) ) return false;
+
+        // match a_block's size so that the block it gets back needs no reallocation; this only happens the first time round a stream buffer
+        if( f_storage.get_n_bytes() != a_block.get_n_bytes() ) f_storage.resize( a_block.get_n_bytes() );
+        f_storage.swap( a_block );
+        f_packet = reinterpret_cast< roach_packet* >( f_storage.block() );
+        return true;
+    }
+
+    void roach_packet_data::swap_packet( roach_packet_data& a_other )
+    {
+        f_storage.swap( a_other.f_storage );
+        std::swap( f_packet, a_other.f_packet );
+        return;
+    }
+
+    namespace
+    {
+        // a_src and a_dest may be the same (in-place swap) but may not otherwise overlap
+        typedef void (*payload_swap_fcn)( const char* a_src, char* a_dest );
+
+        void swap_payload_scalar( const char* a_src, char* a_dest )
         {
-            t_data_64bit[ i_word ] = payload_swap( t_data_64bit[ i_word ] );
+            static const unsigned n_words = PAYLOAD_SIZE / 8;
+            const uint64_t* t_src_64bit = reinterpret_cast< const uint64_t* >( a_src );
+            uint64_t* t_dest_64bit = reinterpret_cast< uint64_t* >( a_dest );
+            for( unsigned i_word = 0; i_word < n_words; ++i_word )
+            {
+                t_dest_64bit[ i_word ] = payload_swap( t_src_64bit[ i_word ] );
+            }
+            return;
         }
+
+#ifdef PSYLLID_X86_SWAP_KERNELS
+        // payload_swap reverses the order of the four 16-bit samples in each 8-byte word; as a byte shuffle within 16 bytes:
+#define PSYLLID_SWAP_SHUFFLE 6, 7, 4, 5, 2, 3, 0, 1, 14, 15, 12, 13, 10, 11, 8, 9
+
+        __attribute__(( target("ssse3") ))
+        void swap_payload_ssse3( const char* a_src, char* a_dest )
+        {
+            const __m128i t_shuffle = _mm_setr_epi8( PSYLLID_SWAP_SHUFFLE );
+            for( unsigned i_byte = 0; i_byte < PAYLOAD_SIZE; i_byte += 16 )
+            {
+                __m128i t_in = _mm_loadu_si128( reinterpret_cast< const __m128i* >( a_src + i_byte ) );
+                _mm_storeu_si128( reinterpret_cast< __m128i* >( a_dest + i_byte ), _mm_shuffle_epi8( t_in, t_shuffle ) );
+            }
+            return;
+        }
+
+        __attribute__(( target("avx2") ))
+        void swap_payload_avx2( const char* a_src, char* a_dest )
+        {
+            // the shuffle works within each 16-byte lane
+            const __m256i t_shuffle = _mm256_setr_epi8( PSYLLID_SWAP_SHUFFLE, PSYLLID_SWAP_SHUFFLE );
+            for( unsigned i_byte = 0; i_byte < PAYLOAD_SIZE; i_byte += 32 )
+            {
+                __m256i t_in = _mm256_loadu_si256( reinterpret_cast< const __m256i* >( a_src + i_byte ) );
+                _mm256_storeu_si256( reinterpret_cast< __m256i* >( a_dest + i_byte ), _mm256_shuffle_epi8( t_in, t_shuffle ) );
+            }
+            return;
+        }
+
+        __attribute__(( target("avx512f,avx512bw") ))
+        void swap_payload_avx512( const char* a_src, char* a_dest )
+        {
+            const __m512i t_shuffle = _mm512_broadcast_i32x4( _mm_setr_epi8( PSYLLID_SWAP_SHUFFLE ) );
+            for( unsigned i_byte = 0; i_byte < PAYLOAD_SIZE; i_byte += 64 )
+            {
+                __m512i t_in = _mm512_loadu_si512( a_src + i_byte );
+                _mm512_storeu_si512( a_dest + i_byte, _mm512_shuffle_epi8( t_in, t_shuffle ) );
+            }
+            return;
+        }
+
+#undef PSYLLID_SWAP_SHUFFLE
+#endif
+
+        payload_swap_fcn kernel_fcn( swap_kernel a_kernel )
+        {
+            switch( a_kernel )
+            {
+#ifdef PSYLLID_X86_SWAP_KERNELS
+                case swap_kernel::ssse3: return &swap_payload_ssse3;
+                case swap_kernel::avx2: return &swap_payload_avx2;
+                case swap_kernel::avx512: return &swap_payload_avx512;
+#endif
+                default: return &swap_payload_scalar;
+            }
+        }
+
+        inline void swap_header( const raw_roach_packet* a_src, raw_roach_packet* a_dest )
+        {
+            a_dest->f_word_0 = be64toh( a_src->f_word_0 );
+            a_dest->f_word_1 = be64toh( a_src->f_word_1 );
+            a_dest->f_word_2 = be64toh( a_src->f_word_2 );
+            a_dest->f_word_3 = be64toh( a_src->f_word_3 );
+            return;
+        }
+
+        inline payload_swap_fcn active_kernel_fcn()
+        {
+            static const payload_swap_fcn s_swap_payload = kernel_fcn( active_swap_kernel() );
+            return s_swap_payload;
+        }
+
+        void check_kernel( swap_kernel a_kernel )
+        {
+            if( ! swap_kernel_available( a_kernel ) )
+            {
+                throw error() << "Byte-swap kernel <" << swap_kernel_name( a_kernel ) << "> is not available";
+            }
+            return;
+        }
+    }
+
+    bool swap_kernel_available( swap_kernel a_kernel )
+    {
+        switch( a_kernel )
+        {
+            case swap_kernel::scalar: return true;
+#ifdef PSYLLID_X86_SWAP_KERNELS
+            case swap_kernel::ssse3: return __builtin_cpu_supports( "ssse3" );
+            case swap_kernel::avx2: return __builtin_cpu_supports( "avx2" );
+            case swap_kernel::avx512: return __builtin_cpu_supports( "avx512f" ) && __builtin_cpu_supports( "avx512bw" );
+#endif
+            default: return false;
+        }
+    }
+
+    swap_kernel active_swap_kernel()
+    {
+        static const swap_kernel s_kernel = []()
+        {
+            if( swap_kernel_available( swap_kernel::avx512 ) ) return swap_kernel::avx512;
+            if( swap_kernel_available( swap_kernel::avx2 ) ) return swap_kernel::avx2;
+            if( swap_kernel_available( swap_kernel::ssse3 ) ) return swap_kernel::ssse3;
+            return swap_kernel::scalar;
+        }();
+        return s_kernel;
+    }
+
+    const char* swap_kernel_name( swap_kernel a_kernel )
+    {
+        switch( a_kernel )
+        {
+            case swap_kernel::scalar: return "scalar";
+            case swap_kernel::ssse3: return "ssse3";
+            case swap_kernel::avx2: return "avx2";
+            case swap_kernel::avx512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    void byteswap_inplace( raw_roach_packet* a_pkt )
+    {
+        swap_header( a_pkt, a_pkt );
+        active_kernel_fcn()( a_pkt->f_data, a_pkt->f_data );
+        return;
+    }
+
+    void byteswap_inplace( raw_roach_packet* a_pkt, swap_kernel a_kernel )
+    {
+        check_kernel( a_kernel );
+        swap_header( a_pkt, a_pkt );
+        kernel_fcn( a_kernel )( a_pkt->f_data, a_pkt->f_data );
+        return;
+    }
+
+    void byteswap_copy( const raw_roach_packet* a_src, raw_roach_packet* a_dest )
+    {
+        swap_header( a_src, a_dest );
+        active_kernel_fcn()( a_src->f_data, a_dest->f_data );
         return;
     }
 
+    void byteswap_copy( const raw_roach_packet* a_src, raw_roach_packet* a_dest, swap_kernel a_kernel )
+    {
+        check_kernel( a_kernel );
+        swap_header( a_src, a_dest );
+        kernel_fcn( a_kernel )( a_src->f_data, a_dest->f_data );
+        return;
+    }
+
+    bool raw_freq_not_time( const raw_roach_packet* a_pkt )
+    {
+        // freq_not_time is the most-significant bit of the fourth header word
+        return ( be64toh( a_pkt->f_word_3 ) >> 63 ) != 0;
+    }
+
+    uint32_t raw_digital_id( const raw_roach_packet* a_pkt )
+    {
+        // bits 52-57 of the first header word
+        return ( be64toh( a_pkt->f_word_0 ) >> 52 ) & 0x3f;
+    }
+
+    uint32_t raw_if_id( const raw_roach_packet* a_pkt )
+    {
+        // bits 58-63 of the first header word
+        return ( be64toh( a_pkt->f_word_0 ) >> 58 ) & 0x3f;
+    }
+
+    uint64_t raw_packet_id( const raw_roach_packet* a_pkt )
+    {
+        return be64toh( a_pkt->f_word_0 );
+    }
+
+    bool unpack_roach_packet( memory_block& a_block, roach_packet_data& a_dest, bool a_hand_off )
+    {
+        // a short block's memory can end right after the packet, so it's never swapped, in place or otherwise
+        if( a_block.get_n_bytes_used() < sizeof( raw_roach_packet ) ) return false;
+
+        if( a_block.get_n_bytes_used() == sizeof( raw_roach_packet ) && a_hand_off && roach_packet_data::can_adopt( a_block ) )
+        {
+            // swap in place and take over the block's memory; the block gets a_dest's old memory in exchange
+            byteswap_inplace( reinterpret_cast< raw_roach_packet* >( a_block.block() ) );
+            a_dest.adopt_packet( a_block );
+            return true;
+        }
+
+        // e.g. the block is a view into a receiver's ring, which has to be given back promptly, or is oversized; only the first
+        // sizeof( raw_roach_packet ) bytes are read
+        byteswap_copy( reinterpret_cast< const raw_roach_packet* >( a_block.block() ), reinterpret_cast< raw_roach_packet* >( &a_dest.packet() ) );
+        return true;
+    }
+
 }
 
 
@@ -8,6 +8,11 @@
 #ifndef PSYLLID_ROACH_PACKET_HH_
 #define PSYLLID_ROACH_PACKET_HH_
 
+#include "block_pool.hh"
+#include "memory_block.hh"
+
+#include "member_variables.hh"
+
 #include <cinttypes>
 #include <cstddef> // for size_t
 
@@ -132,15 +137,77 @@ namespace psyllid
       char f_data[ PAYLOAD_SIZE ];
     };
 
+    /// Converts the header words to host byte order and reorders the payload samples (see payload_swap), using the fastest available swap_kernel
     void byteswap_inplace( raw_roach_packet* a_pkt );
 
+    /*!
+     Implementations of the payload reordering in byteswap_inplace(); all give identical results.
+     The SIMD kernels reorder 16, 32, or 64 bytes at a time with a byte shuffle (pshufb), and are only available on x86 CPUs that support them.
+     The kernel used by byteswap_inplace() is chosen the first time it's called, according to the CPU.
+    */
+    enum class swap_kernel
+    {
+        scalar,
+        ssse3,
+        avx2,
+        avx512
+    };
+
+    /// Whether the kernel is built in and supported by this CPU
+    bool swap_kernel_available( swap_kernel a_kernel );
+
+    /// The kernel used by byteswap_inplace()
+    swap_kernel active_swap_kernel();
+
+    const char* swap_kernel_name( swap_kernel a_kernel );
+
+    /// Same as byteswap_inplace(), with a specific kernel (for testing and benchmarking); throws if the kernel isn't available
+    void byteswap_inplace( raw_roach_packet* a_pkt, swap_kernel a_kernel );
+
+    /// Writes the byte-swapped packet to a_dest, leaving a_src untouched; the packets may not overlap.
+    /// This reads and writes each byte once, where byteswap_inplace() followed by a copy reads and writes each byte twice.
+    void byteswap_copy( const raw_roach_packet* a_src, raw_roach_packet* a_dest );
+
+    /// Same as byteswap_copy(), with a specific kernel (for testing and benchmarking); throws if the kernel isn't available
+    void byteswap_copy( const raw_roach_packet* a_src, raw_roach_packet* a_dest, swap_kernel a_kernel );
+
+    /// Reads the freq_not_time flag of a packet that has not been byte-swapped
+    bool raw_freq_not_time( const raw_roach_packet* a_pkt );
+
+    /// Reads the digital_id of a packet that has not been byte-swapped
+    uint32_t raw_digital_id( const raw_roach_packet* a_pkt );
+
+    /// Reads the if_id of a packet that has not been byte-swapped
+    uint32_t raw_if_id( const raw_roach_packet* a_pkt );
+
+    /// Reads the first header word (unix_time, pkt_in_batch, digital_id, and if_id) of a packet that has not been byte-swapped.
+    /// A time packet and a frequency packet of the same channel that describe the same data have the same value.
+    uint64_t raw_packet_id( const raw_roach_packet* a_pkt );
+
+
+    /*!
+     @class roach_packet_data
+     @author N. S. Oblath
+
+     @brief Base class for the time- and frequency-domain data types; holds a single byte-swapped ROACH packet
 
+     @details
+     The packet is kept in a memory_block.  Normally that memory is allocated by the object, but with adopt_packet() the object
+     can instead take over the memory of an input memory_block that already holds a byte-swapped packet (e.g. a slot in a packet
+     receiver's output stream), giving its previous memory to the input block in exchange.  The packet is then not copied at all
+     on its way from the receiver to the rest of the chain.
+
+     Copying a roach_packet_data copies the packet into the destination's own memory.
+    */
     class roach_packet_data
     {
         public:
             roach_packet_data();
+            roach_packet_data( const roach_packet_data& a_orig );
             virtual ~roach_packet_data();
 
+            roach_packet_data& operator=( const roach_packet_data& a_rhs );
+
         public:
             uint32_t get_unix_time() const;
             void set_unix_time( uint32_t a_time );
@@ -172,117 +239,152 @@ namespace psyllid
             const int8_t* get_raw_array() const;
             size_t get_raw_array_size() const;
 
+            /// Time the packet was received by the kernel, in ns since the epoch; 0 if unknown
+            mv_accessible( uint64_t, rx_timestamp_ns );
+
+            /// True if the packet is a stand-in for one that was lost (see packet_reorder); its payload is zeros
+            mv_accessible( bool, placeholder );
+
+            /// Time since the packet was received by the kernel, in ns; 0 if the receive time is unknown
+            uint64_t get_rx_age_ns() const;
+
         public:
             const roach_packet& packet() const;
             roach_packet& packet();
 
+            /// Whether adopt_packet() can take the memory of a_block: it must own its memory (not be a view), and its chunk must be the size
+            /// of a packet's (see memory_block::get_capacity()), so that output slots never end up holding larger blocks (e.g. a socket receiver's "max-packet-size")
+            static bool can_adopt( const memory_block& a_block );
+
+            /*!
+             Swaps memory with a_block, which must hold a byte-swapped packet; returns false, and does nothing, if can_adopt( a_block ) is false.
+             The memory a_block gets in exchange is the same size as its original memory, so whoever fills it can reuse it as is.
+             The packet's metadata in a_block (e.g. the receive timestamp) is not transferred.
+            */
+            bool adopt_packet( memory_block& a_block );
+
+            /// Exchanges packet memory with a_other without copying; nothing else (e.g. the receive timestamp) is exchanged
+            void swap_packet( roach_packet_data& a_other );
+
         protected:
-            roach_packet f_packet;
+            memory_block f_storage;
+            roach_packet* f_packet;
     };
 
 
+    /*!
+     Puts the byte-swapped packet in a_block into a_dest.
+     If a_hand_off is true and roach_packet_data::can_adopt( a_block ), the packet is swapped in place and a_dest adopts a_block's memory;
+     otherwise it's swapped into a_dest in a single pass, leaving a_block in network byte order.
+     A block that's larger than a packet has its first sizeof( raw_roach_packet ) bytes swapped into a_dest, and is not changed.
+     A block that's smaller than a packet is rejected (returns false, and a_dest is not changed): a block's memory may be only as
+     large as the packet it holds, or a view into a receive buffer or ring, so it can't be swapped in place.
+    */
+    bool unpack_roach_packet( memory_block& a_block, roach_packet_data& a_dest, bool a_hand_off );
+
+
     inline uint32_t roach_packet_data::get_unix_time() const
     {
-        return f_packet.f_unix_time;
+        return f_packet->f_unix_time;
     }
 
     inline void roach_packet_data::set_unix_time( uint32_t a_time )
     {
-        f_packet.f_unix_time = a_time;
+        f_packet->f_unix_time = a_time;
         return;
     }
 
     inline uint32_t roach_packet_data::get_pkt_in_batch() const
     {
-        return f_packet.f_pkt_in_batch;
+        return f_packet->f_pkt_in_batch;
     }
 
     inline void roach_packet_data::set_pkt_in_batch( uint32_t a_pkt )
     {
-        f_packet.f_pkt_in_batch = a_pkt;
+        f_packet->f_pkt_in_batch = a_pkt;
         return;
     }
 
     inline uint32_t roach_packet_data::get_digital_id() const
     {
-        return f_packet.f_digital_id;
+        return f_packet->f_digital_id;
     }
 
     inline void roach_packet_data::set_digital_id( uint32_t a_id )
     {
-        f_packet.f_digital_id = a_id;
+        f_packet->f_digital_id = a_id;
         return;
     }
 
     inline uint32_t roach_packet_data::get_if_id() const
     {
-        return f_packet.f_if_id;
+        return f_packet->f_if_id;
     }
 
     inline void roach_packet_data::set_if_id( uint32_t a_id )
     {
-        f_packet.f_if_id = a_id;
+        f_packet->f_if_id = a_id;
         return;
     }
 
     inline uint32_t roach_packet_data::get_user_data_1() const
     {
-        return f_packet.f_user_data_1;
+        return f_packet->f_user_data_1;
     }
 
     inline void roach_packet_data::set_user_data_1( uint32_t a_data )
     {
-        f_packet.f_user_data_1 = a_data;
+        f_packet->f_user_data_1 = a_data;
         return;
     }
 
     inline uint32_t roach_packet_data::get_user_data_0() const
     {
-        return f_packet.f_user_data_0;
+        return f_packet->f_user_data_0;
     }
 
     inline void roach_packet_data::set_user_data_0( uint32_t a_data )
     {
-        f_packet.f_user_data_0 = a_data;
+        f_packet->f_user_data_0 = a_data;
         return;
     }
 
     inline uint64_t roach_packet_data::get_reserved_0() const
     {
-        return f_packet.f_reserved_0;
+        return f_packet->f_reserved_0;
     }
 
     inline void roach_packet_data::set_reserved_0( uint64_t a_res )
     {
-        f_packet.f_reserved_0 = a_res;
+        f_packet->f_reserved_0 = a_res;
         return;
     }
 
     inline uint64_t roach_packet_data::get_reserved_1() const
     {
-        return f_packet.f_reserved_1;
+        return f_packet->f_reserved_1;
     }
 
     inline void roach_packet_data::set_reserved_1( uint64_t a_res )
     {
-        f_packet.f_reserved_1 = a_res;
+        f_packet->f_reserved_1 = a_res;
         return;
     }
 
     inline bool roach_packet_data::get_freq_not_time() const
     {
-        return f_packet.f_freq_not_time;
+        return f_packet->f_freq_not_time;
     }
 
     inline void roach_packet_data::set_freq_not_time( bool a_flag )
     {
-        f_packet.f_freq_not_time = a_flag;
+        f_packet->f_freq_not_time = a_flag;
         return;
     }
 
     inline const int8_t* roach_packet_data::get_raw_array() const
     {
-        return f_packet.f_data;
+        return f_packet->f_data;
     }
 
     inline size_t roach_packet_data::get_raw_array_size() const
@@ -290,14 +392,25 @@ namespace psyllid
         return PAYLOAD_SIZE;
     }
 
+    inline uint64_t roach_packet_data::get_rx_age_ns() const
+    {
+        return rx_age_ns( f_rx_timestamp_ns );
+    }
+
     inline const roach_packet& roach_packet_data::packet() const
     {
-        return f_packet;
+        return *f_packet;
     }
 
     inline roach_packet& roach_packet_data::packet()
     {
-        return f_packet;
+        return *f_packet;
+    }
+
+    inline bool roach_packet_data::can_adopt( const memory_block& a_block )
+    {
+        return ! a_block.is_view() && a_block.get_n_bytes() >= sizeof( roach_packet ) &&
+                a_block.get_capacity() == block_pool::chunk_size_for( sizeof( roach_packet ) );
     }
 
 } /* namespace psyllid */
@@ -0,0 +1,37 @@
+/*
+ * rx_timestamp.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef DATA_RX_TIMESTAMP_HH_
+#define DATA_RX_TIMESTAMP_HH_
+
+#include <chrono>
+#include <cstdint>
+
+namespace psyllid
+{
+    /*!
+     Receive timestamps (memory_block and roach_packet_data) are in ns since the epoch on the system clock (CLOCK_REALTIME),
+     the clock the kernel uses for SO_TIMESTAMPNS and TPACKET_V3 frames.  A timestamp of 0 means the receive time is unknown.
+    */
+
+    /// The current time on the receive-timestamp clock, in ns since the epoch
+    inline uint64_t rx_clock_now_ns()
+    {
+        return std::chrono::duration_cast< std::chrono::nanoseconds >( std::chrono::system_clock::now().time_since_epoch() ).count();
+    }
+
+    /// Time since a_rx_timestamp_ns; 0 if the timestamp is unknown (0) or in the future
+    inline uint64_t rx_age_ns( uint64_t a_rx_timestamp_ns )
+    {
+        if( a_rx_timestamp_ns == 0 ) return 0;
+        uint64_t t_now_ns = rx_clock_now_ns();
+        return t_now_ns > a_rx_timestamp_ns ? t_now_ns - a_rx_timestamp_ns : 0;
+    }
+
+} /* namespace psyllid */
+
+#endif /* DATA_RX_TIMESTAMP_HH_ */
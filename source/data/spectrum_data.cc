@@ -0,0 +1,28 @@
+/*
+ * spectrum_data.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "spectrum_data.hh"
+
+#include "roach_packet.hh"
+
+namespace psyllid
+{
+
+    spectrum_data::spectrum_data() :
+            f_pkt_in_session( 0 ),
+            f_rx_timestamp_ns( 0 ),
+            f_n_packets( 0 ),
+            f_pkt_span( 0 ),
+            f_array( PAYLOAD_SIZE / 2, 0.f )
+    {
+    }
+
+    spectrum_data::~spectrum_data()
+    {
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,81 @@
+/*
+ * spectrum_data.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_SPECTRUM_DATA_HH_
+#define PSYLLID_SPECTRUM_DATA_HH_
+
+#include "member_variables.hh"
+
+#include <cstddef> // for size_t
+#include <cstdint>
+#include <vector>
+
+
+namespace psyllid
+{
+
+    /*!
+     @class spectrum_data
+     @author N. S. Oblath
+
+     @brief A power spectrum averaged over a number of frequency packets
+
+     @details
+     Each bin is the mean of re^2 + im^2 over the packets that were integrated, in (ADC counts)^2, in the same bin order as the
+     frequency packets.
+
+     The header values describe the packets that went in: pkt_in_session and rx_timestamp_ns are those of the first packet,
+     n_packets is the number of packets integrated, and pkt_span is the number of packet periods from the first packet to the
+     last (inclusive), which is larger than n_packets if packets were missed.
+
+     The array starts out with the size of a ROACH packet (PAYLOAD_SIZE / 2 bins); set_array_size() only allocates when the size changes.
+    */
+    class spectrum_data
+    {
+        public:
+            spectrum_data();
+            virtual ~spectrum_data();
+
+        public:
+            const float* get_array() const;
+            float* get_array();
+            size_t get_array_size() const;
+            void set_array_size( size_t a_size );
+
+            mv_accessible( uint64_t, pkt_in_session );
+            mv_accessible( uint64_t, rx_timestamp_ns );
+            mv_accessible( uint64_t, n_packets );
+            mv_accessible( uint64_t, pkt_span );
+
+        private:
+            std::vector< float > f_array;
+    };
+
+    inline const float* spectrum_data::get_array() const
+    {
+        return f_array.data();
+    }
+
+    inline float* spectrum_data::get_array()
+    {
+        return f_array.data();
+    }
+
+    inline size_t spectrum_data::get_array_size() const
+    {
+        return f_array.size();
+    }
+
+    inline void spectrum_data::set_array_size( size_t a_size )
+    {
+        f_array.resize( a_size );
+        return;
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_SPECTRUM_DATA_HH_ */
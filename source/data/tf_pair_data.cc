@@ -0,0 +1,24 @@
+/*
+ * tf_pair_data.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#include "tf_pair_data.hh"
+
+namespace psyllid
+{
+
+    tf_pair_data::tf_pair_data() :
+            f_time(),
+            f_freq()
+    {
+        f_freq.set_freq_not_time( true );
+    }
+
+    tf_pair_data::~tf_pair_data()
+    {
+    }
+
+} /* namespace psyllid */
@@ -0,0 +1,72 @@
+/*
+ * tf_pair_data.hh
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ */
+
+#ifndef PSYLLID_TF_PAIR_DATA_HH_
+#define PSYLLID_TF_PAIR_DATA_HH_
+
+#include "freq_data.hh"
+#include "time_data.hh"
+
+#include "member_variables.hh"
+
+
+namespace psyllid
+{
+
+    /*!
+     @class tf_pair_data
+     @author N. S. Oblath
+
+     @brief A time packet and the frequency packet that describes the same data
+
+     @details
+     The two packets have the same unix_time, pkt_in_batch, digital_id, and if_id (see tf_roach_pair_receiver),
+     and both have the pair's pkt_in_session.
+    */
+    class tf_pair_data
+    {
+        public:
+            tf_pair_data();
+            virtual ~tf_pair_data();
+
+        public:
+            mv_referrable( time_data, time );
+            mv_referrable( freq_data, freq );
+
+            uint64_t get_pkt_in_session() const;
+            /// Sets pkt_in_session of both packets
+            void set_pkt_in_session( uint64_t a_pkt );
+
+            uint32_t get_unix_time() const;
+            uint32_t get_pkt_in_batch() const;
+    };
+
+    inline uint64_t tf_pair_data::get_pkt_in_session() const
+    {
+        return f_time.get_pkt_in_session();
+    }
+
+    inline void tf_pair_data::set_pkt_in_session( uint64_t a_pkt )
+    {
+        f_time.set_pkt_in_session( a_pkt );
+        f_freq.set_pkt_in_session( a_pkt );
+        return;
+    }
+
+    inline uint32_t tf_pair_data::get_unix_time() const
+    {
+        return f_time.get_unix_time();
+    }
+
+    inline uint32_t tf_pair_data::get_pkt_in_batch() const
+    {
+        return f_time.get_pkt_in_batch();
+    }
+
+} /* namespace psyllid */
+
+#endif /* PSYLLID_TF_PAIR_DATA_HH_ */
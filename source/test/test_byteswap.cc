@@ -0,0 +1,241 @@
+/*
+ * test_byteswap.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Checks that every swap_kernel available on this machine gives the same result as the scalar byteswap_inplace,
+ *  with both byteswap_inplace and byteswap_copy, and then times each of them.
+ *
+ *  The last benchmark compares the two ways tf_roach_receiver could unpack a packet into its output: byteswap_inplace
+ *  followed by a memcpy (each byte is read twice and written twice) and byteswap_copy (each byte is read once and written once).
+ *  It runs over a ring of packets larger than the CPU caches, so that memory traffic is included.
+ *  Before the benchmarks, unpack_roach_packet is checked to reject short blocks, to leave views unchanged, and to copy
+ *  (rather than adopt) blocks whose memory is larger than a packet.
+ *
+ *  Usage: > test_byteswap [options]
+ *
+ *  Parameters:
+ *    - n-packets: (uint) number of random packets to check with each kernel; default is 1000
+ *    - n-iterations: (uint) number of packets to swap when timing each kernel; default is 1000000
+ *    - n-ring-packets: (uint) number of packets in the ring used for the swap-and-copy benchmark; default is 8192 (67 MB in and out)
+ *
+ *  Returns a nonzero value if any kernel disagrees with the scalar kernel.
+ */
+
+#include "memory_block.hh"
+#include "psyllid_error.hh"
+#include "roach_packet.hh"
+
+#include "configurator.hh"
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string.h>
+#include <vector>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_byteswap" );
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        scarab::param_node t_default_config;
+        t_default_config.add( "n-packets", scarab::param_value( 1000 ) );
+        t_default_config.add( "n-iterations", scarab::param_value( 1000000 ) );
+        t_default_config.add( "n-ring-packets", scarab::param_value( 8192 ) );
+
+        scarab::configurator t_configurator( argc, argv, t_default_config );
+
+        unsigned t_n_packets = t_configurator.get< unsigned >( "n-packets" );
+        unsigned t_n_iterations = t_configurator.get< unsigned >( "n-iterations" );
+        unsigned t_n_ring_packets = std::max( t_configurator.get< unsigned >( "n-ring-packets" ), 1U );
+
+        const swap_kernel t_kernels[] = { swap_kernel::scalar, swap_kernel::ssse3, swap_kernel::avx2, swap_kernel::avx512 };
+
+        LINFO( plog, "Kernel used by byteswap_inplace: " << swap_kernel_name( active_swap_kernel() ) );
+
+        // the packet sits one byte into the buffer so that the kernels are also checked with unaligned data
+        std::vector< char > t_original_buffer( sizeof(raw_roach_packet) + 1 );
+        std::vector< char > t_reference_buffer( sizeof(raw_roach_packet) + 1 );
+        std::vector< char > t_test_buffer( sizeof(raw_roach_packet) + 1 );
+        raw_roach_packet* t_original = reinterpret_cast< raw_roach_packet* >( t_original_buffer.data() + 1 );
+        raw_roach_packet* t_reference = reinterpret_cast< raw_roach_packet* >( t_reference_buffer.data() + 1 );
+        raw_roach_packet* t_test = reinterpret_cast< raw_roach_packet* >( t_test_buffer.data() + 1 );
+
+        std::mt19937 t_generator( 20261018 );
+        std::uniform_int_distribution< int > t_byte_dist( 0, 255 );
+
+        unsigned t_n_failures = 0;
+        for( unsigned i_packet = 0; i_packet < t_n_packets; ++i_packet )
+        {
+            char* t_bytes = reinterpret_cast< char* >( t_original );
+            for( unsigned i_byte = 0; i_byte < sizeof(raw_roach_packet); ++i_byte )
+            {
+                t_bytes[ i_byte ] = char( t_byte_dist( t_generator ) );
+            }
+
+            ::memcpy( t_reference, t_original, sizeof(raw_roach_packet) );
+            byteswap_inplace( t_reference, swap_kernel::scalar );
+
+            for( swap_kernel t_kernel : t_kernels )
+            {
+                if( ! swap_kernel_available( t_kernel ) ) continue;
+
+                ::memcpy( t_test, t_original, sizeof(raw_roach_packet) );
+                byteswap_inplace( t_test, t_kernel );
+                if( ::memcmp( t_test, t_reference, sizeof(raw_roach_packet) ) != 0 )
+                {
+                    LERROR( plog, "Kernel <" << swap_kernel_name( t_kernel ) << "> disagrees with the scalar kernel for packet " << i_packet );
+                    ++t_n_failures;
+                }
+            }
+
+            for( swap_kernel t_kernel : t_kernels )
+            {
+                if( ! swap_kernel_available( t_kernel ) ) continue;
+
+                ::memset( t_test, 0, sizeof(raw_roach_packet) );
+                byteswap_copy( t_original, t_test, t_kernel );
+                if( ::memcmp( t_test, t_reference, sizeof(raw_roach_packet) ) != 0 )
+                {
+                    LERROR( plog, "Kernel <" << swap_kernel_name( t_kernel ) << "> disagrees with the scalar kernel for packet " << i_packet << " when copying" );
+                    ++t_n_failures;
+                }
+            }
+
+            ::memcpy( t_test, t_original, sizeof(raw_roach_packet) );
+            byteswap_inplace( t_test );
+            if( ::memcmp( t_test, t_reference, sizeof(raw_roach_packet) ) != 0 )
+            {
+                LERROR( plog, "byteswap_inplace disagrees with the scalar kernel for packet " << i_packet );
+                ++t_n_failures;
+            }
+
+            if( raw_freq_not_time( t_original ) != bool(reinterpret_cast< roach_packet* >( t_reference )->f_freq_not_time) )
+            {
+                LERROR( plog, "raw_freq_not_time disagrees with the swapped packet for packet " << i_packet );
+                ++t_n_failures;
+            }
+        }
+
+        // unpack_roach_packet must not change a view or a short block: short ones are rejected, and the others are copied out
+        {
+            std::vector< uint8_t > t_ring( sizeof(raw_roach_packet) + 64 );
+            for( uint8_t& t_byte : t_ring ) t_byte = uint8_t( t_byte_dist( t_generator ) );
+            std::vector< uint8_t > t_ring_copy( t_ring );
+            roach_packet_data t_dest;
+            memory_block t_view;
+            for( size_t t_size : { size_t(0), sizeof(uint64_t) * 4, sizeof(raw_roach_packet) - 1, sizeof(raw_roach_packet), t_ring.size() } )
+            {
+                t_view.set_view( t_ring.data(), t_size, std::make_shared< int >( 0 ) );
+                bool t_unpacked = unpack_roach_packet( t_view, t_dest, true );
+                if( t_unpacked != ( t_size >= sizeof(raw_roach_packet) ) || t_ring != t_ring_copy )
+                {
+                    LERROR( plog, "unpack_roach_packet mishandled a view of " << t_size << " bytes" );
+                    ++t_n_failures;
+                }
+            }
+            // a socket receiver's blocks are "max-packet-size" (1 MiB by default): copied out, not adopted
+            memory_block t_large;
+            t_large.resize( 1048576 );
+            ::memcpy( t_large.block(), t_ring_copy.data(), sizeof(raw_roach_packet) );
+            t_large.set_n_bytes_used( sizeof(raw_roach_packet) );
+            uint8_t* t_large_memory = t_large.block();
+            if( ! unpack_roach_packet( t_large, t_dest, true ) || t_large.block() != t_large_memory ||
+                    ::memcmp( t_large.block(), t_ring_copy.data(), sizeof(raw_roach_packet) ) != 0 )
+            {
+                LERROR( plog, "unpack_roach_packet adopted (or changed) a block larger than a packet" );
+                ++t_n_failures;
+            }
+
+            memory_block t_short;
+            t_short.resize( sizeof(uint64_t) * 4 );
+            t_short.set_n_bytes_used( sizeof(uint64_t) * 4 );
+            if( unpack_roach_packet( t_short, t_dest, true ) )
+            {
+                LERROR( plog, "unpack_roach_packet accepted a short block" );
+                ++t_n_failures;
+            }
+        }
+
+        if( t_n_failures != 0 )
+        {
+            LERROR( plog, "Byte-swap check failed: " << t_n_failures << " mismatches" );
+            return -1;
+        }
+        LINFO( plog, "All available kernels agree with the scalar kernel for " << t_n_packets << " packets" );
+
+        for( swap_kernel t_kernel : t_kernels )
+        {
+            if( ! swap_kernel_available( t_kernel ) )
+            {
+                LINFO( plog, "Kernel <" << swap_kernel_name( t_kernel ) << "> is not available" );
+                continue;
+            }
+
+            // swapping the same packet repeatedly keeps it in cache, so this measures the kernel rather than memory bandwidth
+            std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+            for( unsigned i_iter = 0; i_iter < t_n_iterations; ++i_iter )
+            {
+                byteswap_inplace( t_test, t_kernel );
+            }
+            double t_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+
+            if( t_seconds > 0. )
+            {
+                LINFO( plog, "Kernel <" << swap_kernel_name( t_kernel ) << ">: " << 1.e9 * t_seconds / double(t_n_iterations) << " ns/packet; "
+                        << double(t_n_iterations) * sizeof(raw_roach_packet) * 1.e-9 / t_seconds << " GB/s" );
+            }
+        }
+
+        // swap-and-copy, as done by tf_roach_receiver; the source ring is refilled with the original packet before each pass so that
+        // the in-place swap always starts from network byte order
+        std::vector< raw_roach_packet > t_source_ring( t_n_ring_packets );
+        std::vector< raw_roach_packet > t_dest_ring( t_n_ring_packets );
+        unsigned t_n_passes = std::max( t_n_iterations / t_n_ring_packets, 1U );
+        uint64_t t_n_swapped = uint64_t(t_n_passes) * t_n_ring_packets;
+
+        double t_seconds_inplace = 0.;
+        double t_seconds_fused = 0.;
+        for( unsigned i_pass = 0; i_pass < t_n_passes; ++i_pass )
+        {
+            for( raw_roach_packet& t_packet : t_source_ring ) ::memcpy( &t_packet, t_original, sizeof(raw_roach_packet) );
+
+            std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+            for( unsigned i_packet = 0; i_packet < t_n_ring_packets; ++i_packet )
+            {
+                byteswap_inplace( &t_source_ring[ i_packet ] );
+                ::memcpy( &t_dest_ring[ i_packet ], &t_source_ring[ i_packet ], sizeof(raw_roach_packet) );
+            }
+            t_seconds_inplace += std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+
+            for( raw_roach_packet& t_packet : t_source_ring ) ::memcpy( &t_packet, t_original, sizeof(raw_roach_packet) );
+
+            t_start = std::chrono::steady_clock::now();
+            for( unsigned i_packet = 0; i_packet < t_n_ring_packets; ++i_packet )
+            {
+                byteswap_copy( &t_source_ring[ i_packet ], &t_dest_ring[ i_packet ] );
+            }
+            t_seconds_fused += std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+        }
+
+        LINFO( plog, "Swap and copy of " << t_n_swapped << " packets with kernel <" << swap_kernel_name( active_swap_kernel() ) << ">:" );
+        LINFO( plog, "\tbyteswap_inplace + memcpy: " << 4 * sizeof(raw_roach_packet) << " bytes touched/packet; " << double(t_n_swapped) / t_seconds_inplace << " packets/s" );
+        LINFO( plog, "\tbyteswap_copy: " << 2 * sizeof(raw_roach_packet) << " bytes touched/packet; " << double(t_n_swapped) / t_seconds_fused << " packets/s" );
+        LINFO( plog, "\tSpeed-up: " << t_seconds_inplace / t_seconds_fused );
+
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
@@ -8,70 +8,119 @@
  *
  *  Usage: > test_fast_packet_acq [options]
  *
- *  Options:
- *    - interface -- (string) network interface to listen on; defaults to "eth1"
+ *  Parameters:
+ *    - interface: (string) network interface to listen on; defaults to "eth1"
+ *    - port: (uint) port number to listen on for packets; default is 23530
+ *    - kernel-filter: (bool) filter packets in the kernel with BPF (true) or in user space (false); default is true
+ *    - source-ip: (string) if given, only packets from this IPv4 address are accepted
+ *
+ *  Run once with kernel-filter=true and once with kernel-filter=false while the same traffic is present on the
+ *  interface to compare the two filtering methods; the packet receiver reports the number of packets it walked
+ *  and output when it exits.
  */
 
 
-#include "tf_roach_receiver.hh"
-#include "fpa_factory.hh"
+#include "packet_receiver_fpa.hh"
 #include "psyllid_error.hh"
-#include "midge_error.hh"
+#include "terminator.hh"
+#include "tf_roach_receiver.hh"
+
+#include "diptera.hh"
 
 #include "configurator.hh"
 #include "logger.hh"
 #include "param.hh"
 
+#include <signal.h>
 
 using namespace psyllid;
 
 LOGGER( plog, "test_fast_packet_acq" );
 
+scarab::cancelable* f_cancelable = nullptr;
+
+void cancel( int )
+{
+    LINFO( plog, "Attempting to cancel" );
+    if( f_cancelable != nullptr ) f_cancelable->cancel();
+    return;
+}
+
 int main( int argc, char** argv )
 {
     try
     {
         scarab::param_node t_default_config;
         t_default_config.add( "interface", scarab::param_value( "eth1" ) );
+        t_default_config.add( "port", scarab::param_value( 23530 ) );
+        t_default_config.add( "kernel-filter", scarab::param_value( true ) );
 
-        scarab::configurator t_configurator( argc, argv, &t_default_config );
+        scarab::configurator t_configurator( argc, argv, t_default_config );
 
         std::string t_interface( t_configurator.get< std::string >( "interface" ) );
+        unsigned t_port = t_configurator.get< unsigned >( "port" );
+        bool t_kernel_filter = t_configurator.get< bool >( "kernel-filter" );
+
+        LINFO( plog, "Creating and configuring nodes; filtering in " << (t_kernel_filter ? "the kernel" : "user space") );
 
-        // setup the server config
-        scarab::param_node t_server_config = scarab::param_node();
-        t_server_config.add( "type", scarab::param_value( "fpa" ) );
-        t_server_config.add( "interface", scarab::param_value( t_interface ) );
+        midge::diptera* t_root = new midge::diptera();
 
-        LINFO( plog, "Creating and configuring receiver" );
+        packet_receiver_fpa* t_pck_rec = new packet_receiver_fpa();
+        t_pck_rec->set_name( "pck_rec" );
+        t_pck_rec->set_length( 10 );
+        t_pck_rec->set_port( t_port );
+        t_pck_rec->interface() = t_interface;
+        t_pck_rec->set_kernel_filter( t_kernel_filter );
+        if( t_configurator.config().has( "source-ip" ) )
+        {
+            t_pck_rec->source_ips().push_back( t_configurator.get< std::string >( "source-ip" ) );
+        }
+        t_root->add( t_pck_rec );
+        f_cancelable = t_pck_rec;
 
-        tf_roach_receiver t_receiver;
-        t_receiver.set_name( "rec" );
-        //t_receiver.node_ptr( &t_fpa, t_interface );
-        t_receiver.set_server_config( t_server_config );
+        tf_roach_receiver* t_tfr_rec = new tf_roach_receiver();
+        t_tfr_rec->set_name( "tfr_rec" );
+        t_tfr_rec->set_time_length( 10 );
+        t_tfr_rec->set_start_paused( false );
+        t_root->add( t_tfr_rec );
 
-        LINFO( plog, "Initializing receiver & FPA" );
+        terminator_time_data* t_term_t = new terminator_time_data();
+        t_term_t->set_name( "term_t" );
+        t_root->add( t_term_t );
 
-        t_receiver.initialize();
+        terminator_freq_data* t_term_f = new terminator_freq_data();
+        t_term_f->set_name( "term_f" );
+        t_root->add( t_term_f );
 
-        LINFO( plog, "Running receiver" );
+        LINFO( plog, "Connecting nodes" );
 
-        t_receiver.execute();
+        t_root->join( "pck_rec.out_0:tfr_rec.in_0" );
+        t_root->join( "tfr_rec.out_0:term_t.in_0" );
+        t_root->join( "tfr_rec.out_1:term_f.in_0" );
 
-        LINFO( plog, "Finalizing receiver and FPA" );
+        LINFO( plog, "Exit with ctrl-c" );
 
-        t_receiver.finalize();
+        // set up signal handling for canceling with ctrl-c
+        signal( SIGINT, cancel );
+
+        LINFO( plog, "Executing" );
+
+        std::exception_ptr t_e_ptr = t_root->run( "pck_rec:tfr_rec:term_t:term_f" );
+
+        if( t_e_ptr ) std::rethrow_exception( t_e_ptr );
+
+        LINFO( plog, "Execution complete" );
+
+        // un-setup signal handling
+        f_cancelable = nullptr;
+
+        delete t_root;
 
         return 0;
     }
-    catch( psyllid::error& e )
-    {
-        LERROR( plog, "Psyllid exception caught: " << e.what() );
-        return -1;
-    }
-    catch( midge::error& e )
+    catch( std::exception& e )
     {
-        LERROR( plog, "Midge exception caught: " << e.what() );
+        LERROR( plog, "Exception caught: " << e.what() );
         return -1;
     }
 
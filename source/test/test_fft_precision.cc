@@ -0,0 +1,201 @@
+/*
+ * test_fft_precision.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Compares the single- and double-precision transforms of packet_fft (as used by frequency_transform).
+ *
+ *  Random time packets (Gaussian noise plus a tone strong enough to saturate its bin) are transformed in double precision,
+ *  and in single precision with and without the SIMD kernels.  The single-precision SIMD and scalar outputs must be identical,
+ *  and the single-precision output may differ from the double-precision output by at most one count in any bin.
+ *  Then the packet rate of load + execute + unfold is measured for each precision and batch size.
+ *
+ *  Usage: > test_fft_precision [options]
+ *
+ *  Parameters:
+ *    - n-packets: (uint) number of random packets to compare; default is 1000
+ *    - n-iterations: (uint) number of packets to transform when timing each configuration; default is 100000
+ *    - fft-size: (uint) number of complex samples per packet; default is 4096
+ *    - batch-sizes: (array of uints) batch sizes to time; default is [1, 16, 64]
+ *
+ *  Returns a nonzero value if the outputs don't agree as described above.
+ */
+
+#include "packet_fft.hh"
+#include "psyllid_error.hh"
+
+#include "configurator.hh"
+#include "logger.hh"
+#include "param.hh"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string.h>
+#include <vector>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_fft_precision" );
+
+/// Returns the packet rate of load + execute + unfold over a_n_iterations packets
+double time_transform( packet_fft& a_fft, const std::vector< int8_t >& a_packets, unsigned a_n_packets, unsigned a_n_iterations )
+{
+    unsigned t_n_values = 2 * a_fft.get_fft_size();
+    std::vector< int8_t > t_output( t_n_values );
+    unsigned t_n_batches = std::max( a_n_iterations / a_fft.get_batch_size(), 1U );
+
+    std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+    unsigned i_packet = 0;
+    for( unsigned i_batch = 0; i_batch < t_n_batches; ++i_batch )
+    {
+        for( unsigned i_row = 0; i_row < a_fft.get_batch_size(); ++i_row )
+        {
+            a_fft.load( i_row, &a_packets[ ( i_packet++ % a_n_packets ) * t_n_values ] );
+        }
+        a_fft.execute();
+        for( unsigned i_row = 0; i_row < a_fft.get_batch_size(); ++i_row )
+        {
+            a_fft.unfold( i_row, t_output.data() );
+        }
+    }
+    double t_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+    return double(t_n_batches) * a_fft.get_batch_size() / t_seconds;
+}
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        scarab::param_node t_default_config;
+        t_default_config.add( "n-packets", scarab::param_value( 1000 ) );
+        t_default_config.add( "n-iterations", scarab::param_value( 100000 ) );
+        t_default_config.add( "fft-size", scarab::param_value( 4096 ) );
+        scarab::param_array t_default_sizes;
+        t_default_sizes.push_back( scarab::param_value( 1 ) );
+        t_default_sizes.push_back( scarab::param_value( 16 ) );
+        t_default_sizes.push_back( scarab::param_value( 64 ) );
+        t_default_config.add( "batch-sizes", t_default_sizes );
+
+        scarab::configurator t_configurator( argc, argv, t_default_config );
+
+        unsigned t_n_packets = std::max( t_configurator.get< unsigned >( "n-packets" ), 1U );
+        unsigned t_n_iterations = t_configurator.get< unsigned >( "n-iterations" );
+        unsigned t_fft_size = t_configurator.get< unsigned >( "fft-size" );
+        const scarab::param_array& t_sizes = t_configurator.config()[ "batch-sizes" ].as_array();
+
+        unsigned t_n_values = 2 * t_fft_size;
+
+        std::mt19937 t_generator( 20261018 );
+        std::normal_distribution< double > t_noise( 0., 20. );
+        std::uniform_real_distribution< double > t_phase( 0., 2. * M_PI );
+        std::vector< int8_t > t_packets( size_t(t_n_packets) * t_n_values );
+        for( unsigned i_packet = 0; i_packet < t_n_packets; ++i_packet )
+        {
+            double t_start_phase = t_phase( t_generator );
+            for( unsigned i_sample = 0; i_sample < t_fft_size; ++i_sample )
+            {
+                double t_tone_phase = t_start_phase + 2. * M_PI * 0.123 * i_sample;
+                double t_i = t_noise( t_generator ) + 8. * std::cos( t_tone_phase );
+                double t_q = t_noise( t_generator ) + 8. * std::sin( t_tone_phase );
+                t_packets[ size_t(i_packet) * t_n_values + 2 * i_sample ] = int8_t( std::max( -128., std::min( 127., std::round( t_i ) ) ) );
+                t_packets[ size_t(i_packet) * t_n_values + 2 * i_sample + 1 ] = int8_t( std::max( -128., std::min( 127., std::round( t_q ) ) ) );
+            }
+        }
+
+        LINFO( plog, "Single precision is " << ( packet_fft::single_precision_available() ? "" : "not " ) << "available; "
+                << "SIMD kernels are " << ( packet_fft::simd_kernels_available() ? "" : "not " ) << "available" );
+
+        unsigned t_n_failures = 0;
+        if( packet_fft::single_precision_available() )
+        {
+            packet_fft t_double_fft( t_fft_size, 1, packet_fft::precision::double_precision, FFTW_ESTIMATE );
+            packet_fft t_single_fft( t_fft_size, 1, packet_fft::precision::single_precision, FFTW_ESTIMATE );
+
+            std::vector< int8_t > t_double_output( t_n_values );
+            std::vector< int8_t > t_single_output( t_n_values );
+            std::vector< int8_t > t_scalar_output( t_n_values );
+
+            uint64_t t_n_differing = 0;
+            int t_max_difference = 0;
+            for( unsigned i_packet = 0; i_packet < t_n_packets; ++i_packet )
+            {
+                const int8_t* t_packet = &t_packets[ size_t(i_packet) * t_n_values ];
+
+                t_double_fft.load( 0, t_packet );
+                t_double_fft.execute();
+                t_double_fft.unfold( 0, t_double_output.data() );
+
+                t_single_fft.set_use_simd( true );
+                t_single_fft.load( 0, t_packet );
+                t_single_fft.execute();
+                t_single_fft.unfold( 0, t_single_output.data() );
+
+                t_single_fft.set_use_simd( false );
+                t_single_fft.load( 0, t_packet );
+                t_single_fft.execute();
+                t_single_fft.unfold( 0, t_scalar_output.data() );
+
+                if( ::memcmp( t_single_output.data(), t_scalar_output.data(), t_n_values ) != 0 )
+                {
+                    LERROR( plog, "The single-precision SIMD and scalar kernels disagree for packet " << i_packet );
+                    ++t_n_failures;
+                }
+
+                for( unsigned i_value = 0; i_value < t_n_values; ++i_value )
+                {
+                    int t_difference = std::abs( int(t_single_output[ i_value ]) - int(t_double_output[ i_value ]) );
+                    if( t_difference == 0 ) continue;
+                    ++t_n_differing;
+                    t_max_difference = std::max( t_max_difference, t_difference );
+                }
+            }
+
+            LINFO( plog, "Single vs. double precision over " << t_n_packets << " packets: " << t_n_differing << " of "
+                    << uint64_t(t_n_packets) * t_n_values << " values differ; the largest difference is " << t_max_difference );
+            if( t_max_difference > 1 )
+            {
+                LERROR( plog, "Single and double precision differ by more than one count" );
+                ++t_n_failures;
+            }
+        }
+
+        if( t_n_failures != 0 )
+        {
+            LERROR( plog, "Precision check failed" );
+            return -1;
+        }
+
+        for( unsigned i_size = 0; i_size < t_sizes.size(); ++i_size )
+        {
+            unsigned t_batch_size = t_sizes[ i_size ]().as_uint();
+
+            packet_fft t_double_fft( t_fft_size, t_batch_size, packet_fft::precision::double_precision, FFTW_MEASURE );
+            double t_double_rate = time_transform( t_double_fft, t_packets, t_n_packets, t_n_iterations );
+            LINFO( plog, "Batch size " << t_batch_size << ", double precision: " << t_double_rate << " packets/s" );
+
+            if( ! packet_fft::single_precision_available() ) continue;
+
+            packet_fft t_single_fft( t_fft_size, t_batch_size, packet_fft::precision::single_precision, FFTW_MEASURE );
+            t_single_fft.set_use_simd( false );
+            double t_scalar_rate = time_transform( t_single_fft, t_packets, t_n_packets, t_n_iterations );
+            LINFO( plog, "Batch size " << t_batch_size << ", single precision, scalar kernels: " << t_scalar_rate << " packets/s (" << t_scalar_rate / t_double_rate << " x double)" );
+
+            if( ! packet_fft::simd_kernels_available() ) continue;
+
+            t_single_fft.set_use_simd( true );
+            double t_simd_rate = time_transform( t_single_fft, t_packets, t_n_packets, t_n_iterations );
+            LINFO( plog, "Batch size " << t_batch_size << ", single precision, SIMD kernels: " << t_simd_rate << " packets/s (" << t_simd_rate / t_double_rate << " x double)" );
+        }
+
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
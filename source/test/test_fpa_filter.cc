@@ -0,0 +1,197 @@
+/*
+ * test_fpa_filter.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Checks the kernel filter of packet_receiver_fpa (packet_receiver_fpa::build_filter) at the limit of its 8-bit jumps.
+ *
+ *  For only source addresses, only extra ports, and an even split of the two, the number of entries is increased until
+ *  build_filter throws.  The largest program that was built is then run on test frames with a small classic BPF
+ *  interpreter: packets from the first and last sources, to the main port and the last extra port, are accepted, and
+ *  packets from other sources, to other ports, non-UDP packets, and IP fragments are dropped.
+ *  No network access or privileges are needed.
+ *
+ *  Usage: > test_fpa_filter
+ *
+ *  Returns a nonzero value if a program gives the wrong result, jumps outside of itself, or is never refused.
+ */
+
+#include "packet_receiver_fpa.hh"
+#include "psyllid_error.hh"
+
+#include "logger.hh"
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <netinet/in.h>
+#include <vector>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_fpa_filter" );
+
+/// Runs a classic BPF program (only the instructions used by build_filter) on a frame; returns the number of bytes to accept
+uint32_t run_filter( const std::vector< sock_filter >& a_code, const std::vector< uint8_t >& a_frame )
+{
+    uint32_t t_a = 0, t_x = 0;
+    for( size_t t_pc = 0; t_pc < a_code.size(); ++t_pc )
+    {
+        const sock_filter& t_ins = a_code[ t_pc ];
+        uint32_t t_offset = t_ins.k;
+        switch( t_ins.code )
+        {
+            case BPF_LD | BPF_W | BPF_ABS:
+                if( t_offset + 4 > a_frame.size() ) return 0;
+                t_a = ( uint32_t(a_frame[ t_offset ]) << 24 ) | ( uint32_t(a_frame[ t_offset + 1 ]) << 16 ) | ( uint32_t(a_frame[ t_offset + 2 ]) << 8 ) | a_frame[ t_offset + 3 ];
+                break;
+            case BPF_LD | BPF_H | BPF_IND:
+                t_offset += t_x;
+                // fall through
+            case BPF_LD | BPF_H | BPF_ABS:
+                if( t_offset + 2 > a_frame.size() ) return 0;
+                t_a = ( uint32_t(a_frame[ t_offset ]) << 8 ) | a_frame[ t_offset + 1 ];
+                break;
+            case BPF_LD | BPF_B | BPF_ABS:
+                if( t_offset + 1 > a_frame.size() ) return 0;
+                t_a = a_frame[ t_offset ];
+                break;
+            case BPF_LDX | BPF_B | BPF_MSH:
+                if( t_offset + 1 > a_frame.size() ) return 0;
+                t_x = ( a_frame[ t_offset ] & 0xf ) * 4;
+                break;
+            case BPF_JMP | BPF_JEQ | BPF_K:
+                t_pc += t_a == t_ins.k ? t_ins.jt : t_ins.jf;
+                break;
+            case BPF_JMP | BPF_JSET | BPF_K:
+                t_pc += ( t_a & t_ins.k ) != 0 ? t_ins.jt : t_ins.jf;
+                break;
+            case BPF_RET | BPF_K:
+                return t_ins.k;
+            default:
+                throw error() << "Unexpected instruction <" << t_ins.code << "> at " << t_pc;
+        }
+    }
+    throw error() << "The program ran past its end";
+}
+
+/// Builds an ethernet frame holding a UDP/IPv4 packet (addresses in host byte order)
+std::vector< uint8_t > make_frame( uint32_t a_source, uint16_t a_dest_port, uint8_t a_protocol = IPPROTO_UDP, uint16_t a_frag_offset = 0 )
+{
+    std::vector< uint8_t > t_frame( ETH_HLEN + 20 + 8 + 16, 0 );
+    t_frame[ 12 ] = ETH_P_IP >> 8;
+    t_frame[ 13 ] = ETH_P_IP & 0xff;
+    uint8_t* t_ip = &t_frame[ ETH_HLEN ];
+    t_ip[ 0 ] = 0x45;
+    t_ip[ 6 ] = a_frag_offset >> 8;
+    t_ip[ 7 ] = a_frag_offset & 0xff;
+    t_ip[ 9 ] = a_protocol;
+    for( unsigned i_byte = 0; i_byte < 4; ++i_byte ) t_ip[ 12 + i_byte ] = uint8_t( a_source >> ( 8 * ( 3 - i_byte ) ) );
+    uint8_t* t_udp = t_ip + 20;
+    t_udp[ 2 ] = a_dest_port >> 8;
+    t_udp[ 3 ] = a_dest_port & 0xff;
+    return t_frame;
+}
+
+/// Increases the number of entries (a_source_fraction of them sources) until build_filter throws, and checks the largest program; returns the number of failures
+unsigned check_limit( const std::string& a_name, double a_source_fraction )
+{
+    const uint32_t t_port = 23530;
+    const uint32_t t_first_source = 0x0a000001; // 10.0.0.1
+    const uint32_t t_unlisted_source = 0xc0a80001; // 192.168.0.1
+
+    std::vector< sock_filter > t_code;
+    std::vector< unsigned > t_extra_ports;
+    std::vector< uint32_t > t_sources;
+    for( unsigned t_n_entries = 0; t_n_entries < 1000; ++t_n_entries )
+    {
+        unsigned t_n_sources = unsigned( a_source_fraction * t_n_entries + 0.5 );
+        std::vector< unsigned > t_these_ports;
+        std::vector< uint32_t > t_these_sources;
+        for( unsigned i_port = 0; i_port < t_n_entries - t_n_sources; ++i_port ) t_these_ports.push_back( t_port + 1 + i_port );
+        for( unsigned i_source = 0; i_source < t_n_sources; ++i_source ) t_these_sources.push_back( htonl( t_first_source + i_source ) );
+
+        try
+        {
+            t_code = packet_receiver_fpa::build_filter( t_port, t_these_ports, t_these_sources );
+            t_extra_ports.swap( t_these_ports );
+            t_sources.swap( t_these_sources );
+        }
+        catch( error& e )
+        {
+            LINFO( plog, a_name << ": build_filter refused " << t_n_sources << " sources and " << t_n_entries - t_n_sources << " extra ports (" << e.what() << ")" );
+            break;
+        }
+    }
+    if( t_code.empty() || t_sources.size() + t_extra_ports.size() >= 999 )
+    {
+        LERROR( plog, a_name << ": build_filter didn't refuse too many entries" );
+        return 1;
+    }
+
+    LINFO( plog, a_name << ": checking the largest program (" << t_code.size() << " instructions, "
+            << t_sources.size() << " sources and " << t_extra_ports.size() << " extra ports)" );
+
+    uint32_t t_last_source = t_sources.empty() ? t_first_source : ntohl( t_sources.back() );
+    uint16_t t_last_port = t_extra_ports.empty() ? t_port : t_extra_ports.back();
+    struct frame_check
+    {
+        std::string f_description;
+        std::vector< uint8_t > f_frame;
+        bool f_accept;
+    };
+    std::vector< frame_check > t_checks = {
+            { "first source, main port", make_frame( t_first_source, t_port ), true },
+            { "last source, last port", make_frame( t_last_source, t_last_port ), true },
+            { "unlisted port", make_frame( t_first_source, t_last_port + 1 ), false },
+            { "non-UDP", make_frame( t_first_source, t_port, IPPROTO_TCP ), false },
+            { "fragment", make_frame( t_first_source, t_port, IPPROTO_UDP, 100 ), false }
+    };
+    if( ! t_sources.empty() ) t_checks.push_back( { "unlisted source", make_frame( t_unlisted_source, t_port ), false } );
+
+    unsigned t_n_failures = 0;
+    for( const frame_check& t_check : t_checks )
+    {
+        try
+        {
+            bool t_accepted = run_filter( t_code, t_check.f_frame ) != 0;
+            if( t_accepted != t_check.f_accept )
+            {
+                LERROR( plog, a_name << ": packet (" << t_check.f_description << ") was " << ( t_accepted ? "accepted" : "dropped" ) );
+                ++t_n_failures;
+            }
+        }
+        catch( error& e )
+        {
+            LERROR( plog, a_name << ": packet (" << t_check.f_description << "): " << e.what() );
+            ++t_n_failures;
+        }
+    }
+    return t_n_failures;
+}
+
+int main()
+{
+    try
+    {
+        unsigned t_n_failures = 0;
+        t_n_failures += check_limit( "Sources only", 1. );
+        t_n_failures += check_limit( "Extra ports only", 0. );
+        t_n_failures += check_limit( "Sources and extra ports", 0.5 );
+
+        if( t_n_failures != 0 )
+        {
+            LERROR( plog, "Filter check failed: " << t_n_failures << " failures" );
+            return -1;
+        }
+
+        LINFO( plog, "Filter check passed" );
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
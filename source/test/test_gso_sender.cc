@@ -0,0 +1,157 @@
+/*
+ * test_gso_sender.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Sends ROACH-sized UDP packets with UDP segmentation offload (UDP_SEGMENT): each send() hands the kernel several
+ *  packets at once, which it splits into individual datagrams.  On loopback, a receiver with UDP_GRO enabled gets them
+ *  back as coalesced super-datagrams, so this exercises the "gro" option of packet_receiver_socket without a NIC.
+ *
+ *  Usage: > test_gso_sender [options]
+ *
+ *  Parameters:
+ *    - ip: (string) IP address to send to; default is "127.0.0.1"
+ *    - port: (uint) port to send to; default is 23530
+ *    - packet-size: (uint) size of each packet in bytes; default is 8224 (a ROACH packet)
+ *    - segments: (uint) number of packets per send() call (at most 64, and at most 65507 bytes in total); default is 7
+ *    - n-packets: (uint) number of packets to send; default is 1000000
+ *    - short-size: (uint) if nonzero, a packet of this many bytes (less than packet-size) is added to the end of each send() call,
+ *                  so that each super-datagram ends with a short segment; default is 0
+ *
+ *  Requires Linux 4.18 or later.  Receive with, e.g.: > test_packet_receivers receiver=socket gro=true
+ *  Each packet starts with a big-endian 64-bit packet count, and is otherwise zero.  Short packets are not counted in n-packets;
+ *  the receiver should output them with their own size (check with: > test_packet_receivers receiver=socket gro=true packet-size=8224 short-size=...).
+ */
+
+#include "psyllid_error.hh"
+
+#include "configurator.hh"
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_gso_sender" );
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        scarab::param_node t_default_config;
+        t_default_config.add( "ip", scarab::param_value( "127.0.0.1" ) );
+        t_default_config.add( "port", scarab::param_value( 23530 ) );
+        t_default_config.add( "packet-size", scarab::param_value( 8224 ) );
+        t_default_config.add( "segments", scarab::param_value( 7 ) );
+        t_default_config.add( "n-packets", scarab::param_value( 1000000 ) );
+        t_default_config.add( "short-size", scarab::param_value( 0 ) );
+
+        scarab::configurator t_configurator( argc, argv, t_default_config );
+
+        std::string t_ip( t_configurator.get< std::string >( "ip" ) );
+        unsigned t_port = t_configurator.get< unsigned >( "port" );
+        unsigned t_packet_size = t_configurator.get< unsigned >( "packet-size" );
+        unsigned t_segments = t_configurator.get< unsigned >( "segments" );
+        uint64_t t_n_packets = t_configurator.get< uint64_t >( "n-packets" );
+        unsigned t_short_size = t_configurator.get< unsigned >( "short-size" );
+
+        unsigned t_n_segments = t_short_size == 0 ? t_segments : t_segments + 1;
+        if( t_packet_size < sizeof(uint64_t) || t_segments == 0 || t_n_segments > 64 || t_packet_size * t_segments + t_short_size > 65507 )
+        {
+            throw error() << "Invalid packet size (" << t_packet_size << ") or number of segments (" << t_segments << ")";
+        }
+        if( t_short_size >= t_packet_size )
+        {
+            throw error() << "The short packet size (" << t_short_size << ") must be less than the packet size (" << t_packet_size << ")";
+        }
+
+        int t_socket = ::socket( AF_INET, SOCK_DGRAM, 0 );
+        if( t_socket < 0 )
+        {
+            throw error() << "Could not create socket: " << strerror( errno );
+        }
+
+        sockaddr_in t_address;
+        ::memset( &t_address, 0, sizeof(sockaddr_in) );
+        t_address.sin_family = AF_INET;
+        t_address.sin_port = htons( t_port );
+        if( ::inet_pton( AF_INET, t_ip.c_str(), &t_address.sin_addr ) != 1 )
+        {
+            throw error() << "Invalid IP address: " << t_ip;
+        }
+        if( ::connect( t_socket, (const sockaddr*)&t_address, sizeof(sockaddr_in) ) < 0 )
+        {
+            throw error() << "Could not connect socket: " << strerror( errno );
+        }
+
+        // every send() is split into datagrams of this size
+        int t_gso_size = t_packet_size;
+        if( ::setsockopt( t_socket, SOL_UDP, UDP_SEGMENT, &t_gso_size, sizeof(t_gso_size) ) < 0 )
+        {
+            throw error() << "Could not enable UDP_SEGMENT: " << strerror( errno );
+        }
+
+        // the short packet, if any, is all ones, so that it can't be mistaken for the start of a full packet
+        std::vector< uint8_t > t_buffer( t_packet_size * t_segments + t_short_size, 0 );
+
+        LINFO( plog, "Sending " << t_n_packets << " packets of " << t_packet_size << " bytes to " << t_ip << ":" << t_port << ", " << t_segments << " per call" );
+
+        uint64_t t_sent = 0;
+        std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+        while( t_sent < t_n_packets )
+        {
+            unsigned t_n_this_call = std::min< uint64_t >( t_segments, t_n_packets - t_sent );
+            for( unsigned i_seg = 0; i_seg < t_n_this_call; ++i_seg )
+            {
+                uint64_t t_count = t_sent + i_seg;
+                for( unsigned i_byte = 0; i_byte < sizeof(uint64_t); ++i_byte )
+                {
+                    t_buffer[ i_seg * t_packet_size + i_byte ] = uint8_t( t_count >> ( 8 * ( sizeof(uint64_t) - 1 - i_byte ) ) );
+                }
+            }
+
+            size_t t_n_bytes = t_n_this_call * t_packet_size;
+            if( t_short_size != 0 )
+            {
+                ::memset( t_buffer.data() + t_n_bytes, 0xff, t_short_size );
+                t_n_bytes += t_short_size;
+            }
+
+            if( ::send( t_socket, t_buffer.data(), t_n_bytes, 0 ) < 0 )
+            {
+                // the receiver isn't listening yet, or its buffer is full; try again
+                if( errno == ECONNREFUSED || errno == ENOBUFS || errno == EAGAIN ) continue;
+                throw error() << "Could not send: " << strerror( errno );
+            }
+            t_sent += t_n_this_call;
+        }
+        double t_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+
+        LINFO( plog, "Sent " << t_sent << " packets in " << t_seconds << " s" );
+        if( t_seconds > 0. )
+        {
+            LINFO( plog, "Packet rate: " << double(t_sent) / t_seconds << " packets/s" );
+            LINFO( plog, "Data rate: " << double(t_sent * t_packet_size) * 8.e-9 / t_seconds << " Gb/s" );
+        }
+
+        ::close( t_socket );
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
@@ -0,0 +1,414 @@
+/*
+ * test_packet_batches.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Checks the batched trigger chain, and measures the packet rate through a receiver and its downstream streams as a
+ *  function of the batch size.
+ *
+ *  The trigger check feeds the same sequence of spectra (a few of them with a bin above the mask, alone and in bursts) to a
+ *  frequency_mask_trigger and event_builder, and to a frequency_mask_batch_trigger and event_batch_builder with each batch
+ *  size.  The trigger flags are read one at a time, as the triggered writer reads them, and the batched chains must give
+ *  the same ids and flags, in the same order, as the single-packet chain.  The triggered writer itself isn't run, since it
+ *  needs a butterfly house and run control to write files.
+ *
+ *  A data_producer feeds packets as fast as it can to either a tf_roach_receiver (one packet per stream slot) or a
+ *  tf_roach_batch_receiver (batch-size packets per slot), whose outputs are read by nodes that count the packets.
+ *  Each configuration runs for a fixed time, and the rate of packets reaching the counters is reported.
+ *  No network is involved, so this measures the cost of the receiver and of the stream hand-offs.
+ *
+ *  The receivers copy the packets rather than handing them off, because the data_producer doesn't refill the blocks it gets back.
+ *
+ *  Usage: > test_packet_batches [options]
+ *
+ *  Parameters:
+ *    - duration: (uint) seconds to run each configuration; default is 2
+ *    - batch-sizes: (array of uints) batch sizes to measure; default is [1, 4, 16, 64]
+ *    - length: (uint) length of the stream buffers, in slots; default is 100
+ *    - n-trigger-packets: (uint) number of spectra in the trigger check; default is 1000
+ *
+ *  Returns a nonzero value if a batched trigger chain doesn't match the single-packet chain.
+ */
+
+#include "data_producer.hh"
+#include "event_builder.hh"
+#include "frequency_mask_trigger.hh"
+#include "packet_batch.hh"
+#include "packet_unbatch.hh"
+#include "psyllid_error.hh"
+#include "tf_roach_batch_receiver.hh"
+#include "tf_roach_receiver.hh"
+
+#include "consumer.hh"
+#include "diptera.hh"
+#include "producer.hh"
+
+#include "configurator.hh"
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_packet_batches" );
+
+/// Counts the packets it receives, whether they arrive one at a time or in batches
+template< class x_input_type >
+class packet_counter : public midge::_consumer< midge::type_list< x_input_type > >
+{
+    public:
+        packet_counter() :
+                f_n_packets( 0 )
+        {}
+        virtual ~packet_counter() {}
+
+        mv_accessible_noset( uint64_t, n_packets );
+
+    public:
+        virtual void initialize() {}
+
+        virtual void execute( midge::diptera* a_midge = nullptr )
+        {
+            try
+            {
+                while( ! this->is_canceled() )
+                {
+                    midge::enum_t t_command = this->template in_stream< 0 >().get();
+                    if( t_command == midge::stream::s_error || t_command == midge::stream::s_exit ) break;
+                    if( t_command != midge::stream::s_run ) continue;
+
+                    for_each_packet( *this->template in_stream< 0 >().data(), [this]( roach_packet_data& ){ ++f_n_packets; } );
+                }
+                return;
+            }
+            catch(...)
+            {
+                if( a_midge ) a_midge->throw_ex( std::current_exception() );
+                else throw;
+            }
+        }
+
+        virtual void finalize() {}
+};
+
+/// Whether spectrum a_id of the trigger check has a bin above the mask: an isolated spectrum every 23, and bursts of 5 every 35
+bool is_above_mask( uint64_t a_id )
+{
+    return a_id % 23 == 0 || ( a_id / 5 ) % 7 == 3;
+}
+
+/// The mask level in the trigger check, in power; the bin above it has power 2 x 20^2
+const double s_mask_level = 100.;
+
+/// Outputs a fixed sequence of spectra, a_batch_size per slot, then stops and exits
+template< class x_output_type >
+class spectrum_producer : public midge::_producer< midge::type_list< x_output_type > >
+{
+    public:
+        spectrum_producer() :
+                f_length( 10 ),
+                f_n_packets( 1000 ),
+                f_batch_size( 1 )
+        {}
+        virtual ~spectrum_producer() {}
+
+        mv_accessible( uint64_t, length );
+        mv_accessible( uint64_t, n_packets );
+        mv_accessible( unsigned, batch_size );
+
+    public:
+        virtual void initialize()
+        {
+            this->template out_buffer< 0 >().initialize( f_length );
+        }
+
+        virtual void execute( midge::diptera* a_midge = nullptr )
+        {
+            try
+            {
+                if( ! this->template out_stream< 0 >().set( midge::stream::s_start ) ) return;
+
+                uint64_t t_id = 0;
+                while( t_id < f_n_packets && ! this->is_canceled() )
+                {
+                    x_output_type* t_slot = this->template out_stream< 0 >().data();
+                    unsigned t_n_in_slot = unsigned( std::min< uint64_t >( f_batch_size, f_n_packets - t_id ) );
+                    _slot_traits< x_output_type >::set_n_packets( *t_slot, t_n_in_slot );
+                    for( unsigned i_packet = 0; i_packet < t_n_in_slot; ++i_packet, ++t_id )
+                    {
+                        freq_data& t_freq = _slot_traits< x_output_type >::packet( *t_slot, i_packet );
+                        ::memset( t_freq.get_array(), 0, t_freq.get_array_size() * sizeof( freq_data::iq_t ) );
+                        t_freq.set_freq_not_time( true );
+                        t_freq.set_pkt_in_batch( t_id % BATCH_COUNTER_SIZE );
+                        t_freq.set_pkt_in_session( t_id );
+                        if( is_above_mask( t_id ) )
+                        {
+                            t_freq.get_array()[ 100 ][ 0 ] = 20;
+                            t_freq.get_array()[ 100 ][ 1 ] = 20;
+                        }
+                    }
+                    if( ! this->template out_stream< 0 >().set( midge::stream::s_run ) ) return;
+                }
+
+                if( ! this->template out_stream< 0 >().set( midge::stream::s_stop ) ) return;
+                this->template out_stream< 0 >().set( midge::stream::s_exit );
+                return;
+            }
+            catch(...)
+            {
+                if( a_midge ) a_midge->throw_ex( std::current_exception() );
+                else throw;
+            }
+        }
+
+        virtual void finalize()
+        {
+            this->template out_buffer< 0 >().finalize();
+        }
+};
+
+typedef std::vector< std::pair< uint64_t, bool > > flag_sequence;
+
+/// Records the id and flag of each trigger flag it receives, reading them one at a time
+template< class x_input_type >
+class flag_recorder : public midge::_consumer< midge::type_list< x_input_type > >
+{
+    public:
+        flag_recorder() :
+                f_flags()
+        {}
+        virtual ~flag_recorder() {}
+
+        mv_referrable( flag_sequence, flags );
+
+    public:
+        virtual void initialize() {}
+
+        virtual void execute( midge::diptera* a_midge = nullptr )
+        {
+            try
+            {
+                _packet_reader< x_input_type > t_reader;
+                while( ! this->is_canceled() )
+                {
+                    midge::enum_t t_command = t_reader.next( this->template in_stream< 0 >() );
+                    if( t_command == midge::stream::s_error || t_command == midge::stream::s_exit ) break;
+                    if( t_command != midge::stream::s_run ) continue;
+
+                    f_flags.push_back( std::make_pair( t_reader.packet().get_id(), t_reader.packet().get_flag() ) );
+                }
+                return;
+            }
+            catch(...)
+            {
+                if( a_midge ) a_midge->throw_ex( std::current_exception() );
+                else throw;
+            }
+        }
+
+        virtual void finalize() {}
+};
+
+/// Runs a_n_packets spectra through a frequency mask trigger and event builder; returns the flags that come out
+template< class x_freq_type, class x_flag_type >
+flag_sequence run_trigger_chain( unsigned a_batch_size, uint64_t a_n_packets, unsigned a_length )
+{
+    midge::diptera* t_root = new midge::diptera();
+
+    spectrum_producer< x_freq_type >* t_producer = new spectrum_producer< x_freq_type >();
+    t_producer->set_name( "prod" );
+    t_producer->set_length( a_length );
+    t_producer->set_n_packets( a_n_packets );
+    t_producer->set_batch_size( a_batch_size );
+    t_root->add( t_producer );
+
+    scarab::param_array t_mask, t_mask2, t_zeros;
+    for( unsigned i_bin = 0; i_bin < PAYLOAD_SIZE / 2; ++i_bin )
+    {
+        t_mask.push_back( scarab::param_value( s_mask_level ) );
+        t_mask2.push_back( scarab::param_value( 2. * s_mask_level ) );
+        t_zeros.push_back( scarab::param_value( 0. ) );
+    }
+    scarab::param_node t_mask_node;
+    t_mask_node.add( "n-packets", scarab::param_value( 1 ) );
+    t_mask_node.add( "mask", t_mask );
+    t_mask_node.add( "mask2", t_mask2 );
+    t_mask_node.add( "data-mean", t_zeros );
+    t_mask_node.add( "data-variance", t_zeros );
+
+    _frequency_mask_trigger< x_freq_type, x_flag_type >* t_fmt = new _frequency_mask_trigger< x_freq_type, x_flag_type >();
+    t_fmt->set_name( "fmt" );
+    t_fmt->set_length( a_length );
+    t_fmt->set_mask_parameters_from_node( t_mask_node );
+    t_fmt->switch_to_apply_trigger();
+    t_root->add( t_fmt );
+
+    _event_builder< x_flag_type >* t_builder = new _event_builder< x_flag_type >();
+    t_builder->set_name( "eb" );
+    t_builder->set_length( a_length );
+    t_builder->set_pretrigger( 2 );
+    t_builder->set_skip_tolerance( 3 );
+    t_root->add( t_builder );
+
+    flag_recorder< x_flag_type >* t_recorder = new flag_recorder< x_flag_type >();
+    t_recorder->set_name( "rec" );
+    t_root->add( t_recorder );
+
+    t_root->join( "prod.out_0:fmt.in_0" );
+    t_root->join( "fmt.out_0:eb.in_0" );
+    t_root->join( "eb.out_0:rec.in_0" );
+
+    std::exception_ptr t_e_ptr = t_root->run( "prod:fmt:eb:rec" );
+    if( t_e_ptr ) std::rethrow_exception( t_e_ptr );
+
+    flag_sequence t_flags = t_recorder->flags();
+    delete t_root;
+
+    return t_flags;
+}
+
+/// Compares the batched trigger chain with the single-packet chain for each batch size; returns the number of failures
+unsigned check_trigger_chain( const std::vector< unsigned >& a_batch_sizes, uint64_t a_n_packets, unsigned a_length )
+{
+    flag_sequence t_reference = run_trigger_chain< freq_data, trigger_flag >( 1, a_n_packets, a_length );
+
+    unsigned t_n_failures = 0;
+    unsigned t_n_triggered = std::count_if( t_reference.begin(), t_reference.end(), []( const std::pair< uint64_t, bool >& a_flag ){ return a_flag.second; } );
+    if( t_n_triggered == 0 || t_n_triggered == t_reference.size() )
+    {
+        LERROR( plog, "Single-packet trigger chain triggered on " << t_n_triggered << " of " << t_reference.size() << " spectra" );
+        ++t_n_failures;
+    }
+    for( uint64_t i_flag = 0; i_flag < t_reference.size(); ++i_flag )
+    {
+        if( t_reference[ i_flag ].first != i_flag )
+        {
+            LERROR( plog, "Single-packet trigger chain output id " << t_reference[ i_flag ].first << " at position " << i_flag );
+            ++t_n_failures;
+            break;
+        }
+    }
+    LINFO( plog, "Single-packet trigger chain: " << t_reference.size() << " flags, " << t_n_triggered << " triggered" );
+
+    for( unsigned t_batch_size : a_batch_sizes )
+    {
+        flag_sequence t_flags = run_trigger_chain< freq_data_batch, trigger_flag_batch >( t_batch_size, a_n_packets, a_length );
+        if( t_flags != t_reference )
+        {
+            auto t_mismatch = std::mismatch( t_flags.begin(), t_flags.end(), t_reference.begin(), t_reference.end() );
+            LERROR( plog, "Batched trigger chain (batch size " << t_batch_size << ") gave " << t_flags.size() << " flags; the first difference from the single-packet chain is at position "
+                    << t_mismatch.first - t_flags.begin() );
+            ++t_n_failures;
+            continue;
+        }
+        LINFO( plog, "Batched trigger chain (batch size " << t_batch_size << ") matches the single-packet chain" );
+    }
+
+    return t_n_failures;
+}
+
+/// Runs the chain until the producer is canceled after a_duration seconds; returns the rate of packets at the counters
+template< class x_receiver, class x_time_input, class x_freq_input >
+double run_chain( x_receiver* a_receiver, unsigned a_length, unsigned a_duration )
+{
+    midge::diptera* t_root = new midge::diptera();
+
+    data_producer* t_producer = new data_producer();
+    t_producer->set_name( "prod" );
+    t_producer->set_length( a_length );
+    t_root->add( t_producer );
+
+    a_receiver->set_name( "rec" );
+    a_receiver->set_time_length( a_length );
+    a_receiver->set_freq_length( a_length );
+    a_receiver->set_start_paused( false );
+    a_receiver->set_hand_off( false );
+    t_root->add( a_receiver );
+
+    packet_counter< x_time_input >* t_time_counter = new packet_counter< x_time_input >();
+    t_time_counter->set_name( "count_t" );
+    t_root->add( t_time_counter );
+
+    packet_counter< x_freq_input >* t_freq_counter = new packet_counter< x_freq_input >();
+    t_freq_counter->set_name( "count_f" );
+    t_root->add( t_freq_counter );
+
+    t_root->join( "prod.out_0:rec.in_0" );
+    t_root->join( "rec.out_0:count_t.in_0" );
+    t_root->join( "rec.out_1:count_f.in_0" );
+
+    std::thread t_timer( [t_producer, a_duration](){
+        std::this_thread::sleep_for( std::chrono::seconds( a_duration ) );
+        t_producer->cancel();
+    } );
+
+    std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+    std::exception_ptr t_e_ptr = t_root->run( "prod:rec:count_t:count_f" );
+    double t_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+    t_timer.join();
+
+    if( t_e_ptr ) std::rethrow_exception( t_e_ptr );
+
+    uint64_t t_n_packets = t_time_counter->get_n_packets() + t_freq_counter->get_n_packets();
+    delete t_root;
+
+    return double(t_n_packets) / t_seconds;
+}
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        scarab::param_node t_default_config;
+        t_default_config.add( "duration", scarab::param_value( 2 ) );
+        t_default_config.add( "length", scarab::param_value( 100 ) );
+        t_default_config.add( "n-trigger-packets", scarab::param_value( 1000 ) );
+        scarab::param_array t_default_sizes;
+        t_default_sizes.push_back( scarab::param_value( 1 ) );
+        t_default_sizes.push_back( scarab::param_value( 4 ) );
+        t_default_sizes.push_back( scarab::param_value( 16 ) );
+        t_default_sizes.push_back( scarab::param_value( 64 ) );
+        t_default_config.add( "batch-sizes", t_default_sizes );
+
+        scarab::configurator t_configurator( argc, argv, t_default_config );
+
+        unsigned t_duration = t_configurator.get< unsigned >( "duration" );
+        unsigned t_length = t_configurator.get< unsigned >( "length" );
+        uint64_t t_n_trigger_packets = t_configurator.get< unsigned >( "n-trigger-packets" );
+        const scarab::param_array& t_sizes = t_configurator.config()[ "batch-sizes" ].as_array();
+        std::vector< unsigned > t_batch_sizes;
+        for( unsigned i_size = 0; i_size < t_sizes.size(); ++i_size ) t_batch_sizes.push_back( t_sizes[ i_size ]().as_uint() );
+
+        if( check_trigger_chain( t_batch_sizes, t_n_trigger_packets, t_length ) != 0 )
+        {
+            LERROR( plog, "Trigger chain check failed" );
+            return -1;
+        }
+
+        double t_rate = run_chain< tf_roach_receiver, time_data, freq_data >( new tf_roach_receiver(), t_length, t_duration );
+        LINFO( plog, "tf_roach_receiver (single packets): " << t_rate << " packets/s" );
+        double t_reference_rate = t_rate;
+
+        for( unsigned t_batch_size : t_batch_sizes )
+        {
+            tf_roach_batch_receiver* t_receiver = new tf_roach_batch_receiver();
+            t_receiver->set_batch_size( t_batch_size );
+            t_rate = run_chain< tf_roach_batch_receiver, time_data_batch, freq_data_batch >( t_receiver, t_length, t_duration );
+            LINFO( plog, "tf_roach_batch_receiver (batch size " << t_batch_size << "): " << t_rate << " packets/s (" << t_rate / t_reference_rate << " x single packets)" );
+        }
+
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
@@ -0,0 +1,295 @@
+/*
+ * test_packet_receivers.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Suggested UDP client: roach_simulator.go, with -pkt-delay 0 (or small) to saturate the receiver
+ *
+ *  Usage: > test_packet_receivers [options]
+ *
+ *  Parameters:
+ *    - receiver: (string) packet receiver to benchmark: "socket", "fpa", "uring", "xdp", or "replay"; default is "socket"
+ *    - ip: (string) IP address to listen on (socket and uring); default is "127.0.0.1"
+ *    - interface: (string) network interface to listen on (fpa and xdp); default is "lo"
+ *    - port: (uint) port number to listen on for packets; default is 23530
+ *    - length: (uint) output buffer length; default is 10
+ *    - batch-size: (uint) recvmmsg batch size for the socket receiver; default is 1
+ *    - gro: (bool) enable UDP GRO in the socket receiver (drive it with test_gso_sender on loopback); default is false
+ *    - duration: (uint) seconds to run after starting; 0 runs until ctrl-c; default is 10
+ *    - filename: (string) pcap file for the replay "receiver", which replays it once as fast as possible; default is "capture.pcap"
+ *    - packet-size: (uint) if nonzero, every packet received must have this many bytes (or short-size bytes); default is 0
+ *    - short-size: (uint) if nonzero, the size of the short packets sent by test_gso_sender short-size=...; default is 0
+ *
+ *  The receiver feeds a counting consumer that reports the number of packets and bytes, and the packet and data rates
+ *  between the first and last packets received.  Run each receiver with the same packet generator settings to compare them.
+ *  With packet-size set, the numbers of short packets and of packets of any other size are reported too, and the latter make
+ *  the test fail (e.g. to check that the socket receiver splits GRO super-datagrams ending in a short segment correctly).
+ *  The fpa and xdp receivers require root.  The replay "receiver" needs no network, and measures how fast packets can be handed downstream.
+ */
+
+#ifdef BUILD_FPA
+#include "packet_receiver_fpa.hh"
+#endif
+#include "packet_receiver_socket.hh"
+#include "packet_replay.hh"
+#ifdef BUILD_IO_URING
+#include "packet_receiver_uring.hh"
+#endif
+#ifdef BUILD_XDP
+#include "packet_receiver_xdp.hh"
+#endif
+#include "psyllid_error.hh"
+
+#include "consumer.hh"
+#include "diptera.hh"
+
+#include "configurator.hh"
+#include "logger.hh"
+#include "param.hh"
+
+#include <chrono>
+
+#include <signal.h>
+#include <unistd.h>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_packet_receivers" );
+
+scarab::cancelable* f_cancelable = nullptr;
+
+void cancel( int )
+{
+    LINFO( plog, "Attempting to cancel" );
+    if( f_cancelable != nullptr ) f_cancelable->cancel();
+    return;
+}
+
+class packet_counter : public midge::_consumer< midge::type_list< memory_block > >
+{
+    public:
+        packet_counter( unsigned a_packet_size, unsigned a_short_size ) :
+                f_packet_size( a_packet_size ),
+                f_short_size( a_short_size ),
+                f_short( 0 ),
+                f_packets( 0 ),
+                f_bytes( 0 ),
+                f_wrong_size( 0 ),
+                f_first(),
+                f_last()
+        {}
+        virtual ~packet_counter() {}
+
+    public:
+        virtual void initialize() {}
+
+        virtual void execute( midge::diptera* a_midge = nullptr )
+        {
+            try
+            {
+                midge::enum_t t_command = midge::stream::s_none;
+                while( ! is_canceled() )
+                {
+                    t_command = in_stream< 0 >().get();
+                    if( t_command == midge::stream::s_none ) continue;
+                    if( t_command == midge::stream::s_error ) break;
+                    if( t_command == midge::stream::s_exit ) break;
+
+                    if( t_command == midge::stream::s_run )
+                    {
+                        f_last = std::chrono::steady_clock::now();
+                        if( f_packets == 0 ) f_first = f_last;
+                        ++f_packets;
+                        size_t t_size = in_stream< 0 >().data()->get_n_bytes_used();
+                        f_bytes += t_size;
+                        if( f_short_size != 0 && t_size == f_short_size ) ++f_short;
+                        else if( f_packet_size != 0 && t_size != f_packet_size ) ++f_wrong_size;
+                    }
+                }
+                return;
+            }
+            catch(...)
+            {
+                if( a_midge ) a_midge->throw_ex( std::current_exception() );
+                else throw;
+            }
+        }
+
+        virtual void finalize() {}
+
+        void report() const
+        {
+            double t_seconds = std::chrono::duration< double >( f_last - f_first ).count();
+            LINFO( plog, "Received " << f_packets << " packets (" << f_bytes << " bytes) in " << t_seconds << " s" );
+            if( f_short_size != 0 ) LINFO( plog, "Short packets (" << f_short_size << " bytes): " << f_short );
+            if( f_packet_size != 0 ) LINFO( plog, "Packets of any other size: " << f_wrong_size );
+            if( f_packets > 1 && t_seconds > 0. )
+            {
+                LINFO( plog, "Packet rate: " << double(f_packets - 1) / t_seconds << " packets/s" );
+                LINFO( plog, "Data rate: " << double(f_bytes) * 8.e-9 / t_seconds << " Gb/s" );
+            }
+            return;
+        }
+
+        uint64_t get_wrong_size() const
+        {
+            return f_wrong_size;
+        }
+
+    private:
+        unsigned f_packet_size;
+        unsigned f_short_size;
+        uint64_t f_short;
+        uint64_t f_packets;
+        uint64_t f_bytes;
+        uint64_t f_wrong_size;
+        std::chrono::steady_clock::time_point f_first;
+        std::chrono::steady_clock::time_point f_last;
+};
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        scarab::param_node t_default_config;
+        t_default_config.add( "receiver", scarab::param_value( "socket" ) );
+        t_default_config.add( "ip", scarab::param_value( "127.0.0.1" ) );
+        t_default_config.add( "interface", scarab::param_value( "lo" ) );
+        t_default_config.add( "port", scarab::param_value( 23530 ) );
+        t_default_config.add( "length", scarab::param_value( 10 ) );
+        t_default_config.add( "batch-size", scarab::param_value( 1 ) );
+        t_default_config.add( "gro", scarab::param_value( false ) );
+        t_default_config.add( "duration", scarab::param_value( 10 ) );
+        t_default_config.add( "filename", scarab::param_value( "capture.pcap" ) );
+        t_default_config.add( "packet-size", scarab::param_value( 0 ) );
+        t_default_config.add( "short-size", scarab::param_value( 0 ) );
+
+        scarab::configurator t_configurator( argc, argv, t_default_config );
+
+        std::string t_receiver( t_configurator.get< std::string >( "receiver" ) );
+        std::string t_ip( t_configurator.get< std::string >( "ip" ) );
+        std::string t_interface( t_configurator.get< std::string >( "interface" ) );
+        unsigned t_port = t_configurator.get< unsigned >( "port" );
+        unsigned t_length = t_configurator.get< unsigned >( "length" );
+        unsigned t_batch_size = t_configurator.get< unsigned >( "batch-size" );
+        bool t_gro = t_configurator.get< bool >( "gro" );
+        unsigned t_duration = t_configurator.get< unsigned >( "duration" );
+        std::string t_filename( t_configurator.get< std::string >( "filename" ) );
+        unsigned t_packet_size = t_configurator.get< unsigned >( "packet-size" );
+        unsigned t_short_size = t_configurator.get< unsigned >( "short-size" );
+
+        LINFO( plog, "Creating and configuring nodes; benchmarking the " << t_receiver << " receiver" );
+
+        midge::diptera* t_root = new midge::diptera();
+
+        if( t_receiver == "socket" )
+        {
+            packet_receiver_socket* t_pck_rec = new packet_receiver_socket();
+            t_pck_rec->set_length( t_length );
+            t_pck_rec->set_port( t_port );
+            t_pck_rec->ip() = t_ip;
+            t_pck_rec->set_batch_size( t_batch_size );
+            t_pck_rec->set_gro( t_gro );
+            f_cancelable = t_pck_rec;
+        }
+        else if( t_receiver == "replay" )
+        {
+            packet_replay* t_pck_rec = new packet_replay();
+            t_pck_rec->set_length( t_length );
+            t_pck_rec->filename() = t_filename;
+            t_pck_rec->timing() = "fast";
+            t_pck_rec->set_start_paused( false );
+            f_cancelable = t_pck_rec;
+        }
+#ifdef BUILD_FPA
+        else if( t_receiver == "fpa" )
+        {
+            packet_receiver_fpa* t_pck_rec = new packet_receiver_fpa();
+            t_pck_rec->set_length( t_length );
+            t_pck_rec->set_port( t_port );
+            t_pck_rec->interface() = t_interface;
+            f_cancelable = t_pck_rec;
+        }
+#endif
+#ifdef BUILD_IO_URING
+        else if( t_receiver == "uring" )
+        {
+            packet_receiver_uring* t_pck_rec = new packet_receiver_uring();
+            t_pck_rec->set_length( t_length );
+            t_pck_rec->set_port( t_port );
+            t_pck_rec->ip() = t_ip;
+            f_cancelable = t_pck_rec;
+        }
+#endif
+#ifdef BUILD_XDP
+        else if( t_receiver == "xdp" )
+        {
+            packet_receiver_xdp* t_pck_rec = new packet_receiver_xdp();
+            t_pck_rec->set_length( t_length );
+            t_pck_rec->set_port( t_port );
+            t_pck_rec->interface() = t_interface;
+            f_cancelable = t_pck_rec;
+        }
+#endif
+        else
+        {
+            throw error() << "Unknown (or not built) receiver: " << t_receiver;
+        }
+
+        midge::node* t_pck_rec_node = dynamic_cast< midge::node* >( f_cancelable );
+        t_pck_rec_node->set_name( "pck_rec" );
+        t_root->add( t_pck_rec_node );
+
+        packet_counter* t_counter = new packet_counter( t_packet_size, t_short_size );
+        t_counter->set_name( "counter" );
+        t_root->add( t_counter );
+
+        LINFO( plog, "Connecting nodes" );
+
+        t_root->join( "pck_rec.out_0:counter.in_0" );
+
+        // set up signal handling for canceling with ctrl-c or after the requested duration
+        signal( SIGINT, cancel );
+        if( t_duration > 0 )
+        {
+            signal( SIGALRM, cancel );
+            alarm( t_duration );
+            LINFO( plog, "Running for " << t_duration << " s; exit early with ctrl-c" );
+        }
+        else
+        {
+            LINFO( plog, "Exit with ctrl-c" );
+        }
+
+        LINFO( plog, "Executing" );
+
+        std::exception_ptr t_e_ptr = t_root->run( "pck_rec:counter" );
+
+        if( t_e_ptr ) std::rethrow_exception( t_e_ptr );
+
+        LINFO( plog, "Execution complete" );
+
+        // un-setup signal handling
+        f_cancelable = nullptr;
+
+        t_counter->report();
+        uint64_t t_wrong_size = t_counter->get_wrong_size();
+
+        delete t_root;
+
+        if( t_wrong_size != 0 )
+        {
+            LERROR( plog, "Received " << t_wrong_size << " packets of an unexpected size" );
+            return -1;
+        }
+
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+
+}
@@ -0,0 +1,261 @@
+/*
+ * test_packet_reorder.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Checks how packet_reorder puts a stream back in order (packet_reorder::handle_packet and advance).
+ *
+ *  A fixed sequence of time packets is run through a time_data_reorder with a window of 4 packets and a max gap of 8, with
+ *  and without gap filling.  The sequence has, in order:
+ *    - packets swapped across the wrap of pkt_in_batch at BATCH_COUNTER_SIZE (390625 -> 0);
+ *    - a duplicate of a packet that's still in the window;
+ *    - a packet that's given up on when the window fills, and then arrives late;
+ *    - a jump of more than the max gap, which restarts the sequence without filling it.
+ *  The pkt_in_batch, pkt_in_session, placeholder flag and payload of each output packet, and the node's packet counts,
+ *  are compared with what's expected.  No network access is needed.
+ *
+ *  Usage: > test_packet_reorder
+ *
+ *  Returns a nonzero value if any output packet or count is wrong.
+ */
+
+#include "packet_reorder.hh"
+#include "psyllid_error.hh"
+
+#include "consumer.hh"
+#include "diptera.hh"
+#include "producer.hh"
+
+#include "logger.hh"
+
+#include <algorithm>
+#include <vector>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_packet_reorder" );
+
+/// The payload marker of a packet: the first payload byte; placeholders have 0
+int8_t payload_marker( uint32_t a_pkt_in_batch )
+{
+    return int8_t( a_pkt_in_batch % 100 + 1 );
+}
+
+/// Outputs time packets with the given pkt_in_batch values, each marked in its payload, then stops and exits
+class sequence_producer : public midge::_producer< midge::type_list< time_data > >
+{
+    public:
+        sequence_producer() :
+                f_length( 10 ),
+                f_sequence()
+        {}
+        virtual ~sequence_producer() {}
+
+        mv_accessible( uint64_t, length );
+        mv_referrable( std::vector< uint32_t >, sequence );
+
+    public:
+        virtual void initialize()
+        {
+            out_buffer< 0 >().initialize( f_length );
+        }
+
+        virtual void execute( midge::diptera* a_midge = nullptr )
+        {
+            try
+            {
+                if( ! out_stream< 0 >().set( midge::stream::s_start ) ) return;
+
+                for( uint32_t t_pkt_in_batch : f_sequence )
+                {
+                    time_data* t_data = out_stream< 0 >().data();
+                    t_data->set_pkt_in_batch( t_pkt_in_batch );
+                    t_data->set_placeholder( false );
+                    t_data->packet().f_data[ 0 ] = payload_marker( t_pkt_in_batch );
+                    if( ! out_stream< 0 >().set( midge::stream::s_run ) ) return;
+                }
+
+                if( ! out_stream< 0 >().set( midge::stream::s_stop ) ) return;
+                out_stream< 0 >().set( midge::stream::s_exit );
+                return;
+            }
+            catch(...)
+            {
+                if( a_midge ) a_midge->throw_ex( std::current_exception() );
+                else throw;
+            }
+        }
+
+        virtual void finalize()
+        {
+            out_buffer< 0 >().finalize();
+        }
+};
+
+struct output_packet
+{
+    uint32_t f_pkt_in_batch;
+    uint64_t f_pkt_in_session;
+    bool f_placeholder;
+    int8_t f_marker;
+};
+
+/// Records the packets it receives
+class packet_recorder : public midge::_consumer< midge::type_list< time_data > >
+{
+    public:
+        packet_recorder() :
+                f_packets()
+        {}
+        virtual ~packet_recorder() {}
+
+        mv_referrable( std::vector< output_packet >, packets );
+
+    public:
+        virtual void initialize() {}
+
+        virtual void execute( midge::diptera* a_midge = nullptr )
+        {
+            try
+            {
+                while( ! is_canceled() )
+                {
+                    midge::enum_t t_command = in_stream< 0 >().get();
+                    if( t_command == midge::stream::s_error || t_command == midge::stream::s_exit ) break;
+                    if( t_command != midge::stream::s_run ) continue;
+
+                    time_data* t_data = in_stream< 0 >().data();
+                    f_packets.push_back( { t_data->get_pkt_in_batch(), t_data->get_pkt_in_session(), t_data->get_placeholder(), t_data->packet().f_data[ 0 ] } );
+                }
+                return;
+            }
+            catch(...)
+            {
+                if( a_midge ) a_midge->throw_ex( std::current_exception() );
+                else throw;
+            }
+        }
+
+        virtual void finalize() {}
+};
+
+/// Runs the sequence through a reorder node, with or without gap filling, and checks the output; returns the number of failures
+unsigned check_sequence( const std::string& a_name, bool a_fill_gaps )
+{
+    const uint32_t t_last = BATCH_COUNTER_SIZE - 1; // 390625, the last pkt_in_batch before the wrap
+    const std::vector< uint32_t > t_sequence = {
+            t_last - 2, t_last, t_last - 1, // reordered before the wrap
+            1, 0,                           // reordered after the wrap
+            3, 3, 2,                        // a duplicate while 3 is waiting for 2
+            5, 6, 7, 8,                     // 8 doesn't fit in the window with 4 missing, so 4 is given up on
+            4,                              // late
+            30,                             // 21 past the head of the window, more than window + max gap: restart
+            32, 31
+    };
+
+    // expected output: pkt_in_batch, and whether it's a placeholder
+    std::vector< std::pair< uint32_t, bool > > t_expected = {
+            { t_last - 2, false }, { t_last - 1, false }, { t_last, false }, { 0, false }, { 1, false }, { 2, false }, { 3, false } };
+    if( a_fill_gaps ) t_expected.push_back( { 4, true } );
+    for( uint32_t t_pkt_in_batch : { 5, 6, 7, 8, 30, 31, 32 } ) t_expected.push_back( { t_pkt_in_batch, false } );
+
+    midge::diptera* t_root = new midge::diptera();
+
+    sequence_producer* t_producer = new sequence_producer();
+    t_producer->set_name( "prod" );
+    t_producer->sequence() = t_sequence;
+    t_root->add( t_producer );
+
+    time_data_reorder* t_reorder = new time_data_reorder();
+    t_reorder->set_name( "reorder" );
+    t_reorder->set_window( 4 );
+    t_reorder->set_max_gap( 8 );
+    t_reorder->set_fill_gaps( a_fill_gaps );
+    t_root->add( t_reorder );
+
+    packet_recorder* t_recorder = new packet_recorder();
+    t_recorder->set_name( "rec" );
+    t_root->add( t_recorder );
+
+    t_root->join( "prod.out_0:reorder.in_0" );
+    t_root->join( "reorder.out_0:rec.in_0" );
+
+    std::exception_ptr t_e_ptr = t_root->run( "prod:reorder:rec" );
+    if( t_e_ptr ) std::rethrow_exception( t_e_ptr );
+
+    unsigned t_n_failures = 0;
+
+    const std::vector< output_packet >& t_output = t_recorder->packets();
+    if( t_output.size() != t_expected.size() )
+    {
+        LERROR( plog, a_name << ": " << t_output.size() << " packets were output; expected " << t_expected.size() );
+        ++t_n_failures;
+    }
+    for( unsigned i_packet = 0; i_packet < std::min( t_output.size(), t_expected.size() ); ++i_packet )
+    {
+        const output_packet& t_packet = t_output[ i_packet ];
+        int8_t t_marker = t_expected[ i_packet ].second ? 0 : payload_marker( t_expected[ i_packet ].first );
+        if( t_packet.f_pkt_in_batch != t_expected[ i_packet ].first || t_packet.f_placeholder != t_expected[ i_packet ].second
+                || t_packet.f_pkt_in_session != i_packet || t_packet.f_marker != t_marker )
+        {
+            LERROR( plog, a_name << ": output packet " << i_packet << " has pkt_in_batch " << t_packet.f_pkt_in_batch << ", pkt_in_session " << t_packet.f_pkt_in_session
+                    << ", placeholder " << t_packet.f_placeholder << " and payload marker " << int(t_packet.f_marker) << "; expected " << t_expected[ i_packet ].first
+                    << ", " << i_packet << ", " << t_expected[ i_packet ].second << " and " << int(t_marker) );
+            ++t_n_failures;
+        }
+    }
+
+    struct count_check
+    {
+        std::string f_description;
+        uint64_t f_count;
+        uint64_t f_expected;
+    };
+    std::vector< count_check > t_counts = {
+            { "received", t_reorder->get_packets_in(), t_sequence.size() },
+            { "put back in order", t_reorder->get_packets_reordered(), 4 }, // t_last - 1, 0, 2, 31
+            { "dropped as late", t_reorder->get_packets_late(), 1 },
+            { "dropped as duplicates", t_reorder->get_packets_duplicate(), 1 },
+            { "missing", t_reorder->get_packets_missing(), 1 },
+            { "placeholders", t_reorder->get_placeholders(), a_fill_gaps ? 1U : 0U },
+            { "sequence restarts", t_reorder->get_restarts(), 1 }
+    };
+    for( const count_check& t_count : t_counts )
+    {
+        if( t_count.f_count != t_count.f_expected )
+        {
+            LERROR( plog, a_name << ": " << t_count.f_count << " packets " << t_count.f_description << "; expected " << t_count.f_expected );
+            ++t_n_failures;
+        }
+    }
+
+    delete t_root;
+
+    LINFO( plog, a_name << ": " << t_n_failures << " failures" );
+    return t_n_failures;
+}
+
+int main()
+{
+    try
+    {
+        unsigned t_n_failures = 0;
+        t_n_failures += check_sequence( "Without gap filling", false );
+        t_n_failures += check_sequence( "With gap filling", true );
+
+        if( t_n_failures != 0 )
+        {
+            LERROR( plog, "Packet reorder check failed: " << t_n_failures << " failures" );
+            return -1;
+        }
+
+        LINFO( plog, "Packet reorder check passed" );
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
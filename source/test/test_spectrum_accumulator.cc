@@ -0,0 +1,176 @@
+/*
+ * test_spectrum_accumulator.cc
+ *
+ *  Created on: Oct 18, 2026
+ *      Author: nsoblath
+ *
+ *  Checks the power sums of spectrum_accumulator (as used by spectrum_integrator).
+ *
+ *  Random frequency packets (including bins at the extremes of the int8 range) are accumulated with and without the SIMD kernel,
+ *  over enough packets that the uint32 sums are folded into the totals.  Both averages must match a reference computed
+ *  in double precision, for a spectrum size that is a multiple of the kernel width and one that isn't.
+ *  Then the packet rate of add() is measured with each kernel.
+ *
+ *  Usage: > test_spectrum_accumulator [options]
+ *
+ *  Parameters:
+ *    - n-packets: (uint) number of packets to accumulate; default is 70000 (more than one fold interval)
+ *    - n-iterations: (uint) number of packets to accumulate when timing each kernel; default is 100000
+ *    - n-bins: (uint) number of bins per packet; default is 4096
+ *
+ *  Returns a nonzero value if the averages don't agree as described above.
+ */
+
+#include "spectrum_accumulator.hh"
+#include "psyllid_error.hh"
+
+#include "configurator.hh"
+#include "logger.hh"
+#include "param.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace psyllid;
+
+LOGGER( plog, "test_spectrum_accumulator" );
+
+/// Accumulates a_n_packets packets (cycling through a_packets) with and without the SIMD kernel, and compares both to the reference; returns the number of failures
+unsigned check_accumulator( unsigned a_n_bins, const std::vector< int8_t >& a_packets, unsigned a_n_distinct, unsigned a_n_packets )
+{
+    unsigned t_n_values = 2 * a_n_bins;
+
+    std::vector< double > t_reference( a_n_bins, 0. );
+    for( unsigned i_packet = 0; i_packet < a_n_packets; ++i_packet )
+    {
+        const int8_t* t_packet = &a_packets[ size_t( i_packet % a_n_distinct ) * t_n_values ];
+        for( unsigned i_bin = 0; i_bin < a_n_bins; ++i_bin )
+        {
+            double t_real = t_packet[ 2 * i_bin ];
+            double t_imag = t_packet[ 2 * i_bin + 1 ];
+            t_reference[ i_bin ] += t_real * t_real + t_imag * t_imag;
+        }
+    }
+    for( double& t_value : t_reference ) t_value /= double(a_n_packets);
+
+    unsigned t_n_failures = 0;
+    for( bool t_use_simd : { false, true } )
+    {
+        if( t_use_simd && ! spectrum_accumulator::simd_kernels_available() ) continue;
+
+        spectrum_accumulator t_accumulator( a_n_bins );
+        t_accumulator.set_use_simd( t_use_simd );
+        for( unsigned i_packet = 0; i_packet < a_n_packets; ++i_packet )
+        {
+            t_accumulator.add( &a_packets[ size_t( i_packet % a_n_distinct ) * t_n_values ] );
+        }
+
+        std::vector< float > t_average( a_n_bins );
+        t_accumulator.average( t_average.data() );
+
+        unsigned t_n_bad_bins = 0;
+        for( unsigned i_bin = 0; i_bin < a_n_bins; ++i_bin )
+        {
+            // the average is a float, so it's good to about one part in 10^7
+            if( std::abs( double(t_average[ i_bin ]) - t_reference[ i_bin ] ) > 1.e-6 * t_reference[ i_bin ] + 1.e-6 ) ++t_n_bad_bins;
+        }
+        LINFO( plog, a_n_bins << " bins, " << ( t_use_simd ? "SIMD" : "scalar" ) << " kernel: " << t_n_bad_bins << " bins differ from the reference" );
+        if( t_n_bad_bins != 0 ) ++t_n_failures;
+        if( t_accumulator.get_n_packets() != a_n_packets )
+        {
+            LERROR( plog, "Accumulated " << t_accumulator.get_n_packets() << " packets instead of " << a_n_packets );
+            ++t_n_failures;
+        }
+    }
+    return t_n_failures;
+}
+
+/// Returns the packet rate of add() over a_n_iterations packets
+double time_accumulator( spectrum_accumulator& a_accumulator, const std::vector< int8_t >& a_packets, unsigned a_n_distinct, unsigned a_n_iterations )
+{
+    unsigned t_n_values = 2 * a_accumulator.get_n_bins();
+    std::chrono::steady_clock::time_point t_start = std::chrono::steady_clock::now();
+    for( unsigned i_packet = 0; i_packet < a_n_iterations; ++i_packet )
+    {
+        a_accumulator.add( &a_packets[ size_t( i_packet % a_n_distinct ) * t_n_values ] );
+    }
+    double t_seconds = std::chrono::duration< double >( std::chrono::steady_clock::now() - t_start ).count();
+    return double(a_n_iterations) / t_seconds;
+}
+
+int main( int argc, char** argv )
+{
+    try
+    {
+        scarab::param_node t_default_config;
+        t_default_config.add( "n-packets", scarab::param_value( 70000 ) );
+        t_default_config.add( "n-iterations", scarab::param_value( 100000 ) );
+        t_default_config.add( "n-bins", scarab::param_value( 4096 ) );
+
+        scarab::configurator t_configurator( argc, argv, t_default_config );
+
+        unsigned t_n_packets = std::max( t_configurator.get< unsigned >( "n-packets" ), 1U );
+        unsigned t_n_iterations = std::max( t_configurator.get< unsigned >( "n-iterations" ), 1U );
+        unsigned t_n_bins = std::max( t_configurator.get< unsigned >( "n-bins" ), 1U );
+
+        // a pool of distinct packets to cycle through; every 7th packet has a bin at each extreme of the int8 range
+        const unsigned t_n_distinct = 100;
+        unsigned t_max_bins = t_n_bins + 7;
+        std::mt19937 t_generator( 20261018 );
+        std::uniform_int_distribution< int > t_value( -128, 127 );
+        std::vector< int8_t > t_packets( size_t(t_n_distinct) * 2 * t_max_bins );
+        for( int8_t& t_sample : t_packets ) t_sample = int8_t( t_value( t_generator ) );
+        for( unsigned i_packet = 0; i_packet < t_n_distinct; i_packet += 7 )
+        {
+            t_packets[ size_t(i_packet) * 2 * t_max_bins ] = -128;
+            t_packets[ size_t(i_packet) * 2 * t_max_bins + 1 ] = -128;
+            t_packets[ size_t(i_packet) * 2 * t_max_bins + 2 ] = 127;
+            t_packets[ size_t(i_packet) * 2 * t_max_bins + 3 ] = -128;
+        }
+
+        LINFO( plog, "SIMD kernel is " << ( spectrum_accumulator::simd_kernels_available() ? "" : "not " ) << "available; "
+                << "the sums are folded every " << spectrum_accumulator::fold_interval() << " packets" );
+
+        unsigned t_n_failures = 0;
+        // the same packets with n-bins bins (the first n-bins of each)
+        std::vector< int8_t > t_compact( size_t(t_n_distinct) * 2 * t_n_bins );
+        for( unsigned i_packet = 0; i_packet < t_n_distinct; ++i_packet )
+        {
+            std::copy( &t_packets[ size_t(i_packet) * 2 * t_max_bins ], &t_packets[ size_t(i_packet) * 2 * t_max_bins ] + 2 * t_n_bins, &t_compact[ size_t(i_packet) * 2 * t_n_bins ] );
+        }
+        t_n_failures += check_accumulator( t_n_bins, t_compact, t_n_distinct, t_n_packets );
+        t_n_failures += check_accumulator( t_max_bins, t_packets, t_n_distinct, t_n_packets );
+        // fully saturated bins, for long enough that the uint32 sums would overflow without folding
+        std::vector< int8_t > t_saturated( 2 * t_n_bins, -128 );
+        t_n_failures += check_accumulator( t_n_bins, t_saturated, 1, 2 * spectrum_accumulator::fold_interval() + 5 );
+
+        if( t_n_failures != 0 )
+        {
+            LERROR( plog, "Accumulator check failed" );
+            return -1;
+        }
+
+        spectrum_accumulator t_accumulator( t_n_bins );
+        t_accumulator.set_use_simd( false );
+        double t_scalar_rate = time_accumulator( t_accumulator, t_compact, t_n_distinct, t_n_iterations );
+        LINFO( plog, "Scalar kernel: " << t_scalar_rate << " packets/s" );
+
+        if( spectrum_accumulator::simd_kernels_available() )
+        {
+            t_accumulator.clear();
+            t_accumulator.set_use_simd( true );
+            double t_simd_rate = time_accumulator( t_accumulator, t_compact, t_n_distinct, t_n_iterations );
+            LINFO( plog, "SIMD kernel: " << t_simd_rate << " packets/s (" << t_simd_rate / t_scalar_rate << " x scalar)" );
+        }
+
+        return 0;
+    }
+    catch( std::exception& e )
+    {
+        LERROR( plog, "Exception caught: " << e.what() );
+        return -1;
+    }
+}
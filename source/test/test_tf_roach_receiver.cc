@@ -13,6 +13,7 @@
  *    - interface: (string) network interface name to listen on for packets; this is only needed if using the FPA receiver; default is "eth1"
  *    - ip: (string) IP address to listen on for packets; this is only needed if using the socket receiver; default is "127.0.0.1"
  *    - fpa: (null) Flag to request use of the FPA receiver; only valid on linux machines
+ *    - xdp: (null) Flag to request use of the AF_XDP receiver (in copy mode, so a veth pair can be used); only valid if built with XDP
  */
 
 
@@ -25,6 +26,10 @@
 #include "packet_receiver_fpa.hh"
 #endif
 
+#ifdef BUILD_XDP
+#include "packet_receiver_xdp.hh"
+#endif
+
 #include "diptera.hh"
 
 #include "configurator.hh"
@@ -61,6 +66,7 @@ int main( int argc, char** argv )
         unsigned t_port = t_configurator.get< unsigned >( "port" );
         std::string t_interface( t_configurator.get< std::string >( "interface" ) );
         bool t_use_fpa( t_configurator.config().has( "fpa" ) );
+        bool t_use_xdp( t_configurator.config().has( "xdp" ) );
 
         LINFO( plog, "Creating and configuring nodes" );
 
@@ -79,6 +85,22 @@ int main( int argc, char** argv )
 #else
             LERROR( plog, "FPA was requested, but is only available on a Linux machine" );
             return -1;
+#endif
+        }
+        else if( t_use_xdp )
+        {
+#ifdef BUILD_XDP
+            packet_receiver_xdp* t_pck_rec = new packet_receiver_xdp();
+            t_pck_rec->set_name( "pck_rec" );
+            t_pck_rec->set_length( 10 );
+            t_pck_rec->set_port( t_port );
+            t_pck_rec->interface() = t_interface;
+            t_pck_rec->xdp_mode() = "copy";
+            t_root->add( t_pck_rec );
+            f_cancelable = t_pck_rec;
+#else
+            LERROR( plog, "XDP was requested, but psyllid was not built with XDP enabled" );
+            return -1;
 #endif
         }
         else
@@ -3,6 +3,16 @@
  *
  *  Created on: Sep 2, 2016
  *      Author: nsoblath
+ *
+ *  Usage: > test_tpacket_v3 [-t RETIRE_TOV_MS] [-s SPIN_COUNT] [-b BUSY_POLL_USEC] INTERFACE
+ *
+ *  Options:
+ *    -t: block retire timeout in ms (tp_retire_blk_tov); default is 60
+ *    -s: number of times to check a block in user space before falling back to poll(); default is 0
+ *    -b: SO_BUSY_POLL value in microseconds; default is 0 (off)
+ *
+ *  Latency benchmark: for every packet the time from frame arrival (the kernel's tp_sec/tp_nsec timestamp)
+ *  to the packet being walked is recorded; the min/mean/max and a histogram are printed on exit (ctrl-c).
  */
 
 /* Written from scratch, but kernel-to-user space API usage
@@ -23,6 +33,7 @@
 #include <unistd.h>
 #include <signal.h>
 #include <inttypes.h>
+#include <time.h>
 #include <sys/socket.h>
 #include <sys/mman.h>
 #include <linux/if_packet.h>
@@ -51,6 +62,13 @@ struct ring {
 static unsigned long packets_total = 0, bytes_total = 0;
 static sig_atomic_t sigint = 0;
 
+static unsigned int retire_tov = 60, spin_count = 0, busy_poll_usec = 0;
+
+// latency from frame arrival to walking, in ns; histogram bins are powers of 2 in us
+#define N_LATENCY_BINS 24
+static uint64_t latency_min = UINT64_MAX, latency_max = 0, latency_sum = 0, latency_n = 0;
+static uint64_t latency_hist[N_LATENCY_BINS];
+
 static void sighandler(int /*num*/)
 {
     sigint = 1;
@@ -81,7 +99,7 @@ static int setup_socket(ring *ring, char *netdev)
     ring->req.tp_frame_size = framesiz;
     ring->req.tp_block_nr = blocknum;
     ring->req.tp_frame_nr = (blocksiz * blocknum) / framesiz;
-    ring->req.tp_retire_blk_tov = 60;
+    ring->req.tp_retire_blk_tov = retire_tov;
     ring->req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
 
     err = setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &ring->req,
@@ -119,6 +137,14 @@ static int setup_socket(ring *ring, char *netdev)
         exit(1);
     }
 
+    if (busy_poll_usec > 0) {
+        err = setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &busy_poll_usec, sizeof(busy_poll_usec));
+        if (err < 0) {
+            perror("setsockopt(SO_BUSY_POLL)");
+            exit(1);
+        }
+    }
+
     return fd;
 }
 
@@ -156,16 +182,54 @@ static void display(tpacket3_hdr *ppd)
     //printf("\n");
 }
 
+static void record_latency(const tpacket3_hdr *ppd, const timespec *now)
+{
+    int64_t latency = (int64_t)(now->tv_sec - ppd->tp_sec) * 1000000000 + ((int64_t)now->tv_nsec - ppd->tp_nsec);
+    if (latency < 0) latency = 0;
+
+    if ((uint64_t)latency < latency_min) latency_min = latency;
+    if ((uint64_t)latency > latency_max) latency_max = latency;
+    latency_sum += latency;
+    ++latency_n;
+
+    unsigned bin = 0;
+    for (uint64_t us = latency / 1000; us > 0 && bin < N_LATENCY_BINS - 1; us >>= 1) ++bin;
+    ++latency_hist[bin];
+}
+
+static void print_latency()
+{
+    unsigned bin;
+
+    if (latency_n == 0) {
+        printf("No packets were walked; no latency to report\n");
+        return;
+    }
+
+    printf("\nFrame-arrival-to-walk latency (%" PRIu64 " packets): min %.1f us; mean %.1f us; max %.1f us\n",
+           latency_n, latency_min / 1000., latency_sum / 1000. / latency_n, latency_max / 1000.);
+    for (bin = 0; bin < N_LATENCY_BINS; ++bin) {
+        if (latency_hist[bin] == 0) continue;
+        if (bin == 0) printf("  < 1 us: %" PRIu64 "\n", latency_hist[bin]);
+        else printf("  %u - %u us: %" PRIu64 "\n", 1u << (bin - 1), 1u << bin, latency_hist[bin]);
+    }
+}
+
 static void walk_block(block_desc *pbd, const int /*block_num*/)
 {
     int num_pkts = pbd->h1.num_pkts, i;
     unsigned long bytes = 0;
     tpacket3_hdr *ppd;
+    timespec now;
+
+    // one timestamp per block: the packets in the block are all walked now
+    clock_gettime(CLOCK_REALTIME, &now);
 
     ppd = (tpacket3_hdr *) ((uint8_t *) pbd +
                        pbd->h1.offset_to_first_pkt);
     for (i = 0; i < num_pkts; ++i) {
         bytes += ppd->tp_snaplen;
+        record_latency(ppd, &now);
         display(ppd);
 
         ppd = (tpacket3_hdr *) ((uint8_t *) ppd +
@@ -190,7 +254,8 @@ static void teardown_socket(ring *ring, int fd)
 
 int main(int argc, char **argp)
 {
-    int fd, err;
+    int fd, err, opt;
+    unsigned int spins = 0;
     socklen_t len;
     ring ring;
     pollfd pfd;
@@ -198,11 +263,24 @@ int main(int argc, char **argp)
     block_desc *pbd;
     tpacket_stats_v3 stats;
 
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s INTERFACE\n", argp[0]);
+    while ((opt = getopt(argc, argp, "t:s:b:")) != -1) {
+        switch (opt) {
+        case 't': retire_tov = strtoul(optarg, NULL, 0); break;
+        case 's': spin_count = strtoul(optarg, NULL, 0); break;
+        case 'b': busy_poll_usec = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "Usage: %s [-t RETIRE_TOV_MS] [-s SPIN_COUNT] [-b BUSY_POLL_USEC] INTERFACE\n", argp[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-t RETIRE_TOV_MS] [-s SPIN_COUNT] [-b BUSY_POLL_USEC] INTERFACE\n", argp[0]);
         return EXIT_FAILURE;
     }
 
+    printf("retire timeout: %u ms; spin count: %u; busy poll: %u us\n", retire_tov, spin_count, busy_poll_usec);
+
     signal(SIGINT, sighandler);
 
     printf("setting up socket\n");
@@ -220,10 +298,16 @@ int main(int argc, char **argp)
     while (likely(!sigint)) {
         pbd = (block_desc *) ring.rd[block_num].iov_base;
 
-        if ((pbd->h1.block_status & TP_STATUS_USER) == 0) {
+        if ((__atomic_load_n(&pbd->h1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            if (spins < spin_count) {
+                ++spins;
+                continue;
+            }
+            spins = 0;
             poll(&pfd, 1, -1);
             continue;
         }
+        spins = 0;
 
         walk_block(pbd, block_num);
         flush_block(pbd);
@@ -243,6 +327,8 @@ int main(int argc, char **argp)
            stats.tp_packets, bytes_total, stats.tp_drops,
            stats.tp_freeze_q_cnt);
 
+    print_latency();
+
     teardown_socket(&ring, fd);
     return 0;
 }